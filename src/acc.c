@@ -0,0 +1,113 @@
+/** @file
+    Implementacja akumulatora długich sum wielomianów
+
+    @author Aliaksandr Sarokin <as372525@students.mimuw.edu.pl>
+    @copyright Uniwersytet Warszawski
+    @date 2017-06-03
+*/
+
+#include <assert.h>
+
+#include "acc.h"
+#include "tree.h"
+
+/**
+ * Wyznacza kubełek dla niezerowego wielomianu: podłogę z logarytmu
+ * liczby jego wyrazów najwyższego poziomu.
+ * @param[in] p : niezerowy wielomian
+ * @return indeks kubełka
+ */
+static unsigned AccLevel(const Poly *p)
+{
+    unsigned size, level = 0;
+
+    if (PolyIsCoeff(p))
+        size = 1;
+    else if (PolyIsTree(p))
+        size = TreeSize(NodeTree(p->l));
+    else
+        size = ListLen(p->l);
+
+    while (size > 1)
+    {
+        size >>= 1;
+        level++;
+    }
+    assert(level < ACC_BUCKETS);
+
+    return level;
+}
+
+PolyAccumulator PolyAccInit(void)
+{
+    PolyAccumulator acc;
+
+    for (unsigned i = 0; i < ACC_BUCKETS; i++)
+        acc.buckets[i] = PolyZero();
+
+    return acc;
+}
+
+bool PolyAccIsEmpty(const PolyAccumulator *acc)
+{
+    for (unsigned i = 0; i < ACC_BUCKETS; i++)
+    {
+        if (!PolyIsZero(&acc->buckets[i]))
+            return false;
+    }
+
+    return true;
+}
+
+void PolyAccPush(PolyAccumulator *acc, Poly p)
+{
+    while (!PolyIsZero(&p))
+    {
+        Poly *bucket = &acc->buckets[AccLevel(&p)];
+
+        if (PolyIsZero(bucket))
+        {
+            *bucket = p;
+            return;
+        }
+
+        Poly sum = PolyAdd(bucket, &p);
+
+        PolyDestroy(bucket);
+        PolyDestroy(&p);
+        *bucket = PolyZero();
+        p = sum;
+    }
+}
+
+Poly PolyAccFlush(PolyAccumulator *acc)
+{
+    Poly parts[ACC_BUCKETS];
+    unsigned count = 0;
+
+    for (unsigned i = 0; i < ACC_BUCKETS; i++)
+    {
+        if (!PolyIsZero(&acc->buckets[i]))
+            parts[count++] = acc->buckets[i];
+        acc->buckets[i] = PolyZero();
+    }
+
+    if (count == 1)
+        return parts[0];
+
+    Poly res = PolyAddAll(count, parts, NULL);
+
+    for (unsigned i = 0; i < count; i++)
+        PolyDestroy(&parts[i]);
+
+    return res;
+}
+
+void PolyAccDestroy(PolyAccumulator *acc)
+{
+    for (unsigned i = 0; i < ACC_BUCKETS; i++)
+    {
+        PolyDestroy(&acc->buckets[i]);
+        acc->buckets[i] = PolyZero();
+    }
+}
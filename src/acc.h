@@ -0,0 +1,65 @@
+/** @file
+    Interfejs akumulatora długich sum wielomianów
+
+    Akumulator trzyma sumy częściowe w kubełkach o rosnących rozmiarach,
+    jak drzewo LSM: kubełek @f$k@f$ trzyma sumę o co najmniej @f$2^k@f$ i
+    mniej niż @f$2^{k+1}@f$ wyrazach. Dodawany wielomian trafia do kubełka
+    swojego rozmiaru; zajęty kubełek jest z nim scalany, a suma idzie dalej,
+    więc sumy są scalane tylko wtedy, gdy ich rozmiar się podwaja. Każdy
+    wyraz bierze udział w co najwyżej logarytmicznie wielu scaleniach, zamiast
+    w scaleniu z całą dotychczasową sumą przy każdym dodawaniu.
+
+    @author Aliaksandr Sarokin <as372525@students.mimuw.edu.pl>
+    @copyright Uniwersytet Warszawski
+    @date 2017-06-03
+*/
+
+#ifndef __ACC_H__
+#define __ACC_H__
+
+#include "poly.h"
+
+/** Liczba kubełków; wystarcza dla każdej liczby wyrazów typu `unsigned` */
+#define ACC_BUCKETS 33
+
+/** Akumulator sumy wielomianów */
+typedef struct PolyAccumulator
+{
+    Poly buckets[ACC_BUCKETS]; ///< sumy częściowe, zerowe w pustych kubełkach
+} PolyAccumulator;
+
+/**
+ * Tworzy pusty akumulator.
+ * @return akumulator o sumie zero
+ */
+PolyAccumulator PolyAccInit(void);
+
+/**
+ * Sprawdza, czy akumulator jest pusty.
+ * @param[in] acc : akumulator
+ * @return czy suma akumulatora jest zerem
+ */
+bool PolyAccIsEmpty(const PolyAccumulator *acc);
+
+/**
+ * Dodaje wielomian do sumy akumulatora. Przejmuje wielomian na własność.
+ * @param[in,out] acc : akumulator
+ * @param[in] p : składnik
+ */
+void PolyAccPush(PolyAccumulator *acc, Poly p);
+
+/**
+ * Daje sumę wszystkich dodanych wielomianów i opróżnia akumulator.
+ * Kubełki są sumowane jednym scalaniem (patrz `PolyAddAll`).
+ * @param[in,out] acc : akumulator
+ * @return suma
+ */
+Poly PolyAccFlush(PolyAccumulator *acc);
+
+/**
+ * Usuwa sumy częściowe akumulatora z pamięci i opróżnia go.
+ * @param[in,out] acc : akumulator
+ */
+void PolyAccDestroy(PolyAccumulator *acc);
+
+#endif /* __ACC_H__ */
@@ -7,6 +7,10 @@
     @date 2017-06-03
  */
 
+#include <stdlib.h>
+#include <assert.h>
+
+#include "acc.h"
 #include "parse.h"
 #include "stack.h"
 #include "utils.h"
@@ -14,6 +18,197 @@
 /** Nieskończona pętla */
 #define FOREVER while (1)
 
+/** Ograniczenia stopni zmiennych w trybie szeregów */
+static PolyBound series = {.vars = 0, .max = NULL, .total = -1};
+
+/** Tablica ograniczeń `series.max` */
+static poly_exp_t *series_max = NULL;
+
+/**
+ * Sprawdza, czy kalkulator jest w trybie szeregów.
+ * @return czy stopień którejś zmiennej jest ograniczony
+ */
+static inline bool SeriesActive(void)
+{
+    return series.vars > 0;
+}
+
+/**
+ * Obcina wielomian do ograniczeń trybu szeregów.
+ * @param[in] p : wielomian
+ * @return obcięty wielomian
+ */
+static Poly SeriesTrunc(const Poly *p)
+{
+    return PolyTrunc(p, &series);
+}
+
+/**
+ * Obcina wielomian na szczycie stosu, jeśli kalkulator jest w trybie
+ * szeregów.
+ * @param[in,out] stack : stos
+ */
+static void SeriesTruncTop(Stack *stack)
+{
+    if (!SeriesActive())
+        return;
+
+    Poly p = StackPop(stack);
+
+    StackPush(stack, SeriesTrunc(&p));
+    PolyDestroy(&p);
+}
+
+/**
+ * Ustawia ograniczenie stopnia zmiennej i obcina wielomiany na stosie.
+ * @param[in,out] stack : stos
+ * @param[in] var : indeks zmiennej
+ * @param[in] deg : ograniczenie stopnia, -1 gdy brak
+ */
+static void SeriesSet(Stack stack, unsigned var, poly_exp_t deg)
+{
+    if (var >= series.vars)
+    {
+        if (deg < 0)
+            return;
+
+        series_max = realloc(series_max, (var + 1) * sizeof(poly_exp_t));
+        assert(series_max != NULL);
+        for (unsigned i = series.vars; i < var; i++)
+            series_max[i] = -1;
+        series.vars = var + 1;
+        series.max = series_max;
+    }
+
+    series_max[var] = deg;
+    while (series.vars > 0 && series_max[series.vars - 1] < 0)
+        series.vars--;
+
+    if (deg >= 0)
+        StackMap(stack, SeriesTrunc);
+}
+
+/**
+ * Przenumerowuje ograniczenia stopni razem ze zmiennymi: ograniczenie
+ * zmiennej @f$x_i@f$ przechodzi na zmienną @f$x_{perm[i]}@f$.
+ * @param[in] count : długość @p perm
+ * @param[in] perm : permutacja zbioru @f$\{0, \ldots, count - 1\}@f$
+ */
+static void SeriesPermute(unsigned count, const unsigned perm[])
+{
+    if (!SeriesActive())
+        return;
+
+    unsigned n = series.vars < count ? count : series.vars;
+    poly_exp_t *max = malloc(n * sizeof(poly_exp_t));
+    assert(max != NULL);
+
+    for (unsigned i = 0; i < n; i++)
+        max[i < count ? perm[i] : i] = i < series.vars ? series_max[i] : -1;
+
+    free(series_max);
+    series_max = max;
+    series.max = max;
+    series.vars = n;
+    while (series.vars > 0 && series_max[series.vars - 1] < 0)
+        series.vars--;
+}
+
+/**
+ * Dołącza kolejne przenumerowanie zmiennych do dotychczasowych.
+ * @param[in,out] order : indeksy, pod którymi są teraz kolejne zmienne
+ * sprzed pierwszego przenumerowania
+ * @param[in,out] vars : długość @p order
+ * @param[in] perm : nowe indeksy zmiennych
+ * @param[in] count : długość @p perm
+ */
+static void OrderCompose(unsigned **order, unsigned *vars, const unsigned perm[],
+                         unsigned count)
+{
+    unsigned n = *vars < count ? count : *vars;
+
+    *order = realloc(*order, (n + 1) * sizeof(unsigned));
+    assert(*order != NULL);
+
+    for (unsigned i = *vars; i < n; i++)
+        (*order)[i] = i;
+    for (unsigned i = 0; i < n; i++)
+    {
+        if ((*order)[i] < count)
+            (*order)[i] = perm[(*order)[i]];
+    }
+
+    *vars = n;
+}
+
+/**
+ * Przywraca zmiennym wielomianów na stosie i ograniczeniom stopni trybu
+ * szeregów indeksy sprzed wszystkich przenumerowań.
+ * @param[in,out] stack : stos
+ * @param[in,out] order : indeksy, pod którymi są teraz kolejne zmienne
+ * @param[in,out] vars : długość @p order
+ */
+static void OrderRestore(Stack stack, unsigned **order, unsigned *vars)
+{
+    unsigned *inv = malloc((*vars + 1) * sizeof(unsigned));
+    assert(inv != NULL);
+
+    for (unsigned i = 0; i < *vars; i++)
+        inv[(*order)[i]] = i;
+
+    StackPermute(stack, *vars, inv);
+    SeriesPermute(*vars, inv);
+
+    free(inv);
+    free(*order);
+    *order = NULL;
+    *vars = 0;
+}
+
+/** Czy kalkulator jest w trybie leniwym */
+static bool lazy = false;
+
+/**
+ * Sprawdza, czy `ADD`, `SUB`, `NEG`, `MUL` i `CLONE` budują wyrażenia.
+ * W trybie szeregów mnożenie obcina wynik do bieżących ograniczeń, więc
+ * wyrażenia są wtedy liczone od razu.
+ * @return czy kalkulator jest w trybie leniwym poza trybem szeregów
+ */
+static inline bool LazyActive(void)
+{
+    return lazy && !SeriesActive();
+}
+
+/** Akumulator poleceń `ACC_PUSH` i `ACC_FLUSH` */
+static PolyAccumulator acc = {.buckets = {{.c = 0, .l = NULL}}};
+
+/**
+ * Sprawdza, czy polecenie zmienia wszystkie wielomiany na stosie. Takie
+ * polecenie musi zmienić także sumę w akumulatorze.
+ * @param[in] command : polecenie
+ * @return czy polecenie działa na całym stosie
+ */
+static bool CommandMapsStack(Command command)
+{
+    return command == MOD || command == INTERN || command == SERIES
+           || command == REORDER || command == RESTORE;
+}
+
+/**
+ * Przenosi sumę z akumulatora na szczyt stosu, jeśli akumulator nie jest
+ * pusty.
+ * @param[in,out] stack : stos
+ * @return czy suma została przeniesiona
+ */
+static bool AccToStack(Stack *stack)
+{
+    if (PolyAccIsEmpty(&acc))
+        return false;
+
+    StackPush(stack, PolyAccFlush(&acc));
+    return true;
+}
+
 /**
  * Funkcja główna.
  * Program zakończy swoje działanie, gdy wczyta EOF.
@@ -25,13 +220,16 @@ int main(void)
     Command command;
     Stack stack = StackInit();
     unsigned row = 0, col = 0;
+    unsigned *order = NULL, order_vars = 0;
+    poly_exp_t deg = -1;
     do
     {
         row++;
-        switch (ParseLineRead(&s, &command, &col))
+        switch (ParseLineRead(&s, &command, &col, &deg))
         {
             case POLY:
                 StackPush(&stack, s);
+                SeriesTruncTop(&stack);
                 s = PolyZero();
                 break;
             case WRONGPOLY:
@@ -54,6 +252,14 @@ int main(void)
                 ErrorWrongCount(row);
                 s = PolyZero();
                 break;
+            case WRONGMODULUS:
+                ErrorWrongModulus(row);
+                s = PolyZero();
+                break;
+            case WRONGEXPONENT:
+                ErrorWrongExponent(row);
+                s = PolyZero();
+                break;
             case COMMAND:
                 if (StackIsSmallerThan(stack, ParseNeededArguments(&s, command)))
                 {
@@ -61,6 +267,8 @@ int main(void)
                     break;
                 }
 
+                bool acc_moved = CommandMapsStack(command) && AccToStack(&stack);
+
                 switch (command)
                 {
                     case ZERO:
@@ -77,45 +285,72 @@ int main(void)
                         StackPush(&stack, p);
                         break;
                     case CLONE:
+                        if (LazyActive())
+                        {
+                            Expr *e = StackPopExpr(&stack);
+                            StackPushExpr(&stack, ExprRetain(e));
+                            StackPushExpr(&stack, e);
+                            break;
+                        }
                         p = StackPop(&stack);
                         q = PolyClone(&p);
                         StackPush(&stack, p);
                         StackPush(&stack, q);
                         break;
                     case ADD:
+                    case SUB:
+                        if (LazyActive())
+                        {
+                            Expr *a = StackPopExpr(&stack);
+                            Expr *b = StackPopExpr(&stack);
+                            StackPushExpr(&stack, ExprAdd(a, b, command == SUB));
+                            break;
+                        }
                         p = StackPop(&stack);
                         q = StackPop(&stack);
-                        r = PolyAdd(&p, &q);
+                        r = command == SUB ? PolySub(&p, &q) : PolyAdd(&p, &q);
                         StackPush(&stack, r);
                         PolyDestroy(&p);
                         PolyDestroy(&q);
                         break;
                     case MUL:
+                        if (LazyActive())
+                        {
+                            Expr *a = StackPopExpr(&stack);
+                            Expr *b = StackPopExpr(&stack);
+                            StackPushExpr(&stack, ExprMul(a, b));
+                            break;
+                        }
                         p = StackPop(&stack);
                         q = StackPop(&stack);
-                        r = PolyMul(&p, &q);
+                        r = SeriesActive() ? PolyMulTrunc(&p, &q, &series)
+                                           : PolyMul(&p, &q);
                         StackPush(&stack, r);
                         PolyDestroy(&p);
                         PolyDestroy(&q);
                         break;
                     case NEG:
+                        if (LazyActive())
+                        {
+                            StackPushExpr(&stack, ExprNeg(StackPopExpr(&stack)));
+                            break;
+                        }
                         p = StackPop(&stack);
                         q = PolyNeg(&p);
                         StackPush(&stack, q);
                         PolyDestroy(&p);
                         break;
-                    case SUB:
+                    case IS_EQ:
                         p = StackPop(&stack);
                         q = StackPop(&stack);
-                        r = PolySub(&p, &q);
-                        StackPush(&stack, r);
-                        PolyDestroy(&p);
-                        PolyDestroy(&q);
+                        printf("%d\n", PolyIsEq(&p, &q));
+                        StackPush(&stack, q);
+                        StackPush(&stack, p);
                         break;
-                    case IS_EQ:
+                    case IS_EQ_FAST:
                         p = StackPop(&stack);
                         q = StackPop(&stack);
-                        printf("%d\n", PolyIsEq(&p, &q));
+                        printf("%d\n", PolyIsEqFast(&p, &q));
                         StackPush(&stack, q);
                         StackPush(&stack, p);
                         break;
@@ -134,6 +369,7 @@ int main(void)
                         q = PolyAt(&p, s.c);
                         PolyDestroy(&p);
                         StackPush(&stack, q);
+                        SeriesTruncTop(&stack);
                         break;
                     case PRINT:
                         p = StackPop(&stack);
@@ -150,11 +386,188 @@ int main(void)
                         StackPush(&stack, PolyCompose(&p, (unsigned)s.c, x));
                         PolyArrayDestroy((unsigned)s.c, x);
                         PolyDestroy(&p);
+                        SeriesTruncTop(&stack);
+                        break;
+                    case OVERFLOW:
+                        StackForce(stack);
+                        printf("%d\n", PolyCoeffOverflow());
+                        break;
+                    case MOD:
+                        StackForce(stack);
+                        PolyCoeffModSet(s.c);
+                        StackMap(stack, PolyCoeffReduce);
+                        break;
+                    case INTERN:
+                        PolyInternSet(true);
+                        StackMap(stack, PolyIntern);
+                        break;
+                    case MEMORY:
+                    {
+                        StackForce(stack);
+                        PolyInternStats st = PolyInternReport();
+                        printf("%zu %zu %zu %.0f\n", st.lists, st.refs,
+                               st.bytes, st.tree_bytes);
+                        break;
+                    }
+                    case TREE:
+                        p = StackPop(&stack);
+                        q = PolyToTree(&p);
+                        StackPush(&stack, q);
+                        PolyDestroy(&p);
+                        break;
+                    case REORDER:
+                    {
+                        unsigned vars, *perm = StackReorderChoose(stack, &vars);
+
+                        StackPermute(stack, vars, perm);
+                        SeriesPermute(vars, perm);
+                        OrderCompose(&order, &order_vars, perm, vars);
+                        for (unsigned i = 0; i < vars; i++)
+                            printf(i == 0 ? "%u" : " %u", perm[i]);
+                        printf("\n");
+                        free(perm);
+                        break;
+                    }
+                    case RESTORE:
+                        OrderRestore(stack, &order, &order_vars);
+                        break;
+                    case SQR:
+                        p = StackPop(&stack);
+                        q = SeriesActive() ? PolyMulTrunc(&p, &p, &series)
+                                           : PolySqr(&p);
+                        StackPush(&stack, q);
+                        PolyDestroy(&p);
+                        break;
+                    case POW:
+                        p = StackPop(&stack);
+                        q = SeriesActive()
+                            ? PolyPowTrunc(&p, (poly_exp_t)s.c, &series)
+                            : PolyPow(&p, (poly_exp_t)s.c);
+                        StackPush(&stack, q);
+                        PolyDestroy(&p);
+                        break;
+                    case DIV:
+                    case REM:
+                    {
+                        Poly quot, rem;
+
+                        p = StackPop(&stack);
+                        q = StackPop(&stack);
+                        if (!PolyDivRem(&p, &q, &quot, &rem))
+                        {
+                            ErrorWrongDivisor(row);
+                            StackPush(&stack, q);
+                            StackPush(&stack, p);
+                            break;
+                        }
+                        StackPush(&stack, command == DIV ? quot : rem);
+                        PolyDestroy(command == DIV ? &rem : &quot);
+                        PolyDestroy(&p);
+                        PolyDestroy(&q);
+                        break;
+                    }
+                    case GCD:
+                    {
+                        Poly g;
+
+                        p = StackPop(&stack);
+                        q = StackPop(&stack);
+                        if (!PolyGcd(&p, &q, &g))
+                        {
+                            ErrorGcdFailed(row);
+                            StackPush(&stack, q);
+                            StackPush(&stack, p);
+                            break;
+                        }
+                        StackPush(&stack, g);
+                        PolyDestroy(&p);
+                        PolyDestroy(&q);
+                        break;
+                    }
+                    case SERIES:
+                        SeriesSet(stack, (unsigned)s.c, deg);
+                        break;
+                    case LAZY:
+                        lazy = true;
+                        break;
+                    case ADD_ALL:
+                    {
+                        unsigned n = (unsigned)s.c;
+
+                        if (LazyActive())
+                        {
+                            Expr *e = ExprFromPoly(PolyZero());
+
+                            for (unsigned i = 0; i < n; i++)
+                                e = ExprAdd(e, StackPopExpr(&stack), false);
+                            StackPushExpr(&stack, e);
+                            break;
+                        }
+
+                        Poly *x = StackPopArray(&stack, n);
+                        StackPush(&stack, PolyAddAll(n, x, NULL));
+                        PolyArrayDestroy(n, x);
+                        break;
+                    }
+                    case FMA:
+                        if (LazyActive())
+                        {
+                            Expr *a = StackPopExpr(&stack);
+                            Expr *prod = ExprMul(a, StackPopExpr(&stack));
+                            Expr *c = StackPopExpr(&stack);
+                            StackPushExpr(&stack, ExprAdd(prod, c, false));
+                            break;
+                        }
+                        p = StackPop(&stack);
+                        q = StackPop(&stack);
+                        r = StackPop(&stack);
+                        if (SeriesActive())
+                        {
+                            Poly prod = PolyMulTrunc(&p, &q, &series);
+                            Poly sum = PolyAdd(&prod, &r);
+
+                            PolyDestroy(&prod);
+                            PolyDestroy(&r);
+                            r = sum;
+                        }
+                        else
+                        {
+                            r = PolyFmaTake(&p, &q, &r);
+                        }
+                        StackPush(&stack, r);
+                        PolyDestroy(&p);
+                        PolyDestroy(&q);
+                        break;
+                    case MUL_ALL:
+                    {
+                        unsigned n = (unsigned)s.c;
+                        Poly *x = StackPopArray(&stack, n);
+
+                        StackPush(&stack, SeriesActive()
+                                          ? PolyMulAllTrunc(n, x, &series)
+                                          : PolyMulAll(n, x));
+                        PolyArrayDestroy(n, x);
+                        break;
+                    }
+                    case ACC_PUSH:
+                        PolyAccPush(&acc, StackPop(&stack));
+                        break;
+                    case ACC_FLUSH:
+                        StackPush(&stack, PolyAccFlush(&acc));
                         break;
                 }
+
+                if (acc_moved)
+                    PolyAccPush(&acc, StackPop(&stack));
                 break;
             case END:
                 StackDestroy(&stack);
+                PolyAccDestroy(&acc);
+                free(order);
+                free(series_max);
+                series_max = NULL;
+                series = (PolyBound) {.vars = 0, .max = NULL, .total = -1};
+                lazy = false;
                 return 0;
         }
     }
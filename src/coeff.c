@@ -0,0 +1,215 @@
+/** @file
+    Implementacja ustawień arytmetyki współczynników
+
+    @author Aliaksandr Sarokin <as372525@students.mimuw.edu.pl>
+    @copyright Uniwersytet Warszawski
+    @date 2017-06-03
+*/
+
+#include <stdlib.h>
+#include <assert.h>
+
+#include "coeff.h"
+#include "utils.h"
+
+_Thread_local CoeffModulus coeff_mod = {.p = 0, .mu = 0, .k = 0, .prime = false};
+
+atomic_bool coeff_overflow = false;
+
+/**
+ * Podnosi liczbę do potęgi modulo @p n.
+ * @param[in] x : podstawa
+ * @param[in] e : wykładnik
+ * @param[in] n : moduł
+ * @return @f$x^e \bmod n@f$
+ */
+static uint64_t PowMod(uint64_t x, uint64_t e, uint64_t n)
+{
+    uint64_t res = 1;
+
+    for (x %= n; e != 0; e >>= 1)
+    {
+        if (e & 1)
+            res = (uint64_t)((unsigned __int128)res * x % n);
+        x = (uint64_t)((unsigned __int128)x * x % n);
+    }
+
+    return res;
+}
+
+bool CoeffIsPrime(uint64_t n)
+{
+    static const uint64_t witnesses[] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37};
+
+    if (n < 2 || n % 2 == 0)
+        return n == 2;
+
+    uint64_t d = n - 1;
+    unsigned s = 0;
+
+    for (; (d & 1) == 0; d >>= 1)
+        s++;
+
+    for (size_t i = 0; i < sizeof(witnesses) / sizeof(witnesses[0]); i++)
+    {
+        uint64_t a = witnesses[i];
+
+        if (a % n == 0)
+            return true;
+
+        uint64_t x = PowMod(a, d, n);
+        unsigned r = 1;
+
+        if (x == 1 || x == n - 1)
+            continue;
+
+        for (; r < s; r++)
+        {
+            x = (uint64_t)((unsigned __int128)x * x % n);
+            if (x == n - 1)
+                break;
+        }
+
+        if (r == s)
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ * Odwraca liczbę nieparzystą modulo @f$2^{b}@f$ metodą Newtona: każdy krok
+ * podwaja liczbę poprawnych bitów, a @f$u \cdot u \equiv 1 \pmod 8@f$.
+ * @param[in] u : liczba nieparzysta
+ * @return @f$u^{-1} \bmod 2^{b}@f$
+ */
+static ucoeff_t InverseOdd(ucoeff_t u)
+{
+    ucoeff_t x = u;
+
+    for (int i = 0; i < 5; i++)
+        x *= 2 - u * x;
+
+    return x;
+}
+
+bool CoeffInverse(poly_coeff_t c, poly_coeff_t *inv)
+{
+    if (!CoeffModActive())
+    {
+        *inv = c;
+        return c == 1 || c == -1;
+    }
+
+    /* Rozszerzony algorytm Euklidesa; |s| nie przekracza p < 2^63. */
+    uint64_t r0 = coeff_mod.p, r1 = (uint64_t)c % coeff_mod.p;
+    long long s0 = 0, s1 = 1;
+
+    while (r1 != 0)
+    {
+        uint64_t t = r0 / r1, r = r0 - t * r1;
+        long long s = s0 - (long long)t * s1;
+
+        r0 = r1;
+        r1 = r;
+        s0 = s1;
+        s1 = s;
+    }
+
+    *inv = (poly_coeff_t)(s0 < 0 ? s0 + (long long)coeff_mod.p : s0);
+
+    return r0 == 1;
+}
+
+/**
+ * Wyznacza współczynniki dwumianowe modulo liczba pierwsza większa od @p n.
+ * @param[in] n : wykładnik dwumianu
+ * @param[out] c : tablica @f$n + 1@f$ współczynników
+ */
+static void BinomialsMod(poly_exp_t n, poly_coeff_t c[])
+{
+    uint64_t p = coeff_mod.p;
+    uint64_t *inv = malloc(((size_t)n / 2 + 2) * sizeof(uint64_t));
+    assert(inv != NULL);
+
+    inv[1] = 1;
+    c[0] = c[n] = 1;
+    for (poly_exp_t k = 1; k <= n / 2; k++)
+    {
+        /* p = (p / k) * k + p % k, więc 1/k = -(p / k) / (p % k). */
+        if (k > 1)
+            inv[k] = (uint64_t)CoeffModReduce((unsigned __int128)(p - p / (uint64_t)k)
+                                              * inv[p % (uint64_t)k]);
+
+        poly_coeff_t num = CoeffModReduce((unsigned __int128)(uint64_t)c[k - 1]
+                                          * (uint64_t)(n - k + 1));
+
+        c[k] = c[n - k] = CoeffModReduce((unsigned __int128)(uint64_t)num * inv[k]);
+    }
+
+    free(inv);
+}
+
+bool CoeffBinomials(poly_exp_t n, poly_coeff_t c[])
+{
+    assert(n >= 0);
+
+    if (CoeffModActive())
+    {
+        if (!coeff_mod.prime || (uint64_t)n >= coeff_mod.p)
+            return false;
+
+        BinomialsMod(n, c);
+        return true;
+    }
+
+    /* binom(n, k) = binom(n, k - 1) * (n - k + 1) / k */
+    ucoeff_t odd = 1;
+    unsigned twos = 0;
+    unsigned __int128 exact = 1;
+    bool fits = true;
+
+    c[0] = c[n] = 1;
+    for (poly_exp_t k = 1; k <= n / 2; k++)
+    {
+        unsigned num = (unsigned)(n - k + 1), den = (unsigned)k;
+        unsigned s = (unsigned)__builtin_ctz(num), t = (unsigned)__builtin_ctz(den);
+
+        odd *= (ucoeff_t)(num >> s) * InverseOdd((ucoeff_t)(den >> t));
+        twos = twos + s - t;
+
+        /* Współczynniki rosną do środka wiersza, więc po pierwszym
+           przepełnieniu dalsze też się nie mieszczą. */
+        if (fits)
+        {
+            exact = exact * num / den;
+            fits = exact <= (unsigned __int128)POLY_COEFF_MAX;
+        }
+
+        c[k] = c[n - k] = (poly_coeff_t)(twos >= POLY_COEFF_BITS ? 0 : odd << twos);
+    }
+
+    CoeffOverflowNote(!fits);
+
+    return true;
+}
+
+void CoeffModSet(poly_coeff_t p)
+{
+    assert(p == 0 || p >= 2);
+
+    if (p == 0)
+    {
+        coeff_mod = (CoeffModulus) {.p = 0, .mu = 0, .k = 0, .prime = false};
+        return;
+    }
+
+    unsigned k = 64 - (unsigned)__builtin_clzl((unsigned long)p);
+
+    coeff_mod = (CoeffModulus) {
+        .p = (uint64_t)p,
+        .mu = (uint64_t)((((unsigned __int128)1 << (2 * k)) - 1) / (uint64_t)p),
+        .k = k,
+        .prime = CoeffIsPrime((uint64_t)p)
+    };
+}
@@ -0,0 +1,339 @@
+/** @file
+    Arytmetyka współczynników z wykrywaniem przepełnienia i trybem modularnym
+
+    Domyślnie wyniki operacji są liczone modulo @f$2^{b}@f$, gdzie @f$b@f$ to
+    `POLY_COEFF_BITS`, a każde wyjście
+    poza zakres `poly_coeff_t` zapala wspólny znacznik, odczytywany przez
+    `PolyCoeffOverflow`. Sprawdzenie to jedna instrukcja skoku, który
+    w typowym przypadku nie jest wykonywany.
+
+    Po ustawieniu modułu @f$p@f$ współczynniki są resztami z przedziału
+    @f$[0, p)@f$, a mnożenie redukuje iloczyn metodą Barretta, bez dzielenia.
+
+    @author Aliaksandr Sarokin <as372525@students.mimuw.edu.pl>
+    @copyright Uniwersytet Warszawski
+    @date 2017-06-03
+*/
+
+#ifndef __COEFF_H__
+#define __COEFF_H__
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "poly.h"
+
+#if POLY_COEFF_BITS == 32
+/** Typ bez znaku tej samej szerokości co `poly_coeff_t`, liczy modulo */
+typedef uint32_t ucoeff_t;
+#else
+/** Typ bez znaku tej samej szerokości co `poly_coeff_t`, liczy modulo */
+typedef unsigned long ucoeff_t;
+#endif
+
+/** Moduł arytmetyki współczynników wraz ze stałymi redukcji Barretta */
+typedef struct CoeffModulus
+{
+    uint64_t p; ///< moduł; 0 oznacza liczenie modulo 2^`POLY_COEFF_BITS`
+    uint64_t mu; ///< @f$\lfloor (4^k - 1) / p \rfloor@f$
+    unsigned k; ///< liczba bitów modułu
+    bool prime; ///< czy moduł jest liczbą pierwszą
+} CoeffModulus;
+
+/**
+ * Stała do wielokrotnego mnożenia modulo @f$p@f$ metodą Shoupa: iloraz
+ * @f$\lfloor w \cdot 2^{64} / p \rfloor@f$ jest liczony raz, więc każde
+ * mnożenie kosztuje dwa mnożenia maszynowe i jedno odejmowanie warunkowe.
+ */
+typedef struct CoeffShoup
+{
+    uint64_t w; ///< stała, reszta modulo @f$p@f$
+    uint64_t w_pre; ///< @f$\lfloor w \cdot 2^{64} / p \rfloor@f$
+} CoeffShoup;
+
+/**
+ * Bieżący moduł arytmetyki współczynników. Każdy wątek ma własny, więc
+ * wątki robocze mogą liczyć modulo różne liczby pierwsze; wątek
+ * uruchamiający pracę równoległą przekazuje im swój moduł.
+ */
+extern _Thread_local CoeffModulus coeff_mod;
+
+/** Czy od ostatniego sprawdzenia któraś operacja przepełniła współczynnik */
+extern atomic_bool coeff_overflow;
+
+/**
+ * Ustawia moduł arytmetyki współczynników.
+ * @param[in] p : moduł, 0 albo co najmniej 2
+ */
+void CoeffModSet(poly_coeff_t p);
+
+/**
+ * Sprawdza pierwszość liczby testem Millera-Rabina.
+ * Zestaw świadków jest rozstrzygający dla wszystkich liczb 64-bitowych.
+ * @param[in] n : liczba
+ * @return czy @p n jest pierwsza
+ */
+bool CoeffIsPrime(uint64_t n);
+
+/**
+ * Wyznacza współczynniki dwumianowe @f$\binom{n}{k}@f$, @f$k = 0, \ldots, n@f$,
+ * w bieżącej arytmetyce. Modulo @f$2^{b}@f$ liczy osobno nieparzystą część
+ * i potęgę dwójki, więc nie dzieli; zapala znacznik przepełnienia, gdy
+ * któryś współczynnik nie mieści się w `poly_coeff_t`. Modulo @f$p@f$
+ * dzieli przez odwrotności, więc wymaga pierwszego @f$p > n@f$.
+ * @param[in] n : wykładnik dwumianu
+ * @param[out] c : tablica @f$n + 1@f$ współczynników
+ * @return czy współczynniki dało się wyznaczyć
+ */
+bool CoeffBinomials(poly_exp_t n, poly_coeff_t c[]);
+
+/**
+ * Odwraca współczynnik w bieżącej arytmetyce. Bez modułu odwracalne są
+ * tylko @f$\pm 1@f$, bo wyniki mają być dokładne w liczbach całkowitych;
+ * modulo @f$p@f$ każda liczba względnie pierwsza z @f$p@f$.
+ * @param[in] c : współczynnik w postaci kanonicznej
+ * @param[out] inv : odwrotność @p c
+ * @return czy @p c jest odwracalny
+ */
+bool CoeffInverse(poly_coeff_t c, poly_coeff_t *inv);
+
+/**
+ * Sprawdza, czy współczynniki są liczone modulo ustawiony moduł.
+ * @return czy tryb modularny jest włączony
+ */
+static inline bool CoeffModActive(void)
+{
+    return __builtin_expect(coeff_mod.p != 0, 0);
+}
+
+/**
+ * Zapala znacznik przepełnienia, jeśli @p overflow.
+ * @param[in] overflow : czy nastąpiło przepełnienie
+ */
+static inline void CoeffOverflowNote(bool overflow)
+{
+    if (__builtin_expect(overflow, 0))
+        atomic_store_explicit(&coeff_overflow, true, memory_order_relaxed);
+}
+
+/**
+ * Redukuje liczbę mniejszą od @f$p^2@f$ modulo @f$p@f$ metodą Barretta.
+ * @param[in] x : liczba
+ * @return @f$x \bmod p@f$
+ */
+static inline poly_coeff_t CoeffModReduce(unsigned __int128 x)
+{
+    uint64_t t = (uint64_t)(x >> (coeff_mod.k - 1));
+    uint64_t q = (uint64_t)(((unsigned __int128)t * coeff_mod.mu) >> (coeff_mod.k + 1));
+    unsigned __int128 r = x - (unsigned __int128)q * coeff_mod.p;
+
+    while (r >= coeff_mod.p)
+        r -= coeff_mod.p;
+
+    return (poly_coeff_t)r;
+}
+
+/**
+ * Dodaje reszty modulo @f$p@f$.
+ * @param[in] a : reszta
+ * @param[in] b : reszta
+ * @return @f$(a + b) \bmod p@f$
+ */
+static inline poly_coeff_t CoeffModAdd(poly_coeff_t a, poly_coeff_t b)
+{
+    uint64_t s = (uint64_t)a + (uint64_t)b;
+
+    return (poly_coeff_t)(s >= coeff_mod.p ? s - coeff_mod.p : s);
+}
+
+/**
+ * Przygotowuje stałą do mnożenia modulo @f$p@f$ metodą Shoupa.
+ * @param[in] w : stała, reszta
+ * @return stała z ilorazem
+ */
+static inline CoeffShoup CoeffShoupInit(poly_coeff_t w)
+{
+    return (CoeffShoup) {
+        .w = (uint64_t)w,
+        .w_pre = (uint64_t)(((unsigned __int128)(uint64_t)w << 64) / coeff_mod.p)
+    };
+}
+
+/**
+ * Mnoży resztę przez przygotowaną stałą modulo @f$p@f$.
+ * Wymaga @f$p < 2^{63}@f$, co zapewnia zakres `poly_coeff_t`.
+ * @param[in] s : stała z ilorazem
+ * @param[in] x : reszta
+ * @return @f$w x \bmod p@f$
+ */
+static inline poly_coeff_t CoeffShoupMul(CoeffShoup s, poly_coeff_t x)
+{
+    uint64_t q = (uint64_t)(((unsigned __int128)s.w_pre * (uint64_t)x) >> 64);
+    uint64_t r = s.w * (uint64_t)x - q * coeff_mod.p;
+
+    return (poly_coeff_t)(r >= coeff_mod.p ? r - coeff_mod.p : r);
+}
+
+/**
+ * Daje wartość bezwzględną współczynnika jako liczbę bez znaku.
+ * @param[in] c : współczynnik
+ * @return @f$|c|@f$
+ */
+static inline uint64_t CoeffAbs(poly_coeff_t c)
+{
+    return c < 0 ? 0 - (uint64_t)c : (uint64_t)c;
+}
+
+/**
+ * Sprawdza, czy suma @p n iloczynów współczynników o wartościach
+ * bezwzględnych nie większych od @p max_a i @p max_b na pewno mieści się
+ * w zakresie, więc pętla może ją liczyć bez sprawdzania przepełnień.
+ * @param[in] max_a : ograniczenie pierwszych czynników
+ * @param[in] max_b : ograniczenie drugich czynników
+ * @param[in] n : liczba składników
+ * @return czy suma na pewno się nie przepełni
+ */
+static inline bool CoeffProductsFit(uint64_t max_a, uint64_t max_b, size_t n)
+{
+    uint64_t prod, total;
+
+    return !__builtin_mul_overflow(max_a, max_b, &prod)
+           && !__builtin_mul_overflow(prod, (uint64_t)n, &total)
+           && total <= (uint64_t)POLY_COEFF_MAX;
+}
+
+/**
+ * Sprowadza dowolną liczbę do postaci kanonicznej bieżącej arytmetyki:
+ * w trybie modularnym do reszty z przedziału @f$[0, p)@f$.
+ * @param[in] c : liczba
+ * @return postać kanoniczna @p c
+ */
+static inline poly_coeff_t CoeffReduce(poly_coeff_t c)
+{
+    if (!CoeffModActive())
+        return c;
+
+    poly_coeff_t r = c % (poly_coeff_t)coeff_mod.p;
+
+    return r < 0 ? r + (poly_coeff_t)coeff_mod.p : r;
+}
+
+/**
+ * Dodaje współczynniki, dopisując przepełnienie do @p overflow.
+ * Pętle mogą dzięki temu zapalić znacznik raz, po przejściu wszystkich wyrazów.
+ * @param[in] a : współczynnik
+ * @param[in] b : współczynnik
+ * @param[in,out] overflow : czy nastąpiło przepełnienie
+ * @return `a + b`
+ */
+static inline poly_coeff_t CoeffAddAcc(poly_coeff_t a, poly_coeff_t b,
+                                       bool *overflow)
+{
+    poly_coeff_t r;
+
+    if (CoeffModActive())
+        return CoeffModAdd(a, b);
+
+    *overflow |= __builtin_add_overflow(a, b, &r);
+
+    return r;
+}
+
+/**
+ * Mnoży współczynniki, dopisując przepełnienie do @p overflow.
+ * @param[in] a : współczynnik
+ * @param[in] b : współczynnik
+ * @param[in,out] overflow : czy nastąpiło przepełnienie
+ * @return `a * b`
+ */
+static inline poly_coeff_t CoeffMulAcc(poly_coeff_t a, poly_coeff_t b,
+                                       bool *overflow)
+{
+    poly_coeff_t r;
+
+    if (CoeffModActive())
+        return CoeffModReduce((unsigned __int128)(uint64_t)a * (uint64_t)b);
+
+    *overflow |= __builtin_mul_overflow(a, b, &r);
+
+    return r;
+}
+
+/**
+ * Dodaje iloczyn współczynników do akumulatora.
+ * @param[in] acc : akumulator
+ * @param[in] a : współczynnik
+ * @param[in] b : współczynnik
+ * @param[in,out] overflow : czy nastąpiło przepełnienie
+ * @return `acc + a * b`
+ */
+static inline poly_coeff_t CoeffMulAdd(poly_coeff_t acc, poly_coeff_t a,
+                                       poly_coeff_t b, bool *overflow)
+{
+    return CoeffAddAcc(acc, CoeffMulAcc(a, b, overflow), overflow);
+}
+
+/**
+ * Dodaje współczynniki.
+ * @param[in] a : współczynnik
+ * @param[in] b : współczynnik
+ * @return `a + b`
+ */
+static inline poly_coeff_t CoeffAdd(poly_coeff_t a, poly_coeff_t b)
+{
+    bool overflow = false;
+    poly_coeff_t r = CoeffAddAcc(a, b, &overflow);
+
+    CoeffOverflowNote(overflow);
+
+    return r;
+}
+
+/**
+ * Mnoży współczynniki.
+ * @param[in] a : współczynnik
+ * @param[in] b : współczynnik
+ * @return `a * b`
+ */
+static inline poly_coeff_t CoeffMul(poly_coeff_t a, poly_coeff_t b)
+{
+    bool overflow = false;
+    poly_coeff_t r = CoeffMulAcc(a, b, &overflow);
+
+    CoeffOverflowNote(overflow);
+
+    return r;
+}
+
+/**
+ * Daje współczynnik przeciwny.
+ * @param[in] a : współczynnik
+ * @return `-a`
+ */
+static inline poly_coeff_t CoeffNeg(poly_coeff_t a)
+{
+    if (CoeffModActive())
+        return a == 0 ? 0 : (poly_coeff_t)(coeff_mod.p - (uint64_t)a);
+
+    CoeffOverflowNote(a == POLY_COEFF_MIN);
+
+    return (poly_coeff_t)(0 - (ucoeff_t)a);
+}
+
+/**
+ * Sprawdza, czy mnożenie przez @p c nie może wyzerować niezerowego
+ * współczynnika, czyli czy @p c jest odwracalne.
+ * W trybie modularnym z modułem złożonym odpowiada zachowawczo `false`.
+ * @param[in] c : współczynnik
+ * @return czy @p c jest odwracalne
+ */
+static inline bool CoeffIsUnit(poly_coeff_t c)
+{
+    if (CoeffModActive())
+        return coeff_mod.prime && c != 0;
+
+    return (c & 1) != 0;
+}
+
+#endif /* __COEFF_H__ */
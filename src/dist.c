@@ -0,0 +1,805 @@
+/** @file
+    Implementacja rozproszonej reprezentacji wielomianów
+
+    @author Aliaksandr Sarokin <as372525@students.mimuw.edu.pl>
+    @copyright Uniwersytet Warszawski
+    @date 2017-06-03
+*/
+
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+
+#include "coeff.h"
+#include "dist.h"
+#include "kernels.h"
+#include "utils.h"
+
+/** Liczba bitów słowa klucza */
+#define DIST_WORD_BITS 64
+
+/**
+ * Maksymalny stosunek liczby komórek gęstej tablicy do liczby iloczynów
+ * wyrazów, przy którym `DistMul` sumuje iloczyny w tej tablicy
+ */
+#define DIST_DENSE_RATIO 4
+
+/** Maksymalna liczba komórek gęstej tablicy w `DistMul` */
+#define DIST_DENSE_MAX (1UL << 24)
+
+/**
+ * Maksymalna liczba zmiennych, dla której `DistMul` ma osobne wersje
+ * z rozwiniętymi pętlami po zmiennych
+ */
+#define DIST_FIXED_VARS_MAX 4
+
+/**
+ * Funkcja wstawiana zawsze w miejscu wywołania. Wywołana ze stałymi
+ * argumentami (liczbą słów klucza, liczbą zmiennych) daje wersję
+ * wyspecjalizowaną w czasie kompilacji.
+ */
+#define DIST_SPECIALISE static inline __attribute__((always_inline))
+
+/** Element kopca w `DistMul`: iloczyn wyrazów `a[i] * b[j]` */
+typedef struct DistHeapItem
+{
+    DistKey key; ///< klucz iloczynu
+    size_t i; ///< indeks wyrazu pierwszego czynnika
+    size_t j; ///< indeks wyrazu drugiego czynnika
+} DistHeapItem;
+
+/**
+ * Porównuje klucze.
+ * @param[in] a : klucz
+ * @param[in] b : klucz
+ * @return `a < b`
+ */
+static inline bool KeyLess(DistKey a, DistKey b)
+{
+    return (a.hi < b.hi) | ((a.hi == b.hi) & (a.lo < b.lo));
+}
+
+/**
+ * Sprawdza równość kluczy.
+ * @param[in] a : klucz
+ * @param[in] b : klucz
+ * @return `a = b`
+ */
+static inline bool KeyEq(DistKey a, DistKey b)
+{
+    return a.hi == b.hi && a.lo == b.lo;
+}
+
+/**
+ * Dodaje klucze, czyli mnoży odpowiadające im jednomiany.
+ * @param[in] a : klucz
+ * @param[in] b : klucz
+ * @return `a + b`
+ */
+static inline DistKey KeyAdd(DistKey a, DistKey b)
+{
+    return (DistKey) {.hi = a.hi + b.hi, .lo = a.lo + b.lo};
+}
+
+/**
+ * Sprawdza, czy któreś pole klucza się przepełniło.
+ * @param[in] k : klucz
+ * @param[in] l : rozmieszczenie pól
+ * @return czy zapalony jest bit strażnika
+ */
+static inline bool KeyOverflow(DistKey k, const DistLayout *l)
+{
+    return ((k.hi & l->guard.hi) | (k.lo & l->guard.lo)) != 0;
+}
+
+/**
+ * Daje przesunięcie pola zmiennej w jej słowie.
+ * @param[in] l : rozmieszczenie pól
+ * @param[in] var : indeks zmiennej
+ * @return przesunięcie w bitach
+ */
+static inline unsigned KeyShift(const DistLayout *l, unsigned var)
+{
+    return DIST_WORD_BITS - (var % l->per_word + 1) * l->width;
+}
+
+/**
+ * Tworzy klucz, w którym tylko pole zmiennej @p var ma wartość @p v.
+ * @param[in] l : rozmieszczenie pól
+ * @param[in] var : indeks zmiennej
+ * @param[in] v : wartość pola
+ * @return klucz
+ */
+static DistKey KeyField(const DistLayout *l, unsigned var, dist_word_t v)
+{
+    v <<= KeyShift(l, var);
+
+    return var < l->per_word ? (DistKey) {.hi = v, .lo = 0}
+                             : (DistKey) {.hi = 0, .lo = v};
+}
+
+/**
+ * Odczytuje wykładnik zmiennej z klucza.
+ * @param[in] l : rozmieszczenie pól
+ * @param[in] k : klucz
+ * @param[in] var : indeks zmiennej
+ * @return wykładnik
+ */
+static inline poly_exp_t KeyGet(const DistLayout *l, DistKey k, unsigned var)
+{
+    dist_word_t w = var < l->per_word ? k.hi : k.lo;
+
+    return (poly_exp_t)((w >> KeyShift(l, var))
+                        & (((dist_word_t)1 << l->width) - 1));
+}
+
+/**
+ * Daje liczbę słów, które zajmują pola zmiennych.
+ * @param[in] l : rozmieszczenie pól
+ * @return 1 albo 2
+ */
+static inline unsigned KeyWords(const DistLayout *l)
+{
+    return l->vars <= l->per_word ? 1 : 2;
+}
+
+/**
+ * Porównuje klucze o @p words słowach.
+ * @param[in] a : klucz
+ * @param[in] b : klucz
+ * @param[in] words : liczba słów
+ * @return `a < b`
+ */
+DIST_SPECIALISE bool KeyLessW(DistKey a, DistKey b, unsigned words)
+{
+    return words == 1 ? a.hi < b.hi : KeyLess(a, b);
+}
+
+/**
+ * Sprawdza równość kluczy o @p words słowach.
+ * @param[in] a : klucz
+ * @param[in] b : klucz
+ * @param[in] words : liczba słów
+ * @return `a = b`
+ */
+DIST_SPECIALISE bool KeyEqW(DistKey a, DistKey b, unsigned words)
+{
+    return words == 1 ? a.hi == b.hi : KeyEq(a, b);
+}
+
+/**
+ * Dodaje klucze o @p words słowach.
+ * @param[in] a : klucz
+ * @param[in] b : klucz
+ * @param[in] words : liczba słów
+ * @return `a + b`
+ */
+DIST_SPECIALISE DistKey KeyAddW(DistKey a, DistKey b, unsigned words)
+{
+    return words == 1 ? (DistKey) {.hi = a.hi + b.hi, .lo = 0} : KeyAdd(a, b);
+}
+
+/**
+ * Sprawdza, czy któreś pole klucza o @p words słowach się przepełniło.
+ * @param[in] k : klucz
+ * @param[in] l : rozmieszczenie pól
+ * @param[in] words : liczba słów
+ * @return czy zapalony jest bit strażnika
+ */
+DIST_SPECIALISE bool KeyOverflowW(DistKey k, const DistLayout *l, unsigned words)
+{
+    return words == 1 ? (k.hi & l->guard.hi) != 0 : KeyOverflow(k, l);
+}
+
+/**
+ * Odczytuje wykładnik zmiennej z klucza o @p words słowach.
+ * W kluczu jednosłowowym pole zmiennej @p var leży zawsze w `hi`.
+ * @param[in] l : rozmieszczenie pól
+ * @param[in] k : klucz
+ * @param[in] var : indeks zmiennej
+ * @param[in] words : liczba słów
+ * @return wykładnik
+ */
+DIST_SPECIALISE poly_exp_t KeyGetW(const DistLayout *l, DistKey k, unsigned var,
+                                   unsigned words)
+{
+    if (words != 1)
+        return KeyGet(l, k, var);
+
+    return (poly_exp_t)((k.hi >> (DIST_WORD_BITS - (var + 1) * l->width))
+                        & (((dist_word_t)1 << l->width) - 1));
+}
+
+bool DistLayoutInit(DistLayout *l, unsigned vars, poly_exp_t max_exp)
+{
+    unsigned width = 2;
+
+    while ((1L << (width - 1)) <= (long)max_exp)
+        width++;
+
+    l->vars = vars;
+    l->width = width;
+    l->per_word = DIST_WORD_BITS / width;
+    l->guard = (DistKey) {.hi = 0, .lo = 0};
+
+    if (vars == 0 || vars > DIST_VARS_MAX || vars > 2 * l->per_word)
+        return false;
+
+    for (unsigned v = 0; v < vars; v++)
+        l->guard = KeyAdd(l->guard, KeyField(l, v, (dist_word_t)1 << (width - 1)));
+
+    return true;
+}
+
+unsigned DistVars(const Poly *p)
+{
+    unsigned res = 0;
+
+    if (PolyIsCoeff(p))
+        return 0;
+
+    /* Bloki gęste i liście mają w nagłówku zerowy współczynnik. */
+    for (const Node *n = p->l; n != NULL; n = n->next)
+    {
+        unsigned v = DistVars(&(n->m.p));
+
+        if (v > res)
+            res = v;
+    }
+
+    return res + 1;
+}
+
+/**
+ * Wyznacza maksymalne wykładniki zmiennych od @p var w głąb i zlicza
+ * niezerowe wyrazy.
+ * @param[in] p : wielomian
+ * @param[in,out] degs : maksymalne wykładniki zmiennych
+ * @param[in] var : indeks zmiennej głównej @p p
+ * @return liczba wyrazów
+ */
+static size_t DistDegreesHelp(const Poly *p, poly_exp_t degs[], unsigned var)
+{
+    size_t res = 0;
+
+    if (PolyIsCoeff(p))
+        return p->c != 0;
+
+    for (ListIter it = ListIterBegin(p->l); it.n != NULL; ListIterNext(&it))
+    {
+        Poly c = ListIterCoeff(&it);
+
+        if (ListIterExp(&it) > degs[var])
+            degs[var] = ListIterExp(&it);
+        res += DistDegreesHelp(&c, degs, var + 1);
+    }
+
+    return res;
+}
+
+size_t DistDegrees(const Poly *p, poly_exp_t degs[])
+{
+    return DistDegreesHelp(p, degs, 0);
+}
+
+/**
+ * Dopisuje wyraz na koniec wielomianu, powiększając w razie potrzeby tablicę.
+ * @param[in,out] d : wielomian
+ * @param[in,out] cap : pojemność tablicy wyrazów
+ * @param[in] key : klucz
+ * @param[in] c : współczynnik
+ */
+static void DistPush(DistPoly *d, size_t *cap, DistKey key, poly_coeff_t c)
+{
+    if (d->len == *cap)
+    {
+        *cap = *cap == 0 ? 16 : 2 * *cap;
+        d->terms = realloc(d->terms, *cap * sizeof(DistTerm));
+        assert(d->terms != NULL);
+    }
+
+    d->terms[d->len++] = (DistTerm) {.key = key, .coeff = c};
+}
+
+/**
+ * Dopisuje wyrazy wielomianu będącego współczynnikiem przy jednomianie
+ * o kluczu @p key.
+ * @param[in,out] d : wielomian wynikowy
+ * @param[in,out] cap : pojemność tablicy wyrazów
+ * @param[in] p : wielomian
+ * @param[in] var : indeks zmiennej głównej @p p
+ * @param[in] key : klucz jednomianu
+ */
+static void DistCollect(DistPoly *d, size_t *cap, const Poly *p, unsigned var,
+                        DistKey key)
+{
+    if (PolyIsCoeff(p))
+    {
+        if (p->c != 0)
+            DistPush(d, cap, key, p->c);
+        return;
+    }
+
+    for (ListIter it = ListIterBegin(p->l); it.n != NULL; ListIterNext(&it))
+    {
+        Poly c = ListIterCoeff(&it);
+        DistKey field = KeyField(&d->layout, var, (dist_word_t)ListIterExp(&it));
+
+        DistCollect(d, cap, &c, var + 1, KeyAdd(key, field));
+    }
+}
+
+DistPoly DistFromPoly(const Poly *p, const DistLayout *l)
+{
+    DistPoly res = {.layout = *l, .len = 0, .terms = NULL};
+    size_t cap = 0;
+
+    DistCollect(&res, &cap, p, 0, (DistKey) {.hi = 0, .lo = 0});
+
+    return res;
+}
+
+/**
+ * Buduje wielomian nad zmienną @p var z wyrazów o wspólnych wykładnikach
+ * zmiennych poprzednich.
+ * @param[in] t : wyrazy
+ * @param[in] n : liczba wyrazów
+ * @param[in] l : rozmieszczenie pól
+ * @param[in] var : indeks zmiennej
+ * @return wielomian
+ */
+static Poly DistBuild(const DistTerm *t, size_t n, const DistLayout *l,
+                      unsigned var)
+{
+    if (n == 0)
+        return PolyZero();
+
+    if (var == l->vars)
+        return PolyFromCoeff(t[0].coeff);
+
+    Mono *monos = malloc(n * sizeof(Mono));
+    unsigned k = 0;
+
+    assert(monos != NULL);
+
+    for (size_t i = 0, j; i < n; i = j)
+    {
+        poly_exp_t e = KeyGet(l, t[i].key, var);
+
+        for (j = i + 1; j < n && KeyGet(l, t[j].key, var) == e; j++)
+            ;
+
+        Poly c = DistBuild(t + i, j - i, l, var + 1);
+        monos[k++] = MonoFromPoly(&c, e);
+    }
+
+    Poly res = PolyAddMonos(k, monos);
+
+    free(monos);
+
+    return res;
+}
+
+Poly DistToPoly(const DistPoly *d)
+{
+    return DistBuild(d->terms, d->len, &d->layout, 0);
+}
+
+DistPoly DistAdd(const DistPoly *a, const DistPoly *b)
+{
+    DistPoly res = {.layout = a->layout, .len = 0, .terms = NULL};
+    size_t cap = a->len + b->len, i = 0, j = 0;
+
+    if (cap == 0)
+        return res;
+
+    res.terms = malloc(cap * sizeof(DistTerm));
+    assert(res.terms != NULL);
+
+    while (i < a->len || j < b->len)
+    {
+        if (j == b->len || (i < a->len && KeyLess(a->terms[i].key, b->terms[j].key)))
+        {
+            res.terms[res.len++] = a->terms[i++];
+        }
+        else if (i == a->len || KeyLess(b->terms[j].key, a->terms[i].key))
+        {
+            res.terms[res.len++] = b->terms[j++];
+        }
+        else
+        {
+            poly_coeff_t c = CoeffAdd(a->terms[i].coeff, b->terms[j].coeff);
+
+            if (c != 0)
+                res.terms[res.len++] = (DistTerm) {.key = a->terms[i].key, .coeff = c};
+            i++;
+            j++;
+        }
+    }
+
+    return res;
+}
+
+/**
+ * Przywraca własność kopca, przesuwając element @p k w dół.
+ * @param[in,out] heap : kopiec
+ * @param[in] size : rozmiar kopca
+ * @param[in] k : indeks elementu
+ * @param[in] words : liczba słów kluczy
+ */
+DIST_SPECIALISE void HeapSiftDown(DistHeapItem *heap, size_t size, size_t k,
+                                  unsigned words)
+{
+    DistHeapItem item = heap[k];
+
+    for (size_t child = 2 * k + 1; child < size; k = child, child = 2 * k + 1)
+    {
+        /* Bez skoku, bo wynik porównania jest nieprzewidywalny. */
+        child += child + 1 < size
+                 && KeyLessW(heap[child + 1].key, heap[child].key, words);
+        if (!KeyLessW(heap[child].key, item.key, words))
+            break;
+        heap[k] = heap[child];
+    }
+
+    heap[k] = item;
+}
+
+/**
+ * Wyznacza maksymalne wykładniki zmiennych wielomianu.
+ * @param[in] d : wielomian
+ * @param[out] degs : maksymalne wykładniki zmiennych
+ */
+static void DistMaxExps(const DistPoly *d, poly_exp_t degs[])
+{
+    for (unsigned v = 0; v < d->layout.vars; v++)
+        degs[v] = 0;
+
+    for (size_t i = 0; i < d->len; i++)
+    {
+        for (unsigned v = 0; v < d->layout.vars; v++)
+        {
+            poly_exp_t e = KeyGet(&d->layout, d->terms[i].key, v);
+            degs[v] = e > degs[v] ? e : degs[v];
+        }
+    }
+}
+
+/**
+ * Przepisuje wyrazy do równoległych tablic indeksów w gęstej tablicy
+ * o zadanych krokach i współczynników.
+ * Indeks sumy kluczy jest sumą indeksów, gdy wykładniki sumy mieszczą się
+ * w wymiarach tablicy.
+ * @param[in] d : wielomian
+ * @param[in] strides : kroki kolejnych zmiennych
+ * @param[out] idx : indeksy wyrazów
+ * @param[out] coeffs : współczynniki wyrazów
+ * @param[in] vars : liczba zmiennych
+ * @param[in] words : liczba słów kluczy
+ */
+DIST_SPECIALISE void DistGatherW(const DistPoly *d, const size_t strides[],
+                                 size_t idx[], poly_coeff_t coeffs[],
+                                 unsigned vars, unsigned words)
+{
+    for (size_t i = 0; i < d->len; i++)
+    {
+        size_t res = 0;
+
+        for (unsigned v = 0; v < vars; v++)
+            res += (size_t)KeyGetW(&d->layout, d->terms[i].key, v, words) * strides[v];
+
+        idx[i] = res;
+        coeffs[i] = d->terms[i].coeff;
+    }
+}
+
+/**
+ * Wywołuje `DistGatherW` w wersji z rozwiniętą pętlą po zmiennych,
+ * gdy klucze mają jedno słowo, a zmiennych jest najwyżej
+ * `DIST_FIXED_VARS_MAX`.
+ * @param[in] d : wielomian
+ * @param[in] strides : kroki kolejnych zmiennych
+ * @param[out] idx : indeksy wyrazów
+ * @param[out] coeffs : współczynniki wyrazów
+ */
+static void DistGather(const DistPoly *d, const size_t strides[],
+                       size_t idx[], poly_coeff_t coeffs[])
+{
+    if (KeyWords(&d->layout) == 1)
+    {
+        switch (d->layout.vars)
+        {
+            case 2:
+                DistGatherW(d, strides, idx, coeffs, 2, 1);
+                return;
+            case 3:
+                DistGatherW(d, strides, idx, coeffs, 3, 1);
+                return;
+            case DIST_FIXED_VARS_MAX:
+                DistGatherW(d, strides, idx, coeffs, DIST_FIXED_VARS_MAX, 1);
+                return;
+            default:
+                break;
+        }
+    }
+
+    DistGatherW(d, strides, idx, coeffs, d->layout.vars, 2);
+}
+
+/**
+ * Mnoży wielomiany, sumując iloczyny wyrazów w gęstej tablicy indeksowanej
+ * wektorami wykładników wyniku. Kwadrat (@p a równe @p b) liczy
+ * `KernelSqrDense`. Wyrazy składnika @p c są dodawane do tej samej tablicy.
+ * @param[in] a : wielomian
+ * @param[in] b : wielomian
+ * @param[in] c : składnik albo `NULL`
+ * @param[out] res : `a * b + c`
+ * @param[in] strides : kroki kolejnych zmiennych w tablicy
+ * @param[in] cells : liczba komórek tablicy
+ */
+static void DistMulDense(const DistPoly *a, const DistPoly *b, const DistPoly *c,
+                         DistPoly *res, const size_t strides[], size_t cells)
+{
+    const DistLayout *l = &a->layout;
+    size_t n = a == b ? a->len : a->len + b->len, cap = 0;
+    size_t nc = c != NULL ? c->len : 0;
+    bool overflow = false;
+    size_t *idx = malloc((n + nc) * sizeof(size_t));
+    poly_coeff_t *coeffs = malloc((n + nc) * sizeof(poly_coeff_t));
+    poly_coeff_t *acc = calloc(cells, sizeof(poly_coeff_t));
+
+    assert(idx != NULL && coeffs != NULL && acc != NULL);
+
+    DistGather(a, strides, idx, coeffs);
+
+    if (a == b)
+    {
+        KernelSqrDense(acc, idx, coeffs, a->len);
+    }
+    else
+    {
+        DistGather(b, strides, idx + a->len, coeffs + a->len);
+        KernelMulDense(acc, idx, coeffs, a->len, idx + a->len, coeffs + a->len,
+                       b->len);
+    }
+
+    /* Składnik dochodzi po iloczynach, bo szybkie pętle jąder wykluczają
+       przepełnienia tylko dla tablicy zaczynającej od zer. */
+    if (nc > 0)
+    {
+        DistGather(c, strides, idx + n, coeffs + n);
+        for (size_t i = n; i < n + nc; i++)
+            acc[idx[i]] = CoeffAddAcc(acc[idx[i]], coeffs[i], &overflow);
+        CoeffOverflowNote(overflow);
+    }
+
+    /* Klucz komórki liczymy licznikiem o zmiennej podstawie zamiast dzielić
+       jej indeks przez kroki. */
+    size_t digits[DIST_VARS_MAX] = {0}, dims[DIST_VARS_MAX];
+    DistKey key = {.hi = 0, .lo = 0}, unit[DIST_VARS_MAX], back[DIST_VARS_MAX];
+
+    for (unsigned v = 0; v < l->vars; v++)
+    {
+        dims[v] = (v == 0 ? cells : strides[v - 1]) / strides[v];
+        unit[v] = KeyField(l, v, 1);
+        back[v] = KeyField(l, v, dims[v] - 1);
+    }
+
+    for (size_t s = 0; s < cells; s++)
+    {
+        if (acc[s] != 0)
+            DistPush(res, &cap, key, acc[s]);
+
+        for (unsigned v = l->vars; v-- > 0;)
+        {
+            if (++digits[v] < dims[v])
+            {
+                key = KeyAdd(key, unit[v]);
+                break;
+            }
+
+            key = (DistKey) {.hi = key.hi - back[v].hi, .lo = key.lo - back[v].lo};
+            digits[v] = 0;
+        }
+    }
+
+    free(idx);
+    free(coeffs);
+    free(acc);
+}
+
+/**
+ * Mnoży wielomiany, scalając kopcem strumienie iloczynów wyrazów.
+ * Pierwszy czynnik nie może być dłuższy od drugiego ani pusty.
+ * Przy podnoszeniu do kwadratu (@p a równe @p b) strumień wyrazu @f$a_i@f$
+ * zaczyna się od @f$a_i^2@f$, a iloczyn różnych wyrazów jest liczony raz
+ * i dodawany dwukrotnie. Wyrazy składnika @p c są wplatane w strumień
+ * wyników w kolejności kluczy.
+ * @param[in] a : wielomian
+ * @param[in] b : wielomian
+ * @param[in] c : składnik albo `NULL`
+ * @param[out] res : `a * b + c`, wcześniej pusty
+ * @param[in] words : liczba słów kluczy
+ * @return czy wykładniki iloczynu zmieściły się w polach
+ */
+DIST_SPECIALISE bool DistMulHeapW(const DistPoly *a, const DistPoly *b,
+                                  const DistPoly *c, DistPoly *res,
+                                  unsigned words)
+{
+    DistHeapItem *heap = malloc(a->len * sizeof(DistHeapItem));
+    size_t size = a->len, cap = 0, kc = 0, nc = c != NULL ? c->len : 0;
+    bool ok = true, overflow = false, sqr = a == b;
+
+    assert(heap != NULL);
+
+    for (size_t i = 0; i < a->len; i++)
+    {
+        size_t j = sqr ? i : 0;
+
+        heap[i] = (DistHeapItem) {
+            .key = KeyAddW(a->terms[i].key, b->terms[j].key, words),
+            .i = i,
+            .j = j
+        };
+        ok &= !KeyOverflowW(heap[i].key, &a->layout, words);
+    }
+
+    /* Strumień iloczynów a[i] * b[j] rośnie wraz z j, bo dodawanie kluczy
+       zachowuje ich porządek. */
+    while (ok && size > 0)
+    {
+        DistKey key = heap[0].key;
+        poly_coeff_t acc = 0;
+
+        for (; kc < nc && KeyLessW(c->terms[kc].key, key, words); kc++)
+            DistPush(res, &cap, c->terms[kc].key, c->terms[kc].coeff);
+        if (kc < nc && KeyEqW(c->terms[kc].key, key, words))
+            acc = c->terms[kc++].coeff;
+
+        while (size > 0 && KeyEqW(heap[0].key, key, words))
+        {
+            DistHeapItem *top = &heap[0];
+            poly_coeff_t prod = CoeffMulAcc(a->terms[top->i].coeff,
+                                            b->terms[top->j].coeff, &overflow);
+
+            acc = CoeffAddAcc(acc, prod, &overflow);
+            if (sqr && top->i != top->j)
+                acc = CoeffAddAcc(acc, prod, &overflow);
+
+            if (++top->j < b->len)
+            {
+                top->key = KeyAddW(a->terms[top->i].key, b->terms[top->j].key, words);
+                ok &= !KeyOverflowW(top->key, &a->layout, words);
+            }
+            else
+            {
+                *top = heap[--size];
+            }
+            HeapSiftDown(heap, size, 0, words);
+        }
+
+        if (acc != 0)
+            DistPush(res, &cap, key, acc);
+    }
+
+    for (; ok && kc < nc; kc++)
+        DistPush(res, &cap, c->terms[kc].key, c->terms[kc].coeff);
+
+    free(heap);
+    CoeffOverflowNote(ok && overflow);
+
+    if (!ok)
+        DistDestroy(res);
+
+    return ok;
+}
+
+/**
+ * `DistMulHeapW` dla kluczy jednosłowowych.
+ * @param[in] a : wielomian
+ * @param[in] b : wielomian
+ * @param[in] c : składnik albo `NULL`
+ * @param[out] res : `a * b + c`
+ * @return czy wykładniki iloczynu zmieściły się w polach
+ */
+static bool DistMulHeap1(const DistPoly *a, const DistPoly *b, const DistPoly *c,
+                         DistPoly *res)
+{
+    return DistMulHeapW(a, b, c, res, 1);
+}
+
+/**
+ * `DistMulHeapW` dla kluczy dwusłowowych.
+ * @param[in] a : wielomian
+ * @param[in] b : wielomian
+ * @param[in] c : składnik albo `NULL`
+ * @param[out] res : `a * b + c`
+ * @return czy wykładniki iloczynu zmieściły się w polach
+ */
+static bool DistMulHeap2(const DistPoly *a, const DistPoly *b, const DistPoly *c,
+                         DistPoly *res)
+{
+    return DistMulHeapW(a, b, c, res, 2);
+}
+
+/**
+ * Liczy `a * b + c` bez osobnego iloczynu: wyrazy @p c trafiają do tej
+ * samej gęstej tablicy albo scalania kopcem co iloczyny wyrazów.
+ * @param[in] a : wielomian
+ * @param[in] b : wielomian
+ * @param[in] c : składnik albo `NULL`
+ * @param[out] res : `a * b + c`
+ * @return czy wykładniki wyniku zmieściły się w polach
+ */
+static bool DistMulAdd(const DistPoly *a, const DistPoly *b, const DistPoly *c,
+                       DistPoly *res)
+{
+    if (a->len > b->len)
+    {
+        const DistPoly *tmp = a;
+        a = b;
+        b = tmp;
+    }
+
+    *res = (DistPoly) {.layout = a->layout, .len = 0, .terms = NULL};
+
+    if (a->len == 0 || b->len == 0)
+    {
+        if (c != NULL && c->len > 0)
+        {
+            res->terms = malloc(c->len * sizeof(DistTerm));
+            assert(res->terms != NULL);
+            memcpy(res->terms, c->terms, c->len * sizeof(DistTerm));
+            res->len = c->len;
+        }
+        return true;
+    }
+
+    poly_exp_t da[DIST_VARS_MAX], db[DIST_VARS_MAX], dc[DIST_VARS_MAX] = {0};
+    size_t strides[DIST_VARS_MAX], cells = 1;
+
+    DistMaxExps(a, da);
+    DistMaxExps(b, db);
+    if (c != NULL)
+        DistMaxExps(c, dc);
+
+    for (unsigned v = a->layout.vars; v-- > 0;)
+    {
+        long deg = (long)da[v] + db[v];
+
+        deg = dc[v] > deg ? dc[v] : deg;
+
+        if (deg >= 1L << (a->layout.width - 1))
+            return false;
+
+        strides[v] = cells;
+        cells = cells <= DIST_DENSE_MAX ? cells * (size_t)(deg + 1) : cells;
+    }
+
+    if (cells <= DIST_DENSE_MAX && cells / DIST_DENSE_RATIO <= a->len * b->len)
+    {
+        DistMulDense(a, b, c, res, strides, cells);
+        return true;
+    }
+
+    return KeyWords(&a->layout) == 1 ? DistMulHeap1(a, b, c, res)
+                                     : DistMulHeap2(a, b, c, res);
+}
+
+bool DistMul(const DistPoly *a, const DistPoly *b, DistPoly *res)
+{
+    return DistMulAdd(a, b, NULL, res);
+}
+
+bool DistFma(const DistPoly *a, const DistPoly *b, const DistPoly *c,
+             DistPoly *res)
+{
+    return DistMulAdd(a, b, c, res);
+}
+
+void DistDestroy(DistPoly *d)
+{
+    free(d->terms);
+    d->terms = NULL;
+    d->len = 0;
+}
@@ -0,0 +1,144 @@
+/** @file
+    Interfejs rozproszonej reprezentacji wielomianów
+
+    Wielomian jest płaską, posortowaną tablicą wyrazów. Wykładniki wszystkich
+    zmiennych wyrazu są upakowane w jeden lub dwa 64-bitowe klucze, więc
+    porównanie i mnożenie jednomianów to porównanie i dodawanie kluczy.
+    Najstarszy bit pola każdej zmiennej jest bitem strażnika: jego zapalenie
+    po dodaniu kluczy oznacza przepełnienie pola.
+
+    @author Aliaksandr Sarokin <as372525@students.mimuw.edu.pl>
+    @copyright Uniwersytet Warszawski
+    @date 2017-06-03
+*/
+
+#ifndef __DIST_H__
+#define __DIST_H__
+
+#include <stdint.h>
+
+#include "poly.h"
+
+/** Maksymalna liczba zmiennych w reprezentacji rozproszonej */
+#define DIST_VARS_MAX 32
+
+/** Słowo klucza wyrazu */
+typedef uint64_t dist_word_t;
+
+/**
+ * Klucz wyrazu: upakowane wykładniki zmiennych.
+ * Zmienna o indeksie 0 zajmuje najstarsze bity `hi`, więc kolejność kluczy
+ * jest leksykograficzną kolejnością wektorów wykładników.
+ */
+typedef struct DistKey
+{
+    dist_word_t hi; ///< starsze słowo
+    dist_word_t lo; ///< młodsze słowo (zerowe, gdy wystarcza jedno słowo)
+} DistKey;
+
+/** Rozmieszczenie pól zmiennych w kluczu */
+typedef struct DistLayout
+{
+    unsigned vars; ///< liczba zmiennych
+    unsigned width; ///< szerokość pola jednej zmiennej razem z bitem strażnika
+    unsigned per_word; ///< liczba pól w jednym słowie
+    DistKey guard; ///< maska bitów strażników
+} DistLayout;
+
+/** Wyraz wielomianu w reprezentacji rozproszonej */
+typedef struct DistTerm
+{
+    DistKey key; ///< upakowane wykładniki
+    poly_coeff_t coeff; ///< niezerowy współczynnik
+} DistTerm;
+
+/** Wielomian w reprezentacji rozproszonej, wyrazy rosnąco według kluczy */
+typedef struct DistPoly
+{
+    DistLayout layout; ///< rozmieszczenie pól w kluczach
+    size_t len; ///< liczba wyrazów
+    DistTerm *terms; ///< wyrazy
+} DistPoly;
+
+/**
+ * Wyznacza rozmieszczenie pól dla @p vars zmiennych o wykładnikach
+ * nie większych niż @p max_exp.
+ * @param[out] l : rozmieszczenie pól
+ * @param[in] vars : liczba zmiennych
+ * @param[in] max_exp : maksymalny wykładnik
+ * @return czy pola mieszczą się w dwóch słowach
+ */
+bool DistLayoutInit(DistLayout *l, unsigned vars, poly_exp_t max_exp);
+
+/**
+ * Daje liczbę zmiennych wielomianu, czyli głębokość jego zagnieżdżenia.
+ * @param[in] p : wielomian
+ * @return liczba zmiennych
+ */
+unsigned DistVars(const Poly *p);
+
+/**
+ * Wyznacza maksymalne wykładniki kolejnych zmiennych wielomianu
+ * i zlicza jego niezerowe wyrazy.
+ * Tablica @p degs musi być wcześniej wypełniona (np. zerami).
+ * @param[in] p : wielomian
+ * @param[in,out] degs : maksymalne wykładniki zmiennych
+ * @return liczba wyrazów
+ */
+size_t DistDegrees(const Poly *p, poly_exp_t degs[]);
+
+/**
+ * Przerabia wielomian na reprezentację rozproszoną.
+ * @param[in] p : wielomian
+ * @param[in] l : rozmieszczenie pól, mieszczące wykładniki @p p
+ * @return wielomian w reprezentacji rozproszonej
+ */
+DistPoly DistFromPoly(const Poly *p, const DistLayout *l);
+
+/**
+ * Przerabia wielomian z reprezentacji rozproszonej na zwykły wielomian.
+ * @param[in] d : wielomian w reprezentacji rozproszonej
+ * @return wielomian
+ */
+Poly DistToPoly(const DistPoly *d);
+
+/**
+ * Dodaje dwa wielomiany o tym samym rozmieszczeniu pól.
+ * @param[in] a : wielomian
+ * @param[in] b : wielomian
+ * @return `a + b`
+ */
+DistPoly DistAdd(const DistPoly *a, const DistPoly *b);
+
+/**
+ * Mnoży dwa wielomiany o tym samym rozmieszczeniu pól.
+ * Gdy prostopadłościan wykładników iloczynu jest mały, iloczyny wyrazów są
+ * sumowane w gęstej tablicy, a wpp scalane kopcem. Gdy @p a i @p b są tym
+ * samym wskaźnikiem, liczy kwadrat, mnożąc każdą parę różnych wyrazów raz.
+ * @param[in] a : wielomian
+ * @param[in] b : wielomian
+ * @param[out] res : `a * b`
+ * @return czy wykładniki iloczynu zmieściły się w polach
+ */
+bool DistMul(const DistPoly *a, const DistPoly *b, DistPoly *res);
+
+/**
+ * Liczy `a * b + c` dla wielomianów o tym samym rozmieszczeniu pól, nie
+ * tworząc iloczynu osobno: wyrazy @p c są dodawane do gęstej tablicy
+ * albo wplatane w scalanie kopcem (patrz `DistMul`).
+ * @param[in] a : wielomian
+ * @param[in] b : wielomian
+ * @param[in] c : składnik
+ * @param[out] res : `a * b + c`
+ * @return czy wykładniki wyniku zmieściły się w polach
+ */
+bool DistFma(const DistPoly *a, const DistPoly *b, const DistPoly *c,
+             DistPoly *res);
+
+/**
+ * Usuwa wielomian w reprezentacji rozproszonej z pamięci.
+ * @param[in] d : wielomian
+ */
+void DistDestroy(DistPoly *d);
+
+#endif /* __DIST_H__ */
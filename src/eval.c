@@ -0,0 +1,317 @@
+/** @file
+    Implementacja probabilistycznego porównywania wielomianów
+
+    @author Aliaksandr Sarokin <as372525@students.mimuw.edu.pl>
+    @copyright Uniwersytet Warszawski
+    @date 2017-06-03
+*/
+
+#include <stdlib.h>
+#include <assert.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "eval.h"
+#include "tree.h"
+#include "utils.h"
+
+/** Liczba pierwsza Mersenne'a @f$2^{61} - 1@f$, moduł wartości */
+#define EVAL_PRIME (((uint64_t)1 << 61) - 1)
+
+/** Liczba rund z niezależnymi punktami */
+#define EVAL_ROUNDS 4
+
+/** Minimalna liczba wyrazów argumentów, od której rundy liczą wątki */
+#define EVAL_PARALLEL_MIN_TERMS 4096
+
+/** Krok ciągu ziaren losowych punktów */
+#define EVAL_GOLDEN UINT64_C(0x9e3779b97f4a7c15)
+
+/** Licznik wywołań, z którego powstają ziarna kolejnych porównań */
+static atomic_uint_fast64_t eval_counter = 0;
+
+/** Jedna runda porównania: wartości obu wielomianów w jednym punkcie */
+typedef struct EvalRound
+{
+    const Poly *p; ///< pierwszy wielomian
+    const Poly *q; ///< drugi wielomian
+    uint64_t seed; ///< ziarno punktu
+    bool equal; ///< czy wartości są równe
+    pthread_t thread; ///< wątek liczący rundę
+    bool started; ///< czy udało się uruchomić wątek
+} EvalRound;
+
+/** Suma wyrazów jednej listy liczona w kolejności rosnących wykładników */
+typedef struct EvalSum
+{
+    uint64_t x; ///< wartość zmiennej listy
+    poly_exp_t exp; ///< wykładnik ostatniego wyrazu
+    uint64_t pw; ///< @f$x^{exp}@f$
+    uint64_t sum; ///< suma dotychczasowych wyrazów
+} EvalSum;
+
+/**
+ * Redukuje liczbę mniejszą od @f$2^{62}@f$ modulo @f$2^{61} - 1@f$.
+ * @param[in] x : liczba
+ * @return reszta
+ */
+static inline uint64_t EvalReduce(uint64_t x)
+{
+    x = (x & EVAL_PRIME) + (x >> 61);
+
+    return x >= EVAL_PRIME ? x - EVAL_PRIME : x;
+}
+
+/**
+ * Mnoży reszty modulo @f$2^{61} - 1@f$.
+ * @param[in] a : reszta
+ * @param[in] b : reszta
+ * @return @f$ab@f$ modulo @f$2^{61} - 1@f$
+ */
+static inline uint64_t EvalMul(uint64_t a, uint64_t b)
+{
+    unsigned __int128 x = (unsigned __int128)a * b;
+
+    return EvalReduce(((uint64_t)x & EVAL_PRIME) + (uint64_t)(x >> 61));
+}
+
+/**
+ * Podnosi resztę do potęgi.
+ * @param[in] x : reszta
+ * @param[in] e : nieujemny wykładnik
+ * @return @f$x^e@f$ modulo @f$2^{61} - 1@f$
+ */
+static uint64_t EvalPow(uint64_t x, poly_exp_t e)
+{
+    uint64_t res = 1;
+
+    for (; e > 0; e >>= 1)
+    {
+        if (e & 1)
+            res = EvalMul(res, x);
+        x = EvalMul(x, x);
+    }
+
+    return res;
+}
+
+/**
+ * Miesza bity liczby (funkcja końcowa splitmix64).
+ * @param[in] x : liczba
+ * @return wymieszana liczba
+ */
+static inline uint64_t EvalMix(uint64_t x)
+{
+    x = (x ^ (x >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+    x = (x ^ (x >> 27)) * UINT64_C(0x94d049bb133111eb);
+
+    return x ^ (x >> 31);
+}
+
+/**
+ * Daje współrzędną losowego punktu rundy. Współrzędna 0 służy do
+ * kodowania współczynników, współrzędna `k + 1` jest wartością @f$x_k@f$.
+ * @param[in] seed : ziarno rundy
+ * @param[in] k : numer współrzędnej
+ * @return niezerowa reszta modulo @f$2^{61} - 1@f$
+ */
+static inline uint64_t EvalPoint(uint64_t seed, unsigned k)
+{
+    return EvalMix(seed + (k + 1) * EVAL_GOLDEN) % (EVAL_PRIME - 1) + 1;
+}
+
+/**
+ * Koduje współczynnik jako resztę @f$h r + l@f$, gdzie @f$h@f$ i @f$l@f$
+ * to starsze i młodsze 32 bity współczynnika. Kodowanie jest liniowe
+ * w losowym @p r, więc różne współczynniki dają różne reszty z dużym
+ * prawdopodobieństwem, także gdy różnią się o wielokrotność modułu.
+ * @param[in] c : współczynnik
+ * @param[in] r : losowa reszta
+ * @return kod współczynnika
+ */
+static inline uint64_t EvalCoeff(poly_coeff_t c, uint64_t r)
+{
+    uint64_t u = (uint64_t)c;
+
+    return EvalReduce(EvalMul(u >> 32, r) + (u & UINT32_MAX));
+}
+
+/**
+ * Dodaje do sumy wyraz @f$v x^e@f$; wykładniki kolejnych wyrazów nie
+ * maleją.
+ * @param[in,out] s : suma
+ * @param[in] e : wykładnik
+ * @param[in] v : wartość współczynnika
+ */
+static inline void EvalTerm(EvalSum *s, poly_exp_t e, uint64_t v)
+{
+    if (e != s->exp)
+    {
+        s->pw = EvalMul(s->pw, e - s->exp == 1 ? s->x : EvalPow(s->x, e - s->exp));
+        s->exp = e;
+    }
+    s->sum = EvalReduce(s->sum + EvalMul(s->pw, v));
+}
+
+static uint64_t EvalPoly(const Poly *p, unsigned depth, uint64_t seed,
+                         uint64_t r);
+
+/**
+ * Dodaje do sumy wyrazy drzewa w kolejności rosnących wykładników.
+ * @param[in] t : drzewo albo `NULL`
+ * @param[in,out] s : suma
+ * @param[in] depth : indeks zmiennej drzewa
+ * @param[in] seed : ziarno rundy
+ * @param[in] r : kod współczynników
+ */
+static void EvalTree(const TreeNode *t, EvalSum *s, unsigned depth,
+                     uint64_t seed, uint64_t r)
+{
+    for (; t != NULL; t = t->right)
+    {
+        EvalTree(t->left, s, depth, seed, r);
+        EvalTerm(s, t->exp, EvalPoly(&t->p, depth + 1, seed, r));
+    }
+}
+
+/**
+ * Wylicza wartość wielomianu w punkcie rundy jednym przejściem po jego
+ * wyrazach; bloki gęste są liczone schematem Hornera od najniższego
+ * wyrazu.
+ * @param[in] p : wielomian nad zmienną @f$x_{depth}@f$
+ * @param[in] depth : indeks pierwszej zmiennej wielomianu
+ * @param[in] seed : ziarno rundy
+ * @param[in] r : kod współczynników
+ * @return wartość modulo @f$2^{61} - 1@f$
+ */
+static uint64_t EvalPoly(const Poly *p, unsigned depth, uint64_t seed,
+                         uint64_t r)
+{
+    if (PolyIsCoeff(p))
+        return EvalCoeff(p->c, r);
+
+    EvalSum s = {.x = EvalPoint(seed, depth + 1), .exp = 0, .pw = 1,
+                 .sum = 0};
+
+    if (PolyIsTree(p))
+    {
+        EvalTree(NodeTree(p->l), &s, depth, seed, r);
+        return s.sum;
+    }
+
+    for (const Node *n = p->l; n != NULL; n = n->next)
+    {
+        if (NodeIsBlock(n))
+        {
+            const Block *b = NodeBlock(n);
+
+            EvalTerm(&s, b->start, EvalCoeff(b->coeffs[0], r));
+            for (unsigned i = 1; i < b->len; i++)
+            {
+                s.pw = EvalMul(s.pw, s.x);
+                s.sum = EvalReduce(s.sum + EvalMul(s.pw, EvalCoeff(b->coeffs[i], r)));
+            }
+            s.exp = b->start + (poly_exp_t)b->len - 1;
+        }
+        else if (NodeIsLeaf(n))
+        {
+            const Leaf *l = NodeLeaf(n);
+            const poly_exp_t *exps = LeafExps(l);
+
+            for (unsigned i = 0; i < l->len; i++)
+                EvalTerm(&s, exps[i], EvalCoeff(l->coeffs[i], r));
+        }
+        else
+        {
+            EvalTerm(&s, n->m.exp, EvalPoly(&n->m.p, depth + 1, seed, r));
+        }
+    }
+
+    return s.sum;
+}
+
+/**
+ * Porównuje wartości wielomianów w punkcie rundy.
+ * Funkcja wątku roboczego.
+ * @param[in,out] arg : runda
+ * @return `NULL`
+ */
+static void* EvalRoundRun(void *arg)
+{
+    EvalRound *round = arg;
+    uint64_t r = EvalPoint(round->seed, 0);
+
+    round->equal = EvalPoly(round->p, 0, round->seed, r)
+                   == EvalPoly(round->q, 0, round->seed, r);
+
+    return NULL;
+}
+
+/**
+ * Liczy wyrazy wielomianu, przerywając po osiągnięciu limitu. W drzewie
+ * liczone są tylko wyrazy najwyższego poziomu.
+ * @param[in] p : wielomian
+ * @param[in] cap : limit
+ * @return liczba wyrazów albo co najmniej @p cap
+ */
+static size_t EvalTerms(const Poly *p, size_t cap)
+{
+    if (PolyIsCoeff(p))
+        return 1;
+
+    if (PolyIsTree(p))
+        return TreeSize(NodeTree(p->l));
+
+    size_t res = 0;
+
+    for (const Node *n = p->l; n != NULL && res < cap; n = n->next)
+    {
+        if (NodeIsBlock(n))
+            res += NodeBlock(n)->len;
+        else if (NodeIsLeaf(n))
+            res += NodeLeaf(n)->len;
+        else
+            res += EvalTerms(&n->m.p, cap - res);
+    }
+
+    return res;
+}
+
+bool EvalIsEq(const Poly *p, const Poly *q)
+{
+    EvalRound rounds[EVAL_ROUNDS];
+    uint64_t base = EvalMix(atomic_fetch_add(&eval_counter, 1) * EVAL_GOLDEN
+                            ^ (uint64_t)time(NULL));
+    size_t terms = EvalTerms(p, EVAL_PARALLEL_MIN_TERMS);
+    bool parallel = terms >= EVAL_PARALLEL_MIN_TERMS
+                    || terms + EvalTerms(q, EVAL_PARALLEL_MIN_TERMS - terms)
+                       >= EVAL_PARALLEL_MIN_TERMS;
+
+    for (unsigned i = 0; i < EVAL_ROUNDS; i++)
+        rounds[i] = (EvalRound) {.p = p, .q = q,
+                                 .seed = EvalMix(base + i * EVAL_GOLDEN),
+                                 .equal = false, .started = false};
+
+    for (unsigned i = 1; parallel && i < EVAL_ROUNDS; i++)
+        rounds[i].started = pthread_create(&rounds[i].thread, NULL,
+                                           EvalRoundRun, &rounds[i]) == 0;
+
+    EvalRoundRun(&rounds[0]);
+
+    bool res = rounds[0].equal;
+
+    /* Bez wątków kolejne rundy liczymy tylko, dopóki wartości są równe. */
+    for (unsigned i = 1; i < EVAL_ROUNDS; i++)
+    {
+        if (rounds[i].started)
+            pthread_join(rounds[i].thread, NULL);
+        else if (res)
+            EvalRoundRun(&rounds[i]);
+        else
+            continue;
+        res &= rounds[i].equal;
+    }
+
+    return res;
+}
@@ -0,0 +1,28 @@
+/** @file
+    Interfejs probabilistycznego porównywania wielomianów
+
+    Wielomiany są porównywane przez wartości w losowych punktach modulo
+    liczba pierwsza @f$2^{61} - 1@f$ (lemat Schwartza–Zippela). Wartość
+    liczona jest jednym przejściem po wyrazach wielomianu, bez tworzenia
+    różnicy ani innych wielomianów pośrednich.
+
+    @author Aliaksandr Sarokin <as372525@students.mimuw.edu.pl>
+    @copyright Uniwersytet Warszawski
+    @date 2017-06-03
+*/
+
+#ifndef __EVAL_H__
+#define __EVAL_H__
+
+#include "poly.h"
+
+/**
+ * Sprawdza równość wielomianów z małym prawdopodobieństwem błędu
+ * (patrz `PolyIsEqFast`).
+ * @param[in] p : wielomian
+ * @param[in] q : wielomian
+ * @return `false`, gdy wielomiany na pewno są różne, wpp `true`
+ */
+bool EvalIsEq(const Poly *p, const Poly *q);
+
+#endif /* __EVAL_H__ */
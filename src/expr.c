@@ -0,0 +1,318 @@
+/** @file
+    Implementacja leniwych wyrażeń kalkulatora
+
+    @author Aliaksandr Sarokin <as372525@students.mimuw.edu.pl>
+    @copyright Uniwersytet Warszawski
+    @date 2017-06-03
+*/
+
+#include <stdlib.h>
+#include <assert.h>
+#include <limits.h>
+
+#include "expr.h"
+#include "utils.h"
+
+/**
+ * Tworzy wyrażenie bez składników.
+ * @param[in] kind : rodzaj
+ * @return wyrażenie
+ */
+static Expr* ExprNew(ExprKind kind)
+{
+    Expr *res = malloc(sizeof(Expr));
+    assert(res != NULL);
+
+    *res = (Expr) {.refs = 1, .kind = kind, .p = PolyZero(), .len = 0,
+                   .cap = 0, .terms = NULL};
+
+    return res;
+}
+
+Expr* ExprFromPoly(Poly p)
+{
+    Expr *res = ExprNew(EXPR_POLY);
+
+    res->p = p;
+
+    return res;
+}
+
+Expr* ExprRetain(Expr *e)
+{
+    e->refs++;
+
+    return e;
+}
+
+/**
+ * Zwalnia składniki wyrażenia, zostawiając samą tablicę.
+ * @param[in,out] e : wyrażenie
+ */
+static void ExprReleaseTerms(Expr *e)
+{
+    for (unsigned i = 0; i < e->len; i++)
+        ExprRelease(e->terms[i].e);
+    free(e->terms);
+    e->terms = NULL;
+    e->len = 0;
+    e->cap = 0;
+}
+
+void ExprRelease(Expr *e)
+{
+    if (--e->refs > 0)
+        return;
+
+    PolyDestroy(&e->p);
+    ExprReleaseTerms(e);
+    free(e);
+}
+
+/**
+ * Dopisuje składnik, przejmując odwołanie do niego.
+ * @param[in,out] e : wyrażenie
+ * @param[in] t : wyrażenie składnika
+ * @param[in] neg : znak składnika
+ */
+static void ExprPush(Expr *e, Expr *t, bool neg)
+{
+    if (e->len == e->cap)
+    {
+        e->cap = e->cap == 0 ? 4 : 2 * e->cap;
+        e->terms = realloc(e->terms, e->cap * sizeof(ExprTerm));
+        assert(e->terms != NULL);
+    }
+
+    e->terms[e->len++] = (ExprTerm) {.e = t, .neg = neg};
+}
+
+/**
+ * Dopisuje do sumy wyrażenie, przejmując odwołanie do niego.
+ * Niewspółdzielona suma oddaje swoje składniki; współdzielone sumy
+ * i iloczyny są liczone od razu, bo ich wartość i tak będzie potrzebna
+ * więcej niż raz.
+ * @param[in,out] sum : suma
+ * @param[in] x : wyrażenie
+ * @param[in] neg : czy odjąć @p x
+ */
+static void ExprAppend(Expr *sum, Expr *x, bool neg)
+{
+    if (x->kind == EXPR_SUM && x->refs == 1)
+    {
+        for (unsigned i = 0; i < x->len; i++)
+            ExprPush(sum, x->terms[i].e, x->terms[i].neg != neg);
+        free(x->terms);
+        free(x);
+        return;
+    }
+
+    if (x->refs > 1)
+        ExprForce(x);
+
+    if (x->kind == EXPR_POLY && PolyIsZero(&x->p))
+        ExprRelease(x);
+    else
+        ExprPush(sum, x, neg);
+}
+
+Expr* ExprAdd(Expr *a, Expr *b, bool sub)
+{
+    Expr *res = ExprNew(EXPR_SUM);
+
+    ExprAppend(res, a, false);
+    ExprAppend(res, b, sub);
+
+    return res;
+}
+
+Expr* ExprNeg(Expr *a)
+{
+    if (a->refs == 1 && a->kind == EXPR_SUM)
+    {
+        for (unsigned i = 0; i < a->len; i++)
+            a->terms[i].neg = !a->terms[i].neg;
+        return a;
+    }
+
+    if (a->refs == 1 && a->kind == EXPR_PROD)
+    {
+        a->terms[0].neg = !a->terms[0].neg;
+        return a;
+    }
+
+    Expr *res = ExprNew(EXPR_SUM);
+
+    ExprAppend(res, a, true);
+
+    return res;
+}
+
+/**
+ * Przygotowuje czynnik iloczynu: zdejmuje z niego negację i liczy go.
+ * @param[in] x : wyrażenie, przejmowane
+ * @param[in,out] neg : znak czynnika
+ * @return policzony czynnik
+ */
+static Expr* ExprFactor(Expr *x, bool *neg)
+{
+    if (x->kind == EXPR_SUM && x->refs == 1 && x->len == 1)
+    {
+        Expr *t = x->terms[0].e;
+
+        *neg = x->terms[0].neg != *neg;
+        free(x->terms);
+        free(x);
+        x = t;
+    }
+
+    if (x->kind == EXPR_PROD && x->refs == 1)
+    {
+        *neg = x->terms[0].neg != *neg;
+        x->terms[0].neg = false;
+    }
+
+    ExprForce(x);
+
+    return x;
+}
+
+Expr* ExprMul(Expr *a, Expr *b)
+{
+    Expr *res = ExprNew(EXPR_PROD);
+    bool neg = false;
+
+    a = ExprFactor(a, &neg);
+    b = ExprFactor(b, &neg);
+    ExprPush(res, a, neg);
+    ExprPush(res, b, false);
+
+    return res;
+}
+
+/**
+ * Przybliża liczbę wyrazów wielomianu liczbą elementów jego listy.
+ * @param[in] p : wielomian
+ * @return liczba elementów listy (0 dla stałej, `UINT_MAX` dla drzewa)
+ */
+static unsigned ExprPolyLen(const Poly *p)
+{
+    if (PolyIsCoeff(p))
+        return 0;
+
+    return PolyIsTree(p) ? UINT_MAX : ListLen(p->l);
+}
+
+/**
+ * Liczy iloczyn dwóch policzonych czynników, który nie jest składnikiem
+ * sumy. Ujemny iloczyn nie ma konsumenta, który przejąłby znak, więc znak
+ * trafia na czynnik o mniejszej liczbie wyrazów.
+ * @param[in] e : iloczyn
+ * @return wartość
+ */
+static Poly ExprProdValue(const Expr *e)
+{
+    const Poly *a = &e->terms[0].e->p, *b = &e->terms[1].e->p;
+
+    if (!e->terms[0].neg)
+        return PolyMul(a, b);
+
+    if (ExprPolyLen(b) < ExprPolyLen(a))
+    {
+        const Poly *tmp = a;
+        a = b;
+        b = tmp;
+    }
+
+    Poly na = PolyNeg(a), res = PolyMul(&na, b);
+
+    PolyDestroy(&na);
+
+    return res;
+}
+
+/**
+ * Liczy sumę. Składniki będące wielomianami sumuje jedno scalanie
+ * (`PolyAddAll`), a iloczyny są dopisywane przez `PolyFmaTake`, więc
+ * żaden iloczyn nie powstaje jako osobny wielomian. Iloczyny odejmowane
+ * trafiają do drugiej sumy, odejmowanej na końcu przez znak w `PolyAddAll`.
+ * @param[in] e : suma
+ * @return wartość
+ */
+static Poly ExprSumValue(const Expr *e)
+{
+    Poly *ps = malloc((e->len + 1) * sizeof(Poly));
+    bool *neg = malloc((e->len + 1) * sizeof(bool));
+    unsigned n = 0;
+    assert(ps != NULL && neg != NULL);
+
+    for (unsigned i = 0; i < e->len; i++)
+    {
+        if (e->terms[i].e->kind != EXPR_PROD)
+        {
+            ps[n] = e->terms[i].e->p;
+            neg[n++] = e->terms[i].neg;
+        }
+    }
+
+    /* sums[1] to suma iloczynów, które trzeba odjąć. */
+    Poly sums[2] = {PolyAddAll(n, ps, neg), PolyZero()};
+
+    for (unsigned i = 0; i < e->len; i++)
+    {
+        const Expr *t = e->terms[i].e;
+
+        if (t->kind == EXPR_PROD)
+        {
+            bool sub = e->terms[i].neg != t->terms[0].neg;
+
+            sums[sub] = PolyFmaTake(&t->terms[0].e->p, &t->terms[1].e->p,
+                                    &sums[sub]);
+        }
+    }
+
+    free(ps);
+    free(neg);
+
+    if (PolyIsZero(&sums[1]))
+        return sums[0];
+
+    bool signs[] = {false, true};
+    Poly res = PolyAddAll(2, sums, signs);
+
+    PolyDestroy(&sums[0]);
+    PolyDestroy(&sums[1]);
+
+    return res;
+}
+
+void ExprForce(Expr *e)
+{
+    if (e->kind == EXPR_POLY)
+        return;
+
+    e->p = e->kind == EXPR_PROD ? ExprProdValue(e) : ExprSumValue(e);
+
+    ExprReleaseTerms(e);
+    e->kind = EXPR_POLY;
+}
+
+Poly ExprTake(Expr *e)
+{
+    ExprForce(e);
+
+    if (e->refs > 1)
+    {
+        Poly res = PolyClone(&e->p);
+
+        ExprRelease(e);
+
+        return res;
+    }
+
+    Poly res = e->p;
+
+    free(e);
+
+    return res;
+}
@@ -0,0 +1,114 @@
+/** @file
+    Interfejs leniwych wyrażeń kalkulatora
+
+    W trybie leniwym polecenia `ADD`, `SUB`, `NEG` i `MUL` nie liczą wyniku,
+    tylko budują wyrażenie. Sumy są płaskie: suma dołączana do sumy oddaje
+    jej składniki, a negacja zmienia tylko znaki składników, więc długi
+    ciąg dodawań i odejmowań daje jedną sumę wielu składników. Iloczyny
+    czekają na policzenie, aż trafią do sumy albo zostaną użyte. Wartość
+    sumy liczona jest jednym scalaniem składników będących wielomianami
+    (patrz `PolyAddAll`), bez sum częściowych, a iloczyny są do niej
+    dopisywane przez `PolyFmaTake`, bez tworzenia samych iloczynów.
+
+    @author Aliaksandr Sarokin <as372525@students.mimuw.edu.pl>
+    @copyright Uniwersytet Warszawski
+    @date 2017-06-03
+*/
+
+#ifndef __EXPR_H__
+#define __EXPR_H__
+
+#include "poly.h"
+
+/** Rodzaj wyrażenia */
+typedef enum ExprKind
+{
+    EXPR_POLY, ///< policzony wielomian
+    EXPR_SUM, ///< suma składników ze znakami
+    EXPR_PROD ///< iloczyn dwóch policzonych czynników
+} ExprKind;
+
+struct Expr;
+
+/** Składnik sumy albo czynnik iloczynu */
+typedef struct ExprTerm
+{
+    struct Expr *e; ///< wyrażenie, do którego składnik ma odwołanie
+    bool neg; ///< czy składnik jest odejmowany (w iloczynie: czy jest ujemny)
+} ExprTerm;
+
+/**
+ * Wyrażenie. Wyrażenia mają liczniki odwołań, więc `CLONE` współdzieli
+ * wyrażenie zamiast je kopiować. Składnikami sum i czynnikami iloczynów są
+ * tylko wielomiany i niewspółdzielone iloczyny, więc policzenie wyrażenia
+ * nie wymaga głębokiej rekursji.
+ */
+typedef struct Expr
+{
+    unsigned refs; ///< liczba odwołań
+    ExprKind kind; ///< rodzaj
+    Poly p; ///< wartość wyrażenia `EXPR_POLY`
+    unsigned len; ///< liczba składników albo czynników
+    unsigned cap; ///< pojemność tablicy `terms`
+    ExprTerm *terms; ///< składniki sumy albo dwa czynniki iloczynu
+} Expr;
+
+/**
+ * Tworzy wyrażenie będące wielomianem. Przejmuje wielomian na własność.
+ * @param[in] p : wielomian
+ * @return wyrażenie
+ */
+Expr* ExprFromPoly(Poly p);
+
+/**
+ * Zwiększa licznik odwołań wyrażenia.
+ * @param[in] e : wyrażenie
+ * @return @p e
+ */
+Expr* ExprRetain(Expr *e);
+
+/**
+ * Zmniejsza licznik odwołań wyrażenia i zwalnia je przy zerze.
+ * @param[in] e : wyrażenie
+ */
+void ExprRelease(Expr *e);
+
+/**
+ * Tworzy sumę `a + b` albo różnicę `a - b`. Przejmuje odwołania do
+ * argumentów.
+ * @param[in] a : wyrażenie
+ * @param[in] b : wyrażenie
+ * @param[in] sub : czy odjąć @p b
+ * @return wyrażenie
+ */
+Expr* ExprAdd(Expr *a, Expr *b, bool sub);
+
+/**
+ * Tworzy wyrażenie przeciwne. Przejmuje odwołanie do argumentu.
+ * @param[in] a : wyrażenie
+ * @return wyrażenie
+ */
+Expr* ExprNeg(Expr *a);
+
+/**
+ * Tworzy iloczyn. Przejmuje odwołania do argumentów.
+ * @param[in] a : wyrażenie
+ * @param[in] b : wyrażenie
+ * @return wyrażenie
+ */
+Expr* ExprMul(Expr *a, Expr *b);
+
+/**
+ * Liczy wartość wyrażenia; wyrażenie staje się wielomianem.
+ * @param[in,out] e : wyrażenie
+ */
+void ExprForce(Expr *e);
+
+/**
+ * Daje wartość wyrażenia, zwalniając odwołanie do niego.
+ * @param[in] e : wyrażenie
+ * @return wielomian
+ */
+Poly ExprTake(Expr *e);
+
+#endif /* __EXPR_H__ */
@@ -0,0 +1,1347 @@
+/** @file
+    Implementacja modularnego NWD wielomianów wielu zmiennych
+
+    @author Aliaksandr Sarokin <as372525@students.mimuw.edu.pl>
+    @copyright Uniwersytet Warszawski
+    @date 2017-06-03
+*/
+
+#include <stdlib.h>
+#include <assert.h>
+#include <pthread.h>
+
+#include "coeff.h"
+#include "gcd.h"
+#include "utils.h"
+
+/** Początek malejącego ciągu kandydatów na moduły obrazów NWD */
+#define GCD_PRIME_START ((uint64_t)1 << (POLY_COEFF_BITS - 2))
+
+/** Maksymalna liczba bitów iloczynu modułów sklejanych w jednej rundzie */
+#define GCD_CRT_BITS 125
+
+/** Maksymalna liczba modułów w jednej rundzie */
+#define GCD_PRIMES_MAX 8
+
+/** Liczba rund z nowymi modułami, po której rezygnujemy */
+#define GCD_ROUNDS_MAX 4
+
+/** Maksymalna liczba wątków */
+#define GCD_THREADS_MAX 64
+
+/** Minimalna łączna liczba wyrazów argumentów liczonych równolegle */
+#define GCD_PARALLEL_MIN_TERMS 256
+
+/** NWD dwóch wielomianów wraz z dopełniającymi czynnikami */
+typedef struct GcdResult
+{
+    Poly g; ///< NWD
+    Poly a; ///< iloraz pierwszego argumentu przez NWD
+    Poly b; ///< iloraz drugiego argumentu przez NWD
+} GcdResult;
+
+/** Zadanie wykonywane przez wątek roboczy */
+typedef struct GcdJob
+{
+    void (*run)(void *); ///< funkcja zadania
+    void *arg; ///< argument funkcji
+    CoeffModulus mod; ///< moduł arytmetyki zlecającego wątku
+    unsigned budget; ///< liczba wątków, które może zająć zadanie
+    pthread_t thread; ///< wątek wykonujący zadanie
+    bool started; ///< czy udało się uruchomić wątek
+} GcdJob;
+
+/** NWD wartości argumentów w jednym punkcie */
+typedef struct GcdPoint
+{
+    const Poly *a; ///< pierwszy argument
+    const Poly *b; ///< drugi argument
+    unsigned vars; ///< liczba zmiennych argumentów
+    poly_coeff_t x; ///< wartość zmiennej @f$x_0@f$
+    GcdResult r; ///< NWD i dopełnienia wartości
+    bool ok; ///< czy NWD wartości udało się wyznaczyć
+} GcdPoint;
+
+/** NWD argumentów o współczynnikach całkowitych modulo liczba pierwsza */
+typedef struct GcdPrime
+{
+    const Poly *a; ///< pierwszy argument
+    const Poly *b; ///< drugi argument
+    unsigned vars; ///< liczba zmiennych argumentów
+    uint64_t p; ///< moduł
+    uint64_t scale; ///< mnożnik unormowanego obrazu NWD
+    Poly g; ///< obraz NWD pomnożony przez `scale`
+    poly_exp_t *lead; ///< wykładniki wyrazu wiodącego obrazu
+    bool ok; ///< czy obraz udało się wyznaczyć
+} GcdPrime;
+
+/** Stan sklejania obrazów chińskim twierdzeniem o resztach */
+typedef struct GcdCrt
+{
+    unsigned count; ///< liczba modułów
+    uint64_t p[GCD_PRIMES_MAX]; ///< moduły
+    uint64_t inv[GCD_PRIMES_MAX]; ///< odwrotność iloczynu wcześniejszych modułów
+    unsigned __int128 mod; ///< iloczyn modułów
+    unsigned __int128 cont; ///< NWD wartości bezwzględnych współczynników
+    bool fits; ///< czy ilorazy przez `cont` mieszczą się w `poly_coeff_t`
+} GcdCrt;
+
+/**
+ * Liczba wątków, które może jeszcze zająć bieżący wątek;
+ * 0 poza obliczaniem NWD.
+ */
+static _Thread_local unsigned gcd_budget = 0;
+
+static bool GcdModular(const Poly *a, const Poly *b, unsigned vars, bool cof,
+                       GcdResult *r);
+
+/**
+ * Daje liczbę wątków, na które warto dzielić obliczenia.
+ * @return liczba wątków
+ */
+static unsigned GcdThreads(void)
+{
+    unsigned cpus = PolyCpuCount();
+
+    return cpus > GCD_THREADS_MAX ? GCD_THREADS_MAX : cpus;
+}
+
+/**
+ * Wykonuje zadanie z modułem i przydziałem wątków zlecającego.
+ * Funkcja wątku roboczego.
+ * @param[in,out] arg : zadanie (`GcdJob`)
+ * @return `NULL`
+ */
+static void* GcdJobRun(void *arg)
+{
+    GcdJob *job = arg;
+    CoeffModulus mod = coeff_mod;
+    unsigned budget = gcd_budget;
+
+    coeff_mod = job->mod;
+    gcd_budget = job->budget;
+    job->run(job->arg);
+    coeff_mod = mod;
+    gcd_budget = budget;
+
+    return NULL;
+}
+
+/**
+ * Wykonuje zadania, równolegle, jeśli @p parallel i bieżący wątek ma
+ * przydział wątków; pierwsze zadanie wykonuje bieżący wątek.
+ * @param[in] count : liczba zadań
+ * @param[in] run : funkcja zadania
+ * @param[in,out] args : tablica argumentów
+ * @param[in] size : rozmiar argumentu
+ * @param[in] parallel : czy zadania są dość duże, by liczyć je w wątkach
+ */
+static void GcdRunJobs(unsigned count, void (*run)(void *), void *args,
+                       size_t size, bool parallel)
+{
+    GcdJob *jobs = malloc(count * sizeof(GcdJob));
+    assert(jobs != NULL);
+
+    parallel &= gcd_budget > 1 && count > 1;
+
+    for (unsigned i = 0; i < count; i++)
+        jobs[i] = (GcdJob) {
+            .run = run, .arg = (char *)args + i * size, .mod = coeff_mod,
+            .budget = parallel && gcd_budget / count > 1 ? gcd_budget / count : 1,
+            .started = false
+        };
+
+    for (unsigned i = 1; parallel && i < count; i++)
+        jobs[i].started = pthread_create(&jobs[i].thread, NULL, GcdJobRun,
+                                         &jobs[i]) == 0;
+
+    GcdJobRun(&jobs[0]);
+
+    for (unsigned i = 1; i < count; i++)
+    {
+        if (jobs[i].started)
+            pthread_join(jobs[i].thread, NULL);
+        else
+            GcdJobRun(&jobs[i]);
+    }
+
+    free(jobs);
+}
+
+/**
+ * Liczy niezerowe wyrazy wielomianu.
+ * @param[in] p : wielomian
+ * @return liczba wyrazów
+ */
+static size_t GcdTerms(const Poly *p)
+{
+    if (PolyIsCoeff(p))
+        return p->c != 0;
+
+    size_t res = 0;
+
+    for (ListIter it = ListIterBegin(p->l); it.n != NULL; ListIterNext(&it))
+    {
+        Poly c = ListIterCoeff(&it);
+
+        res += GcdTerms(&c);
+    }
+
+    return res;
+}
+
+/**
+ * Sprawdza, czy NWD wielomianów warto liczyć w wielu wątkach.
+ * @param[in] a : wielomian
+ * @param[in] b : wielomian
+ * @return czy liczyć równolegle
+ */
+static bool GcdParallel(const Poly *a, const Poly *b)
+{
+    return gcd_budget > 1 && GcdTerms(a) + GcdTerms(b) >= GCD_PARALLEL_MIN_TERMS;
+}
+
+/**
+ * Daje wyraz wielomianu o najwyższym wykładniku.
+ * Wynik nie jest kopią: nie wolno go usuwać ani modyfikować.
+ * @param[in] p : wielomian niebędący współczynnikiem
+ * @param[out] e : wykładnik wyrazu
+ * @return współczynnik wyrazu
+ */
+static Poly GcdLast(const Poly *p, poly_exp_t *e)
+{
+    ListIter it = ListIterBegin(p->l), last = it;
+
+    for (; it.n != NULL; ListIterNext(&it))
+        last = it;
+
+    *e = ListIterExp(&last);
+
+    return ListIterCoeff(&last);
+}
+
+/**
+ * Daje współczynnik wiodący wielomianu w porządku leksykograficznym,
+ * w którym najważniejsza jest zmienna @f$x_0@f$.
+ * @param[in] p : wielomian
+ * @return współczynnik wiodący
+ */
+static poly_coeff_t GcdLeadCoeff(const Poly *p)
+{
+    Poly c = *p;
+    poly_exp_t e;
+
+    while (!PolyIsCoeff(&c))
+        c = GcdLast(&c, &e);
+
+    return c.c;
+}
+
+/**
+ * Wyznacza wykładniki wyrazu wiodącego w porządku leksykograficznym.
+ * @param[in] p : wielomian
+ * @param[in] vars : liczba zmiennych, co najmniej `PolyVars(p)`
+ * @param[out] lead : wykładniki kolejnych zmiennych
+ */
+static void GcdLeadExps(const Poly *p, unsigned vars, poly_exp_t lead[])
+{
+    Poly c = *p;
+
+    for (unsigned i = 0; i < vars; i++)
+    {
+        lead[i] = 0;
+        if (!PolyIsCoeff(&c))
+            c = GcdLast(&c, &lead[i]);
+    }
+}
+
+/**
+ * Porównuje leksykograficznie wykładniki wyrazów.
+ * @param[in] a : wykładniki
+ * @param[in] b : wykładniki
+ * @param[in] vars : liczba zmiennych
+ * @return liczba ujemna, zero albo dodatnia, gdy @p a jest mniejszy,
+ * równy albo większy od @p b
+ */
+static int GcdExpsCompare(const poly_exp_t a[], const poly_exp_t b[],
+                          unsigned vars)
+{
+    for (unsigned i = 0; i < vars; i++)
+    {
+        if (a[i] != b[i])
+            return a[i] < b[i] ? -1 : 1;
+    }
+
+    return 0;
+}
+
+/**
+ * Mnoży wielomian przez współczynnik.
+ * @param[in] p : wielomian
+ * @param[in] c : współczynnik
+ * @return @f$c p@f$
+ */
+static Poly GcdScale(const Poly *p, poly_coeff_t c)
+{
+    Poly s = PolyFromCoeff(c);
+
+    return PolyMul(p, &s);
+}
+
+/**
+ * Zamienia wielomian zmiennych @f$x_0, x_1, \ldots@f$ na wielomian zmiennych
+ * @f$x_1, x_2, \ldots@f$, czyli wyraz wolny względem @f$x_0@f$.
+ * Przejmuje wielomian na własność.
+ * @param[in] p : wielomian
+ * @return wielomian o zmiennych przesuniętych o jeden
+ */
+static Poly GcdLift(Poly p)
+{
+    Mono m = MonoFromPoly(&p, 0);
+
+    return PolyAddMonos(1, &m);
+}
+
+/**
+ * Daje dwumian @f$x_0 - x@f$.
+ * @param[in] x : reszta
+ * @return dwumian
+ */
+static Poly GcdLinear(poly_coeff_t x)
+{
+    Mono monos[] = {{.p = PolyFromCoeff(CoeffNeg(x)), .exp = 0},
+                    {.p = PolyFromCoeff(1), .exp = 1}};
+
+    return PolyAddMonos(2, monos);
+}
+
+/**
+ * Dzieli wielomian przez jego współczynnik wiodący.
+ * Przejmuje wielomian na własność.
+ * @param[in] p : niezerowy wielomian o odwracalnym współczynniku wiodącym
+ * @return wielomian o współczynniku wiodącym 1
+ */
+static Poly GcdMonic(Poly p)
+{
+    poly_coeff_t inv;
+    bool ok = CoeffInverse(GcdLeadCoeff(&p), &inv);
+
+    assert(ok);
+    (void)ok;
+
+    if (inv == 1)
+        return p;
+
+    Poly res = GcdScale(&p, inv);
+
+    PolyDestroy(&p);
+
+    return res;
+}
+
+/**
+ * Wyznacza algorytmem Euklidesa unormowany NWD wielomianów zmiennej
+ * @f$x_0@f$ o stałych współczynnikach modulo liczba pierwsza.
+ * @param[in] a : wielomian
+ * @param[in] b : wielomian
+ * @return NWD, zero tylko dla zerowych @p a i @p b
+ */
+static Poly GcdUni(const Poly *a, const Poly *b)
+{
+    Poly x = PolyClone(a), y = PolyClone(b);
+
+    while (!PolyIsZero(&y))
+    {
+        Poly quot, rem;
+
+        if (PolyIsCoeff(&y))
+        {
+            PolyDestroy(&x);
+            return PolyFromCoeff(1);
+        }
+
+        bool ok = PolyDivRem(&x, &y, &quot, &rem);
+        assert(ok);
+        (void)ok;
+
+        PolyDestroy(&quot);
+        PolyDestroy(&x);
+        x = y;
+        y = rem;
+    }
+
+    return PolyIsZero(&x) ? x : GcdMonic(x);
+}
+
+/**
+ * Dodaje do NWD współczynniki wielomianu, który po przeniesieniu
+ * @f$x_0@f$ na ostatnie miejsce ma jako współczynniki na głębokości
+ * @p depth wielomiany zmiennej @f$x_0@f$.
+ * @param[in] p : wielomian
+ * @param[in] depth : liczba pozostałych zmiennych zewnętrznych
+ * @param[in,out] cont : NWD dotychczasowych współczynników
+ */
+static void GcdContentAdd(const Poly *p, unsigned depth, Poly *cont)
+{
+    if (PolyIsCoeff(cont) && !PolyIsZero(cont))
+        return;
+
+    if (depth == 0 || PolyIsCoeff(p))
+    {
+        Poly g = GcdUni(cont, p);
+
+        PolyDestroy(cont);
+        *cont = g;
+        return;
+    }
+
+    for (ListIter it = ListIterBegin(p->l); it.n != NULL; ListIterNext(&it))
+    {
+        Poly c = ListIterCoeff(&it);
+
+        GcdContentAdd(&c, depth - 1, cont);
+    }
+}
+
+/**
+ * Traktuje wielomian jako wielomian zmiennych @f$x_1, \ldots, x_{vars - 1}@f$
+ * o współczynnikach z pierścienia wielomianów zmiennej @f$x_0@f$ i daje
+ * jego zawartość (unormowany NWD współczynników) oraz współczynnik wiodący.
+ * @param[in] p : niezerowy wielomian
+ * @param[in] vars : liczba zmiennych, co najmniej 2
+ * @param[out] cont : zawartość
+ * @param[out] lead : współczynnik wiodący albo `NULL`
+ */
+static void GcdSplit(const Poly *p, unsigned vars, Poly *cont, Poly *lead)
+{
+    assert(vars >= 2);
+
+    unsigned *perm = malloc(vars * sizeof(unsigned));
+    assert(perm != NULL);
+
+    perm[0] = vars - 1;
+    for (unsigned i = 1; i < vars; i++)
+        perm[i] = i - 1;
+
+    Poly t = PolyPermute(p, vars, perm), c = t;
+    poly_exp_t e;
+
+    *cont = PolyZero();
+    GcdContentAdd(&t, vars - 1, cont);
+
+    for (unsigned i = 0; lead != NULL && i + 1 < vars && !PolyIsCoeff(&c); i++)
+        c = GcdLast(&c, &e);
+    if (lead != NULL)
+        *lead = PolyClone(&c);
+
+    PolyDestroy(&t);
+    free(perm);
+}
+
+/**
+ * Dzieli dokładnie wielomian przez wielomian zmiennej @f$x_0@f$.
+ * @param[in] p : dzielna
+ * @param[in] q : dzielnik o odwracalnym współczynniku wiodącym
+ * @return iloraz
+ */
+static Poly GcdDivUni(const Poly *p, const Poly *q)
+{
+    Poly res;
+    bool ok = PolyDivExact(p, q, &res);
+
+    assert(ok);
+    (void)ok;
+
+    return res;
+}
+
+/**
+ * Dopisuje do wielomianu @f$h@f$, wyznaczonego modulo @f$M(x_0)@f$, wartość
+ * w nowym punkcie @f$x@f$: wynik ma wartość @p v w @f$x@f$ i przystaje do
+ * @f$h@f$ modulo @f$M@f$.
+ * @param[in,out] h : wielomian
+ * @param[in] v : wartość w punkcie @p x, przejmowana na własność
+ * @param[in] m : @f$M@f$
+ * @param[in] x : punkt
+ * @param[in] inv : @f$M(x)^{-1}@f$
+ */
+static void GcdInterpolate(Poly *h, Poly v, const Poly *m, poly_coeff_t x,
+                           poly_coeff_t inv)
+{
+    Poly hx = PolyAt(h, x), d = PolySub(&v, &hx);
+
+    if (!PolyIsZero(&d))
+    {
+        Poly t = GcdLift(GcdScale(&d, inv)), mt = PolyMul(m, &t);
+        Poly sum = PolyAdd(h, &mt);
+
+        PolyDestroy(h);
+        PolyDestroy(&t);
+        PolyDestroy(&mt);
+        *h = sum;
+    }
+
+    PolyDestroy(&hx);
+    PolyDestroy(&d);
+    PolyDestroy(&v);
+}
+
+/**
+ * Liczy NWD wartości argumentów w punkcie.
+ * Funkcja zadania.
+ * @param[in,out] arg : punkt (`GcdPoint`)
+ */
+static void GcdPointRun(void *arg)
+{
+    GcdPoint *pt = arg;
+    Poly a = PolyAt(pt->a, pt->x), b = PolyAt(pt->b, pt->x);
+
+    pt->ok = GcdModular(&a, &b, pt->vars - 1, true, &pt->r);
+
+    PolyDestroy(&a);
+    PolyDestroy(&b);
+}
+
+/**
+ * Usuwa NWD i dopełnienia z pamięci.
+ * @param[in] r : wynik
+ * @param[in] cof : czy są dopełnienia
+ */
+static void GcdResultDestroy(GcdResult *r, bool cof)
+{
+    PolyDestroy(&r->g);
+    if (cof)
+    {
+        PolyDestroy(&r->a);
+        PolyDestroy(&r->b);
+    }
+}
+
+/**
+ * Składa wynik algorytmu Browna. Argumenty mają postać @f$a = c_a a'@f$,
+ * @f$b = c_b b'@f$, gdzie @f$c_a, c_b@f$ są zawartościami, a NWD części
+ * pierwotnych to @f$g_0@f$, @f$a' = g_0 a_0@f$, @f$b' = g_0 b_0@f$.
+ * @param[out] r : NWD i dopełnienia
+ * @param[in] cof : czy wyznaczać dopełnienia
+ * @param[in] c : NWD zawartości
+ * @param[in] ca : zawartość @f$a@f$
+ * @param[in] cb : zawartość @f$b@f$
+ * @param[in] g0 : @f$g_0@f$, przejmowany na własność
+ * @param[in] a0 : @f$a_0@f$, przejmowany na własność
+ * @param[in] b0 : @f$b_0@f$, przejmowany na własność
+ */
+static void GcdAssemble(GcdResult *r, bool cof, const Poly *c, const Poly *ca,
+                        const Poly *cb, Poly g0, Poly a0, Poly b0)
+{
+    Poly cg = PolyMul(c, &g0);
+    poly_coeff_t u = GcdLeadCoeff(&cg);
+
+    r->g = GcdMonic(cg);
+
+    /* a = c_a g_0 a_0 = g (u c_a / c) a_0 */
+    if (cof)
+    {
+        Poly fa = GcdDivUni(ca, c), fb = GcdDivUni(cb, c);
+        Poly ua = GcdScale(&fa, u), ub = GcdScale(&fb, u);
+
+        r->a = PolyMul(&ua, &a0);
+        r->b = PolyMul(&ub, &b0);
+
+        PolyDestroy(&fa);
+        PolyDestroy(&fb);
+        PolyDestroy(&ua);
+        PolyDestroy(&ub);
+    }
+
+    PolyDestroy(&g0);
+    PolyDestroy(&a0);
+    PolyDestroy(&b0);
+}
+
+/**
+ * Wyznacza algorytmem Browna NWD wielomianów co najmniej dwóch zmiennych
+ * modulo liczba pierwsza. Zmienna @f$x_0@f$ jest podstawiana w kolejnych
+ * punktach; obrazy o wyrazie wiodącym większym niż najmniejszy znany
+ * pochodzą z pechowych punktów i są pomijane. Interpolowany jest obraz
+ * @f$h = \gamma g / \mathrm{lc}(g)@f$, gdzie @f$\gamma@f$ to NWD
+ * współczynników wiodących części pierwotnych, oraz dopełnienia
+ * @f$\bar a, \bar b@f$. Gdy punktów jest więcej niż stopień
+ * @f$\gamma a'@f$ i @f$\gamma b'@f$, a stopnie się sumują, to
+ * @f$h \bar a = \gamma a'@f$ i @f$h \bar b = \gamma b'@f$ dokładnie.
+ * @param[in] a : niezerowy wielomian
+ * @param[in] b : niezerowy wielomian
+ * @param[in] vars : liczba zmiennych
+ * @param[in] cof : czy wyznaczać dopełnienia
+ * @param[out] r : NWD i dopełnienia
+ * @return czy wystarczyło punktów
+ */
+static bool GcdBrown(const Poly *a, const Poly *b, unsigned vars, bool cof,
+                     GcdResult *r)
+{
+    Poly ca, cb, la, lb;
+
+    GcdSplit(a, vars, &ca, &la);
+    GcdSplit(b, vars, &cb, &lb);
+
+    Poly c = GcdUni(&ca, &cb), pa = GcdDivUni(a, &ca), pb = GcdDivUni(b, &cb);
+    Poly lpa = GcdDivUni(&la, &ca), lpb = GcdDivUni(&lb, &cb);
+    Poly gamma = GcdUni(&lpa, &lpb);
+    poly_exp_t da = PolyDegBy(&pa, 0), db = PolyDegBy(&pb, 0);
+    poly_exp_t bound = PolyDegBy(&gamma, 0) + (da > db ? da : db);
+    bool parallel = GcdParallel(a, b);
+    unsigned batch = parallel ? gcd_budget : 1;
+
+    GcdPoint *pts = malloc(batch * sizeof(GcdPoint));
+    poly_exp_t *best = malloc(2 * vars * sizeof(poly_exp_t)), *cur = best + vars;
+    assert(pts != NULL && best != NULL);
+
+    Poly h = PolyZero(), ha = PolyZero(), hb = PolyZero(), m = PolyZero();
+    poly_exp_t n = 0;
+    uint64_t x = 0;
+    bool done = false, ok = true;
+
+    while (!done && ok)
+    {
+        unsigned k = 0;
+
+        /* Punkty zerujące współczynnik wiodący zmieniają wyraz wiodący. */
+        for (; k < batch && k <= (unsigned)(bound - n) && x < coeff_mod.p; x++)
+        {
+            Poly gx = PolyAt(&gamma, (poly_coeff_t)x);
+            Poly ax = PolyAt(&lpa, (poly_coeff_t)x), bx = PolyAt(&lpb, (poly_coeff_t)x);
+
+            if (gx.c != 0 && ax.c != 0 && bx.c != 0)
+                pts[k++] = (GcdPoint) {.a = &pa, .b = &pb, .vars = vars,
+                                       .x = (poly_coeff_t)x, .ok = false};
+        }
+
+        if (k == 0)
+        {
+            ok = false;
+            break;
+        }
+
+        GcdRunJobs(k, GcdPointRun, pts, sizeof(GcdPoint), parallel);
+
+        for (unsigned i = 0; i < k; i++)
+        {
+            GcdPoint *pt = &pts[i];
+
+            /* Po złożeniu wyniku pozostałe punkty są zbędne. */
+            if (!pt->ok)
+            {
+                ok = done;
+                continue;
+            }
+
+            if (done || !ok)
+            {
+                GcdResultDestroy(&pt->r, true);
+                continue;
+            }
+
+            GcdLeadExps(&pt->r.g, vars - 1, cur);
+
+            /* Dopełnienia części pierwotnych są całymi częściami pierwotnymi. */
+            if (PolyIsCoeff(&pt->r.g))
+            {
+                GcdResultDestroy(&pt->r, true);
+                GcdAssemble(r, cof, &c, &ca, &cb, PolyFromCoeff(1),
+                            PolyClone(&pa), PolyClone(&pb));
+                PolyDestroy(&h);
+                PolyDestroy(&ha);
+                PolyDestroy(&hb);
+                n = 0;
+                done = true;
+                continue;
+            }
+
+            int cmp = n == 0 ? -1 : GcdExpsCompare(cur, best, vars - 1);
+
+            if (cmp > 0)
+            {
+                GcdResultDestroy(&pt->r, true);
+                continue;
+            }
+
+            Poly gx = PolyAt(&gamma, pt->x);
+            Poly v = GcdScale(&pt->r.g, gx.c);
+
+            PolyDestroy(&pt->r.g);
+
+            if (cmp < 0)
+            {
+                /* Wszystkie wcześniejsze punkty były pechowe. */
+                PolyDestroy(&h);
+                PolyDestroy(&ha);
+                PolyDestroy(&hb);
+                PolyDestroy(&m);
+                h = GcdLift(v);
+                ha = GcdLift(pt->r.a);
+                hb = GcdLift(pt->r.b);
+                m = GcdLinear(pt->x);
+                n = 1;
+                for (unsigned j = 0; j + 1 < vars; j++)
+                    best[j] = cur[j];
+            }
+            else
+            {
+                Poly mx = PolyAt(&m, pt->x), lin = GcdLinear(pt->x);
+                poly_coeff_t inv;
+                bool inverted = CoeffInverse(mx.c, &inv);
+
+                assert(inverted);
+                (void)inverted;
+
+                GcdInterpolate(&h, v, &m, pt->x, inv);
+                GcdInterpolate(&ha, pt->r.a, &m, pt->x, inv);
+                GcdInterpolate(&hb, pt->r.b, &m, pt->x, inv);
+
+                Poly next = PolyMul(&m, &lin);
+
+                PolyDestroy(&m);
+                PolyDestroy(&lin);
+                m = next;
+                n++;
+            }
+
+            poly_exp_t dh = PolyDegBy(&h, 0), dg = PolyDegBy(&gamma, 0);
+
+            if (n > bound && dh + PolyDegBy(&ha, 0) == dg + da
+                && dh + PolyDegBy(&hb, 0) == dg + db)
+            {
+                /* h = ch g_0, więc a' = g_0 (ch h_a / gamma). */
+                Poly ch, cha, chb;
+
+                GcdSplit(&h, vars, &ch, NULL);
+                cha = PolyMul(&ch, &ha);
+                chb = PolyMul(&ch, &hb);
+
+                GcdAssemble(r, cof, &c, &ca, &cb, GcdDivUni(&h, &ch),
+                            GcdDivUni(&cha, &gamma), GcdDivUni(&chb, &gamma));
+
+                PolyDestroy(&ch);
+                PolyDestroy(&cha);
+                PolyDestroy(&chb);
+                PolyDestroy(&h);
+                PolyDestroy(&ha);
+                PolyDestroy(&hb);
+                n = 0;
+                done = true;
+            }
+        }
+    }
+
+    if (n > 0)
+    {
+        PolyDestroy(&h);
+        PolyDestroy(&ha);
+        PolyDestroy(&hb);
+    }
+
+    PolyDestroy(&m);
+    free(pts);
+    free(best);
+    PolyDestroy(&ca);
+    PolyDestroy(&cb);
+    PolyDestroy(&la);
+    PolyDestroy(&lb);
+    PolyDestroy(&c);
+    PolyDestroy(&pa);
+    PolyDestroy(&pb);
+    PolyDestroy(&lpa);
+    PolyDestroy(&lpb);
+    PolyDestroy(&gamma);
+
+    return ok;
+}
+
+/**
+ * Wyznacza unormowany NWD niezerowych wielomianów modulo liczba pierwsza.
+ * @param[in] a : niezerowy wielomian
+ * @param[in] b : niezerowy wielomian
+ * @param[in] vars : liczba zmiennych, co najmniej `PolyVars` argumentów
+ * @param[in] cof : czy wyznaczać dopełnienia
+ * @param[out] r : NWD i dopełnienia
+ * @return czy NWD udało się wyznaczyć
+ */
+static bool GcdModular(const Poly *a, const Poly *b, unsigned vars, bool cof,
+                       GcdResult *r)
+{
+    if (!PolyIsCoeff(a) && !PolyIsCoeff(b) && vars >= 2)
+        return GcdBrown(a, b, vars, cof, r);
+
+    r->g = PolyIsCoeff(a) || PolyIsCoeff(b) ? PolyFromCoeff(1) : GcdUni(a, b);
+
+    if (cof && PolyIsCoeff(&r->g))
+    {
+        r->a = PolyClone(a);
+        r->b = PolyClone(b);
+    }
+    else if (cof)
+    {
+        r->a = GcdDivUni(a, &r->g);
+        r->b = GcdDivUni(b, &r->g);
+    }
+
+    return true;
+}
+
+/**
+ * Dzieli współczynniki wielomianu przez liczbę.
+ * @param[in] p : wielomian
+ * @param[in] d : niezerowy dzielnik
+ * @param[out] quot : iloraz
+ * @return czy @p d dzieli wszystkie współczynniki; wpp @p quot jest
+ * nieustawiony
+ */
+static bool GcdDivCoeff(const Poly *p, poly_coeff_t d, Poly *quot)
+{
+    if (CoeffModActive())
+    {
+        poly_coeff_t inv;
+
+        if (!CoeffInverse(d, &inv))
+            return false;
+
+        *quot = GcdScale(p, inv);
+        return true;
+    }
+
+    if (PolyIsCoeff(p))
+    {
+        if (d == -1)
+            *quot = PolyFromCoeff(CoeffNeg(p->c));
+        else if (p->c % d == 0)
+            *quot = PolyFromCoeff(p->c / d);
+        else
+            return false;
+
+        return true;
+    }
+
+    unsigned len = ListLen(p->l), k = 0;
+    Mono *monos = malloc(len * sizeof(Mono));
+    assert(monos != NULL);
+    bool ok = true;
+
+    for (ListIter it = ListIterBegin(p->l); ok && it.n != NULL; ListIterNext(&it))
+    {
+        Poly c = ListIterCoeff(&it);
+
+        monos[k].exp = ListIterExp(&it);
+        ok = GcdDivCoeff(&c, d, &monos[k].p);
+        k += ok;
+    }
+
+    if (ok)
+        *quot = PolyAddMonos(k, monos);
+    else
+        for (unsigned i = 0; i < k; i++)
+            MonoDestroy(&monos[i]);
+
+    free(monos);
+
+    return ok;
+}
+
+/**
+ * Dzieli wielomian przez wielomian, sprawdzając, czy dzielenie jest
+ * dokładne. Dzieli rekurencyjnie współczynniki wiodące względem
+ * @f$x_0@f$, a bez modułu sprawdza podzielność w liczbach całkowitych.
+ * @param[in] p : dzielna
+ * @param[in] q : niezerowy dzielnik
+ * @param[out] quot : iloraz
+ * @return czy @p q dzieli @p p; wpp @p quot jest nieustawiony
+ */
+static bool GcdDivides(const Poly *p, const Poly *q, Poly *quot)
+{
+    if (PolyIsZero(p))
+    {
+        *quot = PolyZero();
+        return true;
+    }
+
+    if (PolyIsCoeff(q))
+        return GcdDivCoeff(p, q->c, quot);
+
+    if (PolyIsCoeff(p))
+        return false;
+
+    poly_exp_t dq, dr = 0;
+    Poly lq = GcdLast(q, &dq), r = PolyClone(p), res = PolyZero();
+    bool ok = true;
+
+    /* Wyraz wiodący reszty znika w każdym kroku, więc jej stopień maleje. */
+    while (ok && !PolyIsZero(&r))
+    {
+        Poly lr = PolyIsCoeff(&r) ? r : GcdLast(&r, &dr), t;
+
+        if (PolyIsCoeff(&r))
+            dr = 0;
+
+        ok = dr >= dq && GcdDivides(&lr, &lq, &t);
+        if (ok)
+        {
+            Mono m = MonoFromPoly(&t, dr - dq);
+            Poly term = PolyAddMonos(1, &m), tq = PolyMul(&term, q);
+            Poly diff = PolySub(&r, &tq), sum = PolyAdd(&res, &term);
+
+            PolyDestroy(&r);
+            PolyDestroy(&res);
+            PolyDestroy(&term);
+            PolyDestroy(&tq);
+            r = diff;
+            res = sum;
+        }
+    }
+
+    PolyDestroy(&r);
+    if (ok)
+        *quot = res;
+    else
+        PolyDestroy(&res);
+
+    return ok;
+}
+
+/**
+ * Wyznacza NWD liczb.
+ * @param[in] a : liczba
+ * @param[in] b : liczba
+ * @return NWD
+ */
+static unsigned __int128 GcdInt(unsigned __int128 a, unsigned __int128 b)
+{
+    while (b != 0)
+    {
+        unsigned __int128 t = a % b;
+
+        a = b;
+        b = t;
+    }
+
+    return a;
+}
+
+/**
+ * Wyznacza NWD wartości bezwzględnych współczynników wielomianu.
+ * @param[in] p : wielomian
+ * @param[in] g : NWD dotychczasowych współczynników
+ * @return NWD
+ */
+static uint64_t GcdContent(const Poly *p, uint64_t g)
+{
+    if (PolyIsCoeff(p))
+        return (uint64_t)GcdInt(g, CoeffAbs(p->c));
+
+    for (ListIter it = ListIterBegin(p->l); g != 1 && it.n != NULL; ListIterNext(&it))
+    {
+        Poly c = ListIterCoeff(&it);
+
+        g = GcdContent(&c, g);
+    }
+
+    return g;
+}
+
+/**
+ * Podnosi liczbę do potęgi modulo @p n.
+ * @param[in] x : podstawa
+ * @param[in] e : wykładnik
+ * @param[in] n : moduł
+ * @return @f$x^e \bmod n@f$
+ */
+static uint64_t GcdPowMod(uint64_t x, uint64_t e, uint64_t n)
+{
+    uint64_t res = 1;
+
+    for (x %= n; e != 0; e >>= 1)
+    {
+        if (e & 1)
+            res = (uint64_t)((unsigned __int128)res * x % n);
+        x = (uint64_t)((unsigned __int128)x * x % n);
+    }
+
+    return res;
+}
+
+/**
+ * Daje następną w dół liczbę pierwszą, która nie dzieli współczynników
+ * wiodących argumentów, więc nie obniża ich wyrazów wiodących.
+ * @param[in] p : poprzednia liczba
+ * @param[in] la : współczynnik wiodący pierwszego argumentu
+ * @param[in] lb : współczynnik wiodący drugiego argumentu
+ * @return liczba pierwsza albo 0, gdy takiej nie ma
+ */
+static uint64_t GcdNextPrime(uint64_t p, uint64_t la, uint64_t lb)
+{
+    while (p > 2)
+    {
+        p--;
+        if (CoeffIsPrime(p) && la % p != 0 && lb % p != 0)
+            return p;
+    }
+
+    return 0;
+}
+
+/**
+ * Liczy obraz NWD modulo liczba pierwsza.
+ * Funkcja zadania.
+ * @param[in,out] arg : moduł i argumenty (`GcdPrime`)
+ */
+static void GcdPrimeRun(void *arg)
+{
+    GcdPrime *t = arg;
+
+    CoeffModSet((poly_coeff_t)t->p);
+
+    Poly a = PolyCoeffReduce(t->a), b = PolyCoeffReduce(t->b);
+    GcdResult r;
+
+    t->ok = GcdModular(&a, &b, t->vars, false, &r);
+    if (t->ok)
+    {
+        GcdLeadExps(&r.g, t->vars, t->lead);
+        t->g = GcdScale(&r.g, (poly_coeff_t)(t->scale % t->p));
+        PolyDestroy(&r.g);
+    }
+
+    PolyDestroy(&a);
+    PolyDestroy(&b);
+}
+
+/**
+ * Skleja współczynniki obrazów w jedną liczbę z przedziału symetrycznego
+ * algorytmem Garnera.
+ * @param[in] crt : moduły
+ * @param[in] r : reszty
+ * @param[out] neg : czy liczba jest ujemna
+ * @return wartość bezwzględna liczby
+ */
+static unsigned __int128 GcdCrtValue(const GcdCrt *crt, const uint64_t r[],
+                                     bool *neg)
+{
+    unsigned __int128 v = r[0], mod = crt->p[0];
+
+    for (unsigned j = 1; j < crt->count; j++)
+    {
+        uint64_t p = crt->p[j], vp = (uint64_t)(v % p);
+        uint64_t d = r[j] >= vp ? r[j] - vp : r[j] + (p - vp);
+        uint64_t t = (uint64_t)((unsigned __int128)d * crt->inv[j] % p);
+
+        v += mod * t;
+        mod *= p;
+    }
+
+    *neg = v > crt->mod / 2;
+
+    return *neg ? crt->mod - v : v;
+}
+
+/**
+ * Skleja obrazy NWD. W pierwszym przejściu (@p build fałszywe) wyznacza
+ * zawartość całkowitą wyniku, w drugim składa wynik podzielony przez nią.
+ * Współczynnik zerowy modulo któryś moduł jest w jego obrazie pominięty.
+ * @param[in] ps : obrazy, po jednym dla każdego modułu
+ * @param[in,out] crt : moduły i zawartość
+ * @param[in] build : czy składać wynik
+ * @return wynik albo zero w pierwszym przejściu
+ */
+static Poly GcdCrtBuild(const Poly ps[], GcdCrt *crt, bool build)
+{
+    unsigned count = crt->count;
+    bool coeffs = true;
+
+    for (unsigned i = 0; i < count; i++)
+        coeffs &= PolyIsCoeff(&ps[i]);
+
+    if (coeffs)
+    {
+        uint64_t r[GCD_PRIMES_MAX] = {0};
+        bool neg;
+
+        for (unsigned i = 0; i < count; i++)
+            r[i] = (uint64_t)ps[i].c;
+
+        unsigned __int128 v = GcdCrtValue(crt, r, &neg);
+
+        if (!build)
+        {
+            crt->cont = GcdInt(crt->cont, v);
+            return PolyZero();
+        }
+
+        v /= crt->cont;
+        if (v > (unsigned __int128)POLY_COEFF_MAX)
+        {
+            crt->fits = false;
+            return PolyZero();
+        }
+
+        return PolyFromCoeff(neg ? -(poly_coeff_t)v : (poly_coeff_t)v);
+    }
+
+    /* Stały obraz to wyraz x_0^0 jednoelementowej listy. */
+    Node nodes[GCD_PRIMES_MAX];
+    ListIter its[GCD_PRIMES_MAX];
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        nodes[i] = (Node) {.m = {.p = ps[i], .exp = 0}, .next = NULL};
+        if (!PolyIsCoeff(&ps[i]))
+            its[i] = ListIterBegin(ps[i].l);
+        else
+            its[i] = ListIterBegin(ps[i].c == 0 ? NULL : &nodes[i]);
+    }
+
+    Mono *monos = NULL;
+    unsigned len = 0, cap = 0;
+
+    while (true)
+    {
+        poly_exp_t e = -1;
+        Poly sub[GCD_PRIMES_MAX];
+
+        for (unsigned i = 0; i < count; i++)
+        {
+            if (its[i].n != NULL && (e < 0 || ListIterExp(&its[i]) < e))
+                e = ListIterExp(&its[i]);
+        }
+
+        if (e < 0)
+            break;
+
+        for (unsigned i = 0; i < count; i++)
+        {
+            sub[i] = PolyZero();
+            if (its[i].n != NULL && ListIterExp(&its[i]) == e)
+            {
+                sub[i] = ListIterCoeff(&its[i]);
+                ListIterNext(&its[i]);
+            }
+        }
+
+        Poly c = GcdCrtBuild(sub, crt, build);
+
+        if (!build)
+            continue;
+
+        if (len == cap)
+        {
+            cap = cap == 0 ? 8 : 2 * cap;
+            monos = realloc(monos, cap * sizeof(Mono));
+            assert(monos != NULL);
+        }
+        monos[len++] = MonoFromPoly(&c, e);
+    }
+
+    Poly res = PolyAddMonos(len, monos);
+
+    free(monos);
+
+    return res;
+}
+
+/**
+ * Odtwarza wielomian o współczynnikach całkowitych z obrazów
+ * @f$\gamma g / \mathrm{lc}(g)@f$ i dzieli go przez zawartość całkowitą.
+ * @param[in] primes : obrazy z jednakowym wyrazem wiodącym
+ * @param[in] count : liczba obrazów
+ * @param[out] g : część pierwotna o dodatnim współczynniku wiodącym
+ * @return czy współczynniki mieszczą się w zakresie
+ */
+static bool GcdReconstruct(const GcdPrime primes[], unsigned count, Poly *g)
+{
+    GcdCrt crt = {.count = count, .mod = 1, .cont = 0, .fits = true};
+    Poly ps[GCD_PRIMES_MAX];
+
+    for (unsigned j = 0; j < count; j++)
+    {
+        uint64_t p = primes[j].p;
+
+        crt.p[j] = p;
+        crt.inv[j] = GcdPowMod((uint64_t)(crt.mod % p), p - 2, p);
+        crt.mod *= p;
+        ps[j] = primes[j].g;
+    }
+
+    GcdCrtBuild(ps, &crt, false);
+    *g = GcdCrtBuild(ps, &crt, true);
+
+    if (crt.fits && GcdLeadCoeff(g) < 0)
+    {
+        Poly neg = PolyNeg(g);
+
+        PolyDestroy(g);
+        *g = neg;
+    }
+
+    if (!crt.fits)
+        PolyDestroy(g);
+
+    return crt.fits;
+}
+
+/**
+ * Wyznacza NWD niezerowych wielomianów o współczynnikach całkowitych.
+ * W każdej rundzie liczy obrazy modulo liczby pierwsze o iloczynie
+ * mieszczącym się w 128 bitach, skleja te o najmniejszym wyrazie wiodącym
+ * i sprawdza wynik dzieleniem próbnym bez przepełnień.
+ * @param[in] a : niezerowy wielomian
+ * @param[in] b : niezerowy wielomian
+ * @param[in] vars : liczba zmiennych
+ * @param[out] g : NWD
+ * @return czy NWD udało się wyznaczyć
+ */
+static bool GcdInteger(const Poly *a, const Poly *b, unsigned vars, Poly *g)
+{
+    uint64_t ca = GcdContent(a, 0), cb = GcdContent(b, 0);
+    uint64_t c = (uint64_t)GcdInt(ca, cb);
+    Poly pa, pb;
+
+    GcdDivCoeff(a, (poly_coeff_t)ca, &pa);
+    GcdDivCoeff(b, (poly_coeff_t)cb, &pb);
+
+    uint64_t la = CoeffAbs(GcdLeadCoeff(&pa)), lb = CoeffAbs(GcdLeadCoeff(&pb));
+    uint64_t gamma = (uint64_t)GcdInt(la, lb), p = GCD_PRIME_START;
+    bool parallel = GcdParallel(a, b), found = false;
+    GcdPrime primes[GCD_PRIMES_MAX];
+    poly_exp_t *leads = malloc(GCD_PRIMES_MAX * (vars + 1) * sizeof(poly_exp_t));
+    assert(leads != NULL);
+    Poly res;
+
+    for (unsigned round = 0; round < GCD_ROUNDS_MAX && !found; round++)
+    {
+        unsigned count = 0, bits = 0;
+
+        while (count < GCD_PRIMES_MAX && (p = GcdNextPrime(p, la, lb)) != 0)
+        {
+            primes[count] = (GcdPrime) {
+                .a = &pa, .b = &pb, .vars = vars, .p = p, .scale = gamma,
+                .lead = leads + count * (vars + 1), .ok = false
+            };
+            count++;
+            bits += 64 - (unsigned)__builtin_clzl(p);
+            if (bits + 64 - (unsigned)__builtin_clzl(p) > GCD_CRT_BITS)
+                break;
+        }
+
+        if (count == 0)
+            break;
+
+        GcdRunJobs(count, GcdPrimeRun, primes, sizeof(GcdPrime), parallel);
+
+        /* Obrazy o większym wyrazie wiodącym pochodzą z pechowych modułów. */
+        unsigned best = count, kept = 0;
+
+        for (unsigned j = 0; j < count; j++)
+        {
+            if (primes[j].ok && (best == count
+                || GcdExpsCompare(primes[j].lead, primes[best].lead, vars) < 0))
+                best = j;
+        }
+
+        for (unsigned j = 0; j < count; j++)
+        {
+            if (!primes[j].ok)
+                continue;
+
+            if (GcdExpsCompare(primes[j].lead, primes[best].lead, vars) == 0)
+                primes[kept++] = primes[j];
+            else
+                PolyDestroy(&primes[j].g);
+        }
+
+        if (kept == 0)
+            continue;
+
+        if (PolyIsCoeff(&primes[0].g))
+        {
+            res = PolyFromCoeff(1);
+            found = true;
+        }
+        else if (GcdReconstruct(primes, kept, &res))
+        {
+            Poly qa, qb;
+            bool saved = atomic_exchange(&coeff_overflow, false);
+
+            /* Bez przepełnień dzielenie próbne liczy dokładnie. */
+            found = GcdDivides(&pa, &res, &qa);
+            if (found)
+            {
+                found = GcdDivides(&pb, &res, &qb);
+                PolyDestroy(&qa);
+            }
+            if (found)
+                PolyDestroy(&qb);
+            found &= !atomic_exchange(&coeff_overflow, saved);
+
+            if (!found)
+                PolyDestroy(&res);
+        }
+
+        for (unsigned j = 0; j < kept; j++)
+            PolyDestroy(&primes[j].g);
+    }
+
+    if (found)
+    {
+        *g = GcdScale(&res, (poly_coeff_t)c);
+        CoeffOverflowNote(c > (uint64_t)POLY_COEFF_MAX);
+        PolyDestroy(&res);
+    }
+
+    free(leads);
+    PolyDestroy(&pa);
+    PolyDestroy(&pb);
+
+    return found;
+}
+
+bool GcdCompute(const Poly *p, const Poly *q, Poly *g)
+{
+    if (CoeffModActive() && !coeff_mod.prime)
+        return false;
+
+    if (PolyIsZero(p) || PolyIsZero(q))
+    {
+        const Poly *r = PolyIsZero(p) ? q : p;
+
+        if (PolyIsZero(r))
+            *g = PolyZero();
+        else if (CoeffModActive())
+            *g = GcdMonic(PolyClone(r));
+        else
+            *g = GcdLeadCoeff(r) < 0 ? PolyNeg(r) : PolyClone(r);
+
+        return true;
+    }
+
+    unsigned budget = gcd_budget, vars = PolyVars(p);
+    bool res;
+
+    if (PolyVars(q) > vars)
+        vars = PolyVars(q);
+
+    if (budget == 0)
+        gcd_budget = GcdThreads();
+
+    if (CoeffModActive())
+    {
+        GcdResult r;
+
+        res = GcdModular(p, q, vars, false, &r);
+        if (res)
+            *g = r.g;
+    }
+    else
+    {
+        res = GcdInteger(p, q, vars, g);
+    }
+
+    gcd_budget = budget;
+
+    return res;
+}
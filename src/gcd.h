@@ -0,0 +1,31 @@
+/** @file
+    Interfejs modularnego NWD wielomianów wielu zmiennych
+
+    NWD jest liczony algorytmem Browna: modulo liczba pierwsza zmienna
+    @f$x_0@f$ jest podstawiana w kolejnych punktach, NWD wartości liczony
+    rekurencyjnie, a wynik odtwarzany interpolacją; wielomiany jednej
+    zmiennej dzieli algorytm Euklidesa. Dla współczynników całkowitych
+    obrazy modulo kilka liczb pierwszych są sklejane chińskim twierdzeniem
+    o resztach, a wynik sprawdzany dzieleniem próbnym.
+
+    @author Aliaksandr Sarokin <as372525@students.mimuw.edu.pl>
+    @copyright Uniwersytet Warszawski
+    @date 2017-06-03
+*/
+
+#ifndef __GCD_H__
+#define __GCD_H__
+
+#include "poly.h"
+
+/**
+ * Wyznacza NWD wielomianów w bieżącej arytmetyce współczynników
+ * (patrz `PolyGcd`).
+ * @param[in] p : wielomian bez drzewa
+ * @param[in] q : wielomian bez drzewa
+ * @param[out] g : NWD
+ * @return czy NWD udało się wyznaczyć; wpp @p g jest nieustawiony
+ */
+bool GcdCompute(const Poly *p, const Poly *q, Poly *g);
+
+#endif /* __GCD_H__ */
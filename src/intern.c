@@ -0,0 +1,402 @@
+/** @file
+    Implementacja tablicy unikalnych wielomianów
+
+    @author Aliaksandr Sarokin <as372525@students.mimuw.edu.pl>
+    @copyright Uniwersytet Warszawski
+    @date 2017-06-03
+*/
+
+#include <stdlib.h>
+#include <assert.h>
+#include <pthread.h>
+#include <stdint.h>
+
+#include "intern.h"
+#include "utils.h"
+
+/** Liczba kubełków pustej tablicy po wstawieniu pierwszej listy */
+#define INTERN_BUCKETS_MIN 64
+
+/** Lista jednomianów przechowywana w tablicy */
+typedef struct InternEntry
+{
+    List l; ///< lista
+    uint64_t hash; ///< skrót wyrazów listy
+    size_t refs; ///< liczba wszystkich odwołań do listy
+    size_t inner; ///< liczba odwołań z innych list tablicy
+    size_t bytes; ///< pamięć elementów listy
+    double tree_bytes; ///< pamięć głębokiej kopii listy
+    struct InternEntry *next_hash; ///< następna lista w kubełku skrótu
+    struct InternEntry *next_ptr; ///< następna lista w kubełku adresu
+} InternEntry;
+
+/**
+ * Tablica list, haszowana osobno po skrócie wyrazów (do wyszukiwania
+ * równych list) i po adresie listy (do liczników odwołań)
+ */
+typedef struct InternTable
+{
+    InternEntry **by_hash; ///< kubełki według skrótu wyrazów
+    InternEntry **by_ptr; ///< kubełki według adresu listy
+    size_t buckets; ///< liczba kubełków, potęga dwójki
+    size_t count; ///< liczba list
+} InternTable;
+
+atomic_bool intern_active = false;
+
+atomic_size_t intern_count = 0;
+
+/** Tablica unikalnych list */
+static InternTable table = {.by_hash = NULL, .by_ptr = NULL,
+                            .buckets = 0, .count = 0};
+
+/** Blokada tablicy: listy kopiują i zwalniają także wątki dodawania */
+static pthread_mutex_t intern_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Miesza bity liczby (krok końcowy generatora SplitMix64).
+ * @param[in] x : liczba
+ * @return wymieszana liczba
+ */
+static inline uint64_t InternMix(uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9UL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebUL;
+
+    return x ^ (x >> 31);
+}
+
+/**
+ * Daje kubełek adresu listy.
+ * @param[in] l : lista jednomianów
+ * @return indeks kubełka
+ */
+static inline size_t InternPtrBucket(const Node *l)
+{
+    return InternMix((uint64_t)(uintptr_t)l) & (table.buckets - 1);
+}
+
+/**
+ * Sprawdza, czy element listy jest jednomianem o niestałym współczynniku.
+ * @param[in] n : element listy
+ * @return czy współczynnik jest listą
+ */
+static inline bool InternHasChild(const Node *n)
+{
+    return !NodeIsBlock(n) && !NodeIsLeaf(n) && !PolyIsCoeff(&(n->m.p));
+}
+
+/**
+ * Liczy skrót wyrazów listy. Niestałe współczynniki są już w tablicy,
+ * więc wystarcza ich adres. Skrót nie zależy od podziału wyrazów na bloki
+ * gęste, liście i jednomiany.
+ * @param[in] l : lista jednomianów
+ * @return skrót
+ */
+static uint64_t InternHash(const Node *l)
+{
+    uint64_t h = 0x9e3779b97f4a7c15UL;
+
+    for (ListIter it = ListIterBegin(l); it.n != NULL; ListIterNext(&it))
+    {
+        Poly c = ListIterCoeff(&it);
+
+        uint64_t v = PolyIsCoeff(&c) ? (uint64_t)c.c : (uint64_t)(uintptr_t)c.l;
+
+        h = InternMix(h + (((uint64_t)(unsigned)ListIterExp(&it) << 32) ^ v));
+    }
+
+    return h;
+}
+
+/**
+ * Porównuje wyrazy dwóch list, których niestałe współczynniki są w tablicy.
+ * @param[in] a : lista jednomianów
+ * @param[in] b : lista jednomianów
+ * @return czy listy mają te same wyrazy
+ */
+static bool InternEqual(const Node *a, const Node *b)
+{
+    ListIter x = ListIterBegin(a), y = ListIterBegin(b);
+
+    for (; x.n != NULL && y.n != NULL; ListIterNext(&x), ListIterNext(&y))
+    {
+        Poly cx = ListIterCoeff(&x), cy = ListIterCoeff(&y);
+
+        if (ListIterExp(&x) != ListIterExp(&y) || cx.l != cy.l || cx.c != cy.c)
+            return false;
+    }
+
+    return x.n == NULL && y.n == NULL;
+}
+
+/**
+ * Daje pamięć zajmowaną przez element listy, bez jego współczynnika.
+ * @param[in] n : element listy
+ * @return liczba bajtów
+ */
+static size_t InternNodeBytes(const Node *n)
+{
+    if (NodeIsBlock(n))
+        return sizeof(Block) + NodeBlock(n)->len * sizeof(poly_coeff_t);
+    if (NodeIsLeaf(n))
+        return sizeof(Leaf)
+               + NodeLeaf(n)->len * (sizeof(poly_coeff_t) + sizeof(poly_exp_t));
+
+    return sizeof(Node);
+}
+
+/**
+ * Szuka listy w tablicy po adresie. Wymaga blokady.
+ * @param[in] l : lista jednomianów
+ * @return lista w tablicy albo `NULL`
+ */
+static InternEntry* InternFind(const Node *l)
+{
+    if (table.count == 0)
+        return NULL;
+
+    InternEntry *e = table.by_ptr[InternPtrBucket(l)];
+
+    while (e != NULL && e->l != l)
+        e = e->next_ptr;
+
+    return e;
+}
+
+/**
+ * Podwaja liczbę kubełków tablicy i rozkłada do nich listy.
+ * Wymaga blokady.
+ */
+static void InternGrow(void)
+{
+    size_t old = table.buckets;
+    InternEntry **by_hash = table.by_hash;
+
+    free(table.by_ptr);
+    table.buckets = old == 0 ? INTERN_BUCKETS_MIN : 2 * old;
+    table.by_hash = calloc(table.buckets, sizeof(InternEntry *));
+    table.by_ptr = calloc(table.buckets, sizeof(InternEntry *));
+    assert(table.by_hash != NULL && table.by_ptr != NULL);
+
+    for (size_t i = 0; i < old; i++)
+    {
+        for (InternEntry *e = by_hash[i], *next; e != NULL; e = next)
+        {
+            next = e->next_hash;
+
+            size_t h = e->hash & (table.buckets - 1), p = InternPtrBucket(e->l);
+            e->next_hash = table.by_hash[h];
+            table.by_hash[h] = e;
+            e->next_ptr = table.by_ptr[p];
+            table.by_ptr[p] = e;
+        }
+    }
+
+    free(by_hash);
+}
+
+/**
+ * Wstawia do tablicy listę, której równej jeszcze w niej nie ma.
+ * Przejmuje odwołania listy do jej niestałych współczynników.
+ * Wymaga blokady.
+ * @param[in] l : lista jednomianów
+ * @param[in] hash : skrót wyrazów listy
+ */
+static void InternInsert(List l, uint64_t hash)
+{
+    if (table.count >= table.buckets)
+        InternGrow();
+
+    InternEntry *e = malloc(sizeof(InternEntry));
+    assert(e != NULL);
+
+    *e = (InternEntry) {.l = l, .hash = hash, .refs = 1, .inner = 0,
+                        .bytes = 0, .tree_bytes = 0};
+
+    for (const Node *n = l; n != NULL; n = n->next)
+    {
+        e->bytes += InternNodeBytes(n);
+
+        if (InternHasChild(n))
+        {
+            InternEntry *child = InternFind(n->m.p.l);
+
+            assert(child != NULL);
+            child->inner++;
+            e->tree_bytes += child->tree_bytes;
+        }
+    }
+
+    e->tree_bytes += (double)e->bytes;
+
+    size_t h = hash & (table.buckets - 1), p = InternPtrBucket(l);
+    e->next_hash = table.by_hash[h];
+    table.by_hash[h] = e;
+    e->next_ptr = table.by_ptr[p];
+    table.by_ptr[p] = e;
+
+    atomic_store_explicit(&intern_count, ++table.count, memory_order_relaxed);
+}
+
+/**
+ * Usuwa listę z tablicy, nie zwalniając jej. Wymaga blokady.
+ * @param[in] e : lista w tablicy
+ */
+static void InternRemove(InternEntry *e)
+{
+    InternEntry **pos = &table.by_hash[e->hash & (table.buckets - 1)];
+
+    while (*pos != e)
+        pos = &(*pos)->next_hash;
+    *pos = e->next_hash;
+
+    pos = &table.by_ptr[InternPtrBucket(e->l)];
+    while (*pos != e)
+        pos = &(*pos)->next_ptr;
+    *pos = e->next_ptr;
+
+    for (const Node *n = e->l; n != NULL; n = n->next)
+    {
+        if (InternHasChild(n))
+            InternFind(n->m.p.l)->inner--;
+    }
+
+    free(e);
+
+    atomic_store_explicit(&intern_count, --table.count, memory_order_relaxed);
+
+    if (table.count == 0)
+    {
+        free(table.by_hash);
+        free(table.by_ptr);
+        table = (InternTable) {.by_hash = NULL, .by_ptr = NULL,
+                               .buckets = 0, .count = 0};
+    }
+}
+
+List InternList(List l)
+{
+    assert(l != NULL);
+
+    pthread_mutex_lock(&intern_lock);
+
+    if (InternFind(l) != NULL)
+    {
+        pthread_mutex_unlock(&intern_lock);
+        return l;
+    }
+
+    /* Wyniki operacji składają się zwykle z list już wstawionych, więc
+       blokada jest zwalniana tylko dla rzadkich nowych współczynników. */
+    for (Node *n = l; n != NULL; n = n->next)
+    {
+        if (InternHasChild(n) && InternFind(n->m.p.l) == NULL)
+        {
+            pthread_mutex_unlock(&intern_lock);
+            n->m.p.l = InternList(n->m.p.l);
+            pthread_mutex_lock(&intern_lock);
+        }
+    }
+
+    uint64_t hash = InternHash(l);
+    InternEntry *e = NULL;
+
+    if (table.count != 0)
+    {
+        e = table.by_hash[hash & (table.buckets - 1)];
+        while (e != NULL && (e->hash != hash || !InternEqual(e->l, l)))
+            e = e->next_hash;
+    }
+
+    if (e != NULL)
+        e->refs++;
+    else
+        InternInsert(l, hash);
+
+    pthread_mutex_unlock(&intern_lock);
+
+    if (e == NULL)
+        return l;
+
+    ListDestroy(l);
+
+    return e->l;
+}
+
+bool InternRetain(const Node *l)
+{
+    if (InternEmpty())
+        return false;
+
+    pthread_mutex_lock(&intern_lock);
+
+    InternEntry *e = InternFind(l);
+    if (e != NULL)
+        e->refs++;
+
+    pthread_mutex_unlock(&intern_lock);
+
+    return e != NULL;
+}
+
+bool InternRelease(const Node *l)
+{
+    if (InternEmpty())
+        return false;
+
+    bool used = false;
+
+    pthread_mutex_lock(&intern_lock);
+
+    InternEntry *e = InternFind(l);
+    if (e != NULL && --e->refs > 0)
+        used = true;
+    else if (e != NULL)
+        InternRemove(e);
+
+    pthread_mutex_unlock(&intern_lock);
+
+    return used;
+}
+
+bool InternContains(const Node *l)
+{
+    if (InternEmpty())
+        return false;
+
+    pthread_mutex_lock(&intern_lock);
+
+    bool res = InternFind(l) != NULL;
+
+    pthread_mutex_unlock(&intern_lock);
+
+    return res;
+}
+
+PolyInternStats InternStats(void)
+{
+    PolyInternStats res = {.lists = 0, .refs = 0, .bytes = 0, .tree_bytes = 0};
+
+    pthread_mutex_lock(&intern_lock);
+
+    res.lists = table.count;
+
+    for (size_t i = 0; i < table.buckets; i++)
+    {
+        for (const InternEntry *e = table.by_hash[i]; e != NULL; e = e->next_hash)
+        {
+            size_t outer = e->refs - e->inner;
+
+            res.refs += outer;
+            res.bytes += e->bytes;
+            res.tree_bytes += (double)outer * e->tree_bytes;
+        }
+    }
+
+    pthread_mutex_unlock(&intern_lock);
+
+    return res;
+}
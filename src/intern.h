@@ -0,0 +1,88 @@
+/** @file
+    Interfejs tablicy unikalnych wielomianów
+
+    Tablica przechowuje niezmienne listy jednomianów, których wszystkie
+    niestałe współczynniki także są w tablicy. Dwie listy o tych samych
+    wyrazach są w niej jednym obiektem, więc równość takich list to równość
+    wskaźników. Każda lista w tablicy ma licznik odwołań: `ListClone` tylko
+    go zwiększa, a `ListDestroy` zmniejsza i zwalnia listę przy zerze.
+
+    @author Aliaksandr Sarokin <as372525@students.mimuw.edu.pl>
+    @copyright Uniwersytet Warszawski
+    @date 2017-06-03
+*/
+
+#ifndef __INTERN_H__
+#define __INTERN_H__
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "poly.h"
+
+/** Czy wyniki operacji na wielomianach trafiają do tablicy */
+extern atomic_bool intern_active;
+
+/** Liczba list w tablicy */
+extern atomic_size_t intern_count;
+
+/**
+ * Sprawdza, czy wyniki operacji mają trafiać do tablicy.
+ * @return czy tablica jest włączona
+ */
+static inline bool InternActive(void)
+{
+    return __builtin_expect(atomic_load_explicit(&intern_active,
+                                                 memory_order_relaxed), 0);
+}
+
+/**
+ * Sprawdza, czy tablica jest pusta. Dopóki jest, żadna lista nie jest
+ * współdzielona i zwalnianie oraz kopiowanie list nie musi do niej zaglądać.
+ * @return czy tablica jest pusta
+ */
+static inline bool InternEmpty(void)
+{
+    return __builtin_expect(atomic_load_explicit(&intern_count,
+                                                 memory_order_relaxed) == 0, 1);
+}
+
+/**
+ * Wstawia listę do tablicy, przejmując ją na własność.
+ * Najpierw wstawia listy niestałych współczynników. Jeśli w tablicy jest
+ * już lista o tych samych wyrazach, usuwa @p l i zwraca tamtą listę.
+ * @param[in] l : niepusta lista jednomianów
+ * @return lista z tablicy równa @p l
+ */
+List InternList(List l);
+
+/**
+ * Zwiększa licznik odwołań listy, jeśli jest ona w tablicy.
+ * @param[in] l : lista jednomianów
+ * @return czy lista jest w tablicy
+ */
+bool InternRetain(const Node *l);
+
+/**
+ * Zmniejsza licznik odwołań listy, jeśli jest ona w tablicy.
+ * Gdy licznik spada do zera, usuwa listę z tablicy, ale jej nie zwalnia.
+ * @param[in] l : lista jednomianów
+ * @return czy lista jest nadal używana i nie wolno jej zwolnić
+ */
+bool InternRelease(const Node *l);
+
+/**
+ * Sprawdza, czy lista jest w tablicy.
+ * @param[in] l : lista jednomianów
+ * @return czy lista jest w tablicy
+ */
+bool InternContains(const Node *l);
+
+/**
+ * Zbiera statystyki pamięci list w tablicy.
+ * @return statystyki
+ */
+PolyInternStats InternStats(void);
+
+#endif /* __INTERN_H__ */
@@ -0,0 +1,1211 @@
+/** @file
+    Implementacja operacji na ciągłych tablicach współczynników
+
+    @author Aliaksandr Sarokin <as372525@students.mimuw.edu.pl>
+    @copyright Uniwersytet Warszawski
+    @date 2017-06-03
+*/
+
+#include <assert.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "coeff.h"
+#include "kernels.h"
+#include "utils.h"
+
+/* Wersje wektorowe operują na 64-bitowych współczynnikach; węższe pętle
+   skalarne kompilator wektoryzuje sam. */
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(POLY_NO_SIMD) \
+    && POLY_COEFF_BITS == 64
+/** Czy kompilujemy wersje wektorowe */
+#define KERNELS_X86 1
+#include <immintrin.h>
+#endif
+
+/**
+ * Maksymalny stosunek zakresu wykładników iloczynu do liczby iloczynów
+ * wyrazów, przy którym `KernelMulLeaf` sumuje w gęstej tablicy
+ */
+#define MUL_LEAF_DENSE_RATIO 4
+
+/**
+ * Najmniejsza długość gęstych ciągów, od której iloczyn jest liczony
+ * algorytmem Karacuby; krótsze fragmenty mnożone są szkolnie
+ */
+#define KARATSUBA_MIN 32
+
+/** Dostępny zestaw instrukcji wektorowych */
+typedef enum
+{
+    LEVEL_SCALAR,
+    LEVEL_AVX2,
+    LEVEL_AVX512
+} KernelLevel;
+
+/**
+ * Sprawdza, jakie instrukcje wektorowe obsługuje procesor.
+ * @return najlepszy dostępny zestaw instrukcji
+ */
+static KernelLevel KernelLevelGet(void)
+{
+#ifdef KERNELS_X86
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq"))
+        return LEVEL_AVX512;
+    if (__builtin_cpu_supports("avx2"))
+        return LEVEL_AVX2;
+#endif
+    return LEVEL_SCALAR;
+}
+
+/**
+ * Skalarna wersja `KernelNeg`.
+ * @param[out] dst : wynik
+ * @param[in] src : współczynniki
+ * @param[in] n : długość tablic
+ * @return czy któryś wynik się przepełnił
+ */
+static bool NegScalar(poly_coeff_t *dst, const poly_coeff_t *src, size_t n)
+{
+    ucoeff_t overflow = 0;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        poly_coeff_t x = src[i];
+        dst[i] = (poly_coeff_t)(0 - (ucoeff_t)x);
+        overflow |= (ucoeff_t)(x & dst[i]);
+    }
+
+    return (poly_coeff_t)overflow < 0;
+}
+
+/**
+ * Skalarna wersja `KernelScale`.
+ * @param[out] dst : wynik
+ * @param[in] src : współczynniki
+ * @param[in] n : długość tablic
+ * @param[in] c : stała
+ */
+static void ScaleScalar(poly_coeff_t *dst, const poly_coeff_t *src, size_t n,
+                        poly_coeff_t c)
+{
+    for (size_t i = 0; i < n; i++)
+        dst[i] = (poly_coeff_t)((ucoeff_t)src[i] * (ucoeff_t)c);
+}
+
+/**
+ * Skalarna wersja `KernelAdd`.
+ * @param[out] dst : wynik
+ * @param[in] a : współczynniki
+ * @param[in] b : współczynniki
+ * @param[in] n : długość tablic
+ * @return czy któraś suma się przepełniła
+ */
+static bool AddScalar(poly_coeff_t *dst, const poly_coeff_t *a,
+                      const poly_coeff_t *b, size_t n)
+{
+    ucoeff_t overflow = 0;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        poly_coeff_t x = a[i], y = b[i];
+        dst[i] = (poly_coeff_t)((ucoeff_t)x + (ucoeff_t)y);
+        overflow |= (ucoeff_t)((x ^ dst[i]) & (y ^ dst[i]));
+    }
+
+    return (poly_coeff_t)overflow < 0;
+}
+
+/**
+ * Sprawdza, czy iloczyn któregoś współczynnika ze stałą wychodzi poza zakres.
+ * Najpierw szacuje wielkość iloczynów po najwyższych zapalonych bitach,
+ * a dokładnie sprawdza tylko, gdy oszacowanie nie wyklucza przepełnienia.
+ * @param[in] src : współczynniki
+ * @param[in] n : długość tablicy
+ * @param[in] c : stała
+ * @return czy któryś iloczyn się przepełnia
+ */
+static bool ScaleOverflows(const poly_coeff_t *src, size_t n, poly_coeff_t c)
+{
+    ucoeff_t mag = 0, mag_c = (ucoeff_t)(c ^ (c >> (POLY_COEFF_BITS - 1)));
+
+    for (size_t i = 0; i < n; i++)
+        mag |= (ucoeff_t)(src[i] ^ (src[i] >> (POLY_COEFF_BITS - 1)));
+
+    /* Iloczyn mieści się, gdy łącznie ma najwyżej POLY_COEFF_BITS - 1 bitów. */
+    if (mag == 0 || mag_c == 0
+        || __builtin_clzl(mag) + __builtin_clzl(mag_c) >= 129 - POLY_COEFF_BITS)
+        return false;
+
+    bool overflow = false;
+    poly_coeff_t tmp;
+
+    for (size_t i = 0; i < n; i++)
+        overflow |= __builtin_mul_overflow(src[i], c, &tmp);
+
+    return overflow;
+}
+
+/**
+ * Skalarna, bezskokowa wersja `KernelCompact` zaczynająca od wyrazu @p i.
+ * @param[in,out] exps : wykładniki
+ * @param[in,out] coeffs : współczynniki
+ * @param[in] i : indeks pierwszego nieprzetworzonego wyrazu
+ * @param[in] k : liczba wyrazów już zachowanych
+ * @param[in] n : liczba wyrazów
+ * @return liczba pozostałych wyrazów
+ */
+static size_t CompactScalar(poly_exp_t *exps, poly_coeff_t *coeffs,
+                            size_t i, size_t k, size_t n)
+{
+    for (; i < n; i++)
+    {
+        exps[k] = exps[i];
+        coeffs[k] = coeffs[i];
+        k += coeffs[i] != 0;
+    }
+
+    return k;
+}
+
+/**
+ * Wersja `KernelNeg` dla trybu modularnego.
+ * @param[out] dst : wynik
+ * @param[in] src : reszty
+ * @param[in] n : długość tablic
+ */
+static void NegMod(poly_coeff_t *dst, const poly_coeff_t *src, size_t n)
+{
+    const uint64_t p = coeff_mod.p;
+
+    for (size_t i = 0; i < n; i++)
+        dst[i] = (poly_coeff_t)(src[i] == 0 ? 0 : p - (uint64_t)src[i]);
+}
+
+/**
+ * Wersja `KernelScale` dla trybu modularnego, mnożąca metodą Shoupa.
+ * @param[out] dst : wynik
+ * @param[in] src : reszty
+ * @param[in] n : długość tablic
+ * @param[in] c : stała, reszta
+ */
+static void ScaleMod(poly_coeff_t *dst, const poly_coeff_t *src, size_t n,
+                     poly_coeff_t c)
+{
+    const CoeffShoup w = CoeffShoupInit(c);
+
+    for (size_t i = 0; i < n; i++)
+        dst[i] = CoeffShoupMul(w, src[i]);
+}
+
+/**
+ * Wersja `KernelAdd` dla trybu modularnego.
+ * @param[out] dst : wynik
+ * @param[in] a : reszty
+ * @param[in] b : reszty
+ * @param[in] n : długość tablic
+ */
+static void AddMod(poly_coeff_t *dst, const poly_coeff_t *a,
+                   const poly_coeff_t *b, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        dst[i] = CoeffModAdd(a[i], b[i]);
+}
+
+#ifdef KERNELS_X86
+
+/**
+ * Mnoży 64-bitowe liczby w wektorach AVX2 (młodsze 64 bity iloczynu).
+ * @param[in] a : wektor
+ * @param[in] b : wektor
+ * @return `a * b` modulo @f$2^{64}@f$
+ */
+__attribute__((target("avx2")))
+static inline __m256i MulLo64Avx2(__m256i a, __m256i b)
+{
+    __m256i lo = _mm256_mul_epu32(a, b);
+    __m256i c1 = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), b);
+    __m256i c2 = _mm256_mul_epu32(a, _mm256_srli_epi64(b, 32));
+
+    return _mm256_add_epi64(lo, _mm256_slli_epi64(_mm256_add_epi64(c1, c2), 32));
+}
+
+/** Wersja AVX2 `KernelNeg`. @copydetails NegScalar */
+__attribute__((target("avx2")))
+static bool NegAvx2(poly_coeff_t *dst, const poly_coeff_t *src, size_t n)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i overflow = zero;
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(src + i));
+        __m256i r = _mm256_sub_epi64(zero, v);
+        _mm256_storeu_si256((__m256i *)(dst + i), r);
+        overflow = _mm256_or_si256(overflow, _mm256_and_si256(v, r));
+    }
+
+    bool tail = NegScalar(dst + i, src + i, n - i);
+
+    return tail || _mm256_movemask_pd(_mm256_castsi256_pd(overflow)) != 0;
+}
+
+/** Wersja AVX2 `KernelScale`. @copydetails ScaleScalar */
+__attribute__((target("avx2")))
+static void ScaleAvx2(poly_coeff_t *dst, const poly_coeff_t *src, size_t n,
+                      poly_coeff_t c)
+{
+    const __m256i vc = _mm256_set1_epi64x(c);
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(src + i));
+        _mm256_storeu_si256((__m256i *)(dst + i), MulLo64Avx2(v, vc));
+    }
+
+    ScaleScalar(dst + i, src + i, n - i, c);
+}
+
+/** Wersja AVX2 `KernelAdd`. @copydetails AddScalar */
+__attribute__((target("avx2")))
+static bool AddAvx2(poly_coeff_t *dst, const poly_coeff_t *a,
+                    const poly_coeff_t *b, size_t n)
+{
+    __m256i overflow = _mm256_setzero_si256();
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4)
+    {
+        __m256i va = _mm256_loadu_si256((const __m256i *)(a + i));
+        __m256i vb = _mm256_loadu_si256((const __m256i *)(b + i));
+        __m256i r = _mm256_add_epi64(va, vb);
+        _mm256_storeu_si256((__m256i *)(dst + i), r);
+        overflow = _mm256_or_si256(overflow,
+                                   _mm256_and_si256(_mm256_xor_si256(va, r),
+                                                    _mm256_xor_si256(vb, r)));
+    }
+
+    bool tail = AddScalar(dst + i, a + i, b + i, n - i);
+
+    return tail || _mm256_movemask_pd(_mm256_castsi256_pd(overflow)) != 0;
+}
+
+/** Wersja AVX-512 `KernelNeg`. @copydetails NegScalar */
+__attribute__((target("avx512f")))
+static bool NegAvx512(poly_coeff_t *dst, const poly_coeff_t *src, size_t n)
+{
+    const __m512i zero = _mm512_setzero_si512();
+    __m512i overflow = zero;
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8)
+    {
+        __m512i v = _mm512_loadu_si512(src + i);
+        __m512i r = _mm512_sub_epi64(zero, v);
+        _mm512_storeu_si512(dst + i, r);
+        overflow = _mm512_or_si512(overflow, _mm512_and_si512(v, r));
+    }
+
+    bool tail = NegScalar(dst + i, src + i, n - i);
+
+    return tail || _mm512_cmplt_epi64_mask(overflow, zero) != 0;
+}
+
+/** Wersja AVX-512 `KernelScale`. @copydetails ScaleScalar */
+__attribute__((target("avx512f,avx512dq")))
+static void ScaleAvx512(poly_coeff_t *dst, const poly_coeff_t *src, size_t n,
+                        poly_coeff_t c)
+{
+    const __m512i vc = _mm512_set1_epi64(c);
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8)
+    {
+        __m512i v = _mm512_loadu_si512(src + i);
+        _mm512_storeu_si512(dst + i, _mm512_mullo_epi64(v, vc));
+    }
+
+    ScaleScalar(dst + i, src + i, n - i, c);
+}
+
+/** Wersja AVX-512 `KernelAdd`. @copydetails AddScalar */
+__attribute__((target("avx512f")))
+static bool AddAvx512(poly_coeff_t *dst, const poly_coeff_t *a,
+                      const poly_coeff_t *b, size_t n)
+{
+    const __m512i zero = _mm512_setzero_si512();
+    __m512i overflow = zero;
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8)
+    {
+        __m512i va = _mm512_loadu_si512(a + i);
+        __m512i vb = _mm512_loadu_si512(b + i);
+        __m512i r = _mm512_add_epi64(va, vb);
+        _mm512_storeu_si512(dst + i, r);
+        overflow = _mm512_or_si512(overflow,
+                                   _mm512_and_si512(_mm512_xor_si512(va, r),
+                                                    _mm512_xor_si512(vb, r)));
+    }
+
+    bool tail = AddScalar(dst + i, a + i, b + i, n - i);
+
+    return tail || _mm512_cmplt_epi64_mask(overflow, zero) != 0;
+}
+
+/**
+ * Wersja AVX-512 `KernelCompact`.
+ * Przetwarza po 16 wyrazów, zapisując niezerowe instrukcjami kompresji.
+ * @param[in,out] exps : wykładniki
+ * @param[in,out] coeffs : współczynniki
+ * @param[in] n : liczba wyrazów
+ * @return liczba pozostałych wyrazów
+ */
+__attribute__((target("avx512f")))
+static size_t CompactAvx512(poly_exp_t *exps, poly_coeff_t *coeffs, size_t n)
+{
+    size_t i = 0, k = 0;
+
+    for (; i + 16 <= n; i += 16)
+    {
+        __m512i lo = _mm512_loadu_si512(coeffs + i);
+        __m512i hi = _mm512_loadu_si512(coeffs + i + 8);
+        __m512i e = _mm512_loadu_si512(exps + i);
+        __mmask8 m_lo = _mm512_test_epi64_mask(lo, lo);
+        __mmask8 m_hi = _mm512_test_epi64_mask(hi, hi);
+        __mmask16 m = (__mmask16)(m_lo | ((unsigned)m_hi << 8));
+
+        _mm512_mask_compressstoreu_epi64(coeffs + k, m_lo, lo);
+        k += (size_t)__builtin_popcount(m_lo);
+        _mm512_mask_compressstoreu_epi64(coeffs + k, m_hi, hi);
+        k += (size_t)__builtin_popcount(m_hi);
+        _mm512_mask_compressstoreu_epi32(exps + k - (size_t)__builtin_popcount(m),
+                                         m, e);
+    }
+
+    return CompactScalar(exps, coeffs, i, k, n);
+}
+
+#endif /* KERNELS_X86 */
+
+void KernelNeg(poly_coeff_t *dst, const poly_coeff_t *src, size_t n)
+{
+    if (CoeffModActive())
+    {
+        NegMod(dst, src, n);
+        return;
+    }
+
+    switch (KernelLevelGet())
+    {
+#ifdef KERNELS_X86
+        case LEVEL_AVX512:
+            CoeffOverflowNote(NegAvx512(dst, src, n));
+            return;
+        case LEVEL_AVX2:
+            CoeffOverflowNote(NegAvx2(dst, src, n));
+            return;
+#endif
+        default:
+            CoeffOverflowNote(NegScalar(dst, src, n));
+    }
+}
+
+void KernelScale(poly_coeff_t *dst, const poly_coeff_t *src, size_t n,
+                 poly_coeff_t c)
+{
+    if (CoeffModActive())
+    {
+        ScaleMod(dst, src, n, c);
+        return;
+    }
+
+    CoeffOverflowNote(ScaleOverflows(src, n, c));
+
+    switch (KernelLevelGet())
+    {
+#ifdef KERNELS_X86
+        case LEVEL_AVX512:
+            ScaleAvx512(dst, src, n, c);
+            return;
+        case LEVEL_AVX2:
+            ScaleAvx2(dst, src, n, c);
+            return;
+#endif
+        default:
+            ScaleScalar(dst, src, n, c);
+    }
+}
+
+void KernelAdd(poly_coeff_t *dst, const poly_coeff_t *a,
+               const poly_coeff_t *b, size_t n)
+{
+    if (CoeffModActive())
+    {
+        AddMod(dst, a, b, n);
+        return;
+    }
+
+    switch (KernelLevelGet())
+    {
+#ifdef KERNELS_X86
+        case LEVEL_AVX512:
+            CoeffOverflowNote(AddAvx512(dst, a, b, n));
+            return;
+        case LEVEL_AVX2:
+            CoeffOverflowNote(AddAvx2(dst, a, b, n));
+            return;
+#endif
+        default:
+            CoeffOverflowNote(AddScalar(dst, a, b, n));
+    }
+}
+
+poly_coeff_t KernelEval(const poly_coeff_t *coeffs, size_t n, poly_coeff_t x)
+{
+    poly_coeff_t res = 0;
+    bool overflow = false;
+
+    while (n > 0)
+        res = CoeffMulAdd(coeffs[--n], res, x, &overflow);
+
+    CoeffOverflowNote(overflow);
+
+    return res;
+}
+
+size_t KernelCompact(poly_exp_t *exps, poly_coeff_t *coeffs, size_t n)
+{
+#ifdef KERNELS_X86
+    if (KernelLevelGet() == LEVEL_AVX512)
+        return CompactAvx512(exps, coeffs, n);
+#endif
+    return CompactScalar(exps, coeffs, 0, 0, n);
+}
+
+/**
+ * Podnosi liczbę do potęgi modulo @f$2^b@f$, gdzie @f$b@f$ to
+ * `POLY_COEFF_BITS`.
+ * Nie podnosi podstawy do kwadratu po ostatnim potrzebnym bicie wykładnika,
+ * żeby nie zgłaszać przepełnienia niewpływającego na wynik.
+ * @param[in] x : podstawa
+ * @param[in] exp : wykładnik
+ * @param[in,out] overflow : czy nastąpiło przepełnienie
+ * @return @f$x^{exp}@f$
+ */
+static poly_coeff_t PowerScalar(poly_coeff_t x, poly_exp_t exp, bool *overflow)
+{
+    poly_coeff_t res = 1;
+
+    while (exp != 0)
+    {
+        if (exp & 1)
+            res = CoeffMulAcc(res, x, overflow);
+        exp >>= 1;
+        if (exp != 0)
+            x = CoeffMulAcc(x, x, overflow);
+    }
+
+    return res;
+}
+
+poly_coeff_t KernelEvalLeaf(const poly_exp_t *exps, const poly_coeff_t *coeffs,
+                            size_t n, poly_coeff_t x)
+{
+    poly_coeff_t res = 0;
+    bool overflow = false;
+
+    if (n == 0)
+        return 0;
+
+    for (size_t i = n; i-- > 0;)
+    {
+        poly_exp_t gap = exps[i] - (i > 0 ? exps[i - 1] : 0);
+
+        res = CoeffAddAcc(res, coeffs[i], &overflow);
+        res = CoeffMulAcc(res, PowerScalar(x, gap, &overflow), &overflow);
+    }
+
+    CoeffOverflowNote(overflow);
+
+    return res;
+}
+
+size_t KernelMergeLeaf(const poly_exp_t *ea, const poly_coeff_t *ca, size_t na,
+                       const poly_exp_t *eb, const poly_coeff_t *cb, size_t nb,
+                       poly_exp_t *exps, poly_coeff_t *coeffs)
+{
+    size_t i = 0, j = 0, k = 0;
+    bool overflow = false;
+
+    while (i < na && j < nb)
+    {
+        poly_exp_t x = ea[i], y = eb[j];
+        bool take_a = x <= y, take_b = y <= x;
+
+        exps[k] = take_a ? x : y;
+        coeffs[k] = CoeffAddAcc(take_a ? ca[i] : 0, take_b ? cb[j] : 0,
+                                &overflow);
+        k++;
+        i += take_a;
+        j += take_b;
+    }
+
+    for (; i < na; i++, k++)
+    {
+        exps[k] = ea[i];
+        coeffs[k] = ca[i];
+    }
+    for (; j < nb; j++, k++)
+    {
+        exps[k] = eb[j];
+        coeffs[k] = cb[j];
+    }
+
+    CoeffOverflowNote(overflow);
+
+    return KernelCompact(exps, coeffs, k);
+}
+
+/**
+ * Daje największą wartość bezwzględną współczynników.
+ * @param[in] c : współczynniki
+ * @param[in] n : długość tablicy
+ * @return @f$\max_i |c_i|@f$
+ */
+static uint64_t MaxAbs(const poly_coeff_t *c, size_t n)
+{
+    uint64_t res = 0;
+
+    for (size_t i = 0; i < n; i++)
+        res = res < CoeffAbs(c[i]) ? CoeffAbs(c[i]) : res;
+
+    return res;
+}
+
+/**
+ * Skraca wiersz iloczynów do par o sumie pozycji nie większej niż @p limit.
+ * @param[in] ib : rosnące pozycje wyrazów drugiego ciągu
+ * @param[in] n : długość poprzedniego wiersza
+ * @param[in] ia : pozycja wyrazu pierwszego ciągu
+ * @param[in] limit : największa suma pozycji
+ * @return długość wiersza
+ */
+static inline size_t RowLen(const size_t *ib, size_t n, size_t ia, size_t limit)
+{
+    if (ia > limit)
+        return 0;
+
+    while (n > 0 && ib[n - 1] > limit - ia)
+        n--;
+
+    return n;
+}
+
+/**
+ * Mnoży szkolnie dwa gęste ciągi tej samej długości.
+ * @param[out] r : iloczyn, @f$2n - 1@f$ pozycji
+ * @param[in] a : pierwszy ciąg
+ * @param[in] b : drugi ciąg
+ * @param[in] n : długość ciągów
+ * @param[in] mod : czy liczyć modulo ustawiony moduł, wpp modulo @f$2^{b}@f$
+ */
+static void MulBasecase(poly_coeff_t *r, const poly_coeff_t *a,
+                        const poly_coeff_t *b, size_t n, bool mod)
+{
+    memset(r, 0, (2 * n - 1) * sizeof(poly_coeff_t));
+
+    for (size_t i = 0; i < n; i++)
+    {
+        poly_coeff_t *row = r + i;
+
+        if (mod)
+        {
+            CoeffShoup w = CoeffShoupInit(a[i]);
+
+            for (size_t j = 0; j < n; j++)
+                row[j] = CoeffModAdd(row[j], CoeffShoupMul(w, b[j]));
+            continue;
+        }
+
+        for (size_t j = 0; j < n; j++)
+            row[j] = (poly_coeff_t)((ucoeff_t)row[j] + (ucoeff_t)a[i] * (ucoeff_t)b[j]);
+    }
+}
+
+/**
+ * Dodaje albo odejmuje współczynniki.
+ * @param[in] a : współczynnik
+ * @param[in] b : współczynnik
+ * @param[in] sub : czy odejmować
+ * @param[in] mod : czy liczyć modulo ustawiony moduł, wpp modulo @f$2^{b}@f$
+ * @return @f$a \pm b@f$
+ */
+static inline poly_coeff_t KaratsubaAdd(poly_coeff_t a, poly_coeff_t b, bool sub,
+                                        bool mod)
+{
+    if (mod)
+        return CoeffModAdd(a, sub && b != 0 ? (poly_coeff_t)(coeff_mod.p - (uint64_t)b) : b);
+
+    return (poly_coeff_t)(sub ? (ucoeff_t)a - (ucoeff_t)b : (ucoeff_t)a + (ucoeff_t)b);
+}
+
+/**
+ * Mnoży dwa gęste ciągi tej samej długości algorytmem Karacuby:
+ * @f$(a_0 + a_1 x^h)(b_0 + b_1 x^h) = z_0 + (z_1 - z_0 - z_2) x^h + z_2 x^{2h}@f$,
+ * gdzie @f$z_1 = (a_0 + a_1)(b_0 + b_1)@f$. Liczy w pierścieniu reszt,
+ * więc przepełnienia sum pośrednich nie zmieniają wyniku.
+ * @param[out] r : iloczyn, @f$2n - 1@f$ pozycji
+ * @param[in] a : pierwszy ciąg
+ * @param[in] b : drugi ciąg
+ * @param[in] n : długość ciągów
+ * @param[in] t : bufor roboczy, co najmniej @f$8n@f$ pozycji
+ * @param[in] mod : czy liczyć modulo ustawiony moduł, wpp modulo @f$2^{b}@f$
+ */
+static void MulKaratsuba(poly_coeff_t *r, const poly_coeff_t *a,
+                         const poly_coeff_t *b, size_t n, poly_coeff_t *t,
+                         bool mod)
+{
+    if (n < KARATSUBA_MIN)
+    {
+        MulBasecase(r, a, b, n, mod);
+        return;
+    }
+
+    size_t h = n / 2, g = n - h;
+    poly_coeff_t *sa = t, *sb = t + g, *z1 = t + 2 * g;
+
+    MulKaratsuba(r, a, b, h, t, mod);
+    MulKaratsuba(r + 2 * h, a + h, b + h, g, t, mod);
+    r[2 * h - 1] = 0;
+
+    for (size_t i = 0; i < g; i++)
+    {
+        sa[i] = i < h ? KaratsubaAdd(a[i], a[h + i], false, mod) : a[h + i];
+        sb[i] = i < h ? KaratsubaAdd(b[i], b[h + i], false, mod) : b[h + i];
+    }
+
+    MulKaratsuba(z1, sa, sb, g, t + 4 * g, mod);
+
+    for (size_t i = 0; i < 2 * h - 1; i++)
+        z1[i] = KaratsubaAdd(z1[i], r[i], true, mod);
+    for (size_t i = 0; i < 2 * g - 1; i++)
+        z1[i] = KaratsubaAdd(z1[i], r[2 * h + i], true, mod);
+    for (size_t i = 0; i < 2 * g - 1; i++)
+        r[h + i] = KaratsubaAdd(r[h + i], z1[i], false, mod);
+}
+
+/**
+ * Dodaje do gęstej tablicy iloczyn dwóch ciągów algorytmem Karacuby,
+ * jeśli oba są długie i gęste, a wynik nie wymaga sprawdzania przepełnień.
+ * Dłuższy ciąg jest dzielony na kawałki długości krótszego.
+ * @param[in,out] acc : tablica sum
+ * @param[in] ia : pozycje wyrazów pierwszego ciągu
+ * @param[in] ca : współczynniki pierwszego ciągu
+ * @param[in] na : długość pierwszego ciągu
+ * @param[in] ib : pozycje wyrazów drugiego ciągu
+ * @param[in] cb : współczynniki drugiego ciągu
+ * @param[in] nb : długość drugiego ciągu
+ * @param[in] limit : największa suma pozycji
+ * @return czy iloczyn został dodany
+ */
+static bool MulDenseKaratsuba(poly_coeff_t *acc,
+                              const size_t *ia, const poly_coeff_t *ca, size_t na,
+                              const size_t *ib, const poly_coeff_t *cb, size_t nb,
+                              size_t limit)
+{
+    size_t sa = 0, sb = 0;
+
+    for (size_t i = 0; i < na; i++)
+        sa = ia[i] >= sa ? ia[i] + 1 : sa;
+    for (size_t j = 0; j < nb; j++)
+        sb = ib[j] >= sb ? ib[j] + 1 : sb;
+
+    bool mod = CoeffModActive();
+
+    if (sa < KARATSUBA_MIN || sb < KARATSUBA_MIN || 2 * na < sa || 2 * nb < sb
+        || (!mod && !CoeffProductsFit(MaxAbs(ca, na), MaxAbs(cb, nb),
+                                      na < nb ? na : nb)))
+        return false;
+
+    if (sa > sb)
+    {
+        const size_t *ti = ia;
+        const poly_coeff_t *tc = ca;
+        size_t tn = na, ts = sa;
+
+        ia = ib;
+        ca = cb;
+        na = nb;
+        sa = sb;
+        ib = ti;
+        cb = tc;
+        nb = tn;
+        sb = ts;
+    }
+
+    /* Bez sprawdzania przepełnień wynik modulo 2^b jest dokładny, bo
+       mieszczą się w nim wszystkie sumy iloczynów, a nie tylko pośrednie. */
+    size_t len = sa + sb - 1 <= limit ? sa + sb - 1 : limit + 1;
+    poly_coeff_t *a = calloc(2 * sa, sizeof(poly_coeff_t)), *b = a + sa;
+    poly_coeff_t *r = malloc((10 * sa + 1) * sizeof(poly_coeff_t)), *t = r + 2 * sa;
+    assert(a != NULL && r != NULL);
+
+    for (size_t i = 0; i < na; i++)
+        a[ia[i]] = ca[i];
+
+    for (size_t off = 0; off < sb && off < len; off += sa)
+    {
+        memset(b, 0, sa * sizeof(poly_coeff_t));
+        for (size_t j = 0; j < nb; j++)
+        {
+            if (ib[j] >= off && ib[j] < off + sa)
+                b[ib[j] - off] = cb[j];
+        }
+
+        MulKaratsuba(r, a, b, sa, t, mod);
+
+        for (size_t i = 0; i < 2 * sa - 1 && off + i < len; i++)
+            acc[off + i] = KaratsubaAdd(acc[off + i], r[i], false, mod);
+    }
+
+    free(a);
+    free(r);
+
+    return true;
+}
+
+void KernelMulDense(poly_coeff_t *acc,
+                    const size_t *ia, const poly_coeff_t *ca, size_t na,
+                    const size_t *ib, const poly_coeff_t *cb, size_t nb)
+{
+    KernelMulDenseTrunc(acc, ia, ca, na, ib, cb, nb, SIZE_MAX);
+}
+
+void KernelMulDenseTrunc(poly_coeff_t *acc,
+                         const size_t *ia, const poly_coeff_t *ca, size_t na,
+                         const size_t *ib, const poly_coeff_t *cb, size_t nb,
+                         size_t limit)
+{
+    if (MulDenseKaratsuba(acc, ia, ca, na, ib, cb, nb, limit))
+        return;
+
+    /* Pozycje rosną, więc wiersze iloczynów tylko się skracają. */
+    size_t nr = nb;
+
+    if (CoeffModActive())
+    {
+        for (size_t i = 0; i < na; i++)
+        {
+            CoeffShoup w = CoeffShoupInit(ca[i]);
+            poly_coeff_t *row = acc + ia[i];
+
+            nr = RowLen(ib, nr, ia[i], limit);
+            for (size_t j = 0; j < nr; j++)
+                row[ib[j]] = CoeffModAdd(row[ib[j]], CoeffShoupMul(w, cb[j]));
+        }
+        return;
+    }
+
+    /* Do jednej komórki trafia co najwyżej min(na, nb) iloczynów. */
+    if (CoeffProductsFit(MaxAbs(ca, na), MaxAbs(cb, nb), na < nb ? na : nb))
+    {
+        for (size_t i = 0; i < na; i++)
+        {
+            ucoeff_t c = (ucoeff_t)ca[i];
+            poly_coeff_t *row = acc + ia[i];
+
+            nr = RowLen(ib, nr, ia[i], limit);
+            for (size_t j = 0; j < nr; j++)
+                row[ib[j]] = (poly_coeff_t)((ucoeff_t)row[ib[j]] + c * (ucoeff_t)cb[j]);
+        }
+        return;
+    }
+
+    bool overflow = false;
+
+    for (size_t i = 0; i < na; i++)
+    {
+        poly_coeff_t *row = acc + ia[i];
+
+        nr = RowLen(ib, nr, ia[i], limit);
+        for (size_t j = 0; j < nr; j++)
+        {
+            poly_coeff_t prod;
+
+            overflow |= __builtin_mul_overflow(ca[i], cb[j], &prod);
+            overflow |= __builtin_add_overflow(row[ib[j]], prod, row + ib[j]);
+        }
+    }
+
+    CoeffOverflowNote(overflow);
+}
+
+void KernelSqrDense(poly_coeff_t *acc, const size_t *idx, const poly_coeff_t *c,
+                    size_t n)
+{
+    if (MulDenseKaratsuba(acc, idx, c, n, idx, c, n, SIZE_MAX))
+        return;
+
+    if (CoeffModActive())
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            CoeffShoup w = CoeffShoupInit(CoeffModAdd(c[i], c[i]));
+            poly_coeff_t *row = acc + idx[i];
+
+            row[idx[i]] = CoeffModAdd(row[idx[i]],
+                                      CoeffShoupMul(CoeffShoupInit(c[i]), c[i]));
+            for (size_t j = i + 1; j < n; j++)
+                row[idx[j]] = CoeffModAdd(row[idx[j]], CoeffShoupMul(w, c[j]));
+        }
+        return;
+    }
+
+    /* Suma w komórce jest tą samą sumą co przy pełnym mnożeniu, w którym do
+       komórki trafia co najwyżej n iloczynów. */
+    uint64_t max = MaxAbs(c, n);
+
+    if (CoeffProductsFit(max, max, n))
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            ucoeff_t d = 2 * (ucoeff_t)c[i];
+            poly_coeff_t *row = acc + idx[i];
+
+            row[idx[i]] = (poly_coeff_t)((ucoeff_t)row[idx[i]]
+                                         + (ucoeff_t)c[i] * (ucoeff_t)c[i]);
+            for (size_t j = i + 1; j < n; j++)
+                row[idx[j]] = (poly_coeff_t)((ucoeff_t)row[idx[j]] + d * (ucoeff_t)c[j]);
+        }
+        return;
+    }
+
+    bool overflow = false;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        poly_coeff_t *row = acc + idx[i];
+        poly_coeff_t prod;
+
+        overflow |= __builtin_mul_overflow(c[i], c[i], &prod);
+        overflow |= __builtin_add_overflow(row[idx[i]], prod, row + idx[i]);
+
+        for (size_t j = i + 1; j < n; j++)
+        {
+            overflow |= __builtin_mul_overflow(c[i], c[j], &prod);
+            overflow |= __builtin_add_overflow(row[idx[j]], prod, row + idx[j]);
+            overflow |= __builtin_add_overflow(row[idx[j]], prod, row + idx[j]);
+        }
+    }
+
+    CoeffOverflowNote(overflow);
+}
+
+void KernelDivRem(poly_coeff_t *r, size_t m, const poly_coeff_t *b, size_t n,
+                  poly_coeff_t inv)
+{
+    bool overflow = false;
+
+    for (size_t i = m + 1; i-- > n;)
+    {
+        poly_coeff_t c = CoeffMulAcc(r[i], inv, &overflow);
+        poly_coeff_t *row = r + i - n;
+
+        r[i] = c;
+        if (c == 0)
+            continue;
+
+        if (CoeffModActive())
+        {
+            CoeffShoup w = CoeffShoupInit(CoeffNeg(c));
+
+            for (size_t j = 0; j < n; j++)
+                row[j] = CoeffModAdd(row[j], CoeffShoupMul(w, b[j]));
+            continue;
+        }
+
+        for (size_t j = 0; j < n; j++)
+        {
+            poly_coeff_t prod;
+
+            overflow |= __builtin_mul_overflow(c, b[j], &prod);
+            overflow |= __builtin_sub_overflow(row[j], prod, row + j);
+        }
+    }
+
+    CoeffOverflowNote(overflow);
+}
+
+/** Iloczyn dwóch wyrazów w `KernelMulLeaf` i `KernelFmaLeaf` */
+typedef struct LeafTerm
+{
+    long exp; ///< wykładnik
+    poly_coeff_t coeff; ///< współczynnik
+} LeafTerm;
+
+/**
+ * Porównuje iloczyny wyrazów według wykładników.
+ * @param[in] a : iloczyn wyrazów
+ * @param[in] b : iloczyn wyrazów
+ * @return wynik porównania dla `qsort`
+ */
+static int LeafTermCompare(const void *a, const void *b)
+{
+    long x = ((const LeafTerm *)a)->exp, y = ((const LeafTerm *)b)->exp;
+
+    return (x > y) - (x < y);
+}
+
+size_t KernelMulLeaf(const poly_exp_t *ea, const poly_coeff_t *ca, size_t na,
+                     const poly_exp_t *eb, const poly_coeff_t *cb, size_t nb,
+                     poly_exp_t **exps, poly_coeff_t **coeffs)
+{
+    return KernelMulLeafTrunc(ea, ca, na, eb, cb, nb, LONG_MAX, exps, coeffs);
+}
+
+size_t KernelMulLeafTrunc(const poly_exp_t *ea, const poly_coeff_t *ca, size_t na,
+                          const poly_exp_t *eb, const poly_coeff_t *cb, size_t nb,
+                          long limit, poly_exp_t **exps, poly_coeff_t **coeffs)
+{
+    long lo = (long)ea[0] + eb[0], hi = (long)ea[na - 1] + eb[nb - 1];
+    size_t k = 0;
+    bool overflow = false;
+
+    hi = hi < limit ? hi : limit;
+    if (hi < lo)
+    {
+        *exps = malloc(sizeof(poly_exp_t));
+        *coeffs = malloc(sizeof(poly_coeff_t));
+        assert(*exps != NULL && *coeffs != NULL);
+
+        return 0;
+    }
+
+    size_t span = (size_t)(hi - lo) + 1;
+
+    if (span / MUL_LEAF_DENSE_RATIO <= na * nb)
+    {
+        poly_coeff_t *acc = calloc(span, sizeof(poly_coeff_t));
+        size_t *ia = malloc((na + nb) * sizeof(size_t)), *ib = ia + na;
+        *exps = malloc(span * sizeof(poly_exp_t));
+        assert(acc != NULL && ia != NULL && *exps != NULL);
+
+        for (size_t i = 0; i < na; i++)
+            ia[i] = (size_t)(ea[i] - ea[0]);
+        for (size_t j = 0; j < nb; j++)
+            ib[j] = (size_t)(eb[j] - eb[0]);
+
+        KernelMulDenseTrunc(acc, ia, ca, na, ib, cb, nb, span - 1);
+        free(ia);
+
+        for (size_t s = 0; s < span; s++)
+            (*exps)[s] = (poly_exp_t)(lo + (long)s);
+
+        *coeffs = acc;
+
+        return KernelCompact(*exps, *coeffs, span);
+    }
+
+    LeafTerm *terms = malloc(na * nb * sizeof(LeafTerm));
+    assert(terms != NULL);
+
+    for (size_t i = 0; i < na; i++)
+    {
+        for (size_t j = 0; j < nb && (long)ea[i] + eb[j] <= limit; j++, k++)
+        {
+            terms[k].exp = (long)ea[i] + eb[j];
+            terms[k].coeff = CoeffMulAcc(ca[i], cb[j], &overflow);
+        }
+    }
+
+    qsort(terms, k, sizeof(LeafTerm), LeafTermCompare);
+
+    *exps = malloc(k * sizeof(poly_exp_t));
+    *coeffs = malloc(k * sizeof(poly_coeff_t));
+    assert(*exps != NULL && *coeffs != NULL);
+
+    size_t n = 0;
+
+    for (size_t i = 0; i < k; i++)
+    {
+        bool same = n > 0 && (*exps)[n - 1] == (poly_exp_t)terms[i].exp;
+
+        n -= same;
+        (*exps)[n] = (poly_exp_t)terms[i].exp;
+        (*coeffs)[n] = CoeffAddAcc(same ? (*coeffs)[n] : 0, terms[i].coeff,
+                                   &overflow);
+        n++;
+    }
+
+    free(terms);
+    CoeffOverflowNote(overflow);
+
+    return KernelCompact(*exps, *coeffs, n);
+}
+
+size_t KernelFmaLeaf(const poly_exp_t *ea, const poly_coeff_t *ca, size_t na,
+                     const poly_exp_t *eb, const poly_coeff_t *cb, size_t nb,
+                     const poly_exp_t *ec, const poly_coeff_t *cc, size_t nc,
+                     poly_exp_t **exps, poly_coeff_t **coeffs)
+{
+    long lo = (long)ea[0] + eb[0], hi = (long)ea[na - 1] + eb[nb - 1];
+    size_t k = 0;
+    bool overflow = false;
+
+    if (nc > 0)
+    {
+        lo = ec[0] < lo ? ec[0] : lo;
+        hi = ec[nc - 1] > hi ? ec[nc - 1] : hi;
+    }
+
+    size_t span = (size_t)(hi - lo) + 1;
+
+    if (span / MUL_LEAF_DENSE_RATIO <= na * nb + nc)
+    {
+        poly_coeff_t *acc = calloc(span, sizeof(poly_coeff_t));
+        size_t *ia = malloc((na + nb) * sizeof(size_t)), *ib = ia + na;
+        size_t off = (size_t)((long)ea[0] + eb[0] - lo);
+        *exps = malloc(span * sizeof(poly_exp_t));
+        assert(acc != NULL && ia != NULL && *exps != NULL);
+
+        for (size_t i = 0; i < na; i++)
+            ia[i] = (size_t)(ea[i] - ea[0]);
+        for (size_t j = 0; j < nb; j++)
+            ib[j] = (size_t)(eb[j] - eb[0]);
+
+        KernelMulDense(acc + off, ia, ca, na, ib, cb, nb);
+        free(ia);
+
+        /* Składnik dochodzi po iloczynach, bo szybkie pętle `KernelMulDense`
+           wykluczają przepełnienia tylko dla tablicy zaczynającej od zer. */
+        for (size_t l = 0; l < nc; l++)
+        {
+            size_t s = (size_t)(ec[l] - lo);
+            acc[s] = CoeffAddAcc(acc[s], cc[l], &overflow);
+        }
+        CoeffOverflowNote(overflow);
+
+        for (size_t s = 0; s < span; s++)
+            (*exps)[s] = (poly_exp_t)(lo + (long)s);
+
+        *coeffs = acc;
+
+        return KernelCompact(*exps, *coeffs, span);
+    }
+
+    LeafTerm *terms = malloc((na * nb + nc) * sizeof(LeafTerm));
+    assert(terms != NULL);
+
+    for (size_t i = 0; i < na; i++)
+    {
+        for (size_t j = 0; j < nb; j++, k++)
+        {
+            terms[k].exp = (long)ea[i] + eb[j];
+            terms[k].coeff = CoeffMulAcc(ca[i], cb[j], &overflow);
+        }
+    }
+    for (size_t l = 0; l < nc; l++, k++)
+        terms[k] = (LeafTerm) {.exp = ec[l], .coeff = cc[l]};
+
+    qsort(terms, k, sizeof(LeafTerm), LeafTermCompare);
+
+    *exps = malloc(k * sizeof(poly_exp_t));
+    *coeffs = malloc(k * sizeof(poly_coeff_t));
+    assert(*exps != NULL && *coeffs != NULL);
+
+    size_t n = 0;
+
+    for (size_t i = 0; i < k; i++)
+    {
+        bool same = n > 0 && (*exps)[n - 1] == (poly_exp_t)terms[i].exp;
+
+        n -= same;
+        (*exps)[n] = (poly_exp_t)terms[i].exp;
+        (*coeffs)[n] = CoeffAddAcc(same ? (*coeffs)[n] : 0, terms[i].coeff,
+                                   &overflow);
+        n++;
+    }
+
+    free(terms);
+    CoeffOverflowNote(overflow);
+
+    return KernelCompact(*exps, *coeffs, n);
+}
+
+size_t KernelSqrLeaf(const poly_exp_t *e, const poly_coeff_t *c, size_t n,
+                     poly_exp_t **exps, poly_coeff_t **coeffs)
+{
+    long lo = 2L * e[0];
+    size_t span = (size_t)(2L * e[n - 1] - lo) + 1;
+    size_t pairs = n * (n + 1) / 2, k = 0;
+    bool overflow = false;
+
+    /* Sortowanie połowy iloczynów kosztuje więcej niż gęsta tablica, więc
+       próg jest ten sam co w `KernelMulLeaf`. */
+    if (span / MUL_LEAF_DENSE_RATIO <= n * n)
+    {
+        poly_coeff_t *acc = calloc(span, sizeof(poly_coeff_t));
+        size_t *idx = malloc(n * sizeof(size_t));
+        *exps = malloc(span * sizeof(poly_exp_t));
+        assert(acc != NULL && idx != NULL && *exps != NULL);
+
+        for (size_t i = 0; i < n; i++)
+            idx[i] = (size_t)(e[i] - e[0]);
+
+        KernelSqrDense(acc, idx, c, n);
+        free(idx);
+
+        for (size_t s = 0; s < span; s++)
+            (*exps)[s] = (poly_exp_t)(lo + (long)s);
+
+        *coeffs = acc;
+
+        return KernelCompact(*exps, *coeffs, span);
+    }
+
+    LeafTerm *terms = malloc(pairs * sizeof(LeafTerm));
+    assert(terms != NULL);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        terms[k].exp = 2L * e[i];
+        terms[k++].coeff = CoeffMulAcc(c[i], c[i], &overflow);
+
+        for (size_t j = i + 1; j < n; j++, k++)
+        {
+            poly_coeff_t prod = CoeffMulAcc(c[i], c[j], &overflow);
+
+            terms[k].exp = (long)e[i] + e[j];
+            terms[k].coeff = CoeffAddAcc(prod, prod, &overflow);
+        }
+    }
+
+    qsort(terms, k, sizeof(LeafTerm), LeafTermCompare);
+
+    *exps = malloc(k * sizeof(poly_exp_t));
+    *coeffs = malloc(k * sizeof(poly_coeff_t));
+    assert(*exps != NULL && *coeffs != NULL);
+
+    size_t m = 0;
+
+    for (size_t i = 0; i < k; i++)
+    {
+        bool same = m > 0 && (*exps)[m - 1] == (poly_exp_t)terms[i].exp;
+
+        m -= same;
+        (*exps)[m] = (poly_exp_t)terms[i].exp;
+        (*coeffs)[m] = CoeffAddAcc(same ? (*coeffs)[m] : 0, terms[i].coeff,
+                                   &overflow);
+        m++;
+    }
+
+    free(terms);
+    CoeffOverflowNote(overflow);
+
+    return KernelCompact(*exps, *coeffs, m);
+}
@@ -0,0 +1,237 @@
+/** @file
+    Interfejs operacji na ciągłych tablicach współczynników
+
+    Funkcje wybierają w czasie działania programu najszybszą dostępną
+    implementację (AVX-512, AVX2 albo skalarną). Arytmetyka jest modulo
+    @f$2^b@f$, gdzie @f$b@f$ to `POLY_COEFF_BITS`, albo modulo moduł
+    ustawiony `PolyCoeffModSet`, tak jak w pozostałych operacjach na
+    wielomianach.
+
+    @author Aliaksandr Sarokin <as372525@students.mimuw.edu.pl>
+    @copyright Uniwersytet Warszawski
+    @date 2017-06-03
+*/
+
+#ifndef __KERNELS_H__
+#define __KERNELS_H__
+
+#include <stddef.h>
+
+#include "poly.h"
+
+/**
+ * Zapisuje do @p dst tablicę przeciwnych współczynników.
+ * Tablice mogą się pokrywać tylko, gdy @p dst == @p src.
+ * @param[out] dst : wynik
+ * @param[in] src : współczynniki
+ * @param[in] n : długość tablic
+ */
+void KernelNeg(poly_coeff_t *dst, const poly_coeff_t *src, size_t n);
+
+/**
+ * Zapisuje do @p dst współczynniki pomnożone przez stałą.
+ * Tablice mogą się pokrywać tylko, gdy @p dst == @p src.
+ * @param[out] dst : wynik
+ * @param[in] src : współczynniki
+ * @param[in] n : długość tablic
+ * @param[in] c : stała
+ */
+void KernelScale(poly_coeff_t *dst, const poly_coeff_t *src, size_t n,
+                 poly_coeff_t c);
+
+/**
+ * Zapisuje do @p dst sumy odpowiadających sobie współczynników.
+ * @p dst może być równe @p a lub @p b.
+ * @param[out] dst : wynik
+ * @param[in] a : współczynniki
+ * @param[in] b : współczynniki
+ * @param[in] n : długość tablic
+ */
+void KernelAdd(poly_coeff_t *dst, const poly_coeff_t *a,
+               const poly_coeff_t *b, size_t n);
+
+/**
+ * Wylicza schematem Hornera wartość @f$\sum_i coeffs[i] x^i@f$.
+ * @param[in] coeffs : współczynniki
+ * @param[in] n : długość tablicy
+ * @param[in] x : punkt
+ * @return wartość
+ */
+poly_coeff_t KernelEval(const poly_coeff_t *coeffs, size_t n, poly_coeff_t x);
+
+/**
+ * Wylicza wartość @f$\sum_i coeffs[i] x^{exps[i]}@f$ rzadkiego ciągu wyrazów
+ * schematem Hornera z potęgowaniem różnic kolejnych wykładników.
+ * @param[in] exps : rosnące wykładniki
+ * @param[in] coeffs : współczynniki
+ * @param[in] n : liczba wyrazów
+ * @param[in] x : punkt
+ * @return wartość
+ */
+poly_coeff_t KernelEvalLeaf(const poly_exp_t *exps, const poly_coeff_t *coeffs,
+                            size_t n, poly_coeff_t x);
+
+/**
+ * Scala bezskokowo dwa rzadkie ciągi wyrazów o rosnących wykładnikach,
+ * sumując współczynniki przy równych wykładnikach i usuwając zera.
+ * Tablice wynikowe muszą mieć miejsce na @p na + @p nb wyrazów.
+ * @param[in] ea : wykładniki pierwszego ciągu
+ * @param[in] ca : współczynniki pierwszego ciągu
+ * @param[in] na : długość pierwszego ciągu
+ * @param[in] eb : wykładniki drugiego ciągu
+ * @param[in] cb : współczynniki drugiego ciągu
+ * @param[in] nb : długość drugiego ciągu
+ * @param[out] exps : wykładniki wyniku
+ * @param[out] coeffs : współczynniki wyniku
+ * @return liczba wyrazów wyniku
+ */
+size_t KernelMergeLeaf(const poly_exp_t *ea, const poly_coeff_t *ca, size_t na,
+                       const poly_exp_t *eb, const poly_coeff_t *cb, size_t nb,
+                       poly_exp_t *exps, poly_coeff_t *coeffs);
+
+/**
+ * Mnoży dwa niepuste rzadkie ciągi wyrazów o rosnących wykładnikach.
+ * Gdy zakres wykładników iloczynu jest mały w porównaniu z liczbą iloczynów
+ * wyrazów, sumuje je w gęstej tablicy, a wpp sortuje iloczyny wyrazów.
+ * Alokuje tablice wynikowe; zwalnia je wołający.
+ * @param[in] ea : wykładniki pierwszego ciągu
+ * @param[in] ca : współczynniki pierwszego ciągu
+ * @param[in] na : długość pierwszego ciągu
+ * @param[in] eb : wykładniki drugiego ciągu
+ * @param[in] cb : współczynniki drugiego ciągu
+ * @param[in] nb : długość drugiego ciągu
+ * @param[out] exps : rosnące wykładniki wyniku
+ * @param[out] coeffs : niezerowe współczynniki wyniku
+ * @return liczba wyrazów wyniku
+ */
+size_t KernelMulLeaf(const poly_exp_t *ea, const poly_coeff_t *ca, size_t na,
+                     const poly_exp_t *eb, const poly_coeff_t *cb, size_t nb,
+                     poly_exp_t **exps, poly_coeff_t **coeffs);
+
+/**
+ * Jak `KernelMulLeaf`, ale nie tworzy iloczynów wyrazów o wykładniku
+ * większym niż @p limit.
+ * @param[in] ea : wykładniki pierwszego ciągu
+ * @param[in] ca : współczynniki pierwszego ciągu
+ * @param[in] na : długość pierwszego ciągu
+ * @param[in] eb : wykładniki drugiego ciągu
+ * @param[in] cb : współczynniki drugiego ciągu
+ * @param[in] nb : długość drugiego ciągu
+ * @param[in] limit : największy wykładnik wyniku
+ * @param[out] exps : rosnące wykładniki wyniku
+ * @param[out] coeffs : niezerowe współczynniki wyniku
+ * @return liczba wyrazów wyniku
+ */
+size_t KernelMulLeafTrunc(const poly_exp_t *ea, const poly_coeff_t *ca, size_t na,
+                          const poly_exp_t *eb, const poly_coeff_t *cb, size_t nb,
+                          long limit, poly_exp_t **exps, poly_coeff_t **coeffs);
+
+/**
+ * Dodaje iloczyn dwóch niepustych rzadkich ciągów wyrazów do trzeciego
+ * ciągu, nie tworząc iloczynu osobno: iloczyny wyrazów i wyrazy trzeciego
+ * ciągu trafiają do tej samej gęstej tablicy albo tego samego sortowania
+ * co w `KernelMulLeaf`. Wszystkie ciągi mają rosnące wykładniki.
+ * Alokuje tablice wynikowe; zwalnia je wołający.
+ * @param[in] ea : wykładniki pierwszego czynnika
+ * @param[in] ca : współczynniki pierwszego czynnika
+ * @param[in] na : długość pierwszego czynnika
+ * @param[in] eb : wykładniki drugiego czynnika
+ * @param[in] cb : współczynniki drugiego czynnika
+ * @param[in] nb : długość drugiego czynnika
+ * @param[in] ec : wykładniki składnika
+ * @param[in] cc : współczynniki składnika
+ * @param[in] nc : długość składnika, może być zerowa
+ * @param[out] exps : rosnące wykładniki wyniku
+ * @param[out] coeffs : niezerowe współczynniki wyniku
+ * @return liczba wyrazów wyniku
+ */
+size_t KernelFmaLeaf(const poly_exp_t *ea, const poly_coeff_t *ca, size_t na,
+                     const poly_exp_t *eb, const poly_coeff_t *cb, size_t nb,
+                     const poly_exp_t *ec, const poly_coeff_t *cc, size_t nc,
+                     poly_exp_t **exps, poly_coeff_t **coeffs);
+
+/**
+ * Dodaje do gęstej tablicy iloczyny wszystkich par wyrazów:
+ * @f$acc[ia_i + ib_j] \mathrel{+}= ca_i \cdot cb_j@f$.
+ * Wybiera pętlę raz na wywołanie: modularną, bez sprawdzania przepełnień
+ * (gdy ograniczenia wartości współczynników je wykluczają) albo sprawdzaną.
+ * @param[in,out] acc : tablica sum
+ * @param[in] ia : pozycje wyrazów pierwszego ciągu
+ * @param[in] ca : współczynniki pierwszego ciągu
+ * @param[in] na : długość pierwszego ciągu
+ * @param[in] ib : pozycje wyrazów drugiego ciągu
+ * @param[in] cb : współczynniki drugiego ciągu
+ * @param[in] nb : długość drugiego ciągu
+ */
+void KernelMulDense(poly_coeff_t *acc,
+                    const size_t *ia, const poly_coeff_t *ca, size_t na,
+                    const size_t *ib, const poly_coeff_t *cb, size_t nb);
+
+/**
+ * Jak `KernelMulDense`, ale pomija pary o sumie pozycji większej niż
+ * @p limit. Pozycje obu ciągów muszą rosnąć.
+ * @param[in,out] acc : tablica sum
+ * @param[in] ia : pozycje wyrazów pierwszego ciągu
+ * @param[in] ca : współczynniki pierwszego ciągu
+ * @param[in] na : długość pierwszego ciągu
+ * @param[in] ib : pozycje wyrazów drugiego ciągu
+ * @param[in] cb : współczynniki drugiego ciągu
+ * @param[in] nb : długość drugiego ciągu
+ * @param[in] limit : największa suma pozycji
+ */
+void KernelMulDenseTrunc(poly_coeff_t *acc,
+                         const size_t *ia, const poly_coeff_t *ca, size_t na,
+                         const size_t *ib, const poly_coeff_t *cb, size_t nb,
+                         size_t limit);
+
+/**
+ * Podnosi do kwadratu niepusty rzadki ciąg wyrazów o rosnących wykładnikach.
+ * Każdy iloczyn dwóch różnych wyrazów liczy raz i dodaje podwojony, więc
+ * wykonuje około połowy mnożeń `KernelMulLeaf`.
+ * Alokuje tablice wynikowe; zwalnia je wołający.
+ * @param[in] e : wykładniki ciągu
+ * @param[in] c : współczynniki ciągu
+ * @param[in] n : długość ciągu
+ * @param[out] exps : rosnące wykładniki wyniku
+ * @param[out] coeffs : niezerowe współczynniki wyniku
+ * @return liczba wyrazów wyniku
+ */
+size_t KernelSqrLeaf(const poly_exp_t *e, const poly_coeff_t *c, size_t n,
+                     poly_exp_t **exps, poly_coeff_t **coeffs);
+
+/**
+ * Dodaje do gęstej tablicy kwadrat ciągu wyrazów:
+ * @f$acc[i_k + i_l] \mathrel{+}= c_k \cdot c_l@f$ dla wszystkich par
+ * @f$(k, l)@f$, licząc iloczyn różnych wyrazów raz i dodając go podwojonego.
+ * @param[in,out] acc : tablica sum
+ * @param[in] idx : pozycje wyrazów
+ * @param[in] c : współczynniki
+ * @param[in] n : długość ciągu
+ */
+void KernelSqrDense(poly_coeff_t *acc, const size_t *idx, const poly_coeff_t *c,
+                    size_t n);
+
+/**
+ * Dzieli z resztą metodą szkolną gęsty ciąg współczynników przez gęsty
+ * ciąg o odwracalnym współczynniku wiodącym. Działa w miejscu: iloraz
+ * trafia na pozycje @f$n, \ldots, m@f$, a reszta na @f$0, \ldots, n - 1@f$.
+ * @param[in,out] r : współczynniki dzielnej, @f$m + 1@f$ pozycji
+ * @param[in] m : stopień dzielnej, co najmniej @p n
+ * @param[in] b : współczynniki dzielnika, @f$n + 1@f$ pozycji
+ * @param[in] n : stopień dzielnika
+ * @param[in] inv : odwrotność `b[n]`
+ */
+void KernelDivRem(poly_coeff_t *r, size_t m, const poly_coeff_t *b, size_t n,
+                  poly_coeff_t inv);
+
+/**
+ * Usuwa wyrazy o zerowych współczynnikach, zachowując kolejność pozostałych.
+ * Działa w miejscu na równoległych tablicach wykładników i współczynników.
+ * @param[in,out] exps : wykładniki
+ * @param[in,out] coeffs : współczynniki
+ * @param[in] n : liczba wyrazów
+ * @return liczba pozostałych wyrazów
+ */
+size_t KernelCompact(poly_exp_t *exps, poly_coeff_t *coeffs, size_t n);
+
+#endif /* __KERNELS_H__ */
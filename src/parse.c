@@ -6,6 +6,7 @@
     @date 2017-06-03
 */
 
+#include <assert.h>
 #include <string.h>
 #include <stdlib.h>
 
@@ -18,8 +19,11 @@
 /** Maksymalna długość wczytywanej liczby */
 #define NUMBER_LEN_MAX 21
 
+/** Liczba jednomianów sumy, które `ParsePoly` trzyma bez alokacji */
+#define PARSE_INLINE_MONOS 8
+
 /** Liczba komend */
-#define COMMAND_ALL 15
+#define COMMAND_ALL 35
 
 /** Maksymalna liczba w postaci napisu */
 #define NUMBER_MAX_STRING "9223372036854775807"
@@ -27,6 +31,15 @@
 /** Minimalna liczba w postaci napisu */
 #define NUMBER_MIN_STRING "-9223372036854775808"
 
+/** Jednomiany wczytywanej sumy; krótkie sumy mieszczą się w `buf` */
+typedef struct MonoArray
+{
+    Mono *monos; ///< jednomiany, `buf` albo tablica na stercie
+    unsigned len; ///< liczba jednomianów
+    unsigned cap; ///< pojemność `monos`
+    Mono buf[PARSE_INLINE_MONOS]; ///< wewnętrzny bufor
+} MonoArray;
+
 /** Tablica komend */
 const char *t[] =
                 {
@@ -37,7 +50,17 @@ const char *t[] =
                     "IS_EQ", "DEG",
                     "DEG_BY", "AT",
                     "PRINT", "POP",
-                    "COMPOSE"
+                    "COMPOSE", "OVERFLOW",
+                    "MOD", "INTERN",
+                    "MEMORY", "TREE",
+                    "REORDER", "RESTORE",
+                    "SQR", "POW",
+                    "SERIES", "DIV",
+                    "REM", "GCD",
+                    "IS_EQ_FAST", "LAZY",
+                    "ADD_ALL", "MUL_ALL",
+                    "FMA", "ACC_PUSH",
+                    "ACC_FLUSH"
                 };
 
 /**
@@ -106,9 +129,9 @@ static bool ParseNumber(long long *n, unsigned *c)
             *n = atoll(s);
             bool res = true;
             unsigned z = 0;
-            if (*n == POLY_COEFF_MIN)
+            if (*n == LLONG_MIN)
                 res = ParseNumberLimit(NUMBER_MIN_STRING, s, --i, &z);
-            else if (*n == POLY_COEFF_MAX) {
+            else if (*n == LLONG_MAX) {
                 if (i == NUMBER_LEN_MAX)
                     (*c)--;
                 res = ParseNumberLimit(NUMBER_MAX_STRING, s, --i, &z);
@@ -139,10 +162,11 @@ static bool ParseNumberArgument(long long *n)
 }
 
 /**
- * Parsuje DEG_BY i AT
+ * Parsuje argument komend DEG_BY, AT, COMPOSE, MOD, POW, ADD_ALL i MUL_ALL
  * @param[in] command : komenda
  * @param[in,out] c : kolumna
- * @return COMMAND, WRONGVALUE, WRONGVARIABLE, WRONGCOMMAND
+ * @return COMMAND, WRONGVALUE, WRONGVARIABLE, WRONGCOUNT, WRONGMODULUS,
+ * WRONGEXPONENT, WRONGCOMMAND
  */
 static ParseResult ParseArgument(const Command *command, poly_coeff_t *c)
 {
@@ -155,8 +179,13 @@ static ParseResult ParseArgument(const Command *command, poly_coeff_t *c)
             return WRONGVALUE;
         else if (*command == DEG_BY)
             return WRONGVARIABLE;
-        else if (*command == COMPOSE)
+        else if (*command == COMPOSE || *command == ADD_ALL
+                 || *command == MUL_ALL)
             return WRONGCOUNT;
+        else if (*command == MOD)
+            return WRONGMODULUS;
+        else if (*command == POW)
+            return WRONGEXPONENT;
         else
             return WRONGCOMMAND;
     }
@@ -172,11 +201,22 @@ static ParseResult ParseArgument(const Command *command, poly_coeff_t *c)
             if ((x = getchar()) != '\n') ParseLineIgnore(x);
             return WRONGVARIABLE;
         }
-        else if (*command == COMPOSE && (n < 0 || n > UINT_MAX))
+        else if ((*command == COMPOSE || *command == ADD_ALL
+                  || *command == MUL_ALL) && (n < 0 || n > UINT_MAX))
         {
             if ((x = getchar()) != '\n') ParseLineIgnore(x);
             return WRONGCOUNT;
         }
+        else if (*command == MOD && (n < 0 || n == 1 || n > POLY_COEFF_MAX))
+        {
+            if ((x = getchar()) != '\n') ParseLineIgnore(x);
+            return WRONGMODULUS;
+        }
+        else if (*command == POW && (n < 0 || n > POLY_EXP_MAX))
+        {
+            if ((x = getchar()) != '\n') ParseLineIgnore(x);
+            return WRONGEXPONENT;
+        }
         else
         {
             if (getchar() != '\n')
@@ -195,13 +235,127 @@ static ParseResult ParseArgument(const Command *command, poly_coeff_t *c)
             return WRONGVALUE;
         else if (*command == DEG_BY)
             return WRONGVARIABLE;
-        else if (*command == COMPOSE)
+        else if (*command == COMPOSE || *command == ADD_ALL
+                 || *command == MUL_ALL)
             return WRONGCOUNT;
+        else if (*command == MOD)
+            return WRONGMODULUS;
+        else if (*command == POW)
+            return WRONGEXPONENT;
         else
             return WRONGCOMMAND;
     }
 }
 
+/**
+ * Parsuje argumenty komendy SERIES: indeks zmiennej i ograniczenie jej
+ * stopnia, oddzielone spacją
+ * @param[in,out] c : indeks zmiennej
+ * @param[in,out] e : ograniczenie stopnia, -1 gdy brak
+ * @return COMMAND, WRONGVARIABLE, WRONGEXPONENT, WRONGCOMMAND
+ */
+static ParseResult ParseSeriesArguments(poly_coeff_t *c, poly_exp_t *e)
+{
+    long long n = 0, m = 0;
+    unsigned digits = 0;
+    int x = getchar();
+
+    if (x != ' ')
+    {
+        ParseLineIgnore(x);
+        return WRONGVARIABLE;
+    }
+
+    x = getchar();
+    while (x >= '0' && x <= '9' && n < SERIES_VARS_MAX)
+    {
+        n = 10 * n + (x - '0');
+        digits++;
+        x = getchar();
+    }
+    if (x == '\n' && digits > 0 && n < SERIES_VARS_MAX)
+    {
+        return WRONGEXPONENT;
+    }
+    else if (x != ' ' || digits == 0 || n >= SERIES_VARS_MAX)
+    {
+        ParseLineIgnore(x);
+        return WRONGVARIABLE;
+    }
+
+    if (!ParseNumberArgument(&m))
+    {
+        ParseLineIgnore(x);
+        return WRONGEXPONENT;
+    }
+    else if (m < -1 || m > POLY_EXP_MAX)
+    {
+        if ((x = getchar()) != '\n') ParseLineIgnore(x);
+        return WRONGEXPONENT;
+    }
+    else if (getchar() != '\n')
+    {
+        ParseLineIgnore('\0');
+        return WRONGCOMMAND;
+    }
+
+    *c = (poly_coeff_t)n;
+    *e = (poly_exp_t)m;
+
+    return COMMAND;
+}
+
+/**
+ * Inicjuje pustą tablicę jednomianów.
+ * @param[out] a : tablica jednomianów
+ */
+static void MonoArrayInit(MonoArray *a)
+{
+    a->monos = a->buf;
+    a->len = 0;
+    a->cap = PARSE_INLINE_MONOS;
+}
+
+/**
+ * Dopisuje jednomian do tablicy, przejmując go na własność.
+ * @param[in,out] a : tablica jednomianów
+ * @param[in] m : jednomian
+ */
+static void MonoArrayPush(MonoArray *a, const Mono *m)
+{
+    if (a->len == a->cap)
+    {
+        a->cap *= 2;
+
+        if (a->monos == a->buf)
+        {
+            a->monos = malloc(a->cap * sizeof(Mono));
+            assert(a->monos != NULL);
+            memcpy(a->monos, a->buf, sizeof(a->buf));
+        }
+        else
+        {
+            a->monos = realloc(a->monos, a->cap * sizeof(Mono));
+            assert(a->monos != NULL);
+        }
+    }
+
+    a->monos[a->len++] = *m;
+}
+
+/**
+ * Usuwa jednomiany z tablicy i zwalnia jej pamięć.
+ * @param[in,out] a : tablica jednomianów
+ */
+static void MonoArrayDestroy(MonoArray *a)
+{
+    for (unsigned i = 0; i < a->len; i++)
+        MonoDestroy(&a->monos[i]);
+
+    if (a->monos != a->buf)
+        free(a->monos);
+}
+
 /**
  * Próbuje wczytać wielomian.
  * @param[in,out] p : wielomian
@@ -213,7 +367,8 @@ static bool ParsePoly(Poly *p, unsigned *c)
     int x = getchar();
     ungetc(x, stdin);
     if (x == '(') {
-        List monos = ListCreate();
+        MonoArray monos;
+        MonoArrayInit(&monos);
 
         do
         {
@@ -221,7 +376,7 @@ static bool ParsePoly(Poly *p, unsigned *c)
             {
                 ParseLineIgnore(x);
                 PolyDestroy(p);
-                ListDestroy(monos);
+                MonoArrayDestroy(&monos);
                 return false;
             }
             (*c)++;
@@ -229,7 +384,7 @@ static bool ParsePoly(Poly *p, unsigned *c)
             if (ParsePoly(&l, c) == false)
             {
                 PolyDestroy(p);
-                ListDestroy(monos);
+                MonoArrayDestroy(&monos);
                 return false;
             }
             (*c)++;
@@ -240,7 +395,7 @@ static bool ParsePoly(Poly *p, unsigned *c)
                 ParseLineIgnore(x);
                 PolyDestroy(p);
                 PolyDestroy(&l);
-                ListDestroy(monos);
+                MonoArrayDestroy(&monos);
                 return false;
             }
 
@@ -253,13 +408,13 @@ static bool ParsePoly(Poly *p, unsigned *c)
                 ParseLineIgnore('\0');
                 PolyDestroy(p);
                 PolyDestroy(&l);
-                ListDestroy(monos);
+                MonoArrayDestroy(&monos);
                 return false;
             }
 
             poly_exp_t exp = (poly_exp_t ) n;
             Mono m = MonoFromPoly(&l, exp);
-            monos = NodeCreate(&m, monos);
+            MonoArrayPush(&monos, &m);
             (*c)++;
             if ((x = getchar()) != ')')
             {
@@ -267,7 +422,7 @@ static bool ParsePoly(Poly *p, unsigned *c)
                     (*c)--;
                 ParseLineIgnore(x);
                 PolyDestroy(p);
-                ListDestroy(monos);
+                MonoArrayDestroy(&monos);
                 return false;
             }
             (*c)++;
@@ -278,7 +433,7 @@ static bool ParsePoly(Poly *p, unsigned *c)
                     (*c)--;
                 ParseLineIgnore(x);
                 PolyDestroy(p);
-                ListDestroy(monos);
+                MonoArrayDestroy(&monos);
                 return false;
             }
             if (x != '+')
@@ -289,10 +444,9 @@ static bool ParsePoly(Poly *p, unsigned *c)
         }
         while (x == '+');
 
-        unsigned size;
-        Mono *mm = ListToArray(monos, &size);
-        *p = PolyAddMonos(size, mm);
-        free(mm);
+        *p = PolyAddMonos(monos.len, monos.monos);
+        if (monos.monos != monos.buf)
+            free(monos.monos);
         return true;
     }
     else
@@ -301,8 +455,8 @@ static bool ParsePoly(Poly *p, unsigned *c)
         bool res = ParseNumber(&n, c);
         if (res && n >= POLY_COEFF_MIN && n <= POLY_COEFF_MAX)
         {
-            p->c = (poly_coeff_t) n;
-            p->l = NULL;
+            Poly c = PolyFromCoeff((poly_coeff_t) n);
+            *p = PolyCoeffReduce(&c);
             return true;
         }
         else
@@ -349,7 +503,8 @@ static bool ParseCommand(Command *command)
     }
 }
 
-ParseResult ParseLineRead(Poly *p, Command *command, unsigned *c)
+ParseResult ParseLineRead(Poly *p, Command *command, unsigned *c,
+                          poly_exp_t *e)
 {
     int x = getchar();
 
@@ -362,10 +517,16 @@ ParseResult ParseLineRead(Poly *p, Command *command, unsigned *c)
         *command = ZERO;
         if (ParseCommand(command))
         {
-            if (*command == AT || *command == DEG_BY || *command == COMPOSE)
+            if (*command == AT || *command == DEG_BY || *command == COMPOSE
+                || *command == MOD || *command == POW || *command == ADD_ALL
+                || *command == MUL_ALL)
             {
                 return ParseArgument(command, &p->c);
             }
+            else if (*command == SERIES)
+            {
+                return ParseSeriesArguments(&p->c, e);
+            }
 
             if ((x = getchar()) != '\n')
             {
@@ -410,11 +571,11 @@ static void PolyPrintHelp(const Poly *p)
 {
     if (PolyIsCoeff(p))
     {
-        printf("%ld", p->c);
+        printf("%ld", (long)p->c);
     }
     else
     {
-        if (p->c != 0) printf("(%ld,0)+", p->c);
+        if (p->c != 0) printf("(%ld,0)+", (long)p->c);
         ListPrint(p->l);
     }
 }
@@ -425,22 +586,33 @@ static void PolyPrintHelp(const Poly *p)
  */
 static void ListPrint(const List l)
 {
-    Node *k = l;
-    while(k != NULL)
+    ListIter k = ListIterBegin(l);
+    while(k.n != NULL)
     {
+        Poly c = ListIterCoeff(&k);
         printf("(");
-        PolyPrintHelp(&(k->m.p));
-        printf(",%d)", k->m.exp);
-        if (k->next != NULL)
+        PolyPrintHelp(&c);
+        printf(",%d)", ListIterExp(&k));
+        ListIterNext(&k);
+        if (k.n != NULL)
         {
             printf("+");
         }
-        k = k->next;
     }
 }
 
 void PolyPrint(const Poly *p)
 {
-    PolyPrintHelp(p);
+    if (PolyIsTree(p))
+    {
+        Poly tmp = PolyToList(p);
+
+        PolyPrintHelp(&tmp);
+        PolyDestroy(&tmp);
+    }
+    else
+    {
+        PolyPrintHelp(p);
+    }
     printf("\n");
 }
\ No newline at end of file
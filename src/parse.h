@@ -14,6 +14,9 @@
 #include "poly.h"
 #include "utils.h"
 
+/** Liczba zmiennych, których stopnie można ograniczyć komendą SERIES */
+#define SERIES_VARS_MAX 4096
+
 /** Rezultat wczytywania linii */
 typedef enum {
     POLY,
@@ -23,7 +26,9 @@ typedef enum {
     WRONGCOMMAND,
     WRONGVARIABLE,
     WRONGVALUE,
-    WRONGCOUNT
+    WRONGCOUNT,
+    WRONGMODULUS,
+    WRONGEXPONENT
 } ParseResult;
 
 /** Wszystkie dostępne komendy */
@@ -42,7 +47,27 @@ typedef enum {
     AT,
     PRINT,
     POP,
-    COMPOSE
+    COMPOSE,
+    OVERFLOW,
+    MOD,
+    INTERN,
+    MEMORY,
+    TREE,
+    REORDER,
+    RESTORE,
+    SQR,
+    POW,
+    SERIES,
+    DIV,
+    REM,
+    GCD,
+    IS_EQ_FAST,
+    LAZY,
+    ADD_ALL,
+    MUL_ALL,
+    FMA,
+    ACC_PUSH,
+    ACC_FLUSH
 } Command;
 
 /**
@@ -56,6 +81,15 @@ static inline size_t ParseNeededArguments(const Poly *p, Command command)
     switch (command)
     {
         case ZERO:
+        case OVERFLOW:
+        case MOD:
+        case INTERN:
+        case MEMORY:
+        case REORDER:
+        case RESTORE:
+        case SERIES:
+        case LAZY:
+        case ACC_FLUSH:
             return 0;
         case IS_COEFF:
         case IS_ZERO:
@@ -66,14 +100,27 @@ static inline size_t ParseNeededArguments(const Poly *p, Command command)
         case PRINT:
         case POP:
         case NEG:
+        case TREE:
+        case SQR:
+        case POW:
+        case ACC_PUSH:
             return 1;
         case IS_EQ:
         case ADD:
         case MUL:
         case SUB:
+        case DIV:
+        case REM:
+        case GCD:
+        case IS_EQ_FAST:
             return 2;
+        case FMA:
+            return 3;
         case COMPOSE:
-            return (size_t)p->c + 1;
+            return (size_t)(unsigned)p->c + 1;
+        case ADD_ALL:
+        case MUL_ALL:
+            return (unsigned)p->c;
     }
     return 0;
 }
@@ -89,9 +136,11 @@ void PolyPrint(const Poly *p);
  * @param[in,out] p : wielomian
  * @param[in,out] command : komenda
  * @param[in,out] c : kolumna
+ * @param[out] e : ograniczenie stopnia komendy SERIES
  * @return rezultat wczytywania linii
  */
-ParseResult ParseLineRead(Poly *p, Command *command, unsigned *c);
+ParseResult ParseLineRead(Poly *p, Command *command, unsigned *c,
+                          poly_exp_t *e);
 
 /**
  * Wypisuje komunikat o błędzie stosu.
@@ -131,7 +180,7 @@ static inline void ErrorWrongValue(int r)
 }
 
 /**
- * Wypisuje komunikat o błędzie DEG_BY.
+ * Wypisuje komunikat o błędzie DEG_BY i SERIES.
  * @param[in] r : wiersz
  */
 static inline void ErrorWrongVariable(int r)
@@ -140,7 +189,8 @@ static inline void ErrorWrongVariable(int r)
 }
 
 /**
- * Wypisuje komunikat o błędzie COMPOSE.
+ * Wypisuje komunikat o błędnej liczbie argumentów COMPOSE, ADD_ALL
+ * i MUL_ALL.
  * @param[in] r : wiersz
  */
 static inline void ErrorWrongCount(int r)
@@ -148,4 +198,40 @@ static inline void ErrorWrongCount(int r)
     fprintf(stderr, "ERROR %d WRONG COUNT\n", r);
 }
 
+/**
+ * Wypisuje komunikat o błędzie MOD.
+ * @param[in] r : wiersz
+ */
+static inline void ErrorWrongModulus(int r)
+{
+    fprintf(stderr, "ERROR %d WRONG MODULUS\n", r);
+}
+
+/**
+ * Wypisuje komunikat o błędzie POW i SERIES.
+ * @param[in] r : wiersz
+ */
+static inline void ErrorWrongExponent(int r)
+{
+    fprintf(stderr, "ERROR %d WRONG EXPONENT\n", r);
+}
+
+/**
+ * Wypisuje komunikat o błędzie DIV i REM.
+ * @param[in] r : wiersz
+ */
+static inline void ErrorWrongDivisor(int r)
+{
+    fprintf(stderr, "ERROR %d WRONG DIVISOR\n", r);
+}
+
+/**
+ * Wypisuje komunikat o błędzie GCD.
+ * @param[in] r : wiersz
+ */
+static inline void ErrorGcdFailed(int r)
+{
+    fprintf(stderr, "ERROR %d GCD FAILED\n", r);
+}
+
 #endif /* __PARSE_H__ */
\ No newline at end of file
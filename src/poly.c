@@ -6,12 +6,132 @@
     @date 2017-06-03
  */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdlib.h>
 #include <assert.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
 
+#include "coeff.h"
 #include "poly.h"
+#include "kernels.h"
+#include "dist.h"
+#include "intern.h"
+#include "tree.h"
+#include "reorder.h"
+#include "gcd.h"
+#include "eval.h"
 #include "utils.h"
 
+/** Minimalna łączna długość fragmentów stałych, od której są scalane bezskokowo */
+#define LEAF_MERGE_MIN_LEN 16
+
+/** Minimalna liczba niezerowych wyrazów bloku gęstego */
+#define BLOCK_MIN_TERMS 8
+
+/** Maksymalna liczba kolejnych zerowych wyrazów wewnątrz bloku gęstego */
+#define BLOCK_MAX_HOLE 2
+
+/** Minimalna liczba wyrazów liścia */
+#define LEAF_MIN_TERMS 2
+
+/** Maksymalna liczba wyrazów liścia */
+#define LEAF_MAX_TERMS 256
+
+/**
+ * Liczba wyrazów, które budowniczy listy trzyma we własnych buforach,
+ * zanim zaalokuje bufory na stercie
+ */
+#define BUILDER_INLINE_TERMS 8
+
+/** Liczba jednomianów, które `PolyAddMonos` sortuje bez alokacji */
+#define ADD_MONOS_INLINE 8
+
+/** Liczba składników, które `PolyAddAll` scala bez alokacji buforów */
+#define ADD_ALL_INLINE 8
+
+/** Rozmiar bufora sumowania nakładających się bloków gęstych */
+#define MERGE_BLOCK_BUF 256
+
+/**
+ * Minimalna liczba iloczynów wyrazów, od której wielomiany wielu zmiennych
+ * są mnożone w reprezentacji rozproszonej
+ */
+#define DIST_MUL_MIN_PRODUCTS 64
+
+/**
+ * Największa liczba wyrazów czynnika, przez który `PolyMul` mnoży,
+ * scalając przesunięte kopie drugiego czynnika
+ */
+#define MUL_SHORT_TERMS 4
+
+/**
+ * Ile razy liczba iloczynów rozwinięcia wielomianowego może przekraczać
+ * liczbę wykładników wyniku, by rozwinięcie się opłacało
+ */
+#define POW_MULTINOMIAL_RATIO 4
+
+/**
+ * Ile razy stopień dzielnej o stałych współczynnikach może przekraczać
+ * liczbę jej wyrazów, by dzielić ją na gęstej tablicy
+ */
+#define DIV_DENSE_RATIO 4
+
+/**
+ * Najmniejszy stopień dzielnika i ilorazu, od którego gęste dzielenie
+ * modulo @f$p@f$ korzysta z metody Newtona
+ */
+#define DIV_NEWTON_MIN 2048
+
+/** Minimalna łączna długość list, od której dodawanie jest zrównoleglane */
+#define PARALLEL_ADD_MIN_LEN 2048
+
+/** Minimalna liczba jednomianów przypadająca na jeden wątek */
+#define PARALLEL_ADD_CHUNK_MIN 512
+
+/** Maksymalna liczba wątków używanych przy dodawaniu */
+#define PARALLEL_ADD_THREADS_MAX 64
+
+/**
+ * Minimalna łączna liczba iloczynów wyrazów poziomu drzewa iloczynów,
+ * od której mnożenia poziomu są wykonywane równolegle
+ */
+#define PARALLEL_MUL_ALL_MIN_PRODUCTS 65536
+
+/**
+ * Głębokość zagnieżdżenia scaleń, od której budowniczy scalanej listy
+ * jest trzymany na stercie, a nie na stosie
+ */
+#define MERGE_STACK_DEPTH 64
+
+/**
+ * Czy bieżący wątek scala już fragment listy.
+ * Zagnieżdżone dodawania współczynników wykonywane są wtedy sekwencyjnie.
+ */
+static _Thread_local bool add_worker = false;
+
+/** Liczba trwających w bieżącym wątku scaleń, zagnieżdżonych w sobie */
+static _Thread_local unsigned merge_depth = 0;
+
+/**
+ * Fragment scalania dwóch list, przetwarzany przez jeden wątek.
+ * Zakresy są lewostronnie domknięte, koniec `NULL` oznacza koniec listy.
+ */
+typedef struct MergeChunk
+{
+    const Node *p; ///< początek zakresu pierwszej listy
+    const Node *p_end; ///< koniec zakresu pierwszej listy
+    const Node *q; ///< początek zakresu drugiej listy
+    const Node *q_end; ///< koniec zakresu drugiej listy
+    List res; ///< scalony fragment
+    Node *tail; ///< ostatni element scalonego fragmentu
+    CoeffModulus mod; ///< moduł arytmetyki wątku scalającego
+    pthread_t thread; ///< wątek przetwarzający fragment
+    bool started; ///< czy udało się uruchomić wątek
+} MergeChunk;
+
 /**
  * Daje większą z dwóch liczb.
  * @param[in] a : liczba
@@ -36,545 +156,4383 @@ static poly_coeff_t Power(poly_coeff_t x, poly_exp_t exp)
     while (exp != 0)
     {
         if (exp & 1)
-            res *= x;
+            res = CoeffMul(res, x);
         exp >>= 1;
-        x *= x;
+        if (exp != 0)
+            x = CoeffMul(x, x);
     }
 
     return res;
 }
 
-List ListCreate()
+/**
+ * Budowniczy listy jednomianów.
+ * Przyjmuje wyrazy w kolejności rosnących wykładników i sam wybiera ich
+ * reprezentację: wystarczająco gęste ciągi stałych współczynników trafiają
+ * do bloków gęstych, pozostałe stałe współczynniki do liści, a jednomiany
+ * o niestałych współczynnikach do pojedynczych elementów listy.
+ * Wyrazy czekające w `leaf_*` zawsze poprzedzają wyrazy z `run`.
+ * Krótkie ciągi i wyrazy czekające na liść mieszczą się w buforach wewnątrz
+ * budowniczego, więc małe wielomiany kosztują tylko alokacje elementów
+ * zbudowanej listy.
+ */
+typedef struct ListBuilder
 {
-    return NULL;
+    List head; ///< zbudowana lista
+    Node **tail; ///< pole `next` ostatniego elementu listy
+    Block *run; ///< bieżący ciąg stałych współczynników (bufor może być pusty)
+    unsigned cap; ///< pojemność bufora `run`
+    unsigned terms; ///< liczba niezerowych wyrazów w `run`
+    poly_exp_t *leaf_exps; ///< wykładniki wyrazów czekających na liść
+    poly_coeff_t *leaf_coeffs; ///< współczynniki wyrazów czekających na liść
+    unsigned leaf_len; ///< liczba wyrazów czekających na liść
+    unsigned leaf_cap; ///< pojemność tablic `leaf_*`
+    /** wewnętrzny bufor `run` */
+    union
+    {
+        Block block; ///< nagłówek ciągu
+        /** miejsce na nagłówek i `BUILDER_INLINE_TERMS` współczynników */
+        unsigned char bytes[sizeof(Block) + BUILDER_INLINE_TERMS * sizeof(poly_coeff_t)];
+    } run_buf;
+    poly_exp_t leaf_exps_buf[BUILDER_INLINE_TERMS]; ///< wewnętrzny bufor `leaf_exps`
+    poly_coeff_t leaf_coeffs_buf[BUILDER_INLINE_TERMS]; ///< wewnętrzny bufor `leaf_coeffs`
+} ListBuilder;
+
+/**
+ * Alokuje blok gęsty z miejscem na @p len współczynników.
+ * Ustawia tylko nagłówek elementu listy.
+ * @param[in] len : liczba współczynników
+ * @return blok gęsty
+ */
+static Block* BlockAlloc(unsigned len)
+{
+    Block *res = malloc(sizeof(Block) + (size_t)len * sizeof(poly_coeff_t));
+
+    assert(res != NULL);
+
+    res->node.m = (Mono) {.p = PolyZero(), .exp = NODE_BLOCK};
+    res->node.next = NULL;
+    res->start = 0;
+    res->len = 0;
+
+    return res;
 }
 
-bool ListIsEmpty(const List l)
+/**
+ * Alokuje liść z miejscem na @p len wyrazów.
+ * @param[in] len : liczba wyrazów
+ * @return liść
+ */
+static Leaf* LeafAlloc(unsigned len)
 {
-    return l == ListCreate();
+    Leaf *res = malloc(sizeof(Leaf)
+                       + (size_t)len * (sizeof(poly_coeff_t) + sizeof(poly_exp_t)));
+
+    assert(res != NULL);
+
+    res->node.m = (Mono) {.p = PolyZero(), .exp = NODE_LEAF};
+    res->node.next = NULL;
+    res->len = len;
+
+    return res;
 }
 
-void ListDestroy(List l)
+/**
+ * Daje wykładnik pierwszego wyrazu elementu listy.
+ * @param[in] n : element listy
+ * @return wykładnik
+ */
+static inline poly_exp_t NodeFirstExp(const Node *n)
 {
-    if (!ListIsEmpty(l))
+    switch (n->m.exp)
     {
-        ListDestroy(l->next);
-        MonoDestroy(&(l->m));
-        free(l);
+        case NODE_BLOCK:
+            return NodeBlock(n)->start;
+        case NODE_LEAF:
+            return LeafExps(NodeLeaf(n))[0];
+        default:
+            return n->m.exp;
     }
 }
 
-Node* NodeCreate(Mono *m, Node *next)
+/**
+ * Daje wykładnik ostatniego wyrazu elementu listy.
+ * @param[in] n : element listy
+ * @return wykładnik
+ */
+static inline poly_exp_t NodeLastExp(const Node *n)
 {
-    Node* new = (Node*) malloc(sizeof(Node));
+    switch (n->m.exp)
+    {
+        case NODE_BLOCK:
+            return NodeBlock(n)->start + (poly_exp_t)NodeBlock(n)->len - 1;
+        case NODE_LEAF:
+            return LeafExps(NodeLeaf(n))[NodeLeaf(n)->len - 1];
+        default:
+            return n->m.exp;
+    }
+}
 
-    assert(new != NULL);
+/**
+ * Daje liczbę pozycji wyrazów w elemencie listy (dla bloku gęstego
+ * razem z zerami).
+ * @param[in] n : element listy
+ * @return liczba pozycji
+ */
+static inline size_t NodeTerms(const Node *n)
+{
+    switch (n->m.exp)
+    {
+        case NODE_BLOCK:
+            return NodeBlock(n)->len;
+        case NODE_LEAF:
+            return NodeLeaf(n)->len;
+        default:
+            return 1;
+    }
+}
 
-    new->m = *m;
-    new->next = next;
+/**
+ * Inicjuje pustego budowniczego listy.
+ * @param[out] b : budowniczy
+ */
+static void BuilderInit(ListBuilder *b)
+{
+    b->head = ListCreate();
+    b->tail = &b->head;
+    b->run = NULL;
+    b->cap = 0;
+    b->terms = 0;
+    b->leaf_exps = b->leaf_exps_buf;
+    b->leaf_coeffs = b->leaf_coeffs_buf;
+    b->leaf_len = 0;
+    b->leaf_cap = BUILDER_INLINE_TERMS;
+}
 
-    return new;
+/**
+ * Sprawdza, czy bieżący ciąg leży w wewnętrznym buforze budowniczego.
+ * @param[in] b : budowniczy
+ * @return czy `run` jest wewnętrznym buforem
+ */
+static inline bool BuilderRunInline(const ListBuilder *b)
+{
+    return b->run == &b->run_buf.block;
 }
 
-Node* NodeClone(Node* n)
+/**
+ * Zwalnia bufor bieżącego ciągu, jeśli leży na stercie.
+ * @param[in,out] b : budowniczy
+ */
+static inline void BuilderRunFree(ListBuilder *b)
 {
-    Mono m = MonoClone(&(n->m));
+    if (!BuilderRunInline(b))
+        free(b->run);
+    b->run = NULL;
+    b->cap = 0;
+}
 
-    return NodeCreate(&m, NULL);
+/**
+ * Dopisuje element na koniec budowanej listy.
+ * @param[in,out] b : budowniczy
+ * @param[in] n : element listy
+ */
+static inline void BuilderLink(ListBuilder *b, Node *n)
+{
+    n->next = NULL;
+    *b->tail = n;
+    b->tail = &n->next;
 }
 
-List ListClone(const List l)
+/**
+ * Zapewnia miejsce na @p len współczynników w bieżącym ciągu.
+ * @param[in,out] b : budowniczy
+ * @param[in] len : wymagana liczba współczynników
+ */
+static void BuilderReserve(ListBuilder *b, unsigned len)
 {
-    if (!ListIsEmpty(l))
+    if (b->run != NULL && len <= b->cap)
+        return;
+
+    unsigned cap = b->cap < BLOCK_MIN_TERMS ? 2 * BLOCK_MIN_TERMS : 2 * b->cap;
+    if (cap < len)
+        cap = len;
+
+    Block *run;
+
+    if (b->run == NULL && len <= BUILDER_INLINE_TERMS)
     {
-        List res = NodeClone(l);
-        res->next = ListClone(l->next);
-        return res;
+        run = &b->run_buf.block;
+        cap = BUILDER_INLINE_TERMS;
+    }
+    else if (b->run == NULL || BuilderRunInline(b))
+    {
+        run = malloc(sizeof(Block) + (size_t)cap * sizeof(poly_coeff_t));
+        assert(run != NULL);
+
+        if (b->run != NULL)
+            memcpy(run, b->run, sizeof(Block) + b->run->len * sizeof(poly_coeff_t));
     }
     else
     {
-        return ListCreate();
+        run = realloc(b->run, sizeof(Block) + (size_t)cap * sizeof(poly_coeff_t));
+        assert(run != NULL);
     }
-}
 
-Mono* ListToArray(List l, unsigned *size)
-{
-    *size = ListLen(l);
-    Mono* res = (Mono*)calloc(*size, sizeof(Mono));
-    assert(res != NULL);
-    unsigned i = 0;
-    List p = l;
-    while (p != NULL)
+    if (b->run == NULL)
     {
-        res[i++] = p->m;
-        List tmp = p->next;
-        free(p);
-        p = tmp;
+        run->node.m = (Mono) {.p = PolyZero(), .exp = NODE_BLOCK};
+        run->len = 0;
     }
-
-    return res;
-}
-
-unsigned ListLen(const List l)
-{
-    return ListIsEmpty(l) ? 0 : 1 + ListLen(l->next);
+    b->run = run;
+    b->cap = cap;
 }
 
-List ListMerge(const List p, const List q)
+/**
+ * Zapisuje wyrazy czekające na liść: po co najwyżej `LEAF_MAX_TERMS` do
+ * liści, a końcówkę krótszą niż `LEAF_MIN_TERMS` jako pojedyncze jednomiany.
+ * @param[in,out] b : budowniczy
+ */
+static void BuilderFlushLeaf(ListBuilder *b)
 {
-    if (ListIsEmpty(p) && ListIsEmpty(q))
+    for (unsigned i = 0; i < b->leaf_len;)
     {
-        return NULL;
-    }
-    else if (ListIsEmpty(p))
-    {
-        if (!PolyIsZero(&q->m.p))
+        unsigned len = b->leaf_len - i;
+
+        if (len > LEAF_MAX_TERMS)
+            len = LEAF_MAX_TERMS;
+
+        if (len >= LEAF_MIN_TERMS)
         {
-            Mono mono = MonoClone(&(q->m));
-            return NodeCreate(&mono, ListMerge(p, q->next));
+            Leaf *leaf = LeafAlloc(len);
+
+            memcpy(leaf->coeffs, b->leaf_coeffs + i, len * sizeof(poly_coeff_t));
+            memcpy((poly_exp_t *)LeafExps(leaf), b->leaf_exps + i,
+                   len * sizeof(poly_exp_t));
+            BuilderLink(b, &leaf->node);
+            i += len;
         }
         else
         {
-            return ListMerge(p, q->next);
+            Poly c = PolyFromCoeff(b->leaf_coeffs[i]);
+            Mono m = MonoFromPoly(&c, b->leaf_exps[i]);
+            BuilderLink(b, NodeCreate(&m, NULL));
+            i++;
         }
     }
-    else if (ListIsEmpty(q))
+
+    b->leaf_len = 0;
+}
+
+/**
+ * Dopisuje niezerowy wyraz do wyrazów czekających na liść.
+ * @param[in,out] b : budowniczy
+ * @param[in] e : wykładnik
+ * @param[in] c : współczynnik
+ */
+static void BuilderPushLeaf(ListBuilder *b, poly_exp_t e, poly_coeff_t c)
+{
+    if (b->leaf_len == b->leaf_cap)
     {
-        if (!PolyIsZero(&(p->m.p)))
+        b->leaf_cap *= 2;
+
+        if (b->leaf_exps == b->leaf_exps_buf)
         {
-            Mono mono = MonoClone(&(p->m));
-            return NodeCreate(&mono, ListMerge(p->next, q));
+            b->leaf_exps = malloc(b->leaf_cap * sizeof(poly_exp_t));
+            b->leaf_coeffs = malloc(b->leaf_cap * sizeof(poly_coeff_t));
+            assert(b->leaf_exps != NULL && b->leaf_coeffs != NULL);
+            memcpy(b->leaf_exps, b->leaf_exps_buf, sizeof(b->leaf_exps_buf));
+            memcpy(b->leaf_coeffs, b->leaf_coeffs_buf, sizeof(b->leaf_coeffs_buf));
         }
         else
         {
-            return ListMerge(p->next, q);
+            b->leaf_exps = realloc(b->leaf_exps, b->leaf_cap * sizeof(poly_exp_t));
+            b->leaf_coeffs = realloc(b->leaf_coeffs, b->leaf_cap * sizeof(poly_coeff_t));
+            assert(b->leaf_exps != NULL && b->leaf_coeffs != NULL);
         }
     }
-    if (p->m.exp == q->m.exp)
+
+    b->leaf_exps[b->leaf_len] = e;
+    b->leaf_coeffs[b->leaf_len++] = c;
+}
+
+/**
+ * Zamyka bieżący ciąg współczynników: zapisuje go jako blok gęsty, jeśli ma
+ * co najmniej `BLOCK_MIN_TERMS` niezerowych wyrazów, a wpp przenosi jego
+ * wyrazy do wyrazów czekających na liść.
+ * @param[in,out] b : budowniczy
+ */
+static void BuilderFlush(ListBuilder *b)
+{
+    Block *run = b->run;
+
+    if (run == NULL || run->len == 0)
+        return;
+
+    if (b->terms >= BLOCK_MIN_TERMS)
     {
-        Poly tmp = PolyAdd(&(p->m.p), &(q->m.p));
-        if (!PolyIsZero(&tmp))
+        Block *blk;
+
+        if (BuilderRunInline(b))
         {
-            Mono m = MonoFromPoly(&tmp, p->m.exp);
-            return NodeCreate(&m, ListMerge(p->next, q->next));
+            blk = BlockAlloc(run->len);
+            memcpy(blk, run, sizeof(Block) + run->len * sizeof(poly_coeff_t));
         }
         else
         {
-            PolyDestroy(&tmp);
-            return ListMerge(p->next, q->next);
+            blk = realloc(run, sizeof(Block) + run->len * sizeof(poly_coeff_t));
+            assert(blk != NULL);
         }
+
+        BuilderFlushLeaf(b);
+        BuilderLink(b, &blk->node);
+        b->run = NULL;
+        b->cap = 0;
     }
     else
     {
-        if (p->m.exp < q->m.exp)
-        {
-            Mono m = MonoClone(&(p->m));
-            return NodeCreate(&m, ListMerge(p->next, q));
-        }
-        else
+        for (unsigned i = 0; i < run->len; i++)
         {
-            Mono m = MonoClone(&(q->m));
-            return NodeCreate(&m, ListMerge(p, q->next));
+            if (run->coeffs[i] != 0)
+                BuilderPushLeaf(b, run->start + (poly_exp_t)i, run->coeffs[i]);
         }
+        run->len = 0;
     }
+
+    b->terms = 0;
 }
 
-List ListAddMonos(List l, Mono *m)
+/**
+ * Daje liczbę zerowych wyrazów między końcem bieżącego ciągu a wykładnikiem
+ * @p e albo -1, gdy ciąg jest pusty.
+ * @param[in] b : budowniczy
+ * @param[in] e : wykładnik
+ * @return długość przerwy
+ */
+static inline long BuilderGap(const ListBuilder *b, poly_exp_t e)
+{
+    if (b->run == NULL || b->run->len == 0)
+        return -1;
+
+    return (long)e - b->run->start - (long)b->run->len;
+}
+
+/**
+ * Dopisuje wyraz o stałym współczynniku. Zera są pomijane.
+ * @param[in,out] b : budowniczy
+ * @param[in] e : wykładnik, większy od wykładników dotychczasowych wyrazów
+ * @param[in] c : współczynnik
+ */
+static void BuilderPushCoeff(ListBuilder *b, poly_exp_t e, poly_coeff_t c)
 {
-    if (!ListIsEmpty(l))
+    if (c == 0)
+        return;
+
+    long gap = BuilderGap(b, e);
+
+    if (gap < 0 || gap > BLOCK_MAX_HOLE)
     {
-        Node *prev, *ptr;
-        for (ptr = l, prev = NULL; ptr != NULL; prev = ptr, ptr = ptr->next)
-        {
-            if (ptr->m.exp == m->exp)
-            {
-                Poly tmp = PolyAdd(&(ptr->m.p), &(m->p));
+        BuilderFlush(b);
+        BuilderReserve(b, 1);
+        b->run->start = e;
+        gap = 0;
+    }
 
-                if (PolyIsZero(&tmp))
-                {
-                    if (prev == NULL)
-                        l = ptr->next;
-                    else
-                        prev->next = ptr->next;
-
-                    Node *tmp_ptr = ptr;
-                    ptr = ptr->next;
-                    MonoDestroy(&(tmp_ptr->m));
-                    free(tmp_ptr);
-                    PolyDestroy(&tmp);
-                }
-                else
-                {
-                    PolyDestroy(&(ptr->m.p));
-                    ptr->m.p = tmp;
-                }
-                MonoDestroy(m);
-                break;
-            }
-            else
-            {
-                if (ptr->m.exp > m->exp)
-                {
-                    if (prev == NULL)
-                    {
-                        l = NodeCreate(m, l);
-                    }
-                    else
-                    {
-                        prev->next = NodeCreate(m, ptr);
-                    }
-                    break;
-                }
-            }
-        }
-        if (ptr == NULL && prev != NULL)
-            prev->next = NodeCreate(m, NULL);
+    Block *run;
+    unsigned len = b->run->len + (unsigned)gap + 1;
+
+    BuilderReserve(b, len);
+    run = b->run;
+    while (run->len + 1 < len)
+        run->coeffs[run->len++] = 0;
+    run->coeffs[run->len++] = c;
+    b->terms++;
+}
+
+/**
+ * Dopisuje kolejne wyrazy o stałych współczynnikach.
+ * @param[in,out] b : budowniczy
+ * @param[in] start : wykładnik pierwszego wyrazu
+ * @param[in] coeffs : współczynniki
+ * @param[in] n : liczba wyrazów
+ */
+static void BuilderPushSlots(ListBuilder *b, poly_exp_t start,
+                             const poly_coeff_t *coeffs, unsigned n)
+{
+    for (unsigned i = 0; i < n; i++)
+        BuilderPushCoeff(b, start + (poly_exp_t)i, coeffs[i]);
+}
+
+/**
+ * Dopisuje jednomian, przejmując go na własność.
+ * @param[in,out] b : budowniczy
+ * @param[in] m : jednomian
+ */
+static void BuilderPushMono(ListBuilder *b, Mono *m)
+{
+    if (PolyIsCoeff(&(m->p)))
+    {
+        BuilderPushCoeff(b, m->exp, m->p.c);
+        return;
     }
-    else
+
+    BuilderFlush(b);
+    BuilderFlushLeaf(b);
+    BuilderLink(b, NodeCreate(m, NULL));
+}
+
+/**
+ * Dopisuje blok gęsty, przejmując go na własność.
+ * Blok musi spełniać warunek gęstości, więc od razu staje się bieżącym
+ * ciągiem, który kolejne wyrazy mogą przedłużyć.
+ * @param[in,out] b : budowniczy
+ * @param[in] blk : blok gęsty
+ */
+static void BuilderPushBlock(ListBuilder *b, Block *blk)
+{
+    long gap = BuilderGap(b, blk->start);
+
+    if (gap >= 0 && gap <= BLOCK_MAX_HOLE)
     {
-        l = NodeCreate(m, NULL);
+        unsigned len = b->run->len + (unsigned)gap + blk->len;
+
+        BuilderReserve(b, len);
+        while (b->run->len + blk->len < len)
+            b->run->coeffs[b->run->len++] = 0;
+        memcpy(b->run->coeffs + b->run->len, blk->coeffs,
+               blk->len * sizeof(poly_coeff_t));
+        b->run->len = len;
+        b->terms += blk->len;
+        free(blk);
+        return;
     }
 
-    return l;
+    BuilderFlush(b);
+    BuilderRunFree(b);
+    b->run = blk;
+    b->cap = blk->len;
+    b->terms = blk->len;
 }
 
-inline void PolyDestroy(Poly *p)
+/**
+ * Kończy budowanie listy.
+ * @param[in,out] b : budowniczy
+ * @return zbudowana lista
+ */
+static List BuilderFinish(ListBuilder *b)
 {
-    ListDestroy(p->l);
+    BuilderFlush(b);
+    BuilderFlushLeaf(b);
+    BuilderRunFree(b);
+
+    if (b->leaf_exps != b->leaf_exps_buf)
+    {
+        free(b->leaf_exps);
+        free(b->leaf_coeffs);
+    }
+
+    return b->head;
+}
+
+/**
+ * Przesuwa iterator stojący w bloku gęstym o @p k pozycji (co najmniej
+ * jedną), a następnie do najbliższego niezerowego wyrazu.
+ * @param[in,out] it : iterator
+ * @param[in] k : liczba pozycji
+ */
+static inline void ListIterSkip(ListIter *it, unsigned k)
+{
+    it->i += k - 1;
+    ListIterNext(it);
+}
+
+List ListCreate()
+{
+    return NULL;
+}
+
+bool ListIsEmpty(const List l)
+{
+    return l == ListCreate();
+}
+
+void ListDestroy(List l)
+{
+    if (!ListIsEmpty(l) && InternRelease(l))
+        return;
+
+    while (!ListIsEmpty(l))
+    {
+        List next = l->next;
+
+        if (NodeIsTree(l))
+            TreeRelease(NodeTree(l));
+        MonoDestroy(&(l->m));
+        free(l);
+        l = next;
+    }
 }
 
-Poly PolyClone(const Poly *p)
-{
-    return (Poly) {.c = p->c, .l = ListClone(p->l)};
+Node* NodeCreate(Mono *m, Node *next)
+{
+    Node* new = (Node*) malloc(sizeof(Node));
+
+    assert(new != NULL);
+
+    new->m = *m;
+    new->next = next;
+
+    return new;
+}
+
+Node* NodeClone(Node* n)
+{
+    if (NodeIsBlock(n))
+    {
+        const Block *blk = NodeBlock(n);
+        Block *res = BlockAlloc(blk->len);
+
+        res->start = blk->start;
+        res->len = blk->len;
+        memcpy(res->coeffs, blk->coeffs, blk->len * sizeof(poly_coeff_t));
+
+        return &res->node;
+    }
+
+    if (NodeIsLeaf(n))
+    {
+        const Leaf *leaf = NodeLeaf(n);
+        Leaf *res = LeafAlloc(leaf->len);
+
+        memcpy(res->coeffs, leaf->coeffs,
+               leaf->len * (sizeof(poly_coeff_t) + sizeof(poly_exp_t)));
+
+        return &res->node;
+    }
+
+    if (NodeIsTree(n))
+        return TreeList(TreeRetain(NodeTree(n)));
+
+    Mono m = MonoClone(&(n->m));
+
+    return NodeCreate(&m, NULL);
+}
+
+List ListClone(const List l)
+{
+    if (!ListIsEmpty(l) && InternRetain(l))
+        return l;
+
+    List res = ListCreate();
+    Node **tail = &res;
+
+    for (Node *ptr = l; ptr != NULL; ptr = ptr->next)
+    {
+        *tail = NodeClone(ptr);
+        tail = &((*tail)->next);
+    }
+
+    return res;
+}
+
+Mono* ListToArray(List l, unsigned *size)
+{
+    *size = ListLen(l);
+    Mono* res = (Mono*)calloc(*size, sizeof(Mono));
+    assert(res != NULL);
+    unsigned i = 0;
+    for (ListIter it = ListIterBegin(l); it.n != NULL; ListIterNext(&it))
+    {
+        Poly c = ListIterCoeff(&it);
+        res[i++] = MonoFromPoly(&c, ListIterExp(&it));
+    }
+
+    List p = l;
+    while (p != NULL)
+    {
+        List tmp = p->next;
+        free(p);
+        p = tmp;
+    }
+
+    return res;
+}
+
+unsigned ListLen(const List l)
+{
+    unsigned res = 0;
+
+    for (ListIter it = ListIterBegin(l); it.n != NULL; ListIterNext(&it))
+        res++;
+
+    return res;
+}
+
+/**
+ * Sprawdza, czy fragment listy ma tylko stałe współczynniki, i zlicza
+ * pozycje jego wyrazów.
+ * @param[in] l : lista jednomianów
+ * @param[in] l_end : element za końcem fragmentu
+ * @param[out] len : liczba pozycji wyrazów (dla bloków gęstych razem z zerami)
+ * @param[out] dense : czy fragment zawiera blok gęsty
+ * @return czy fragment ma tylko stałe współczynniki
+ */
+static bool ListRangeIsLeaf(const Node *l, const Node *l_end, size_t *len,
+                            bool *dense)
+{
+    *len = 0;
+    *dense = false;
+    for (; l != l_end; l = l->next)
+    {
+        if (!PolyIsCoeff(&(l->m.p)))
+            return false;
+        *dense |= NodeIsBlock(l);
+        *len += NodeTerms(l);
+    }
+
+    return true;
+}
+
+/**
+ * Przepisuje niezerowe wyrazy fragmentu listy o stałych współczynnikach
+ * do równoległych tablic.
+ * @param[in] l : lista jednomianów
+ * @param[in] l_end : element za końcem fragmentu
+ * @param[out] exps : wykładniki
+ * @param[out] coeffs : współczynniki
+ * @return liczba wyrazów
+ */
+static size_t ListRangeGather(const Node *l, const Node *l_end,
+                              poly_exp_t *exps, poly_coeff_t *coeffs)
+{
+    size_t k = 0;
+
+    for (; l != l_end; l = l->next)
+    {
+        if (NodeIsLeaf(l))
+        {
+            const Leaf *leaf = NodeLeaf(l);
+
+            memcpy(exps + k, LeafExps(leaf), leaf->len * sizeof(poly_exp_t));
+            memcpy(coeffs + k, leaf->coeffs, leaf->len * sizeof(poly_coeff_t));
+            k += leaf->len;
+            continue;
+        }
+
+        for (ListIter it = ListIterBegin(l); it.n == l; ListIterNext(&it), k++)
+        {
+            exps[k] = ListIterExp(&it);
+            coeffs[k] = ListIterCoeff(&it).c;
+        }
+    }
+
+    return k;
+}
+
+/**
+ * Dopisuje wyrazy z równoległych tablic.
+ * @param[in,out] b : budowniczy
+ * @param[in] exps : rosnące wykładniki
+ * @param[in] coeffs : współczynniki
+ * @param[in] n : liczba wyrazów
+ */
+static void BuilderPushTerms(ListBuilder *b, const poly_exp_t *exps,
+                             const poly_coeff_t *coeffs, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        BuilderPushCoeff(b, exps[i], coeffs[i]);
+}
+
+/**
+ * Scala fragmenty dwóch list o współczynnikach stałych.
+ * Przepisuje je do równoległych tablic i scala `KernelMergeLeaf`.
+ * @param[in] p : lista jednomianów
+ * @param[in] p_end : element za końcem fragmentu @p p
+ * @param[in] q : lista jednomianów
+ * @param[in] q_end : element za końcem fragmentu @p q
+ * @param[in] len : łączna liczba pozycji wyrazów fragmentów
+ * @return scalona lista
+ */
+static __attribute__((noinline)) List ListMergeLeaf(const Node *p,
+                                                    const Node *p_end,
+                                                    const Node *q,
+                                                    const Node *q_end,
+                                                    size_t len)
+{
+    poly_exp_t *exps = malloc(2 * len * sizeof(poly_exp_t));
+    poly_coeff_t *coeffs = malloc(2 * len * sizeof(poly_coeff_t));
+
+    assert(exps != NULL && coeffs != NULL);
+
+    size_t np = ListRangeGather(p, p_end, exps, coeffs);
+    size_t nq = ListRangeGather(q, q_end, exps + np, coeffs + np);
+    size_t k = KernelMergeLeaf(exps, coeffs, np, exps + np, coeffs + np, nq,
+                               exps + len, coeffs + len);
+
+    ListBuilder b;
+    BuilderInit(&b);
+    BuilderPushTerms(&b, exps + len, coeffs + len, k);
+
+    free(exps);
+    free(coeffs);
+
+    return BuilderFinish(&b);
+}
+
+/**
+ * Scala wyrazy dwóch bloków gęstych, na których stoją iteratory.
+ * Wyrazy tylko jednego bloku kopiuje aż do początku części wspólnej,
+ * a część wspólną sumuje wektorowo przez `KernelAdd`.
+ * Nie jest rozwijana w miejscu wywołania, bo jej bufor trafiłby wtedy
+ * do ramki rekurencyjnej `ListMergeInto`.
+ * @param[in,out] b : budowniczy listy wynikowej
+ * @param[in,out] x : iterator stojący w bloku gęstym
+ * @param[in,out] y : iterator stojący w bloku gęstym
+ */
+static __attribute__((noinline)) void ListMergeBlocks(ListBuilder *b,
+                                                      ListIter *x,
+                                                      ListIter *y)
+{
+    poly_exp_t ex = ListIterExp(x), ey = ListIterExp(y);
+
+    if (ex != ey)
+    {
+        ListIter *lo = ex < ey ? x : y;
+        const Block *blk = NodeBlock(lo->n);
+        unsigned n = (unsigned)(ex < ey ? ey - ex : ex - ey);
+
+        if (n > blk->len - lo->i)
+            n = blk->len - lo->i;
+        BuilderPushSlots(b, ListIterExp(lo), blk->coeffs + lo->i, n);
+        ListIterSkip(lo, n);
+        return;
+    }
+
+    const Block *bx = NodeBlock(x->n), *by = NodeBlock(y->n);
+    unsigned n = bx->len - x->i;
+    poly_coeff_t buf[MERGE_BLOCK_BUF];
+
+    if (n > by->len - y->i)
+        n = by->len - y->i;
+
+    for (unsigned k = 0; k < n; k += MERGE_BLOCK_BUF)
+    {
+        unsigned len = n - k < MERGE_BLOCK_BUF ? n - k : MERGE_BLOCK_BUF;
+
+        KernelAdd(buf, bx->coeffs + x->i + k, by->coeffs + y->i + k, len);
+        BuilderPushSlots(b, ex + (poly_exp_t)k, buf, len);
+    }
+
+    ListIterSkip(x, n);
+    ListIterSkip(y, n);
+}
+
+/**
+ * Przepisuje bieżący wyraz iteratora do listy wynikowej i przesuwa iterator.
+ * Blok gęsty, który w całości poprzedza wyrazy drugiej listy, jest
+ * kopiowany w jednym kroku.
+ * @param[in,out] b : budowniczy listy wynikowej
+ * @param[in,out] it : iterator
+ * @param[in] other : iterator drugiej listy
+ * @param[in] other_left : czy w drugiej liście zostały jeszcze wyrazy
+ */
+static void ListMergeTake(ListBuilder *b, ListIter *it, const ListIter *other,
+                          bool other_left)
+{
+    if (NodeIsBlock(it->n) && it->i == 0
+        && (!other_left || NodeLastExp(it->n) < ListIterExp(other)))
+    {
+        BuilderPushBlock(b, (Block *)NodeClone((Node *)it->n));
+        *it = ListIterBegin(it->n->next);
+        return;
+    }
+
+    Poly c = ListIterCoeff(it);
+
+    if (PolyIsCoeff(&c))
+    {
+        BuilderPushCoeff(b, ListIterExp(it), c.c);
+    }
+    else
+    {
+        Mono m = MonoClone(&(it->n->m));
+        BuilderPushMono(b, &m);
+    }
+
+    ListIterNext(it);
+}
+
+/**
+ * Stan scalania dwóch list: budowniczy wyniku, iteratory i miejsce na
+ * współczynniki dodawane rekurencyjnie.
+ * Scalenie odwołuje się do nich przez wskaźniki, więc trzymane na stosie
+ * zajmowałyby go na każdym poziomie zagnieżdżenia dodawania współczynników.
+ */
+typedef struct MergeState
+{
+    ListBuilder b; ///< budowniczy scalonej listy
+    ListIter ip; ///< iterator pierwszej listy
+    ListIter iq; ///< iterator drugiej listy
+    Poly cp; ///< współczynnik bieżącego wyrazu pierwszej listy
+    Poly cq; ///< współczynnik bieżącego wyrazu drugiej listy
+    Mono m; ///< suma wyrazów o równych wykładnikach
+} MergeState;
+
+/**
+ * Scala fragmenty dwóch list, dopisując wynik do budowniczego stanu @p s.
+ * Nakładające się bloki gęste sumuje `ListMergeBlocks`, a współczynniki
+ * wyrazów o równych wykładnikach dodaje rekurencyjnie `PolyAdd`.
+ * @param[in,out] s : stan scalania z iteratorami na początkach fragmentów
+ * @param[in] p_end : element za końcem pierwszego fragmentu
+ * @param[in] q_end : element za końcem drugiego fragmentu
+ */
+static __attribute__((noinline)) void ListMergeInto(MergeState *s,
+                                                    const Node *p_end,
+                                                    const Node *q_end)
+{
+    merge_depth++;
+    while (s->ip.n != p_end || s->iq.n != q_end)
+    {
+        bool has_p = s->ip.n != p_end, has_q = s->iq.n != q_end;
+
+        if (has_p && has_q && NodeIsBlock(s->ip.n) && NodeIsBlock(s->iq.n))
+        {
+            ListMergeBlocks(&s->b, &s->ip, &s->iq);
+        }
+        else if (!has_q
+                 || (has_p && ListIterExp(&s->ip) < ListIterExp(&s->iq)))
+        {
+            ListMergeTake(&s->b, &s->ip, &s->iq, has_q);
+        }
+        else if (!has_p || ListIterExp(&s->iq) < ListIterExp(&s->ip))
+        {
+            ListMergeTake(&s->b, &s->iq, &s->ip, has_p);
+        }
+        else
+        {
+            s->cp = ListIterCoeff(&s->ip);
+            s->cq = ListIterCoeff(&s->iq);
+            s->m.p = PolyAdd(&s->cp, &s->cq);
+            s->m.exp = ListIterExp(&s->ip);
+            BuilderPushMono(&s->b, &s->m);
+            ListIterNext(&s->ip);
+            ListIterNext(&s->iq);
+        }
+    }
+    merge_depth--;
+}
+
+/**
+ * Scala fragmenty dwóch list przez `ListMergeInto` ze stanem na stosie.
+ * Stan zajmuje kilkaset bajtów, więc funkcja nie może zostać
+ * wchłonięta przez `ListMergeRange`.
+ * @param[in] p : lista jednomianów
+ * @param[in] p_end : element za końcem fragmentu @p p
+ * @param[in] q : lista jednomianów
+ * @param[in] q_end : element za końcem fragmentu @p q
+ * @return scalona lista
+ */
+static __attribute__((noinline)) List ListMergeStack(const Node *p,
+                                                     const Node *p_end,
+                                                     const Node *q,
+                                                     const Node *q_end)
+{
+    MergeState s = {.ip = ListIterBegin(p), .iq = ListIterBegin(q)};
+
+    BuilderInit(&s.b);
+    ListMergeInto(&s, p_end, q_end);
+
+    return BuilderFinish(&s.b);
+}
+
+/**
+ * Sprawdza, czy fragmenty dwóch list należy scalić przez `ListMergeLeaf`:
+ * oba mają tylko stałe współczynniki, nie oba zawierają bloki gęste i mają
+ * łącznie co najmniej `LEAF_MERGE_MIN_LEN` pozycji wyrazów.
+ * @param[in] p : lista jednomianów
+ * @param[in] p_end : element za końcem fragmentu @p p
+ * @param[in] q : lista jednomianów
+ * @param[in] q_end : element za końcem fragmentu @p q
+ * @return łączna liczba pozycji wyrazów fragmentów albo 0, gdy fragmentów
+ * nie należy scalać przez `ListMergeLeaf`
+ */
+static __attribute__((noinline)) size_t ListMergeLeafLen(const Node *p,
+                                                         const Node *p_end,
+                                                         const Node *q,
+                                                         const Node *q_end)
+{
+    size_t len_p, len_q;
+    bool dense_p, dense_q;
+
+    if (ListRangeIsLeaf(p, p_end, &len_p, &dense_p)
+        && ListRangeIsLeaf(q, q_end, &len_q, &dense_q)
+        && !(dense_p && dense_q) && len_p + len_q >= LEAF_MERGE_MIN_LEN)
+        return len_p + len_q;
+
+    return 0;
+}
+
+/**
+ * Scala fragmenty dwóch list, ograniczone z prawej strony przez
+ * @p p_end i @p q_end.
+ * Fragmenty o stałych współczynnikach scala `ListMergeLeaf`, a pozostałe
+ * `ListMergeInto`. Dodawanie współczynników zagnieżdża scalenia w sobie,
+ * więc od głębokości `MERGE_STACK_DEPTH` stan scalania jest trzymany na
+ * stercie: ramka jednego poziomu zagnieżdżenia jest wtedy mała, a głęboko
+ * zagnieżdżone wielomiany nie przepełniają stosu.
+ * @param[in] p : lista jednomianów
+ * @param[in] p_end : element za końcem fragmentu @p p
+ * @param[in] q : lista jednomianów
+ * @param[in] q_end : element za końcem fragmentu @p q
+ * @return scalona lista
+ */
+static List ListMergeRange(const Node *p, const Node *p_end,
+                           const Node *q, const Node *q_end)
+{
+    size_t len = ListMergeLeafLen(p, p_end, q, q_end);
+
+    if (len > 0)
+        return ListMergeLeaf(p, p_end, q, q_end, len);
+
+    if (merge_depth < MERGE_STACK_DEPTH)
+        return ListMergeStack(p, p_end, q, q_end);
+
+    MergeState *s = malloc(sizeof(MergeState));
+    assert(s != NULL);
+
+    s->ip = ListIterBegin(p);
+    s->iq = ListIterBegin(q);
+    BuilderInit(&s->b);
+    ListMergeInto(s, p_end, q_end);
+
+    List res = BuilderFinish(&s->b);
+
+    free(s);
+
+    return res;
+}
+
+List ListMerge(const List p, const List q)
+{
+    return ListMergeRange(p, NULL, q, NULL);
+}
+
+/**
+ * Scala fragment list opisany przez @p arg.
+ * Funkcja wątku roboczego.
+ * @param[in,out] arg : fragment scalania (`MergeChunk`)
+ * @return `NULL`
+ */
+static void* MergeChunkRun(void *arg)
+{
+    MergeChunk *chunk = arg;
+    bool was_worker = add_worker;
+
+    add_worker = true;
+    coeff_mod = chunk->mod;
+    chunk->res = ListMergeRange(chunk->p, chunk->p_end, chunk->q, chunk->q_end);
+    add_worker = was_worker;
+
+    chunk->tail = chunk->res;
+    while (chunk->tail != NULL && chunk->tail->next != NULL)
+        chunk->tail = chunk->tail->next;
+
+    return NULL;
+}
+
+/** Liczba procesorów odczytana przy pierwszym użyciu */
+static unsigned cpu_count = 1;
+
+/** Liczba procesorów ustawiona przez `PolyCpuCountSet`, 0 gdy brak */
+static unsigned cpu_count_override = 0;
+
+/** Jednokrotne odczytanie liczby procesorów */
+static pthread_once_t cpu_count_once = PTHREAD_ONCE_INIT;
+
+/**
+ * Odczytuje liczbę procesorów dostępnych w systemie.
+ */
+static void CpuCountInit(void)
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+    cpu_count = n < 1 ? 1 : (unsigned)n;
+}
+
+unsigned PolyCpuCount(void)
+{
+    pthread_once(&cpu_count_once, CpuCountInit);
+
+    return cpu_count_override > 0 ? cpu_count_override : cpu_count;
+}
+
+void PolyCpuCountSet(unsigned n)
+{
+    cpu_count_override = n;
+}
+
+/**
+ * Sprawdza, czy scalanie może w ogóle podzielić się na wątki.
+ * @return czy scalanie musi być sekwencyjne
+ */
+static inline bool MergeSequential(void)
+{
+    /* Wątki sięgałyby co chwilę do wspólnej tablicy unikalnych wielomianów. */
+    return add_worker || InternActive() || PolyCpuCount() < 2;
+}
+
+/**
+ * Daje liczbę wątków, na które warto podzielić scalanie list o łącznej
+ * długości @p len.
+ * @param[in] len : łączna długość list
+ * @return liczba wątków (1, gdy scalanie ma być sekwencyjne)
+ */
+static unsigned MergeThreads(size_t len)
+{
+    if (len < PARALLEL_ADD_MIN_LEN)
+        return 1;
+
+    size_t res = len / PARALLEL_ADD_CHUNK_MIN;
+    if (res > PolyCpuCount())
+        res = PolyCpuCount();
+    if (res > PARALLEL_ADD_THREADS_MAX)
+        res = PARALLEL_ADD_THREADS_MAX;
+
+    return res < 1 ? 1 : (unsigned)res;
+}
+
+/**
+ * Scala dwie listy w @p threads wątkach, dzieląc je na przedziały
+ * wykładników, które są scalane równolegle, a następnie sklejane
+ * w kolejności.
+ * Tablica przedziałów zajmuje kilka kilobajtów stosu, więc funkcja nie może
+ * zostać wchłonięta przez `ListMergeParallel`, wołaną przy każdym
+ * rekurencyjnym dodawaniu współczynników.
+ * @param[in] p : lista jednomianów
+ * @param[in] len_p : liczba wyrazów @p p
+ * @param[in] q : lista jednomianów
+ * @param[in] len_q : liczba wyrazów @p q
+ * @param[in] threads : liczba wątków, co najmniej 2
+ * @return scalona lista
+ */
+static __attribute__((noinline)) List ListMergeChunks(const List p,
+                                                      size_t len_p,
+                                                      const List q,
+                                                      size_t len_q,
+                                                      unsigned threads)
+{
+    /* Granice przedziałów wyznaczamy na dłuższej liście. */
+    bool p_longer = len_p >= len_q;
+    const Node *a = p_longer ? p : q, *b = p_longer ? q : p;
+    size_t len_a = p_longer ? len_p : len_q;
+
+    MergeChunk chunks[PARALLEL_ADD_THREADS_MAX];
+    size_t pos = 0;
+
+    for (unsigned i = 0; i < threads; i++)
+    {
+        const Node *a_begin = a, *b_begin = b;
+
+        if (i + 1 < threads)
+        {
+            size_t end = len_a * (i + 1) / threads;
+            for (; pos < end && a != NULL; a = a->next)
+                pos += NodeTerms(a);
+
+            /* Granica nie może przecinać bloku gęstego ani liścia żadnej z list. */
+            long bound = a != NULL ? NodeFirstExp(a) : LONG_MAX;
+            bool moved = true;
+
+            while (moved)
+            {
+                moved = false;
+                for (; b != NULL && NodeFirstExp(b) < bound; b = b->next)
+                {
+                    if (NodeLastExp(b) >= bound)
+                        bound = (long)NodeLastExp(b) + 1;
+                }
+                for (; a != NULL && NodeFirstExp(a) < bound; a = a->next)
+                {
+                    pos += NodeTerms(a);
+                    if (NodeLastExp(a) >= bound)
+                    {
+                        bound = (long)NodeLastExp(a) + 1;
+                        moved = true;
+                    }
+                }
+            }
+        }
+        else
+        {
+            a = NULL;
+            b = NULL;
+        }
+
+        chunks[i] = (MergeChunk) {
+            .p = p_longer ? a_begin : b_begin, .p_end = p_longer ? a : b,
+            .q = p_longer ? b_begin : a_begin, .q_end = p_longer ? b : a,
+            .res = ListCreate(), .tail = NULL, .mod = coeff_mod,
+            .started = false
+        };
+    }
+
+    for (unsigned i = 1; i < threads; i++)
+        chunks[i].started = pthread_create(&chunks[i].thread, NULL,
+                                           MergeChunkRun, &chunks[i]) == 0;
+
+    MergeChunkRun(&chunks[0]);
+
+    for (unsigned i = 1; i < threads; i++)
+    {
+        if (chunks[i].started)
+            pthread_join(chunks[i].thread, NULL);
+        else
+            MergeChunkRun(&chunks[i]);
+    }
+
+    List res = ListCreate();
+    Node *tail = NULL;
+
+    for (unsigned i = 0; i < threads; i++)
+    {
+        if (ListIsEmpty(chunks[i].res))
+            continue;
+
+        if (tail == NULL)
+            res = chunks[i].res;
+        else
+            tail->next = chunks[i].res;
+        tail = chunks[i].tail;
+    }
+
+    return res;
+}
+
+/**
+ * Scala dwie listy, dla długich list równolegle (patrz `ListMergeChunks`).
+ * Dla krótkich list (lub gdy jesteśmy już w wątku roboczym) działa jak
+ * `ListMerge`.
+ * @param[in] p : lista jednomianów
+ * @param[in] q : lista jednomianów
+ * @return scalona lista
+ */
+static List ListMergeParallel(const List p, const List q)
+{
+    size_t len_p = 0, len_q = 0;
+
+    if (MergeSequential())
+        return ListMerge(p, q);
+
+    for (const Node *ptr = p; ptr != NULL; ptr = ptr->next)
+        len_p += NodeTerms(ptr);
+    for (const Node *ptr = q; ptr != NULL; ptr = ptr->next)
+        len_q += NodeTerms(ptr);
+
+    unsigned threads = MergeThreads(len_p + len_q);
+    if (threads < 2)
+        return ListMerge(p, q);
+
+    return ListMergeChunks(p, len_p, q, len_q, threads);
+}
+
+List ListAddMonos(List l, Mono *m)
+{
+    Node n = {.m = *m, .next = NULL};
+    List res = PolyIsZero(&(m->p)) ? ListMerge(l, NULL) : ListMerge(l, &n);
+
+    ListDestroy(l);
+    MonoDestroy(m);
+
+    return res;
+}
+
+inline void PolyDestroy(Poly *p)
+{
+    ListDestroy(p->l);
+}
+
+Poly PolyClone(const Poly *p)
+{
+    return (Poly) {.c = p->c, .l = ListClone(p->l)};
+}
+
+/**
+ * Tworzy wielomian z listy jednomianów, przejmując ją na własność.
+ * Lista złożona z samego wyrazu wolnego staje się współczynnikiem.
+ * @param[in] l : lista jednomianów
+ * @return wielomian
+ */
+static Poly PolyFromList(List l)
+{
+    if (!ListIsEmpty(l) && l->next == NULL && !NodeIsBlock(l)
+        && l->m.exp == 0 && PolyIsCoeff(&(l->m.p)))
+    {
+        poly_coeff_t c = l->m.p.c;
+
+        ListDestroy(l);
+
+        return PolyFromCoeff(c);
+    }
+
+    return (Poly) {.c = 0, .l = l};
+}
+
+/**
+ * Przenosi listę wyniku operacji do tablicy unikalnych wielomianów,
+ * jeśli tablica jest włączona.
+ * @param[in] p : wielomian, przejmowany na własność
+ * @return wielomian równy @p p
+ */
+static inline Poly PolyShare(Poly p)
+{
+    if (InternActive() && !PolyIsCoeff(&p))
+        p.l = InternList(p.l);
+
+    return p;
+}
+
+/**
+ * Daje postać listową wielomianu. Dla wielomianu w drzewie tworzy ją
+ * w @p tmp, wpp zwraca sam wielomian bez kopiowania.
+ * @param[in] p : wielomian
+ * @param[out] tmp : miejsce na postać listową
+ * @return wielomian bez drzewa równy @p p
+ */
+static inline const Poly* PolyListView(const Poly *p, Poly *tmp)
+{
+    if (!PolyIsTree(p))
+        return p;
+
+    *tmp = PolyToList(p);
+
+    return tmp;
+}
+
+/**
+ * Zwalnia postać listową utworzoną przez `PolyListView`.
+ * @param[in] view : wynik `PolyListView`
+ * @param[in] tmp : miejsce przekazane do `PolyListView`
+ */
+static inline void PolyListViewDone(const Poly *view, Poly *tmp)
+{
+    if (view == tmp)
+        PolyDestroy(tmp);
+}
+
+/**
+ * Tworzy wielomian z drzewa, przejmując odwołanie do niego.
+ * Puste drzewo jest zerem, a drzewo z samego wyrazu wolnego staje się
+ * współczynnikiem.
+ * @param[in] t : drzewo
+ * @return wielomian
+ */
+static Poly PolyFromTree(TreeNode *t)
+{
+    if (t == NULL)
+        return PolyZero();
+
+    if (t->size == 1 && t->exp == 0 && PolyIsCoeff(&(t->p)))
+    {
+        poly_coeff_t c = t->p.c;
+
+        TreeRelease(t);
+
+        return PolyFromCoeff(c);
+    }
+
+    return (Poly) {.c = 0, .l = TreeList(t)};
+}
+
+/**
+ * Dodaje dwa wielomiany, z których co najmniej jeden jest w drzewie.
+ * Wyrazy mniejszego argumentu są dodawane pojedynczo do drzewa większego.
+ * Nie jest wchłaniana przez `PolyAdd`, żeby jej zmienne nie zajmowały
+ * stosu na każdym poziomie rekurencyjnego dodawania współczynników.
+ * @param[in] p : wielomian
+ * @param[in] q : wielomian
+ * @return `p + q` w drzewie
+ */
+static __attribute__((noinline)) Poly PolyAddTree(const Poly *p,
+                                                  const Poly *q)
+{
+    if (!PolyIsTree(p)
+        || (PolyIsTree(q) && NodeTree(q->l)->size > NodeTree(p->l)->size))
+    {
+        const Poly *tmp = p;
+        p = q;
+        q = tmp;
+    }
+
+    TreeNode *t = TreeRetain(NodeTree(p->l));
+
+    if (PolyIsTree(q))
+    {
+        t = TreeAddTree(t, NodeTree(q->l));
+    }
+    else if (PolyIsCoeff(q))
+    {
+        if (q->c != 0)
+            t = TreeAddTerm(t, 0, q);
+    }
+    else
+    {
+        for (ListIter it = ListIterBegin(q->l); it.n != NULL; ListIterNext(&it))
+        {
+            Poly c = ListIterCoeff(&it);
+            t = TreeAddTerm(t, ListIterExp(&it), &c);
+        }
+    }
+
+    return PolyFromTree(t);
+}
+
+/**
+ * Dodaje do wielomianu liczbę.
+ * Nie jest wchłaniana przez `PolyAdd`, żeby jej jednomian nie zajmował
+ * stosu na każdym poziomie rekurencyjnego dodawania współczynników.
+ * @param[in] p : wielomian
+ * @param[in] c : liczba
+ * @return `p + c`
+ */
+static __attribute__((noinline)) Poly PolyAddCoeff(const Poly *p,
+                                                   poly_coeff_t c)
+{
+    assert(!PolyIsCoeff(p));
+
+    Node n = {.m = {.p = PolyFromCoeff(c), .exp = 0}, .next = NULL};
+
+    return PolyFromList(ListMerge(p->l, c == 0 ? NULL : &n));
+}
+
+Poly PolyAdd(const Poly *p, const Poly *q)
+{
+    if (PolyIsTree(p) || PolyIsTree(q))
+        return PolyAddTree(p, q);
+    else if (PolyIsCoeff(p) && PolyIsCoeff(q))
+        return (Poly) {.l = ListCreate(), .c = CoeffAdd(p->c, q->c)};
+    else if (PolyIsCoeff(p))
+        return PolyShare(PolyAddCoeff(q, p->c));
+    else if (PolyIsCoeff(q))
+        return PolyShare(PolyAddCoeff(p, q->c));
+
+    return PolyShare(PolyFromList(ListMergeParallel(p->l, q->l)));
+}
+
+/** Element kopca scalania wielu list: bieżący wyraz jednej z list */
+typedef struct AddAllItem
+{
+    poly_exp_t exp; ///< wykładnik bieżącego wyrazu
+    unsigned i; ///< numer listy
+} AddAllItem;
+
+/**
+ * Przywraca porządek kopca od pozycji @p k w dół; na szczycie kopca jest
+ * wyraz o najmniejszym wykładniku.
+ * @param[in,out] heap : kopiec
+ * @param[in] size : rozmiar kopca
+ * @param[in] k : pozycja
+ */
+static void AddAllSiftDown(AddAllItem heap[], unsigned size, unsigned k)
+{
+    AddAllItem x = heap[k];
+
+    for (unsigned c = 2 * k + 1; c < size; c = 2 * k + 1)
+    {
+        if (c + 1 < size && heap[c + 1].exp < heap[c].exp)
+            c++;
+        if (heap[c].exp >= x.exp)
+            break;
+        heap[k] = heap[c];
+        k = c;
+    }
+
+    heap[k] = x;
+}
+
+/**
+ * Sumuje wielomiany bez drzew jednym scalaniem wszystkich list: kopiec
+ * wskazuje najmniejszy wykładnik, a współczynniki wyrazów o tym samym
+ * wykładniku są sumowane rekurencyjnie, także jednym scalaniem.
+ * @param[in] count : liczba składników
+ * @param[in] ps : składniki
+ * @param[in] neg : które składniki odjąć albo `NULL`
+ * @return suma
+ */
+static Poly PolyAddAllList(unsigned count, const Poly ps[], const bool neg[])
+{
+    ListIter its_buf[ADD_ALL_INLINE];
+    AddAllItem heap_buf[ADD_ALL_INLINE];
+    Poly group_buf[ADD_ALL_INLINE + 1];
+    bool group_neg_buf[ADD_ALL_INLINE + 1];
+    bool inline_bufs = count <= ADD_ALL_INLINE;
+    ListIter *its = inline_bufs ? its_buf : malloc(count * sizeof(ListIter));
+    AddAllItem *heap = inline_bufs ? heap_buf : malloc(count * sizeof(AddAllItem));
+    Poly *group = inline_bufs ? group_buf : malloc((count + 1) * sizeof(Poly));
+    bool *group_neg = inline_bufs ? group_neg_buf : malloc((count + 1) * sizeof(bool));
+    assert(its != NULL && heap != NULL && group != NULL && group_neg != NULL);
+
+    poly_coeff_t cst = 0;
+    unsigned size = 0;
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        if (!PolyIsCoeff(&ps[i]))
+        {
+            its[i] = ListIterBegin(ps[i].l);
+            heap[size++] = (AddAllItem) {.exp = ListIterExp(&its[i]), .i = i};
+        }
+        else if (neg != NULL && neg[i])
+        {
+            cst = CoeffAdd(cst, CoeffNeg(ps[i].c));
+        }
+        else
+        {
+            cst = CoeffAdd(cst, ps[i].c);
+        }
+    }
+
+    for (unsigned k = size / 2; k-- > 0;)
+        AddAllSiftDown(heap, size, k);
+
+    ListBuilder b;
+    bool cst_pending = cst != 0;
+
+    BuilderInit(&b);
+
+    while (size > 0)
+    {
+        poly_exp_t e = heap[0].exp;
+        unsigned k = 0;
+        bool coeffs = true;
+
+        if (cst_pending && e > 0)
+            BuilderPushCoeff(&b, 0, cst);
+        else if (cst_pending)
+        {
+            group[k] = PolyFromCoeff(cst);
+            group_neg[k++] = false;
+        }
+        cst_pending = false;
+
+        while (size > 0 && heap[0].exp == e)
+        {
+            unsigned i = heap[0].i;
+
+            group[k] = ListIterCoeff(&its[i]);
+            group_neg[k] = neg != NULL && neg[i];
+            coeffs &= PolyIsCoeff(&group[k]);
+            k++;
+
+            ListIterNext(&its[i]);
+            if (its[i].n == NULL)
+                heap[0] = heap[--size];
+            else
+                heap[0].exp = ListIterExp(&its[i]);
+            if (size > 0)
+                AddAllSiftDown(heap, size, 0);
+        }
+
+        if (coeffs)
+        {
+            poly_coeff_t c = 0;
+
+            for (unsigned j = 0; j < k; j++)
+                c = CoeffAdd(c, group_neg[j] ? CoeffNeg(group[j].c) : group[j].c);
+            BuilderPushCoeff(&b, e, c);
+        }
+        else
+        {
+            Poly c = PolyAddAllList(k, group, group_neg);
+
+            if (!PolyIsZero(&c))
+            {
+                Mono m = MonoFromPoly(&c, e);
+                BuilderPushMono(&b, &m);
+            }
+        }
+    }
+
+    if (cst_pending)
+        BuilderPushCoeff(&b, 0, cst);
+
+    if (!inline_bufs)
+    {
+        free(its);
+        free(heap);
+        free(group);
+        free(group_neg);
+    }
+
+    return PolyFromList(BuilderFinish(&b));
+}
+
+Poly PolyAddAll(unsigned count, const Poly ps[], const bool neg[])
+{
+    if (count == 0)
+        return PolyZero();
+    else if (count == 1)
+        return neg != NULL && neg[0] ? PolyNeg(&ps[0]) : PolyClone(&ps[0]);
+    else if (count == 2 && (neg == NULL || (!neg[0] && !neg[1])))
+        return PolyAdd(&ps[0], &ps[1]);
+
+    Poly *views = malloc(count * sizeof(Poly));
+    assert(views != NULL);
+
+    for (unsigned i = 0; i < count; i++)
+        views[i] = PolyIsTree(&ps[i]) ? PolyToList(&ps[i]) : ps[i];
+
+    Poly res = PolyShare(PolyAddAllList(count, views, neg));
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        if (PolyIsTree(&ps[i]))
+            PolyDestroy(&views[i]);
+    }
+    free(views);
+
+    return res;
+}
+
+/**
+ * Porównuje jednomiany według wykładników.
+ * @param[in] a : jednomian
+ * @param[in] b : jednomian
+ * @return wynik porównania dla `qsort`
+ */
+static int MonoCompare(const void *a, const void *b)
+{
+    poly_exp_t x = ((const Mono *)a)->exp, y = ((const Mono *)b)->exp;
+
+    return (x > y) - (x < y);
+}
+
+Poly PolyAddMonos(unsigned count, const Mono monos[])
+{
+    if (count == 0)
+        return PolyZero();
+
+    Mono buf[ADD_MONOS_INLINE];
+    Mono *arr = count <= ADD_MONOS_INLINE ? buf : malloc(count * sizeof(Mono));
+    assert(arr != NULL);
+    memcpy(arr, monos, count * sizeof(Mono));
+    if (count > 1)
+        qsort(arr, count, sizeof(Mono), MonoCompare);
+
+    ListBuilder b;
+    BuilderInit(&b);
+
+    /* Drzewa występują tylko na najwyższym poziomie wielomianu. */
+    for (unsigned i = 0; i < count; i++)
+    {
+        if (PolyIsTree(&arr[i].p))
+        {
+            Poly tmp = PolyToList(&arr[i].p);
+            MonoDestroy(&arr[i]);
+            arr[i].p = tmp;
+        }
+    }
+
+    for (unsigned i = 0; i < count;)
+    {
+        Mono m = arr[i++];
+
+        for (; i < count && arr[i].exp == m.exp; i++)
+        {
+            Poly tmp = PolyAdd(&(m.p), &(arr[i].p));
+            MonoDestroy(&m);
+            MonoDestroy(&arr[i]);
+            m.p = tmp;
+        }
+
+        BuilderPushMono(&b, &m);
+    }
+
+    if (arr != buf)
+        free(arr);
+
+    return PolyShare(PolyFromList(BuilderFinish(&b)));
+}
+
+/**
+ * Mnoży blok gęsty przez niezerową stałą i jednomian @f$x^e@f$ i dopisuje
+ * wynik do listy.
+ * Mnożenie przez element odwracalny (liczbę nieparzystą, gdy liczymy modulo
+ * potęga dwójki, albo niezerową resztę modulo liczba pierwsza) nie zeruje
+ * wyrazów, więc blok zachowuje wtedy swój kształt i jest mnożony
+ * w miejscu.
+ * @param[in,out] b : budowniczy listy wynikowej
+ * @param[in] blk : blok gęsty
+ * @param[in] e : przesunięcie wykładników
+ * @param[in] c : stała
+ */
+static void BuilderPushBlockMulTerm(ListBuilder *b, const Block *blk,
+                                    poly_exp_t e, poly_coeff_t c)
+{
+    Block *res = BlockAlloc(blk->len);
+
+    res->start = blk->start + e;
+    res->len = blk->len;
+
+    if (c == CoeffNeg(1))
+        KernelNeg(res->coeffs, blk->coeffs, blk->len);
+    else if (c == 1)
+        memcpy(res->coeffs, blk->coeffs, blk->len * sizeof(poly_coeff_t));
+    else
+        KernelScale(res->coeffs, blk->coeffs, blk->len, c);
+
+    if (CoeffIsUnit(c))
+    {
+        BuilderPushBlock(b, res);
+    }
+    else
+    {
+        BuilderPushSlots(b, res->start, res->coeffs, res->len);
+        free(res);
+    }
+}
+
+/**
+ * Mnoży liść przez niezerową stałą i jednomian @f$x^e@f$ i dopisuje wynik
+ * do listy.
+ * Tablice wyniku zajmują `LEAF_MAX_TERMS` wyrazów, więc funkcja nie może
+ * zostać wchłonięta przez rekurencyjne `PolyMulTerm`.
+ * @param[in,out] b : budowniczy listy wynikowej
+ * @param[in] leaf : liść
+ * @param[in] e : przesunięcie wykładników
+ * @param[in] c : stała
+ */
+static __attribute__((noinline)) void BuilderPushLeafMulTerm(ListBuilder *b,
+                                                            const Leaf *leaf,
+                                                            poly_exp_t e,
+                                                            poly_coeff_t c)
+{
+    poly_coeff_t coeffs[LEAF_MAX_TERMS];
+    poly_exp_t exps[LEAF_MAX_TERMS];
+    const poly_exp_t *src = LeafExps(leaf);
+
+    if (c == CoeffNeg(1))
+        KernelNeg(coeffs, leaf->coeffs, leaf->len);
+    else
+        KernelScale(coeffs, leaf->coeffs, leaf->len, c);
+
+    if (e != 0)
+    {
+        for (unsigned i = 0; i < leaf->len; i++)
+            exps[i] = src[i] + e;
+        src = exps;
+    }
+
+    BuilderPushTerms(b, src, coeffs, leaf->len);
+}
+
+/**
+ * Mnoży wielomian przez jednomian @f$c x^e@f$ o stałym współczynniku.
+ * Kopiuje wielomian w jednym przejściu, przesuwając wykładniki wyrazów
+ * najwyższego poziomu i od razu pomijając jednomiany, których
+ * współczynniki stały się zerowe; bloki gęste i liście są przepisywane
+ * w całości.
+ * @param[in] p : wielomian
+ * @param[in] e : wykładnik jednomianu, zero, gdy @p p jest współczynnikiem
+ * @param[in] c : współczynnik jednomianu
+ * @return przemnożony wielomian
+ */
+static Poly PolyMulTerm(const Poly *p, poly_exp_t e, poly_coeff_t c)
+{
+    if (c == 0)
+        return PolyZero();
+
+    if (PolyIsCoeff(p))
+    {
+        assert(e == 0);
+        return PolyFromCoeff(CoeffMul(p->c, c));
+    }
+
+    ListBuilder b;
+    BuilderInit(&b);
+
+    for (const Node *ptr = p->l; ptr != NULL; ptr = ptr->next)
+    {
+        if (NodeIsBlock(ptr))
+        {
+            BuilderPushBlockMulTerm(&b, NodeBlock(ptr), e, c);
+            continue;
+        }
+
+        if (NodeIsLeaf(ptr))
+        {
+            BuilderPushLeafMulTerm(&b, NodeLeaf(ptr), e, c);
+            continue;
+        }
+
+        Poly tmp = c == 1 ? PolyClone(&(ptr->m.p))
+                          : PolyMulTerm(&(ptr->m.p), 0, c);
+        Mono m = MonoFromPoly(&tmp, ptr->m.exp + e);
+        BuilderPushMono(&b, &m);
+    }
+
+    return PolyFromList(BuilderFinish(&b));
+}
+
+/**
+ * Mnoży wielomian przez stałą.
+ * @param[in] p : wielomian
+ * @param[in] c : stała
+ * @return przemnożony wielomian
+ */
+static Poly PolyMulCoeff(const Poly *p, const poly_coeff_t c)
+{
+    return PolyMulTerm(p, 0, c);
+}
+
+/**
+ * Mnoży dwa wielomiany o stałych współczynnikach przez `KernelMulLeafTrunc`.
+ * @param[in] p : wielomian
+ * @param[in] len_p : liczba pozycji wyrazów @p p
+ * @param[in] q : wielomian
+ * @param[in] len_q : liczba pozycji wyrazów @p q
+ * @param[in] limit : największy wykładnik wyniku
+ * @return `p * q` bez wyrazów o wykładnikach większych niż @p limit
+ */
+static Poly PolyMulLeaf(const Poly *p, size_t len_p, const Poly *q, size_t len_q,
+                        long limit)
+{
+    poly_exp_t *exps = malloc((len_p + len_q) * sizeof(poly_exp_t));
+    poly_coeff_t *coeffs = malloc((len_p + len_q) * sizeof(poly_coeff_t));
+
+    assert(exps != NULL && coeffs != NULL);
+
+    size_t np = ListRangeGather(p->l, NULL, exps, coeffs);
+    size_t nq = ListRangeGather(q->l, NULL, exps + np, coeffs + np);
+    poly_exp_t *res_exps;
+    poly_coeff_t *res_coeffs;
+    size_t k = KernelMulLeafTrunc(exps, coeffs, np, exps + np, coeffs + np, nq,
+                                  limit, &res_exps, &res_coeffs);
+
+    ListBuilder b;
+    BuilderInit(&b);
+    BuilderPushTerms(&b, res_exps, res_coeffs, k);
+
+    free(exps);
+    free(coeffs);
+    free(res_exps);
+    free(res_coeffs);
+
+    return PolyFromList(BuilderFinish(&b));
+}
+
+/**
+ * Przygotowuje rozmieszczenie pól kluczy dla wielomianów o @p vars
+ * zmiennych i maksymalnych wykładnikach iloczynu @p degs.
+ * @param[out] l : rozmieszczenie pól
+ * @param[in] vars : liczba zmiennych
+ * @param[in] degs : maksymalne wykładniki kolejnych zmiennych wyniku
+ * @return czy wykładniki mieszczą się w kluczach
+ */
+static bool PolyDistLayout(DistLayout *l, unsigned vars, const long degs[])
+{
+    long max_exp = 0;
+
+    for (unsigned v = 0; v < vars; v++)
+        max_exp = degs[v] > max_exp ? degs[v] : max_exp;
+
+    return max_exp <= POLY_EXP_MAX
+           && DistLayoutInit(l, vars, (poly_exp_t)max_exp);
+}
+
+/**
+ * Mnoży wielomiany wielu zmiennych w reprezentacji rozproszonej.
+ * @param[in] p : wielomian
+ * @param[in] q : wielomian
+ * @param[out] res : `p * q`
+ * @return czy mnożenie w reprezentacji rozproszonej się opłacało i powiodło
+ */
+static bool PolyMulDist(const Poly *p, const Poly *q, Poly *res)
+{
+    unsigned vars = DistVars(p), vars_q = DistVars(q);
+
+    vars = vars < vars_q ? vars_q : vars;
+    if (vars < 2 || vars > DIST_VARS_MAX)
+        return false;
+
+    poly_exp_t dp[DIST_VARS_MAX] = {0}, dq[DIST_VARS_MAX] = {0};
+    size_t np = DistDegrees(p, dp), nq = DistDegrees(q, dq);
+    long degs[DIST_VARS_MAX];
+    DistLayout l;
+
+    for (unsigned v = 0; v < vars; v++)
+        degs[v] = (long)dp[v] + dq[v];
+
+    if (np * nq < DIST_MUL_MIN_PRODUCTS || !PolyDistLayout(&l, vars, degs))
+        return false;
+
+    DistPoly a = DistFromPoly(p, &l), b = DistFromPoly(q, &l), c;
+    bool ok = DistMul(&a, &b, &c);
+
+    if (ok)
+    {
+        *res = DistToPoly(&c);
+        DistDestroy(&c);
+    }
+    DistDestroy(&a);
+    DistDestroy(&b);
+
+    return ok;
+}
+
+/**
+ * Liczy wyrazy listy, przerywając po przekroczeniu ograniczenia.
+ * @param[in] l : lista jednomianów
+ * @param[in] limit : ograniczenie
+ * @return liczba wyrazów albo `limit + 1`, gdy jest ich więcej niż @p limit
+ */
+static unsigned ListLenUpTo(const List l, unsigned limit)
+{
+    unsigned res = 0;
+
+    for (ListIter it = ListIterBegin(l); it.n != NULL && res <= limit;
+         ListIterNext(&it))
+        res++;
+
+    return res;
+}
+
+/**
+ * Mnoży wielomian przez wielomian o co najwyżej `MUL_SHORT_TERMS` wyrazach.
+ * Iloczyn jest sumą kopii @p p przesuniętych o wykładniki wyrazów @p q i
+ * pomnożonych przez ich współczynniki. Kopie są uporządkowane, więc są
+ * scalane w jednym przejściu, bez sortowania iloczynów wyrazów; przez
+ * jednomian @p p jest po prostu przepisywany. Iloczyny współczynników
+ * liczy rekurencyjnie `PolyMul`, więc krótkie czynniki na głębszych
+ * poziomach też są mnożone w ten sposób.
+ * @param[in] p : wielomian, który nie jest współczynnikiem
+ * @param[in] q : wielomian, który nie jest współczynnikiem, o co najwyżej
+ * `MUL_SHORT_TERMS` wyrazach
+ * @return `p * q`
+ */
+static Poly PolyMulShort(const Poly *p, const Poly *q)
+{
+    ListIter its[MUL_SHORT_TERMS];
+    poly_exp_t shift[MUL_SHORT_TERMS];
+    Poly c[MUL_SHORT_TERMS];
+    unsigned k = 0;
+
+    for (ListIter x = ListIterBegin(q->l); x.n != NULL; ListIterNext(&x))
+    {
+        its[k] = ListIterBegin(p->l);
+        shift[k] = ListIterExp(&x);
+        c[k++] = ListIterCoeff(&x);
+    }
+
+    ListBuilder b;
+    BuilderInit(&b);
+
+    while (true)
+    {
+        poly_exp_t e = 0;
+        bool any = false;
+
+        for (unsigned j = 0; j < k; j++)
+        {
+            if (its[j].n == NULL)
+                continue;
+
+            poly_exp_t x = ListIterExp(&its[j]) + shift[j];
+
+            if (!any || x < e)
+            {
+                e = x;
+                any = true;
+            }
+        }
+
+        if (!any)
+            break;
+
+        Poly sum = PolyZero();
+
+        for (unsigned j = 0; j < k; j++)
+        {
+            if (its[j].n == NULL || ListIterExp(&its[j]) + shift[j] != e)
+                continue;
+
+            Poly pc = ListIterCoeff(&its[j]);
+
+            if (PolyIsCoeff(&sum) && PolyIsCoeff(&pc) && PolyIsCoeff(&c[j]))
+                sum.c = CoeffAdd(sum.c, CoeffMul(pc.c, c[j].c));
+            else if (PolyIsZero(&sum))
+                sum = PolyMul(&pc, &c[j]);
+            else
+                sum = PolyFmaTake(&pc, &c[j], &sum);
+            ListIterNext(&its[j]);
+        }
+
+        Mono m = MonoFromPoly(&sum, e);
+        BuilderPushMono(&b, &m);
+    }
+
+    return PolyFromList(BuilderFinish(&b));
+}
+
+/**
+ * Mnoży dwa wielomiany, z których co najmniej jeden jest w drzewie.
+ * @param[in] p : wielomian
+ * @param[in] q : wielomian
+ * @return `p * q`
+ */
+static Poly PolyMulTree(const Poly *p, const Poly *q)
+{
+    Poly tp, tq;
+    const Poly *vp = PolyListView(p, &tp), *vq = PolyListView(q, &tq);
+    Poly res = PolyMul(vp, vq);
+
+    PolyListViewDone(vp, &tp);
+    PolyListViewDone(vq, &tq);
+
+    return res;
+}
+
+Poly PolyMul(const Poly *p, const Poly *q)
+{
+    if (PolyIsTree(p) || PolyIsTree(q))
+        return PolyMulTree(p, q);
+    else if (PolyIsCoeff(p) && PolyIsCoeff(q))
+        return PolyFromCoeff(CoeffMul(p->c, q->c));
+    else if (PolyIsCoeff(p))
+        return PolyShare(PolyMulCoeff(q, p->c));
+    else if (PolyIsCoeff(q))
+        return PolyShare(PolyMulCoeff(p, q->c));
+
+    unsigned terms_p = ListLenUpTo(p->l, MUL_SHORT_TERMS);
+    unsigned terms_q = ListLenUpTo(q->l, MUL_SHORT_TERMS);
+    const Poly *longer = terms_q <= terms_p ? p : q;
+    const Poly *shorter = longer == p ? q : p;
+    unsigned terms = longer == p ? terms_q : terms_p;
+    ListIter first = ListIterBegin(shorter->l);
+    Poly c = ListIterCoeff(&first);
+
+    if (terms == 1 && PolyIsCoeff(&c))
+        return PolyShare(PolyMulTerm(longer, ListIterExp(&first), c.c));
+
+    size_t len_p, len_q;
+    bool dense_p, dense_q;
+
+    /* Przez krótki czynnik rzadki wielomian jest mnożony scalaniem jego
+       przesuniętych kopii, a gęsty jądrem na gęstej tablicy. */
+    if (ListRangeIsLeaf(p->l, NULL, &len_p, &dense_p)
+        && ListRangeIsLeaf(q->l, NULL, &len_q, &dense_q)
+        && (terms > MUL_SHORT_TERMS || dense_p || dense_q))
+        return PolyShare(PolyMulLeaf(p, len_p, q, len_q, LONG_MAX));
+    else if (terms <= MUL_SHORT_TERMS)
+        return PolyShare(PolyMulShort(longer, shorter));
+
+    Poly res;
+
+    if (PolyMulDist(p, q, &res))
+        return PolyShare(res);
+
+    unsigned n = ListLen(p->l) * ListLen(q->l);
+    unsigned k = 0;
+    Mono *arr = calloc(n, sizeof(struct Mono));
+    
+    for (ListIter z = ListIterBegin(p->l); z.n != NULL; ListIterNext(&z))
+    {
+        Poly zc = ListIterCoeff(&z);
+
+        for (ListIter x = ListIterBegin(q->l); x.n != NULL; ListIterNext(&x))
+        {
+            Poly xc = ListIterCoeff(&x);
+            arr[k++] = (Mono) {.p = PolyMul(&zc, &xc),
+                               .exp = ListIterExp(&z) + ListIterExp(&x)};
+        }
+    }
+
+    res = PolyAddMonos(n, arr);
+
+    free(arr);
+
+    return res;
+}
+
+/**
+ * Daje wyrazy wielomianu bez drzewa jako tablicę jednomianów, które są
+ * widokami wyrazów @p p, a nie kopiami. Niezerowy współczynnik daje
+ * jeden wyraz o wykładniku 0.
+ * @param[in] p : wielomian bez drzewa
+ * @param[out] size : liczba wyrazów
+ * @return tablica jednomianów do zwolnienia przez `free`
+ */
+static Mono* PolyMonosView(const Poly *p, unsigned *size)
+{
+    *size = PolyIsCoeff(p) ? p->c != 0 : ListLen(p->l);
+
+    Mono *res = malloc((*size + 1) * sizeof(Mono));
+    assert(res != NULL);
+
+    if (PolyIsCoeff(p))
+    {
+        res[0] = (Mono) {.p = *p, .exp = 0};
+        return res;
+    }
+
+    unsigned i = 0;
+
+    for (ListIter it = ListIterBegin(p->l); it.n != NULL; ListIterNext(&it))
+        res[i++] = (Mono) {.p = ListIterCoeff(&it), .exp = ListIterExp(&it)};
+
+    return res;
+}
+
+/**
+ * Sprawdza, czy wielomian bez drzewa ma tylko stałe współczynniki.
+ * @param[in] p : wielomian bez drzewa
+ * @param[out] len : liczba pozycji wyrazów
+ * @return czy @p p jest współczynnikiem albo listą o stałych współczynnikach
+ */
+static bool PolyIsLeaf(const Poly *p, size_t *len)
+{
+    bool dense;
+
+    if (!PolyIsCoeff(p))
+        return ListRangeIsLeaf(p->l, NULL, len, &dense);
+
+    *len = 1;
+
+    return true;
+}
+
+/**
+ * Przepisuje niezerowe wyrazy wielomianu o stałych współczynnikach
+ * do równoległych tablic.
+ * @param[in] p : wielomian spełniający `PolyIsLeaf`
+ * @param[out] exps : wykładniki
+ * @param[out] coeffs : współczynniki
+ * @return liczba wyrazów
+ */
+static size_t PolyLeafGather(const Poly *p, poly_exp_t *exps,
+                             poly_coeff_t *coeffs)
+{
+    if (!PolyIsCoeff(p))
+        return ListRangeGather(p->l, NULL, exps, coeffs);
+
+    exps[0] = 0;
+    coeffs[0] = p->c;
+
+    return p->c != 0;
+}
+
+/**
+ * Liczy `p * q + r` dla wielomianów o stałych współczynnikach przez
+ * `KernelFmaLeaf`.
+ * @param[in] p : niezerowy wielomian
+ * @param[in] len_p : liczba pozycji wyrazów @p p
+ * @param[in] q : niezerowy wielomian
+ * @param[in] len_q : liczba pozycji wyrazów @p q
+ * @param[in] r : wielomian
+ * @param[in] len_r : liczba pozycji wyrazów @p r
+ * @return `p * q + r`
+ */
+static Poly PolyFmaLeaf(const Poly *p, size_t len_p, const Poly *q, size_t len_q,
+                        const Poly *r, size_t len_r)
+{
+    size_t len = len_p + len_q + len_r;
+    poly_exp_t *exps = malloc(len * sizeof(poly_exp_t));
+    poly_coeff_t *coeffs = malloc(len * sizeof(poly_coeff_t));
+
+    assert(exps != NULL && coeffs != NULL);
+
+    size_t np = PolyLeafGather(p, exps, coeffs);
+    size_t nq = PolyLeafGather(q, exps + np, coeffs + np);
+    size_t nr = PolyLeafGather(r, exps + np + nq, coeffs + np + nq);
+    poly_exp_t *res_exps;
+    poly_coeff_t *res_coeffs;
+    size_t k = KernelFmaLeaf(exps, coeffs, np, exps + np, coeffs + np, nq,
+                             exps + np + nq, coeffs + np + nq, nr,
+                             &res_exps, &res_coeffs);
+
+    ListBuilder b;
+    BuilderInit(&b);
+    BuilderPushTerms(&b, res_exps, res_coeffs, k);
+
+    free(exps);
+    free(coeffs);
+    free(res_exps);
+    free(res_coeffs);
+
+    return PolyFromList(BuilderFinish(&b));
+}
+
+/**
+ * Liczy niezerowe wyrazy wielomianu bez drzewa na wszystkich poziomach,
+ * przerywając po przekroczeniu @p limit.
+ * @param[in] p : wielomian bez drzewa
+ * @param[in] limit : ograniczenie
+ * @return liczba wyrazów, jeśli nie przekracza @p limit; wpp liczba
+ * większa niż @p limit
+ */
+static size_t PolyTermsUpTo(const Poly *p, size_t limit)
+{
+    if (PolyIsCoeff(p))
+        return p->c != 0;
+
+    size_t n = 0;
+
+    for (ListIter it = ListIterBegin(p->l); it.n != NULL && n <= limit;
+         ListIterNext(&it))
+    {
+        Poly c = ListIterCoeff(&it);
+        n += PolyTermsUpTo(&c, limit - n);
+    }
+
+    return n;
+}
+
+/**
+ * Liczy `p * q + r` dla wielomianów wielu zmiennych w reprezentacji
+ * rozproszonej (patrz `DistFma`).
+ * @param[in] p : niezerowy wielomian bez drzewa
+ * @param[in] q : niezerowy wielomian bez drzewa
+ * @param[in] r : wielomian bez drzewa
+ * @param[out] res : `p * q + r`
+ * @return czy liczenie w reprezentacji rozproszonej się opłacało i powiodło
+ */
+static bool PolyFmaDist(const Poly *p, const Poly *q, const Poly *r, Poly *res)
+{
+    unsigned vars = DistVars(p), vars_q = DistVars(q);
+
+    vars = vars < vars_q ? vars_q : vars;
+    if (vars > DIST_VARS_MAX)
+        return false;
+
+    poly_exp_t dp[DIST_VARS_MAX] = {0}, dq[DIST_VARS_MAX] = {0};
+    poly_exp_t dr[DIST_VARS_MAX] = {0};
+    size_t np = DistDegrees(p, dp), nq = DistDegrees(q, dq);
+
+    /* Przepisanie dużego składnika do reprezentacji rozproszonej i z powrotem
+       kosztuje więcej niż scalanie go z iloczynami po wyrazach, więc
+       składnika nie przeglądamy dalej niż do liczby iloczynów. */
+    if (np * nq < DIST_MUL_MIN_PRODUCTS || PolyTermsUpTo(r, np * nq) > np * nq)
+        return false;
+
+    unsigned vars_r = DistVars(r);
+
+    vars = vars < vars_r ? vars_r : vars;
+    if (vars < 2 || vars > DIST_VARS_MAX)
+        return false;
+
+    long degs[DIST_VARS_MAX];
+    DistLayout l;
+
+    DistDegrees(r, dr);
+    for (unsigned v = 0; v < vars; v++)
+    {
+        degs[v] = (long)dp[v] + dq[v];
+        degs[v] = dr[v] > degs[v] ? dr[v] : degs[v];
+    }
+
+    if (!PolyDistLayout(&l, vars, degs))
+        return false;
+
+    DistPoly a = DistFromPoly(p, &l), b = DistFromPoly(q, &l);
+    DistPoly c = DistFromPoly(r, &l), d;
+    bool ok = DistFma(&a, &b, &c, &d);
+
+    if (ok)
+    {
+        *res = DistToPoly(&d);
+        DistDestroy(&d);
+    }
+    DistDestroy(&a);
+    DistDestroy(&b);
+    DistDestroy(&c);
+
+    return ok;
+}
+
+/**
+ * Dodaje iloczyn do wielomianu w drzewie, wstawiając do drzewa kolejno
+ * iloczyny wyrazów. Drzewo, do którego wołający ma jedyne odwołanie,
+ * jest zmieniane w miejscu.
+ * @param[in] p : niezerowy wielomian bez drzewa
+ * @param[in] q : niezerowy wielomian bez drzewa
+ * @param[in] r : wielomian w drzewie
+ * @param[in] own : czy @p r jest przejmowany na własność
+ * @return `p * q + r` w drzewie
+ */
+static Poly PolyFmaTree(const Poly *p, const Poly *q, Poly *r, bool own)
+{
+    TreeNode *t = TreeRetain(NodeTree(r->l));
+    unsigned np, nq;
+    Mono *pm = PolyMonosView(p, &np), *qm = PolyMonosView(q, &nq);
+
+    if (own)
+        PolyDestroy(r);
+
+    for (unsigned i = 0; i < np; i++)
+    {
+        for (unsigned j = 0; j < nq; j++)
+        {
+            Poly c = PolyMul(&pm[i].p, &qm[j].p);
+
+            if (!PolyIsZero(&c))
+                t = TreeAddTerm(t, pm[i].exp + qm[j].exp, &c);
+            PolyDestroy(&c);
+        }
+    }
+
+    free(pm);
+    free(qm);
+
+    return PolyFromTree(t);
+}
+
+/** Iloczyn pary wyrazów w `PolyFmaTerms` */
+typedef struct FmaEntry
+{
+    poly_exp_t exp; ///< wykładnik iloczynu
+    unsigned i; ///< numer wyrazu pierwszego czynnika
+    unsigned j; ///< numer wyrazu drugiego czynnika
+} FmaEntry;
+
+/**
+ * Porównuje iloczyny par wyrazów według wykładnika.
+ * @param[in] a : iloczyn pary wyrazów
+ * @param[in] b : iloczyn pary wyrazów
+ * @return wynik porównania dla `qsort`
+ */
+static int FmaEntryCompare(const void *a, const void *b)
+{
+    const FmaEntry *x = a, *y = b;
+
+    if (x->exp != y->exp)
+        return (x->exp > y->exp) - (x->exp < y->exp);
+    if (x->i != y->i)
+        return (x->i > y->i) - (x->i < y->i);
+
+    return (x->j > y->j) - (x->j < y->j);
+}
+
+/**
+ * Liczy `p * q + r` rekurencyjnie: posortowane iloczyny par wyrazów są
+ * scalane z wyrazami @p r, a współczynnik każdego wykładnika powstaje
+ * z wyrazu @p r przez kolejne `PolyFmaTake` na współczynnikach, więc
+ * iloczyn nie powstaje osobno na żadnym poziomie. Gdy @p r jest
+ * przejmowany poza trybem tablicy unikalnych wielomianów, jego
+ * jednomiany przechodzą do wyniku bez kopiowania.
+ * @param[in] p : niezerowy wielomian bez drzewa
+ * @param[in] q : niezerowy wielomian bez drzewa
+ * @param[in] r : wielomian bez drzewa
+ * @param[in] own : czy @p r jest przejmowany na własność
+ * @return `p * q + r`
+ */
+static Poly PolyFmaTerms(const Poly *p, const Poly *q, Poly *r, bool own)
+{
+    unsigned np, nq, nr;
+    Mono *pm = PolyMonosView(p, &np), *qm = PolyMonosView(q, &nq), *rm;
+    bool steal = own && !InternActive() && !PolyIsCoeff(r);
+
+    rm = steal ? ListToArray(r->l, &nr) : PolyMonosView(r, &nr);
+
+    size_t n = (size_t)np * nq, k = 0;
+    FmaEntry *entries = malloc(n * sizeof(FmaEntry));
+    assert(entries != NULL);
+
+    for (unsigned i = 0; i < np; i++)
+    {
+        for (unsigned j = 0; j < nq; j++)
+            entries[k++] = (FmaEntry) {.exp = pm[i].exp + qm[j].exp,
+                                       .i = i, .j = j};
+    }
+
+    qsort(entries, n, sizeof(FmaEntry), FmaEntryCompare);
+
+    ListBuilder b;
+    BuilderInit(&b);
+
+    k = 0;
+    for (unsigned l = 0; k < n || l < nr;)
+    {
+        poly_exp_t e;
+        Poly acc = PolyZero();
+
+        if (l < nr && (k == n || rm[l].exp <= entries[k].exp))
+        {
+            e = rm[l].exp;
+            acc = steal ? rm[l].p : PolyClone(&rm[l].p);
+            l++;
+        }
+        else
+        {
+            e = entries[k].exp;
+        }
+
+        for (; k < n && entries[k].exp == e; k++)
+        {
+            const FmaEntry *x = &entries[k];
+            acc = PolyFmaTake(&pm[x->i].p, &qm[x->j].p, &acc);
+        }
+
+        Mono m = MonoFromPoly(&acc, e);
+        BuilderPushMono(&b, &m);
+    }
+
+    if (own && !steal)
+        PolyDestroy(r);
+
+    free(entries);
+    free(pm);
+    free(qm);
+    free(rm);
+
+    return PolyFromList(BuilderFinish(&b));
+}
+
+/**
+ * Liczy `p * q + r`, wybierając sposób jak `PolyMul`: jądro dla stałych
+ * współczynników, reprezentację rozproszoną dla dużych iloczynów wielu
+ * zmiennych, drzewo dla @p r w drzewie, a wpp rekurencję po wyrazach.
+ * @param[in] p : wielomian
+ * @param[in] q : wielomian
+ * @param[in] r : wielomian
+ * @param[in] own : czy @p r jest przejmowany na własność
+ * @return `p * q + r`
+ */
+static Poly PolyFmaBody(const Poly *p, const Poly *q, Poly *r, bool own)
+{
+    if (PolyIsZero(p) || PolyIsZero(q))
+        return own ? *r : PolyClone(r);
+    else if (PolyIsZero(r))
+        return PolyMul(p, q);
+
+    if (PolyIsTree(p) || PolyIsTree(q))
+    {
+        Poly tp, tq;
+        const Poly *vp = PolyListView(p, &tp), *vq = PolyListView(q, &tq);
+        Poly res = PolyFmaBody(vp, vq, r, own);
+
+        PolyListViewDone(vp, &tp);
+        PolyListViewDone(vq, &tq);
+
+        return res;
+    }
+    else if (PolyIsTree(r))
+    {
+        return PolyFmaTree(p, q, r, own);
+    }
+
+    size_t len_p, len_q, len_r;
+    Poly res;
+
+    if (PolyIsCoeff(p) && PolyIsCoeff(q) && PolyIsCoeff(r))
+        res = PolyFromCoeff(CoeffAdd(CoeffMul(p->c, q->c), r->c));
+    else if (PolyIsLeaf(p, &len_p) && PolyIsLeaf(q, &len_q)
+             && PolyIsLeaf(r, &len_r))
+        res = PolyFmaLeaf(p, len_p, q, len_q, r, len_r);
+    else if (!PolyFmaDist(p, q, r, &res))
+        return PolyFmaTerms(p, q, r, own);
+
+    if (own)
+        PolyDestroy(r);
+
+    return res;
+}
+
+Poly PolyFma(const Poly *p, const Poly *q, const Poly *r)
+{
+    /* Bez przejmowania na własność `r` nie jest zmieniany. */
+    Poly res = PolyFmaBody(p, q, (Poly *)r, false);
+
+    return PolyIsTree(&res) ? res : PolyShare(res);
+}
+
+Poly PolyFmaTake(const Poly *p, const Poly *q, Poly *r)
+{
+    Poly res = PolyFmaBody(p, q, r, true);
+
+    return PolyIsTree(&res) ? res : PolyShare(res);
+}
+
+/**
+ * Podnosi do kwadratu wielomian o stałych współczynnikach przez
+ * `KernelSqrLeaf`.
+ * @param[in] p : wielomian
+ * @param[in] len : liczba pozycji wyrazów @p p
+ * @return `p * p`
+ */
+static Poly PolySqrLeaf(const Poly *p, size_t len)
+{
+    poly_exp_t *exps = malloc(len * sizeof(poly_exp_t));
+    poly_coeff_t *coeffs = malloc(len * sizeof(poly_coeff_t));
+
+    assert(exps != NULL && coeffs != NULL);
+
+    size_t n = ListRangeGather(p->l, NULL, exps, coeffs);
+    poly_exp_t *res_exps;
+    poly_coeff_t *res_coeffs;
+    size_t k = KernelSqrLeaf(exps, coeffs, n, &res_exps, &res_coeffs);
+
+    ListBuilder b;
+    BuilderInit(&b);
+    BuilderPushTerms(&b, res_exps, res_coeffs, k);
+
+    free(exps);
+    free(coeffs);
+    free(res_exps);
+    free(res_coeffs);
+
+    return PolyFromList(BuilderFinish(&b));
+}
+
+/**
+ * Podnosi do kwadratu wielomian wielu zmiennych w reprezentacji
+ * rozproszonej.
+ * @param[in] p : wielomian
+ * @param[out] res : `p * p`
+ * @return czy podnoszenie w reprezentacji rozproszonej się opłacało
+ * i powiodło
+ */
+static bool PolySqrDist(const Poly *p, Poly *res)
+{
+    unsigned vars = DistVars(p);
+
+    if (vars < 2 || vars > DIST_VARS_MAX)
+        return false;
+
+    poly_exp_t dp[DIST_VARS_MAX] = {0};
+    size_t np = DistDegrees(p, dp);
+    long degs[DIST_VARS_MAX];
+    DistLayout l;
+
+    for (unsigned v = 0; v < vars; v++)
+        degs[v] = 2L * dp[v];
+
+    if (np * np < DIST_MUL_MIN_PRODUCTS || !PolyDistLayout(&l, vars, degs))
+        return false;
+
+    DistPoly a = DistFromPoly(p, &l), c;
+    bool ok = DistMul(&a, &a, &c);
+
+    if (ok)
+    {
+        *res = DistToPoly(&c);
+        DistDestroy(&c);
+    }
+    DistDestroy(&a);
+
+    return ok;
+}
+
+Poly PolySqr(const Poly *p)
+{
+    if (PolyIsTree(p))
+    {
+        Poly tmp;
+        const Poly *view = PolyListView(p, &tmp);
+        Poly res = PolySqr(view);
+
+        PolyListViewDone(view, &tmp);
+
+        return res;
+    }
+    else if (PolyIsCoeff(p))
+    {
+        return PolyFromCoeff(CoeffMul(p->c, p->c));
+    }
+
+    size_t len;
+    bool dense;
+
+    if (ListRangeIsLeaf(p->l, NULL, &len, &dense))
+        return PolyShare(PolySqrLeaf(p, len));
+
+    Poly res;
+
+    if (PolySqrDist(p, &res))
+        return PolyShare(res);
+
+    /* Kwadraty wyrazów i podwojone iloczyny par różnych wyrazów. */
+    unsigned len_p = ListLen(p->l);
+    unsigned n = len_p * (len_p + 1) / 2;
+    unsigned k = 0;
+    Mono *arr = calloc(n, sizeof(struct Mono));
+    assert(arr != NULL);
+
+    for (ListIter z = ListIterBegin(p->l); z.n != NULL; ListIterNext(&z))
+    {
+        Poly zc = ListIterCoeff(&z);
+
+        arr[k++] = (Mono) {.p = PolySqr(&zc), .exp = 2 * ListIterExp(&z)};
+
+        ListIter x = z;
+
+        for (ListIterNext(&x); x.n != NULL; ListIterNext(&x))
+        {
+            Poly xc = ListIterCoeff(&x);
+            Poly prod = PolyMul(&zc, &xc);
+
+            arr[k++] = (Mono) {.p = PolyMulCoeff(&prod, 2),
+                               .exp = ListIterExp(&z) + ListIterExp(&x)};
+            PolyDestroy(&prod);
+        }
+    }
+
+    res = PolyAddMonos(k, arr);
+
+    free(arr);
+
+    return res;
+}
+
+Poly PolyNeg(const Poly *p)
+{
+    if (PolyIsTree(p))
+    {
+        Poly tmp = PolyToList(p);
+        Poly neg = PolyMulCoeff(&tmp, CoeffNeg(1));
+        Poly res = PolyToTree(&neg);
+
+        PolyDestroy(&tmp);
+        PolyDestroy(&neg);
+
+        return res;
+    }
+
+    return PolyShare(PolyMulCoeff(p, CoeffNeg(1)));
+}
+
+Poly PolySub(const Poly *p, const Poly *q)
+{
+    Poly tmp = PolyNeg(q);
+    Poly res = PolyAdd(&tmp, p);
+
+    PolyDestroy(&tmp);
+
+    return res;
+}
+
+/**
+ * Daje maksymalny stopień na liście jednomianów.
+ * @param[in] l : lista jednomianów
+ * @return max potęga
+ */
+static poly_exp_t PolyMaxDeg(const List l)
+{
+    poly_exp_t res = -1;
+
+    for (Node *ptr = l; ptr != NULL; ptr = ptr->next)
+        res = Max(res, NodeLastExp(ptr));
+
+    return res;
+}
+
+poly_exp_t PolyDegBy(const Poly *p, unsigned var_idx)
+{
+    if (PolyIsTree(p) && var_idx == 0)
+    {
+        return TreeMaxExp(NodeTree(p->l));
+    }
+    else if (PolyIsTree(p))
+    {
+        Poly tmp = PolyToList(p);
+        poly_exp_t res = PolyDegBy(&tmp, var_idx);
+
+        PolyDestroy(&tmp);
+
+        return res;
+    }
+    else if (var_idx > 0)
+    {
+        poly_exp_t res = var_idx == POLY_DEG_MAX ? 0 :  -1;
+
+        for (ListIter it = ListIterBegin(p->l); it.n != NULL; ListIterNext(&it))
+        {
+            Poly c = ListIterCoeff(&it);
+            res = Max(res, PolyDegBy(&c, var_idx - 1));
+        }
+        
+        return res;
+    }
+    else
+    {
+        return PolyIsZero(p) ? -1 : PolyIsCoeff(p) ? 0 : PolyMaxDeg(p->l);
+    }
+}
+
+poly_exp_t PolyDeg(const Poly *p)
+{
+    if (PolyIsTree(p))
+    {
+        Poly tmp = PolyToList(p);
+        poly_exp_t res = PolyDeg(&tmp);
+
+        PolyDestroy(&tmp);
+
+        return res;
+    }
+    else if (!PolyIsCoeff(p))
+    {
+        poly_exp_t res = -1;
+
+        for (ListIter it = ListIterBegin(p->l); it.n != NULL; ListIterNext(&it))
+        {
+            Poly c = ListIterCoeff(&it);
+            res = Max(res, ListIterExp(&it) + PolyDeg(&c));
+        }
+
+        return res;
+    }
+    else
+    {
+        return PolyIsZero(p) ? -1 : 0;
+    }
+}
+
+bool PolyIsEq(const Poly *p, const Poly *q)
+{
+    if (p->l == q->l)
+        return p->c == q->c;
+
+    if (PolyIsTree(p) && PolyIsTree(q))
+        return TreeEqual(NodeTree(p->l), NodeTree(q->l));
+
+    if (PolyIsTree(p) || PolyIsTree(q))
+    {
+        Poly tp, tq;
+        const Poly *vp = PolyListView(p, &tp), *vq = PolyListView(q, &tq);
+        bool res = PolyIsEq(vp, vq);
+
+        PolyListViewDone(vp, &tp);
+        PolyListViewDone(vq, &tq);
+
+        return res;
+    }
+
+    /* Różne listy z tablicy unikalnych wielomianów mają różne wyrazy. */
+    if (!PolyIsCoeff(p) && !PolyIsCoeff(q) && InternContains(p->l)
+        && InternContains(q->l))
+        return false;
+
+    /* Różnica modulo 2^POLY_COEFF_BITS jest zerem wtedy i tylko wtedy,
+       gdy wielomiany są równe, więc jej przepełnienia nie są przepełnieniem
+       wyniku. */
+    bool overflow = PolyCoeffOverflow();
+    Poly tmp = PolySub(p, q);
+
+    bool res = PolyIsZero(&tmp);
+
+    PolyDestroy(&tmp);
+    PolyCoeffOverflow();
+    CoeffOverflowNote(overflow);
+
+    return res;
+}
+
+bool PolyIsEqFast(const Poly *p, const Poly *q)
+{
+    if (p->l == q->l)
+        return p->c == q->c;
+
+    return EvalIsEq(p, q);
+}
+
+bool PolyCoeffOverflow(void)
+{
+    return atomic_exchange_explicit(&coeff_overflow, false, memory_order_relaxed);
+}
+
+void PolyCoeffModSet(poly_coeff_t p)
+{
+    CoeffModSet(p);
+}
+
+poly_coeff_t PolyCoeffMod(void)
+{
+    return (poly_coeff_t)coeff_mod.p;
+}
+
+Poly PolyCoeffReduce(const Poly *p)
+{
+    if (PolyIsTree(p))
+    {
+        Poly tmp = PolyToList(p);
+        Poly red = PolyCoeffReduce(&tmp);
+        Poly res = PolyToTree(&red);
+
+        PolyDestroy(&tmp);
+        PolyDestroy(&red);
+
+        return res;
+    }
+    else if (PolyIsCoeff(p))
+        return PolyFromCoeff(CoeffReduce(p->c));
+
+    ListBuilder b;
+    BuilderInit(&b);
+
+    for (ListIter k = ListIterBegin(p->l); k.n != NULL; ListIterNext(&k))
+    {
+        Poly c = ListIterCoeff(&k);
+        Mono m = {.p = PolyCoeffReduce(&c), .exp = ListIterExp(&k)};
+
+        BuilderPushMono(&b, &m);
+    }
+
+    return PolyShare(PolyFromList(BuilderFinish(&b)));
+}
+
+void PolyInternSet(bool on)
+{
+    atomic_store_explicit(&intern_active, on, memory_order_relaxed);
+}
+
+Poly PolyIntern(const Poly *p)
+{
+    Poly res = PolyIsTree(p) ? PolyToList(p) : PolyClone(p);
+
+    if (!PolyIsCoeff(&res))
+        res.l = InternList(res.l);
+
+    return res;
+}
+
+PolyInternStats PolyInternReport(void)
+{
+    return InternStats();
+}
+
+Poly PolyToTree(const Poly *p)
+{
+    if (PolyIsCoeff(p) || PolyIsTree(p))
+        return PolyClone(p);
+
+    unsigned count = ListLen(p->l), i = 0;
+    Mono *monos = malloc(count * sizeof(Mono));
+    assert(monos != NULL);
+
+    for (ListIter it = ListIterBegin(p->l); it.n != NULL; ListIterNext(&it))
+    {
+        Poly c = ListIterCoeff(&it);
+        monos[i++] = (Mono) {.p = PolyClone(&c), .exp = ListIterExp(&it)};
+    }
+
+    Poly res = PolyFromTree(TreeBuild(count, monos));
+
+    free(monos);
+
+    return res;
+}
+
+Poly PolyToList(const Poly *p)
+{
+    if (!PolyIsTree(p))
+        return PolyClone(p);
+
+    const TreeNode *t = NodeTree(p->l);
+    Mono *monos = malloc(t->size * sizeof(Mono));
+    assert(monos != NULL);
+    Mono *end = TreeGather(t, monos);
+
+    ListBuilder b;
+    BuilderInit(&b);
+
+    for (Mono *m = monos; m != end; m++)
+        BuilderPushMono(&b, m);
+
+    free(monos);
+
+    return PolyShare(PolyFromList(BuilderFinish(&b)));
+}
+
+unsigned PolyVars(const Poly *p)
+{
+    Poly tmp;
+    const Poly *view = PolyListView(p, &tmp);
+    unsigned res = DistVars(view);
+
+    PolyListViewDone(view, &tmp);
+
+    return res;
+}
+
+Poly PolyPermute(const Poly *p, unsigned count, const unsigned perm[])
+{
+    Poly tmp;
+    const Poly *view = PolyListView(p, &tmp);
+    unsigned vars = DistVars(view) < count ? count : DistVars(view);
+    unsigned *full = malloc((vars + 1) * sizeof(unsigned));
+    assert(full != NULL);
+
+    for (unsigned i = 0; i < vars; i++)
+        full[i] = i < count ? perm[i] : i;
+
+    Poly res = ReorderPermute(view, vars, full);
+
+    free(full);
+    PolyListViewDone(view, &tmp);
+
+    return res;
+}
+
+void PolyReorderChoose(unsigned count, const Poly ps[], unsigned vars,
+                       unsigned perm[])
+{
+    Poly *views = calloc(count + 1, sizeof(Poly));
+    assert(views != NULL);
+
+    for (unsigned i = 0; i < count; i++)
+        views[i] = PolyIsTree(&ps[i]) ? PolyToList(&ps[i]) : ps[i];
+
+    ReorderChoose(count, views, vars, perm);
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        if (PolyIsTree(&ps[i]))
+            PolyDestroy(&views[i]);
+    }
+    free(views);
+}
+
+Poly PolyAt(const Poly *p, poly_coeff_t x)
+{
+    if (PolyIsTree(p))
+    {
+        Poly tmp = PolyToList(p);
+        Poly res = PolyAt(&tmp, x);
+
+        PolyDestroy(&tmp);
+
+        return res;
+    }
+
+    Poly res = PolyZero();
+    poly_coeff_t acc = p->c;
+
+    x = CoeffReduce(x);
+
+    for (Node *ptr = p->l; ptr != NULL; ptr = ptr->next)
+    {
+        if (NodeIsBlock(ptr))
+        {
+            const Block *blk = NodeBlock(ptr);
+            acc = CoeffAdd(acc, CoeffMul(Power(x, blk->start),
+                                         KernelEval(blk->coeffs, blk->len, x)));
+        }
+        else if (NodeIsLeaf(ptr))
+        {
+            const Leaf *leaf = NodeLeaf(ptr);
+            acc = CoeffAdd(acc, KernelEvalLeaf(LeafExps(leaf), leaf->coeffs,
+                                               leaf->len, x));
+        }
+        else if (PolyIsCoeff(&(ptr->m.p)))
+        {
+            acc = CoeffAdd(acc, CoeffMul(ptr->m.p.c, Power(x, ptr->m.exp)));
+        }
+        else
+        {
+            Poly tmp1 = PolyMulCoeff(&(ptr->m.p), Power(x, ptr->m.exp));
+            Poly tmp2 = PolyAdd(&res, &tmp1);
+            PolyDestroy(&res);
+            PolyDestroy(&tmp1);
+            res = tmp2;
+        }
+    }
+
+    Poly tmp = PolyFromCoeff(acc);
+    Poly sum = PolyAdd(&res, &tmp);
+
+    PolyDestroy(&res);
+
+    return sum;
+}
+
+void PolyArrayDestroy(unsigned count, Poly x[])
+{
+    for (unsigned i = 0; i < count; i++)
+        PolyDestroy(&x[i]);
+    free(x);
+}
+
+/**
+ * Daje wyraz wolny wielomianu.
+ * @param[in] p : wielomian
+ * @return @f$p(0)@f$
+ */
+static Poly PolyConstTerm(const Poly *p)
+{
+    if (!PolyIsCoeff(p))
+    {
+        ListIter it = ListIterBegin(p->l);
+        Poly c = ListIterCoeff(&it);
+
+        return ListIterExp(&it) == 0 ? PolyConstTerm(&c) : PolyZero();
+    }
+    else
+    {
+        return PolyClone(p);
+    }
+}
+
+/**
+ * Podnosi wielomian wielu zmiennych do potęgi w reprezentacji rozproszonej,
+ * przerabiając go tylko raz na początku i raz na końcu.
+ * @param[in] p : wielomian
+ * @param[in] exp : wykładnik
+ * @param[in] seq : czy mnożyć kolejno przez podstawę zamiast podnosić
+ * do kwadratu
+ * @param[out] res : @f$p^exp@f$
+ * @return czy potęgowanie w reprezentacji rozproszonej się powiodło
+ */
+static bool PolyPowerDist(const Poly *p, poly_exp_t exp, bool seq, Poly *res)
+{
+    unsigned vars = DistVars(p);
+
+    if (vars < 2 || vars > DIST_VARS_MAX || exp < 2)
+        return false;
+
+    poly_exp_t dp[DIST_VARS_MAX] = {0};
+    long degs[DIST_VARS_MAX];
+    DistLayout l;
+
+    DistDegrees(p, dp);
+    for (unsigned v = 0; v < vars; v++)
+        degs[v] = (long)dp[v] * exp;
+
+    if (!PolyDistLayout(&l, vars, degs))
+        return false;
+
+    Poly one = PolyFromCoeff(1);
+    DistPoly acc = DistFromPoly(&one, &l), q = DistFromPoly(p, &l), tmp;
+    bool ok = true;
+
+    /* Kwadraty liczymy tylko do potrzebnej potęgi, więc mieszczą się w polach. */
+    while (ok && exp != 0)
+    {
+        if (seq || (exp & 1))
+        {
+            ok = DistMul(&acc, &q, &tmp);
+            DistDestroy(&acc);
+            acc = tmp;
+        }
+        exp = seq ? exp - 1 : exp >> 1;
+        if (!seq && ok && exp != 0)
+        {
+            ok = DistMul(&q, &q, &tmp);
+            DistDestroy(&q);
+            q = tmp;
+        }
+    }
+
+    if (ok)
+        *res = DistToPoly(&acc);
+    DistDestroy(&acc);
+    DistDestroy(&q);
+
+    return ok;
+}
+
+/**
+ * Podnosi wielomian do potęgi przez podnoszenie do kwadratu albo przez
+ * mnożenie kolejno przez podstawę.
+ * @param[in] p : wielomian
+ * @param[in] exp : wykładnik
+ * @param[in] seq : czy mnożyć kolejno przez podstawę
+ * @return @f$p^exp@f$
+ */
+static Poly PolyPower(const Poly *p, poly_exp_t exp, bool seq)
+{
+    Poly res = PolyFromCoeff(1);
+    Poly tmp;
+
+    if (PolyPowerDist(p, exp, seq, &tmp))
+        return tmp;
+
+    if (seq)
+    {
+        for (poly_exp_t k = 0; k < exp; k++)
+        {
+            tmp = PolyMul(&res, p);
+            PolyDestroy(&res);
+            res = tmp;
+        }
+
+        return res;
+    }
+
+    Poly q = PolyClone(p);
+
+    while (exp != 0)
+    {
+        if (exp & 1)
+        {
+            tmp = PolyMul(&res, &q);
+            PolyDestroy(&res);
+            res = tmp;
+        }
+        exp >>= 1;
+        if (exp != 0)
+        {
+            tmp = PolySqr(&q);
+            PolyDestroy(&q);
+            q = tmp;
+        }
+    }
+
+    PolyDestroy(&q);
+
+    return res;
+}
+
+/**
+ * Szacuje liczbę wyrazów @p k-tej potęgi wielomianu: nie więcej niż punktów
+ * prostopadłościanu wykładników i niż różnych iloczynów @p k spośród
+ * @p t wyrazów.
+ * @param[in] t : liczba wyrazów podstawy
+ * @param[in] vars : liczba zmiennych
+ * @param[in] degs : maksymalne wykładniki zmiennych podstawy
+ * @param[in] k : wykładnik
+ * @return szacowana liczba wyrazów
+ */
+static double PolyPowTerms(size_t t, unsigned vars, const poly_exp_t degs[],
+                           poly_exp_t k)
+{
+    double box = 1, comb = 1;
+
+    for (unsigned v = 0; v < vars; v++)
+        box *= (double)k * degs[v] + 1;
+
+    /* comb = binom(k + t - 1, t - 1) */
+    for (size_t i = 1; i < t && comb < box; i++)
+        comb = comb * ((double)k + (double)i) / (double)i;
+
+    return comb < box ? comb : box;
+}
+
+/**
+ * Wybiera między podnoszeniem do kwadratu a mnożeniem kolejno przez
+ * podstawę, porównując szacowane liczby iloczynów wyrazów. Dla rzadkiej
+ * podstawy wyrazy potęg prawie się nie sumują i kwadraty dużych potęg
+ * kosztują więcej niż wiele mnożeń przez krótką podstawę.
+ * @param[in] p : wielomian
+ * @param[in] exp : wykładnik
+ * @return czy mnożyć kolejno przez podstawę
+ */
+static bool PolyPowSequential(const Poly *p, poly_exp_t exp)
+{
+    unsigned vars = DistVars(p);
+
+    if (vars > DIST_VARS_MAX)
+        return false;
+
+    poly_exp_t degs[DIST_VARS_MAX] = {0};
+    size_t t = DistDegrees(p, degs);
+    double sqr = 0, seq = 0;
+    poly_exp_t m = 1, r = 0;
+
+    for (poly_exp_t e = exp; e != 0; e >>= 1)
+    {
+        double q = PolyPowTerms(t, vars, degs, m);
+
+        if (e & 1)
+        {
+            sqr += r == 0 ? 0 : PolyPowTerms(t, vars, degs, r) * q;
+            r += m;
+        }
+        if (e >> 1 != 0)
+        {
+            sqr += q * q / 2;
+            m *= 2;
+        }
+    }
+
+    for (poly_exp_t k = 1; k < exp && seq <= sqr; k++)
+        seq += (double)t * PolyPowTerms(t, vars, degs, k);
+
+    return seq <= sqr;
+}
+
+/**
+ * Podnosi do potęgi dwumian o stałych współczynnikach
+ * @f$a x^e + b x^f@f$, @f$f < e@f$: wyraz @f$\binom{n}{i} a^i b^{n-i}
+ * x^{ei + f(n-i)}@f$ dla każdego @f$i@f$, bez mnożenia wielomianów.
+ * @param[in] a : współczynnik wyrazu wyższego stopnia
+ * @param[in] e : wykładnik wyrazu wyższego stopnia
+ * @param[in] b : współczynnik wyrazu niższego stopnia
+ * @param[in] f : wykładnik wyrazu niższego stopnia
+ * @param[in] exp : wykładnik potęgi
+ * @param[in,out] binom : współczynniki dwumianowe, nadpisywane
+ * @return @f$(a x^e + b x^f)^{exp}@f$
+ */
+static Poly PolyPowBinomialLeaf(poly_coeff_t a, poly_exp_t e, poly_coeff_t b,
+                                poly_exp_t f, poly_exp_t exp, poly_coeff_t binom[])
+{
+    poly_exp_t *exps = malloc(((size_t)exp + 1) * sizeof(poly_exp_t));
+    assert(exps != NULL);
+    poly_coeff_t pow = 1;
+    bool overflow = false;
+
+    for (poly_exp_t i = 0; i <= exp; i++)
+    {
+        exps[i] = (poly_exp_t)((long)e * i + (long)f * (exp - i));
+        binom[i] = CoeffMulAcc(binom[i], pow, &overflow);
+        if (i < exp)
+            pow = CoeffMulAcc(pow, a, &overflow);
+    }
+
+    pow = 1;
+    for (poly_exp_t i = exp; i >= 0; i--)
+    {
+        binom[i] = CoeffMulAcc(binom[i], pow, &overflow);
+        if (i > 0)
+            pow = CoeffMulAcc(pow, b, &overflow);
+    }
+
+    CoeffOverflowNote(overflow);
+
+    size_t n = KernelCompact(exps, binom, (size_t)exp + 1);
+    ListBuilder builder;
+    BuilderInit(&builder);
+    BuilderPushTerms(&builder, exps, binom, n);
+
+    free(exps);
+
+    return PolyFromList(BuilderFinish(&builder));
+}
+
+/**
+ * Podnosi do potęgi wielomian o dwóch albo trzech wyrazach na najwyższym
+ * poziomie, rozwijając
+ * @f$(a x_0^e + r)^n = \sum_k \binom{n}{k} (a x_0^e)^{n-k} r^k@f$,
+ * gdzie @f$a x_0^e@f$ to wyraz najwyższego stopnia, a potęgi @f$r@f$
+ * są liczone kolejno mnożeniem przez krótkie @f$r@f$. Dla trzech wyrazów
+ * daje to rozwinięcie wielomianowe, opłacalne tylko wtedy, gdy niewiele
+ * iloczynów ma ten sam wykładnik.
+ * @param[in] p : wielomian
+ * @param[in] len : liczba wyrazów @p p na najwyższym poziomie
+ * @param[in] exp : wykładnik, co najmniej 2
+ * @param[out] res : @f$p^{exp}@f$
+ * @return czy rozwinięcie się opłacało, a współczynniki dwumianowe dało
+ * się wyznaczyć
+ */
+static bool PolyPowBinomial(const Poly *p, unsigned len, poly_exp_t exp, Poly *res)
+{
+    Mono terms[3];
+    unsigned t = 0;
+
+    for (ListIter it = ListIterBegin(p->l); it.n != NULL; ListIterNext(&it))
+        terms[t++] = (Mono) {.p = ListIterCoeff(&it), .exp = ListIterExp(&it)};
+
+    poly_exp_t e = terms[len - 1].exp;
+
+    if (len == 3 && ((double)exp + 1) * ((double)exp + 2) / 2
+                    > POW_MULTINOMIAL_RATIO * ((double)(e - terms[0].exp) * exp + 1))
+        return false;
+
+    poly_coeff_t *binom = malloc(((size_t)exp + 1) * sizeof(poly_coeff_t));
+    assert(binom != NULL);
+
+    if (!CoeffBinomials(exp, binom))
+    {
+        free(binom);
+        return false;
+    }
+
+    if (len == 2 && PolyIsCoeff(&terms[0].p) && PolyIsCoeff(&terms[1].p))
+    {
+        *res = PolyPowBinomialLeaf(terms[1].p.c, e, terms[0].p.c, terms[0].exp,
+                                   exp, binom);
+        free(binom);
+        return true;
+    }
+
+    Poly *lead = malloc(((size_t)exp + 1) * sizeof(Poly));
+    Mono lead_mono = {.p = PolyClone(&terms[len - 1].p), .exp = e}, rest_monos[2];
+    assert(lead != NULL);
+
+    for (unsigned i = 0; i + 1 < len; i++)
+        rest_monos[i] = (Mono) {.p = PolyClone(&terms[i].p), .exp = terms[i].exp};
+
+    Poly base = PolyAddMonos(1, &lead_mono), rest = PolyAddMonos(len - 1, rest_monos);
+    Poly rest_pow = PolyFromCoeff(1);
+
+    lead[0] = PolyFromCoeff(1);
+    for (poly_exp_t m = 1; m <= exp; m++)
+        lead[m] = PolyMul(&lead[m - 1], &base);
+
+    size_t count = 0, cap = 0;
+    Mono *monos = NULL;
+
+    for (poly_exp_t k = 0; k <= exp; k++)
+    {
+        Poly prod = PolyMul(&lead[exp - k], &rest_pow);
+        Poly term = PolyMulCoeff(&prod, binom[k]);
+        unsigned n = PolyIsCoeff(&term) ? 1 : ListLen(term.l);
+
+        if (count + n > cap)
+        {
+            cap = 2 * (count + n);
+            monos = realloc(monos, cap * sizeof(Mono));
+            assert(monos != NULL);
+        }
+
+        if (PolyIsCoeff(&term))
+        {
+            monos[count++] = (Mono) {.p = term, .exp = 0};
+        }
+        else
+        {
+            for (ListIter it = ListIterBegin(term.l); it.n != NULL; ListIterNext(&it))
+            {
+                Poly c = ListIterCoeff(&it);
+                monos[count++] = (Mono) {.p = PolyClone(&c), .exp = ListIterExp(&it)};
+            }
+            PolyDestroy(&term);
+        }
+
+        PolyDestroy(&prod);
+
+        if (k < exp)
+        {
+            prod = PolyMul(&rest_pow, &rest);
+            PolyDestroy(&rest_pow);
+            rest_pow = prod;
+        }
+    }
+
+    *res = PolyAddMonos((unsigned)count, monos);
+
+    free(monos);
+    PolyArrayDestroy((unsigned)exp + 1, lead);
+    PolyDestroy(&base);
+    PolyDestroy(&rest);
+    PolyDestroy(&rest_pow);
+    free(binom);
+
+    return true;
+}
+
+Poly PolyPow(const Poly *p, poly_exp_t exp)
+{
+    assert(exp >= 0);
+
+    if (PolyIsTree(p))
+    {
+        Poly tmp;
+        const Poly *view = PolyListView(p, &tmp);
+        Poly res = PolyPow(view, exp);
+
+        PolyListViewDone(view, &tmp);
+
+        return res;
+    }
+    else if (PolyIsCoeff(p))
+    {
+        return PolyFromCoeff(Power(p->c, exp));
+    }
+    else if (exp == 0)
+    {
+        return PolyFromCoeff(1);
+    }
+    else if (exp == 1)
+    {
+        return PolyClone(p);
+    }
+
+    unsigned len = ListLen(p->l);
+
+    if (len == 1)
+    {
+        ListIter it = ListIterBegin(p->l);
+        Poly c = ListIterCoeff(&it);
+        Mono m = {.p = PolyPow(&c, exp),
+                  .exp = (poly_exp_t)((long)ListIterExp(&it) * exp)};
+
+        return PolyAddMonos(1, &m);
+    }
+
+    Poly res;
+
+    if (len <= 3 && PolyPowBinomial(p, len, exp, &res))
+        return PolyShare(res);
+
+    return PolyShare(PolyPower(p, exp, PolyPowSequential(p, exp)));
+}
+
+/**
+ * Daje pozostały stopień całkowity na najwyższym poziomie.
+ * @param[in] b : ograniczenia
+ * @return ograniczenie stopnia całkowitego albo `LONG_MAX`
+ */
+static inline long BoundBudget(const PolyBound *b)
+{
+    return b->total < 0 ? LONG_MAX : b->total;
+}
+
+/**
+ * Daje największy dopuszczalny wykładnik zmiennej.
+ * @param[in] b : ograniczenia
+ * @param[in] var : indeks zmiennej
+ * @param[in] budget : pozostały stopień całkowity
+ * @return największy wykładnik
+ */
+static inline long BoundLimit(const PolyBound *b, unsigned var, long budget)
+{
+    if (var < b->vars && b->max[var] >= 0 && b->max[var] < budget)
+        return b->max[var];
+
+    return budget;
+}
+
+/**
+ * Sprawdza, czy wielomian mieści się w ograniczeniach.
+ * @param[in] p : wielomian bez drzewa
+ * @param[in] b : ograniczenia
+ * @param[in] var : indeks zmiennej wielomianu @p p
+ * @param[in] budget : pozostały stopień całkowity
+ * @return czy żaden wyraz nie przekracza ograniczeń
+ */
+static bool PolyFitsBound(const Poly *p, const PolyBound *b, unsigned var,
+                          long budget)
+{
+    if (PolyIsCoeff(p) || (var >= b->vars && b->total < 0))
+        return true;
+
+    long limit = BoundLimit(b, var, budget);
+
+    for (ListIter it = ListIterBegin(p->l); it.n != NULL; ListIterNext(&it))
+    {
+        Poly c = ListIterCoeff(&it);
+
+        if (ListIterExp(&it) > limit
+            || !PolyFitsBound(&c, b, var + 1, budget - ListIterExp(&it)))
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ * Obcina wielomian do wyrazów mieszczących się w ograniczeniach.
+ * @param[in] p : wielomian bez drzewa
+ * @param[in] b : ograniczenia
+ * @param[in] var : indeks zmiennej wielomianu @p p
+ * @param[in] budget : pozostały stopień całkowity
+ * @return obcięty wielomian
+ */
+static Poly PolyTruncLevel(const Poly *p, const PolyBound *b, unsigned var,
+                           long budget)
+{
+    if (PolyIsCoeff(p) || (var >= b->vars && b->total < 0))
+        return PolyClone(p);
+
+    long limit = BoundLimit(b, var, budget);
+    ListBuilder lb;
+    BuilderInit(&lb);
+
+    for (ListIter it = ListIterBegin(p->l);
+         it.n != NULL && ListIterExp(&it) <= limit; ListIterNext(&it))
+    {
+        Poly c = ListIterCoeff(&it);
+        Mono m = {.p = PolyTruncLevel(&c, b, var + 1, budget - ListIterExp(&it)),
+                  .exp = ListIterExp(&it)};
+
+        if (PolyIsZero(&m.p))
+            continue;
+        BuilderPushMono(&lb, &m);
+    }
+
+    return PolyFromList(BuilderFinish(&lb));
+}
+
+/**
+ * Daje wielomian obcięty do ograniczeń: sam wielomian, jeśli się w nich
+ * mieści, wpp obcięty w @p tmp.
+ * @param[in] p : wielomian
+ * @param[in] b : ograniczenia
+ * @param[out] tmp : miejsce na obcięty wielomian
+ * @return wielomian bez drzewa mieszczący się w ograniczeniach
+ */
+static const Poly* PolyTruncView(const Poly *p, const PolyBound *b, Poly *tmp)
+{
+    if (!PolyIsTree(p) && PolyFitsBound(p, b, 0, BoundBudget(b)))
+        return p;
+
+    *tmp = PolyTrunc(p, b);
+
+    return tmp;
+}
+
+/**
+ * Zwalnia wielomian dany przez `PolyTruncView`.
+ * @param[in] view : wynik `PolyTruncView`
+ * @param[in] tmp : miejsce przekazane do `PolyTruncView`
+ */
+static inline void PolyTruncViewDone(const Poly *view, Poly *tmp)
+{
+    if (view == tmp)
+        PolyDestroy(tmp);
+}
+
+/**
+ * Mnoży wielomiany, pomijając pary wyrazów, których iloczyn przekracza
+ * ograniczenia; współczynniki par mnoży rekurencyjnie z ograniczeniami
+ * kolejnej zmiennej.
+ * @param[in] p : wielomian bez drzewa
+ * @param[in] q : wielomian bez drzewa
+ * @param[in] b : ograniczenia
+ * @param[in] var : indeks zmiennej wielomianów
+ * @param[in] budget : pozostały stopień całkowity
+ * @return obcięty iloczyn
+ */
+static Poly PolyMulTruncLevel(const Poly *p, const Poly *q, const PolyBound *b,
+                              unsigned var, long budget)
+{
+    if (PolyIsCoeff(p) && PolyIsCoeff(q))
+        return PolyFromCoeff(CoeffMul(p->c, q->c));
+
+    if (PolyIsCoeff(p) || PolyIsCoeff(q))
+    {
+        const Poly *c = PolyIsCoeff(p) ? p : q;
+        Poly t = PolyTruncLevel(PolyIsCoeff(p) ? q : p, b, var, budget);
+        Poly res = PolyMulCoeff(&t, c->c);
+
+        PolyDestroy(&t);
+
+        return res;
+    }
+
+    long limit = BoundLimit(b, var, budget);
+    size_t len_p, len_q;
+    bool dense_p, dense_q;
+
+    if (ListRangeIsLeaf(p->l, NULL, &len_p, &dense_p)
+        && ListRangeIsLeaf(q->l, NULL, &len_q, &dense_q))
+        return PolyMulLeaf(p, len_p, q, len_q, limit);
+
+    unsigned np = ListLen(p->l), nq = ListLen(q->l), i = 0, k = 0;
+    Mono *tp = malloc((np + nq) * sizeof(Mono)), *tq = tp + np;
+    assert(tp != NULL);
+
+    for (ListIter it = ListIterBegin(p->l); it.n != NULL; ListIterNext(&it))
+        tp[i++] = (Mono) {.p = ListIterCoeff(&it), .exp = ListIterExp(&it)};
+    i = 0;
+    for (ListIter it = ListIterBegin(q->l); it.n != NULL; ListIterNext(&it))
+        tq[i++] = (Mono) {.p = ListIterCoeff(&it), .exp = ListIterExp(&it)};
+
+    /* Wykładniki rosną, więc każdy wiersz par kończy się na pierwszej
+       parze ponad ograniczeniem. */
+    size_t pairs = 0;
+
+    for (i = 0; i < np; i++)
+        for (unsigned j = 0; j < nq && (long)tp[i].exp + tq[j].exp <= limit; j++)
+            pairs++;
+
+    Mono *monos = malloc((pairs + 1) * sizeof(Mono));
+    assert(monos != NULL);
+
+    for (i = 0; i < np; i++)
+    {
+        for (unsigned j = 0; j < nq && (long)tp[i].exp + tq[j].exp <= limit; j++)
+        {
+            long e = (long)tp[i].exp + tq[j].exp;
+
+            monos[k++] = (Mono) {.p = PolyMulTruncLevel(&tp[i].p, &tq[j].p, b,
+                                                        var + 1, budget - e),
+                                 .exp = (poly_exp_t)e};
+        }
+    }
+
+    Poly res = PolyAddMonos(k, monos);
+
+    free(monos);
+    free(tp);
+
+    return res;
+}
+
+Poly PolyTrunc(const Poly *p, const PolyBound *b)
+{
+    Poly tmp;
+    const Poly *view = PolyListView(p, &tmp);
+    Poly res = PolyFitsBound(view, b, 0, BoundBudget(b))
+               ? PolyClone(view)
+               : PolyShare(PolyTruncLevel(view, b, 0, BoundBudget(b)));
+
+    PolyListViewDone(view, &tmp);
+
+    return res;
+}
+
+Poly PolyAddTrunc(const Poly *p, const Poly *q, const PolyBound *b)
+{
+    Poly tp, tq;
+    const Poly *vp = PolyTruncView(p, b, &tp), *vq = PolyTruncView(q, b, &tq);
+    Poly res = PolyAdd(vp, vq);
+
+    PolyTruncViewDone(vp, &tp);
+    PolyTruncViewDone(vq, &tq);
+
+    return res;
+}
+
+Poly PolyMulTrunc(const Poly *p, const Poly *q, const PolyBound *b)
+{
+    Poly tp, tq;
+    const Poly *vp = PolyListView(p, &tp), *vq = PolyListView(q, &tq);
+    Poly res = PolyShare(PolyMulTruncLevel(vp, vq, b, 0, BoundBudget(b)));
+
+    PolyListViewDone(vp, &tp);
+    PolyListViewDone(vq, &tq);
+
+    return res;
+}
+
+/** Czynnik drzewa iloczynów */
+typedef struct MulAllItem
+{
+    Poly p; ///< wielomian
+    size_t terms; ///< liczba wyrazów
+    bool owned; ///< czy wielomian jest wynikiem pośrednim do usunięcia
+} MulAllItem;
+
+/** Mnożenia jednego poziomu drzewa iloczynów wykonywane przez jeden wątek */
+typedef struct MulAllJob
+{
+    MulAllItem *items; ///< czynniki poziomu, wyniki trafiają na miejsca par
+    unsigned first; ///< numer pierwszej pary wątku
+    unsigned pairs; ///< liczba par poziomu
+    unsigned stride; ///< odstęp między parami wątku
+    const PolyBound *b; ///< ograniczenia albo `NULL`
+    CoeffModulus mod; ///< moduł arytmetyki zlecającego wątku
+    pthread_t thread; ///< wątek
+    bool started; ///< czy udało się uruchomić wątek
+} MulAllJob;
+
+/**
+ * Liczy wyrazy wielomianu; w drzewie tylko wyrazy najwyższego poziomu.
+ * @param[in] p : wielomian
+ * @return liczba wyrazów
+ */
+static size_t PolyTermCount(const Poly *p)
+{
+    if (PolyIsCoeff(p))
+        return 1;
+    else if (PolyIsTree(p))
+        return TreeSize(NodeTree(p->l));
+
+    size_t res = 0;
+
+    for (ListIter it = ListIterBegin(p->l); it.n != NULL; ListIterNext(&it))
+    {
+        Poly c = ListIterCoeff(&it);
+        res += PolyTermCount(&c);
+    }
+
+    return res;
+}
+
+/**
+ * Porównuje czynniki drzewa iloczynów według liczby wyrazów.
+ * @param[in] a : czynnik
+ * @param[in] b : czynnik
+ * @return wynik porównania dla `qsort`
+ */
+static int MulAllItemCompare(const void *a, const void *b)
+{
+    size_t x = ((const MulAllItem *)a)->terms, y = ((const MulAllItem *)b)->terms;
+
+    return (x > y) - (x < y);
+}
+
+/**
+ * Mnoży pary czynników przydzielone wątkowi: para @f$k@f$ to czynniki
+ * @f$2k@f$ i @f$2k + 1@f$, a iloczyn zastępuje pierwszy z nich.
+ * Funkcja wątku roboczego.
+ * @param[in,out] arg : zadanie (`MulAllJob`)
+ * @return `NULL`
+ */
+static void* MulAllJobRun(void *arg)
+{
+    MulAllJob *job = arg;
+    bool was_worker = add_worker;
+
+    add_worker = true;
+    coeff_mod = job->mod;
+    for (unsigned k = job->first; k < job->pairs; k += job->stride)
+    {
+        MulAllItem *x = &job->items[2 * k], *y = x + 1;
+        Poly res = job->b != NULL ? PolyMulTrunc(&x->p, &y->p, job->b)
+                                  : PolyMul(&x->p, &y->p);
+
+        if (x->owned)
+            PolyDestroy(&x->p);
+        if (y->owned)
+            PolyDestroy(&y->p);
+        *x = (MulAllItem) {.p = res, .terms = PolyTermCount(&res), .owned = true};
+    }
+    add_worker = was_worker;
+
+    return NULL;
+}
+
+/**
+ * Daje liczbę wątków dla poziomu drzewa iloczynów.
+ * @param[in] items : czynniki poziomu, posortowane
+ * @param[in] pairs : liczba par
+ * @return liczba wątków (1, gdy mnożenia mają być sekwencyjne)
+ */
+static unsigned MulAllThreads(const MulAllItem items[], unsigned pairs)
+{
+    double products = 0;
+
+    if (add_worker || InternActive() || pairs < 2)
+        return 1;
+
+    for (unsigned k = 0; k < pairs; k++)
+        products += (double)items[2 * k].terms * (double)items[2 * k + 1].terms;
+    if (products < PARALLEL_MUL_ALL_MIN_PRODUCTS)
+        return 1;
+
+    unsigned res = pairs;
+    if (res > PolyCpuCount())
+        res = PolyCpuCount();
+    if (res > PARALLEL_ADD_THREADS_MAX)
+        res = PARALLEL_ADD_THREADS_MAX;
+
+    return res;
+}
+
+/** Oszacowanie czynnika przy wyborze kolejności mnożeń */
+typedef struct MulAllEst
+{
+    double terms; ///< szacowana liczba wyrazów
+    double *degs; ///< szacowane maksymalne wykładniki zmiennych
+} MulAllEst;
+
+/**
+ * Porównuje oszacowania czynników według liczby wyrazów.
+ * @param[in] a : oszacowanie
+ * @param[in] b : oszacowanie
+ * @return wynik porównania dla `qsort`
+ */
+static int MulAllEstCompare(const void *a, const void *b)
+{
+    double x = ((const MulAllEst *)a)->terms, y = ((const MulAllEst *)b)->terms;
+
+    return (x > y) - (x < y);
+}
+
+/**
+ * Szacuje mnożenie dwóch czynników i zapisuje oszacowanie iloczynu
+ * w miejsce pierwszego. Iloczyn ma co najwyżej tyle wyrazów, ile iloczyn
+ * liczb wyrazów czynników i ile pudełko wyznaczone przez wykładniki.
+ * @param[in,out] x : pierwszy czynnik, potem iloczyn
+ * @param[in] y : drugi czynnik
+ * @param[in] vars : liczba zmiennych albo `DIST_VARS_MAX + 1`, gdy
+ * pudełka się nie liczy
+ * @param[in] b : ograniczenia albo `NULL`
+ * @return szacowany koszt mnożenia
+ */
+static double MulAllEstMul(MulAllEst *x, const MulAllEst *y, unsigned vars,
+                           const PolyBound *b)
+{
+    double cost = x->terms * y->terms, box = 1;
+
+    x->terms = cost;
+    if (vars > DIST_VARS_MAX)
+        return cost;
+
+    for (unsigned v = 0; v < vars; v++)
+    {
+        x->degs[v] += y->degs[v];
+        if (b != NULL && x->degs[v] > BoundLimit(b, v, BoundBudget(b)))
+            x->degs[v] = BoundLimit(b, v, BoundBudget(b));
+        box *= x->degs[v] + 1;
+    }
+    if (box < x->terms)
+        x->terms = box;
+
+    return cost;
+}
+
+/**
+ * Wypełnia oszacowania czynników.
+ * @param[out] est : oszacowania
+ * @param[out] degs : miejsce na wykładniki, @p count razy @p vars
+ * @param[in] base : wykładniki czynników albo `NULL`
+ * @param[in] items : czynniki
+ * @param[in] count : liczba czynników
+ * @param[in] vars : liczba zmiennych
+ */
+static void MulAllEstInit(MulAllEst est[], double degs[], const double base[],
+                          const MulAllItem items[], unsigned count,
+                          unsigned vars)
+{
+    for (unsigned i = 0; i < count; i++)
+    {
+        est[i].terms = items[i].terms;
+        est[i].degs = degs + (size_t)i * vars;
+        if (base != NULL)
+            memcpy(est[i].degs, base + (size_t)i * vars, vars * sizeof(double));
+    }
+}
+
+/**
+ * Sprawdza, czy mnożenie kolejno do akumulatora, od najmniejszych
+ * czynników, będzie tańsze niż drzewo zrównoważone. Tak jest, gdy
+ * iloczyny rzadkich czynników szybko wypełniają pudełko wykładników:
+ * w drzewie dwa duże iloczyny pośrednie mnożą się wtedy kwadratowo,
+ * a akumulator rośnie wolno i dostaje tylko małe czynniki.
+ * @param[in] items : czynniki
+ * @param[in] count : liczba czynników
+ * @param[in] b : ograniczenia albo `NULL`
+ * @return czy mnożyć sekwencyjnie
+ */
+static bool MulAllSequential(const MulAllItem items[], unsigned count,
+                             const PolyBound *b)
+{
+    unsigned vars = 0;
+
+    for (unsigned i = 0; i < count && vars <= DIST_VARS_MAX; i++)
+    {
+        Poly tmp;
+        const Poly *view = PolyListView(&items[i].p, &tmp);
+        unsigned v = DistVars(view);
+
+        PolyListViewDone(view, &tmp);
+        if (v > vars)
+            vars = v;
+    }
+
+    unsigned width = vars <= DIST_VARS_MAX ? vars : 0;
+    MulAllEst *est = malloc(count * sizeof(MulAllEst));
+    double *base = malloc(((size_t)count * width + 1) * sizeof(double));
+    double *degs = malloc(((size_t)count * width + 1) * sizeof(double));
+    double seq = 0, tree = 0;
+    assert(est != NULL && base != NULL && degs != NULL);
+
+    for (unsigned i = 0; i < count && width > 0; i++)
+    {
+        poly_exp_t d[DIST_VARS_MAX] = {0};
+        Poly tmp;
+        const Poly *view = PolyListView(&items[i].p, &tmp);
+
+        DistDegrees(view, d);
+        PolyListViewDone(view, &tmp);
+        for (unsigned v = 0; v < width; v++)
+            base[(size_t)i * width + v] = d[v];
+    }
+
+    MulAllEstInit(est, degs, base, items, count, width);
+    qsort(est, count, sizeof(MulAllEst), MulAllEstCompare);
+    for (unsigned i = 1; i < count; i++)
+        seq += MulAllEstMul(&est[0], &est[i], vars, b);
+
+    MulAllEstInit(est, degs, base, items, count, width);
+    for (unsigned n = count; n > 1; n = (n + 1) / 2)
+    {
+        qsort(est, n, sizeof(MulAllEst), MulAllEstCompare);
+        for (unsigned k = 0; k < n / 2; k++)
+        {
+            tree += MulAllEstMul(&est[2 * k], &est[2 * k + 1], vars, b);
+            est[k] = est[2 * k];
+        }
+        if (n % 2 == 1)
+            est[n / 2] = est[n - 1];
+    }
+
+    free(est);
+    free(base);
+    free(degs);
+
+    return seq < tree;
 }
 
 /**
- * Dodaje do wielomianu liczbę.
- * @param[in] p : wielomian
- * @param[in] c : liczba
- * @return `p + c`
+ * Mnoży wiele wielomianów w drzewie iloczynów zrównoważonym według
+ * liczby wyrazów: na każdym poziomie czynniki są sortowane i mnożone
+ * parami sąsiadów, więc mnożone są wielomiany podobnej wielkości,
+ * a mnożenia jednego poziomu mogą działać równolegle. Gdy według
+ * oszacowania (`MulAllSequential`) taniej jest mnożyć kolejno do
+ * akumulatora, czynniki są mnożone od najmniejszego.
+ * @param[in] count : liczba czynników
+ * @param[in] ps : czynniki
+ * @param[in] b : ograniczenia albo `NULL`
+ * @return iloczyn
  */
-static Poly PolyAddCoeff(const Poly *p, poly_coeff_t c) {
-    assert(!PolyIsCoeff(p));
+static Poly PolyMulAllBound(unsigned count, const Poly ps[], const PolyBound *b)
+{
+    for (unsigned i = 0; i < count; i++)
+    {
+        if (PolyIsZero(&ps[i]))
+            return PolyZero();
+    }
 
-    Poly res = PolyClone(p);
+    if (count == 0)
+        return PolyFromCoeff(1);
+    else if (count == 1)
+        return b != NULL ? PolyTrunc(&ps[0], b) : PolyClone(&ps[0]);
 
-    if (c == 0)
-        return res;
+    MulAllItem *items = malloc(count * sizeof(MulAllItem));
+    MulAllJob jobs[PARALLEL_ADD_THREADS_MAX];
+    assert(items != NULL);
 
-    Poly tmp1 = PolyFromCoeff(c);
+    for (unsigned i = 0; i < count; i++)
+        items[i] = (MulAllItem) {.p = ps[i], .terms = PolyTermCount(&ps[i]),
+                                 .owned = false};
 
-    if (res.l->m.exp == 0)
+    if (count > 2 && MulAllSequential(items, count, b))
     {
-        Poly tmp2 = PolyAdd(&tmp1, &res.l->m.p);
-        PolyDestroy(&tmp1);
-        PolyDestroy(&res.l->m.p);
-        res.l->m.p = tmp2;
-        if (PolyIsZero(&res.l->m.p))
+        /* Akumulator stoi na początku, kolejny czynnik tuż za nim. */
+        qsort(items, count, sizeof(MulAllItem), MulAllItemCompare);
+        jobs[0] = (MulAllJob) {.items = items, .first = 0, .pairs = 1,
+                               .stride = 1, .b = b, .mod = coeff_mod,
+                               .started = false};
+        for (unsigned i = 1; i < count; i++)
         {
-            List tmp = res.l->next;
-            MonoDestroy(&res.l->m);
-            free(res.l);
-            res.l = tmp;
+            items[1] = items[i];
+            MulAllJobRun(&jobs[0]);
         }
+        count = 1;
     }
-    else
+
+    for (unsigned n = count; n > 1; n = (n + 1) / 2)
     {
-        Mono m = MonoFromPoly(&tmp1, 0);
-        res.l = NodeCreate(&m, res.l);
+        unsigned pairs = n / 2, threads;
+
+        qsort(items, n, sizeof(MulAllItem), MulAllItemCompare);
+        threads = MulAllThreads(items, pairs);
+
+        for (unsigned t = 0; t < threads; t++)
+            jobs[t] = (MulAllJob) {.items = items, .first = t, .pairs = pairs,
+                                   .stride = threads, .b = b, .mod = coeff_mod,
+                                   .started = false};
+        for (unsigned t = 1; t < threads; t++)
+            jobs[t].started = pthread_create(&jobs[t].thread, NULL,
+                                             MulAllJobRun, &jobs[t]) == 0;
+
+        MulAllJobRun(&jobs[0]);
+
+        for (unsigned t = 1; t < threads; t++)
+        {
+            if (jobs[t].started)
+                pthread_join(jobs[t].thread, NULL);
+            else
+                MulAllJobRun(&jobs[t]);
+        }
+
+        /* Iloczyny par przechodzą na początek, nieparzysty czynnik za nie. */
+        for (unsigned k = 0; k < pairs; k++)
+            items[k] = items[2 * k];
+        if (n % 2 == 1)
+            items[pairs] = items[n - 1];
     }
 
+    Poly res = items[0].p;
+
+    free(items);
+
     return res;
 }
 
-Poly PolyAdd(const Poly *p, const Poly *q)
+Poly PolyMulAll(unsigned count, const Poly ps[])
 {
-    if (PolyIsCoeff(p) && PolyIsCoeff(q))
-        return (Poly) {.l = ListCreate(), .c = p->c + q->c};
-    else if (PolyIsCoeff(p))
-        return PolyAddCoeff(q, p->c);
-    else if (PolyIsCoeff(q))
-        return PolyAddCoeff(p, q->c);
-
-    List l = ListMerge(p->l, q->l);
-    poly_coeff_t x = 0;
-
-    if (l != NULL && l->next == NULL
-        && l->m.exp == 0 && PolyIsCoeff(&l->m.p))
-    {
-        x = l->m.p.c;
-        ListDestroy(l);
-        l = NULL;
-    }
+    return PolyMulAllBound(count, ps, NULL);
+}
 
-    return (Poly) {.l = l, .c = x};
+Poly PolyMulAllTrunc(unsigned count, const Poly ps[], const PolyBound *b)
+{
+    return PolyMulAllBound(count, ps, b);
 }
 
-Poly PolyAddMonos(unsigned count, const Mono monos[])
+Poly PolyPowTrunc(const Poly *p, poly_exp_t exp, const PolyBound *b)
 {
-    Poly res = PolyZero();
+    assert(exp >= 0);
+
+    Poly res = PolyFromCoeff(1), q = PolyTrunc(p, b), tmp;
 
-    for (int i = (int)count - 1; i >= 0; i--)
+    while (exp != 0)
     {
-        Mono mono = monos[i];
-        if (PolyIsZero(&(mono.p)))
+        if (exp & 1)
         {
-            MonoDestroy(&mono);
-            continue;
+            tmp = PolyMulTrunc(&res, &q, b);
+            PolyDestroy(&res);
+            res = tmp;
+        }
+        exp >>= 1;
+        if (exp != 0)
+        {
+            tmp = PolyMulTrunc(&q, &q, b);
+            PolyDestroy(&q);
+            q = tmp;
         }
-        res.l = ListAddMonos(res.l, &mono);
     }
 
-    if (!ListIsEmpty(res.l) && res.l->next == NULL
-        && res.l->m.exp == 0 && PolyIsCoeff(&(res.l->m.p)))
-    {
-        res.c += res.l->m.p.c;
-        ListDestroy(res.l);
-        res.l = NULL;
-    }
+    PolyDestroy(&q);
 
     return res;
 }
 
+/** Dzielnik jednej zmiennej przygotowany do dzielenia wielu dzielnych */
+typedef struct PolyDivisor
+{
+    const Poly *q; ///< dzielnik bez drzewa
+    poly_exp_t *exps; ///< rosnące wykładniki dzielnika
+    poly_coeff_t *coeffs; ///< współczynniki dzielnika
+    size_t len; ///< liczba wyrazów dzielnika
+    poly_exp_t deg; ///< stopień dzielnika
+    poly_coeff_t inv; ///< odwrotność współczynnika wiodącego
+    Poly rev; ///< odwrócony dzielnik, póki `g_len` jest zerem nieustawiony
+    Poly g; ///< odwrotność szeregu `rev` modulo @f$x^{g\_len}@f$
+    poly_exp_t g_len; ///< liczba wyrazów `g`, 0 póki niepotrzebna
+} PolyDivisor;
+
 /**
- * Pomocnicza do funkcji, mnożącej wielomian przez stałą.
- * @param[in,out] p : wielomian
- * @param[in] c : stała
+ * Przepisuje wyrazy dzielnika do równoległych tablic i odwraca jego
+ * współczynnik wiodący.
+ * @param[out] d : dzielnik
+ * @param[in] q : wielomian bez drzewa
+ * @return czy @p q jest niezerowym wielomianem zmiennej @f$x_0@f$
+ * o stałych współczynnikach i odwracalnym współczynniku wiodącym
  */
-static void PolyMulCoeffHelp(Poly *p, const poly_coeff_t c)
+static bool PolyDivisorInit(PolyDivisor *d, const Poly *q)
 {
-    p->c *= c;
+    bool dense;
 
-    for (Node *ptr = p->l; ptr != NULL; ptr = ptr->next)
-        PolyMulCoeffHelp(&(ptr->m.p), c);
+    d->q = q;
+    d->g_len = 0;
+    if (PolyIsCoeff(q))
+        d->len = 1;
+    else if (!ListRangeIsLeaf(q->l, NULL, &d->len, &dense))
+        return false;
+
+    d->exps = malloc(d->len * sizeof(poly_exp_t));
+    d->coeffs = malloc(d->len * sizeof(poly_coeff_t));
+    assert(d->exps != NULL && d->coeffs != NULL);
+
+    if (PolyIsCoeff(q))
+    {
+        d->exps[0] = 0;
+        d->coeffs[0] = q->c;
+    }
+    else
+    {
+        d->len = ListRangeGather(q->l, NULL, d->exps, d->coeffs);
+    }
+    d->deg = d->exps[d->len - 1];
+
+    if (!PolyIsZero(q) && CoeffInverse(d->coeffs[d->len - 1], &d->inv))
+        return true;
+
+    free(d->exps);
+    free(d->coeffs);
+
+    return false;
 }
 
 /**
- * Usuwa zera z wielomianu
- * @param[in,out] p : wielomian
+ * Usuwa dzielnik z pamięci.
+ * @param[in] d : dzielnik
  */
-static void PolyRemoveZeros(Poly *p)
+static void PolyDivisorDestroy(PolyDivisor *d)
 {
-    Node *ptr = p->l, *prev = NULL;
-    while (ptr != NULL)
+    free(d->exps);
+    free(d->coeffs);
+    if (d->g_len > 0)
     {
-        PolyRemoveZeros(&ptr->m.p);
-        if (PolyIsZero(&ptr->m.p))
-        {
-            if (prev == NULL)
-            {
-                Node *tmp = ptr;
-                ptr = ptr->next;
-                PolyDestroy(&tmp->m.p);
-                free(tmp);
-                p->l = ptr;
-            }
-            else
-            {
-                ptr = ptr->next;
-                PolyDestroy(&prev->next->m.p);
-                free(prev->next);
-                prev->next = ptr;
-            }
-        }
-        else
-        {
-            prev = ptr;
-            ptr = ptr->next;
-        }
+        PolyDestroy(&d->rev);
+        PolyDestroy(&d->g);
     }
 }
 
 /**
- * Mnoży jednomian przez stalą.
- * @param[in] p : wielomian
- * @param[in] c : stała
- * @return przemnożony wielomian
+ * Odwraca kolejność współczynników zmiennej @f$x_0@f$:
+ * daje @f$x_0^d p(1/x_0)@f$.
+ * @param[in] p : wielomian bez drzewa stopnia co najwyżej @p d względem
+ * @f$x_0@f$
+ * @param[in] d : stopień
+ * @return odwrócony wielomian
  */
-static Poly PolyMulCoeff(const Poly *p, const poly_coeff_t c)
+static Poly PolyReverse(const Poly *p, poly_exp_t d)
 {
-    if (c == 0)
-        return PolyZero();
-
-    Poly res = PolyClone(p);
-
-    PolyMulCoeffHelp(&res, c);
-
-    PolyRemoveZeros(&res);
+    if (PolyIsCoeff(p))
+    {
+        Poly c = PolyClone(p);
+        Mono m = MonoFromPoly(&c, d);
 
-    return res;
-}
+        return PolyAddMonos(1, &m);
+    }
 
-Poly PolyMul(const Poly *p, const Poly *q)
-{
-    if (PolyIsCoeff(p) && PolyIsCoeff(q))
-        return PolyFromCoeff(p->c * q->c);
-    else if (PolyIsCoeff(p))
-        return PolyMulCoeff(q, p->c);
-    else if (PolyIsCoeff(q))
-        return PolyMulCoeff(p, q->c);
+    unsigned n = ListLen(p->l), k = 0;
+    Mono *monos = malloc(n * sizeof(Mono));
+    assert(monos != NULL);
 
-    unsigned n = ListLen(p->l) * ListLen(q->l);
-    unsigned k = 0;
-    Mono *arr = calloc(n, sizeof(struct Mono));
-    
-    for (Node *z = p->l; z != NULL; z = z->next)
+    for (ListIter it = ListIterBegin(p->l); it.n != NULL; ListIterNext(&it))
     {
-        for (Node *x = q->l; x != NULL; x = x->next)
-            arr[k++] = (Mono) {.p = PolyMul(&(z->m.p), &(x->m.p)),
-                               .exp = z->m.exp + x->m.exp};
+        Poly c = ListIterCoeff(&it);
+
+        monos[k++] = (Mono) {.p = PolyClone(&c), .exp = d - ListIterExp(&it)};
     }
 
-    Poly res = PolyAddMonos(n, arr);
+    Poly res = PolyAddMonos(k, monos);
 
-    free(arr);
+    free(monos);
 
     return res;
 }
 
-Poly PolyNeg(const Poly *p)
+/**
+ * Przedłuża odwrotność szeregu odwróconego dzielnika do @p k wyrazów
+ * iteracją Newtona @f$g \leftarrow g + g (1 - f g)@f$, podwajającą liczbę
+ * poprawnych wyrazów; iloczyny są obcinane przez `PolyMulTrunc`.
+ * @param[in,out] d : dzielnik
+ * @param[in] k : liczba wyrazów odwrotności
+ */
+static void PolyDivisorInverse(PolyDivisor *d, poly_exp_t k)
 {
-    return PolyMulCoeff(p, -1);
-}
+    if (d->g_len == 0)
+    {
+        d->rev = PolyReverse(d->q, d->deg);
+        d->g = PolyFromCoeff(d->inv);
+        d->g_len = 1;
+    }
 
-Poly PolySub(const Poly *p, const Poly *q)
-{
-    Poly tmp = PolyNeg(q);
-    Poly res = PolyAdd(&tmp, p);
+    poly_exp_t max[] = {0};
+    PolyBound b = {.vars = 1, .max = max, .total = -1};
+    Poly one = PolyFromCoeff(1);
 
-    PolyDestroy(&tmp);
+    while (d->g_len < k)
+    {
+        d->g_len = d->g_len < k - d->g_len ? 2 * d->g_len : k;
+        max[0] = d->g_len - 1;
 
-    return res;
+        Poly fg = PolyMulTrunc(&d->rev, &d->g, &b), e = PolySub(&one, &fg);
+        Poly ge = PolyMulTrunc(&d->g, &e, &b), next = PolyAdd(&d->g, &ge);
+
+        PolyDestroy(&fg);
+        PolyDestroy(&e);
+        PolyDestroy(&ge);
+        PolyDestroy(&d->g);
+        d->g = next;
+    }
 }
 
 /**
- * Daje maksymalny stopień na liście jednomianów.
- * @param[in] l : lista jednomianów
- * @return max potęga
+ * Dzieli z resztą przez odwrotność szeregu: iloraz jest odwróconym
+ * iloczynem odwróconej dzielnej i odwrotności odwróconego dzielnika,
+ * a reszta różnicą dolnych wyrazów dzielnej i iloczynu dzielnika przez
+ * iloraz. Wszystkie iloczyny są obcięte do potrzebnych wyrazów.
+ * @param[in] p : wielomian bez drzewa o stałych współczynnikach
+ * @param[in] m : stopień @p p
+ * @param[in,out] d : dzielnik stopnia nie większego niż @p m
+ * @param[out] quot : iloraz
+ * @param[out] rem : reszta
  */
-static poly_exp_t PolyMaxDeg(const List l)
+static void PolyDivNewton(const Poly *p, poly_exp_t m, PolyDivisor *d,
+                          Poly *quot, Poly *rem)
 {
-    poly_exp_t res = -1;
+    poly_exp_t k = m - d->deg + 1, max[] = {k - 1};
+    PolyBound b = {.vars = 1, .max = max, .total = -1};
 
-    for (Node *ptr = l; ptr != NULL; ptr = ptr->next)
-        res = Max(res, ptr->m.exp);
+    PolyDivisorInverse(d, k);
 
-    return res;
-}
+    Poly rp = PolyReverse(p, m), rquot = PolyMulTrunc(&rp, &d->g, &b);
 
-poly_exp_t PolyDegBy(const Poly *p, unsigned var_idx)
-{
-    if (var_idx > 0)
-    {
-        poly_exp_t res = var_idx == POLY_DEG_MAX ? 0 :  -1;
+    *quot = PolyReverse(&rquot, k - 1);
 
-        for (Node *ptr = p->l; ptr != NULL; ptr = ptr->next)
-            res = Max(res, PolyDegBy(&(ptr->m.p), var_idx - 1));
-        
-        return res;
+    if (d->deg == 0)
+    {
+        *rem = PolyZero();
     }
     else
     {
-        return PolyIsZero(p) ? -1 : PolyIsCoeff(p) ? 0 : PolyMaxDeg(p->l);
+        max[0] = d->deg - 1;
+
+        Poly low = PolyTrunc(p, &b), prod = PolyMulTrunc(d->q, quot, &b);
+
+        *rem = PolySub(&low, &prod);
+        PolyDestroy(&low);
+        PolyDestroy(&prod);
     }
+
+    PolyDestroy(&rp);
+    PolyDestroy(&rquot);
 }
 
-poly_exp_t PolyDeg(const Poly *p)
+/**
+ * Dzieli z resztą gęstą tablicą przez `KernelDivRem`.
+ * @param[in] p : wielomian bez drzewa o stałych współczynnikach
+ * @param[in] len : liczba pozycji wyrazów @p p
+ * @param[in] m : stopień @p p
+ * @param[in] d : dzielnik stopnia nie większego niż @p m
+ * @param[out] quot : iloraz
+ * @param[out] rem : reszta
+ */
+static void PolyDivDense(const Poly *p, size_t len, poly_exp_t m,
+                         const PolyDivisor *d, Poly *quot, Poly *rem)
 {
-    if (!PolyIsCoeff(p))
-    {
-        poly_exp_t res = -1;
-
-        for (Node *ptr = p->l; ptr != NULL; ptr = ptr->next)
-            res = Max(res, ptr->m.exp + PolyDeg(&(ptr->m.p)));
+    size_t n = (size_t)d->deg;
+    poly_exp_t *exps = malloc(len * sizeof(poly_exp_t));
+    poly_coeff_t *coeffs = malloc(len * sizeof(poly_coeff_t));
+    poly_coeff_t *r = calloc((size_t)m + 1, sizeof(poly_coeff_t));
+    poly_coeff_t *b = calloc(n + 1, sizeof(poly_coeff_t));
+    assert(exps != NULL && coeffs != NULL && r != NULL && b != NULL);
 
-        return res;
+    if (PolyIsCoeff(p))
+    {
+        exps[0] = 0;
+        coeffs[0] = p->c;
     }
     else
     {
-        return PolyIsZero(p) ? -1 : 0;
+        len = ListRangeGather(p->l, NULL, exps, coeffs);
     }
-}
+    for (size_t i = 0; i < len; i++)
+        r[exps[i]] = coeffs[i];
+    for (size_t i = 0; i < d->len; i++)
+        b[d->exps[i]] = d->coeffs[i];
 
-bool PolyIsEq(const Poly *p, const Poly *q)
-{
-    Poly tmp = PolySub(p, q);
+    KernelDivRem(r, (size_t)m, b, n, d->inv);
 
-    bool res = PolyIsZero(&tmp);
+    ListBuilder lq, lr;
+    BuilderInit(&lq);
+    BuilderInit(&lr);
+    for (size_t i = n; i <= (size_t)m; i++)
+        BuilderPushCoeff(&lq, (poly_exp_t)(i - n), r[i]);
+    for (size_t i = 0; i < n; i++)
+        BuilderPushCoeff(&lr, (poly_exp_t)i, r[i]);
 
-    PolyDestroy(&tmp);
+    *quot = PolyFromList(BuilderFinish(&lq));
+    *rem = PolyFromList(BuilderFinish(&lr));
 
-    return res;
+    free(exps);
+    free(coeffs);
+    free(r);
+    free(b);
 }
 
-Poly PolyAt(const Poly *p, poly_coeff_t x)
+/**
+ * Dzieli z resztą metodą szkolną: odejmuje od reszty wielokrotności
+ * dzielnika, póki jej stopień nie spadnie poniżej stopnia dzielnika.
+ * Wykonuje tyle kroków, ile iloraz ma wyrazów, więc nadaje się dla
+ * rzadkich dzielnych.
+ * @param[in] p : wielomian bez drzewa o stałych współczynnikach
+ * @param[in] d : dzielnik
+ * @param[out] quot : iloraz
+ * @param[out] rem : reszta
+ */
+static void PolyDivClassical(const Poly *p, const PolyDivisor *d, Poly *quot,
+                             Poly *rem)
 {
-    Poly res = PolyFromCoeff(p->c);
+    poly_exp_t n = d->deg;
+    unsigned count = 0, cap = 8;
+    Mono *q = malloc(cap * sizeof(Mono)), *sub = malloc(d->len * sizeof(Mono));
+    assert(q != NULL && sub != NULL);
 
-    for (Node *ptr = p->l; ptr != NULL; ptr = ptr->next)
+    *rem = PolyClone(p);
+
+    while (PolyDegBy(rem, 0) >= n)
     {
-        Poly tmp1 = PolyMulCoeff(&(ptr->m.p), Power(x, ptr->m.exp));
-        Poly tmp2 = PolyAdd(&res, &tmp1);
-        PolyDestroy(&res);
-        PolyDestroy(&tmp1);
-        res = tmp2;
+        Poly lead = *rem;
+        poly_exp_t e = 0;
+
+        for (ListIter it = ListIterBegin(rem->l); it.n != NULL; ListIterNext(&it))
+        {
+            lead = ListIterCoeff(&it);
+            e = ListIterExp(&it);
+        }
+
+        poly_coeff_t t = CoeffMul(lead.c, d->inv);
+
+        for (size_t j = 0; j < d->len; j++)
+            sub[j] = (Mono) {.p = PolyFromCoeff(CoeffMul(t, d->coeffs[j])),
+                             .exp = e - n + d->exps[j]};
+
+        Poly s = PolyAddMonos((unsigned)d->len, sub), tmp = PolySub(rem, &s);
+
+        PolyDestroy(&s);
+        PolyDestroy(rem);
+        *rem = tmp;
+
+        if (count == cap)
+        {
+            cap *= 2;
+            q = realloc(q, cap * sizeof(Mono));
+            assert(q != NULL);
+        }
+        q[count++] = (Mono) {.p = PolyFromCoeff(t), .exp = e - n};
     }
 
-    return res;
-}
+    *quot = PolyAddMonos(count, q);
 
-void PolyArrayDestroy(unsigned count, Poly x[])
-{
-    for (unsigned i = 0; i < count; i++)
-        PolyDestroy(&x[i]);
-    free(x);
+    free(q);
+    free(sub);
 }
 
 /**
- * Daje wyraz wolny wielomianu.
- * @param[in] p : wielomian
- * @return @f$p(0)@f$
+ * Dzieli z resztą wielomian jednej zmiennej o stałych współczynnikach.
+ * Gęste dzielne dzieli tablicą, a duże dzielenia modulo @f$p@f$ metodą
+ * Newtona: bez modułu iloraz zwykle przepełnia współczynniki, a wtedy
+ * iloczyny są liczone szkolnie i Newton traci przewagę.
+ * @param[in] p : wielomian bez drzewa o stałych współczynnikach
+ * @param[in,out] d : dzielnik
+ * @param[out] quot : iloraz
+ * @param[out] rem : reszta
  */
-static Poly PolyConstTerm(const Poly *p)
+static void PolyDivLeaf(const Poly *p, PolyDivisor *d, Poly *quot, Poly *rem)
 {
+    poly_exp_t m = PolyDegBy(p, 0);
+    size_t len = 1;
+    bool dense;
+
     if (!PolyIsCoeff(p))
-        return p->l->m.exp == 0 ? PolyConstTerm(&p->l->m.p) : PolyZero();
+        ListRangeIsLeaf(p->l, NULL, &len, &dense);
+
+    if (m < d->deg)
+    {
+        *quot = PolyZero();
+        *rem = PolyClone(p);
+    }
+    else if ((size_t)m / DIV_DENSE_RATIO >= len)
+    {
+        PolyDivClassical(p, d, quot, rem);
+    }
+    else if (CoeffModActive() && d->deg >= DIV_NEWTON_MIN
+             && m - d->deg >= DIV_NEWTON_MIN)
+    {
+        PolyDivNewton(p, m, d, quot, rem);
+    }
     else
-        return PolyClone(p);
+    {
+        PolyDivDense(p, len, m, d, quot, rem);
+    }
 }
 
 /**
- * Podnosi wielomian do potęgi.
- * @param[in] p : wielomian
- * @param[in] exp : wykładnik
- * @return @f$p^exp@f$
+ * Dzieli z resztą wielomian, w którym zmienna dzielenia jest ostatnia.
+ * Dzielnik ma stałe współczynniki, więc dzielenie jest liniowe względem
+ * pozostałych zmiennych: każdy wielomian ostatniej zmiennej dzieli się
+ * osobno, a odwrotność szeregu dzielnika liczy się raz.
+ * @param[in] p : wielomian bez drzewa
+ * @param[in] var : indeks zmiennej wielomianu @p p
+ * @param[in] vars : liczba zmiennych
+ * @param[in,out] d : dzielnik
+ * @param[out] quot : iloraz
+ * @param[out] rem : reszta
  */
-static Poly PolyPower(const Poly *p, poly_exp_t exp)
+static void PolyDivInner(const Poly *p, unsigned var, unsigned vars,
+                         PolyDivisor *d, Poly *quot, Poly *rem)
 {
-    Poly res = PolyFromCoeff(1);
-    Poly tmp;
-    Poly q = PolyClone(p);
+    if (PolyIsCoeff(p) || var + 1 == vars)
+    {
+        PolyDivLeaf(p, d, quot, rem);
+        return;
+    }
 
-    while (exp != 0)
+    unsigned n = ListLen(p->l), k = 0;
+    Mono *qm = malloc(2 * n * sizeof(Mono)), *rm = qm + n;
+    assert(qm != NULL);
+
+    for (ListIter it = ListIterBegin(p->l); it.n != NULL; ListIterNext(&it), k++)
     {
-        if (exp & 1)
+        Poly c = ListIterCoeff(&it), q, r;
+
+        PolyDivInner(&c, var + 1, vars, d, &q, &r);
+        qm[k] = MonoFromPoly(&q, ListIterExp(&it));
+        rm[k] = MonoFromPoly(&r, ListIterExp(&it));
+    }
+
+    *quot = PolyAddMonos(k, qm);
+    *rem = PolyAddMonos(k, rm);
+
+    free(qm);
+}
+
+bool PolyDivRem(const Poly *p, const Poly *q, Poly *quot, Poly *rem)
+{
+    Poly tp, tq;
+    const Poly *vp = PolyListView(p, &tp), *vq = PolyListView(q, &tq);
+    PolyDivisor d;
+    bool res = PolyDivisorInit(&d, vq);
+    unsigned vars = DistVars(vp);
+
+    if (res && vars <= 1)
+    {
+        PolyDivLeaf(vp, &d, quot, rem);
+    }
+    else if (res)
+    {
+        /* x_0 staje się ostatnią zmienną, a po dzieleniu wraca na miejsce. */
+        unsigned *perm = malloc(2 * vars * sizeof(unsigned)), *back = perm + vars;
+        assert(perm != NULL);
+
+        for (unsigned i = 0; i < vars; i++)
         {
-            tmp = PolyMul(&res, &q);
-            PolyDestroy(&res);
-            res = tmp;
+            perm[i] = i == 0 ? vars - 1 : i - 1;
+            back[i] = i + 1 == vars ? 0 : i + 1;
         }
-        exp >>= 1;
-        tmp = PolyMul(&q, &q);
-        PolyDestroy(&q);
-        q = tmp;
+
+        Poly t = ReorderPermute(vp, vars, perm), tquot, trem;
+
+        PolyDivInner(&t, 0, vars, &d, &tquot, &trem);
+        *quot = ReorderPermute(&tquot, vars, back);
+        *rem = ReorderPermute(&trem, vars, back);
+
+        PolyDestroy(&t);
+        PolyDestroy(&tquot);
+        PolyDestroy(&trem);
+        free(perm);
     }
 
-    PolyDestroy(&q);
+    if (res)
+    {
+        *quot = PolyShare(*quot);
+        *rem = PolyShare(*rem);
+        PolyDivisorDestroy(&d);
+    }
+
+    PolyListViewDone(vp, &tp);
+    PolyListViewDone(vq, &tq);
 
     return res;
 }
 
-Poly PolyCompose(const Poly *p, unsigned count, const Poly x[])
+bool PolyDivExact(const Poly *p, const Poly *q, Poly *quot)
+{
+    Poly rem;
+
+    if (!PolyDivRem(p, q, quot, &rem))
+        return false;
+
+    bool res = PolyIsZero(&rem);
+
+    PolyDestroy(&rem);
+    if (!res)
+        PolyDestroy(quot);
+
+    return res;
+}
+
+bool PolyGcd(const Poly *p, const Poly *q, Poly *g)
+{
+    Poly tp, tq;
+    const Poly *vp = PolyListView(p, &tp), *vq = PolyListView(q, &tq);
+    bool res = GcdCompute(vp, vq, g);
+
+    if (res)
+        *g = PolyShare(*g);
+
+    PolyListViewDone(vp, &tp);
+    PolyListViewDone(vq, &tq);
+
+    return res;
+}
+
+/**
+ * Składa wielomiany, z których żaden nie jest w drzewie.
+ * @param[in] p : wielomian
+ * @param[in] count : liczba wielomianów
+ * @param[in] x : tablica wielomianów
+ * @return @f$p(x[0], x[1], \ldots, x[count - 1], 0, 0, \ldots, 0)@f$
+ */
+static Poly PolyComposeList(const Poly *p, unsigned count, const Poly x[])
 {
     if (count == 0)
     {
@@ -589,10 +4547,12 @@ Poly PolyCompose(const Poly *p, unsigned count, const Poly x[])
         else
         {
             Poly tmp1, tmp2, tmp3, tmp4, res = PolyZero();
-            for (Node *ptr = p->l; ptr != NULL; ptr = ptr->next)
+            for (ListIter it = ListIterBegin(p->l); it.n != NULL;
+                 ListIterNext(&it))
             {
-                tmp1 = PolyCompose(&ptr->m.p, count - 1, x + 1);
-                tmp2 = PolyPower(&x[0], ptr->m.exp);
+                Poly c = ListIterCoeff(&it);
+                tmp1 = PolyComposeList(&c, count - 1, x + 1);
+                tmp2 = PolyPow(&x[0], ListIterExp(&it));
                 tmp3 = PolyMul(&tmp1, &tmp2);
                 tmp4 = res;
                 res = PolyAdd(&tmp3, &tmp4);
@@ -605,3 +4565,28 @@ Poly PolyCompose(const Poly *p, unsigned count, const Poly x[])
         }
     }
 }
+
+Poly PolyCompose(const Poly *p, unsigned count, const Poly x[])
+{
+    bool trees = PolyIsTree(p);
+
+    for (unsigned i = 0; i < count && !trees; i++)
+        trees = PolyIsTree(&x[i]);
+
+    if (!trees)
+        return PolyComposeList(p, count, x);
+
+    Poly tp, *xs = calloc(count + 1, sizeof(Poly));
+    assert(xs != NULL);
+    const Poly *vp = PolyListView(p, &tp);
+
+    for (unsigned i = 0; i < count; i++)
+        xs[i] = PolyToList(&x[i]);
+
+    Poly res = PolyComposeList(vp, count, xs);
+
+    PolyListViewDone(vp, &tp);
+    PolyArrayDestroy(count, xs);
+
+    return res;
+}
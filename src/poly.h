@@ -13,6 +13,7 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <limits.h>
+#include <stdint.h>
 
 /** Maksymalny stopien jednomianu */
 #define POLY_EXP_MAX INT_MAX
@@ -20,6 +21,28 @@
 /** Maksymalny stopien dla DEG_BY */
 #define POLY_DEG_MAX UINT_MAX
 
+#ifndef POLY_COEFF_BITS
+/**
+ * Szerokość współczynników w bitach, 32 albo 64.
+ * Biblioteka jest kompilowana osobno dla każdej szerokości, więc węższe
+ * współczynniki nie płacą za szerszy typ.
+ */
+#define POLY_COEFF_BITS 64
+#endif
+
+#if POLY_COEFF_BITS == 32
+
+/** Maksywalna wartość współczynnika */
+#define POLY_COEFF_MAX INT32_MAX
+
+/** Minimalna wartość współczynnika */
+#define POLY_COEFF_MIN INT32_MIN
+
+/** Typ współczynników wielomianu */
+typedef int32_t poly_coeff_t;
+
+#elif POLY_COEFF_BITS == 64
+
 /** Maksywalna wartość współczynnika */
 #define POLY_COEFF_MAX LONG_MAX
 
@@ -29,6 +52,10 @@
 /** Typ współczynników wielomianu */
 typedef long poly_coeff_t;
 
+#else
+#error "POLY_COEFF_BITS must be 32 or 64"
+#endif
+
 /** Typ wykładników wielomianu */
 typedef int poly_exp_t;
 
@@ -60,6 +87,11 @@ typedef struct Mono
 
 /**
  * Struktura przchowująca element listy jednomianów.
+ * Element jest pojedynczym jednomianem albo nagłówkiem bloku gęstego
+ * (wtedy `m.exp == NODE_BLOCK`, patrz `Block`) lub liścia
+ * (wtedy `m.exp == NODE_LEAF`, patrz `Leaf`). Wielomian zapisany
+ * w trwałym drzewie wyrazów (patrz `PolyToTree`) ma listę złożoną z jednego
+ * elementu, dla którego `m.exp == NODE_TREE`.
  */
 typedef struct Node
 {
@@ -67,6 +99,56 @@ typedef struct Node
     struct Node *next; ///< następny jednomian
 } Node;
 
+/** Wykładnik w nagłówku elementu listy oznaczający blok gęsty */
+#define NODE_BLOCK (-1)
+
+/** Wykładnik w nagłówku elementu listy oznaczający liść */
+#define NODE_LEAF (-2)
+
+/** Wykładnik w nagłówku elementu listy oznaczający trwałe drzewo wyrazów */
+#define NODE_TREE (-3)
+
+/**
+ * Blok gęsty: ciąg wyrazów o kolejnych wykładnikach
+ * `start, start + 1, ..., start + len - 1` i stałych współczynnikach.
+ * Pierwszy i ostatni współczynnik są niezerowe, wewnątrz bloku mogą
+ * wystąpić krótkie przerwy zerowych współczynników.
+ * Blok jest elementem listy jednomianów: zaczyna się nagłówkiem `Node`
+ * i jest alokowany razem ze współczynnikami.
+ */
+typedef struct Block
+{
+    Node node; ///< nagłówek elementu listy, `node.m.exp == NODE_BLOCK`
+    poly_exp_t start; ///< wykładnik pierwszego wyrazu
+    unsigned len; ///< liczba wyrazów
+    poly_coeff_t coeffs[]; ///< współczynniki kolejnych wyrazów
+} Block;
+
+/**
+ * Liść: ciąg wyrazów o stałych, niezerowych współczynnikach i rosnących,
+ * dowolnie odległych wykładnikach.
+ * Współczynniki i wykładniki są przechowywane w równoległych tablicach
+ * (12 bajtów na wyraz); tablica wykładników leży zaraz za tablicą
+ * współczynników, w tej samej alokacji co nagłówek `Node`.
+ */
+typedef struct Leaf
+{
+    Node node; ///< nagłówek elementu listy, `node.m.exp == NODE_LEAF`
+    unsigned len; ///< liczba wyrazów
+    poly_coeff_t coeffs[]; ///< współczynniki, a za nimi `len` wykładników
+} Leaf;
+
+/**
+ * Iterator po niezerowych wyrazach listy jednomianów.
+ * Przechodzi zarówno po pojedynczych jednomianach, jak i po wyrazach
+ * bloków gęstych i liści.
+ */
+typedef struct ListIter
+{
+    const Node *n; ///< bieżący element listy
+    unsigned i; ///< indeks wyrazu w bloku gęstym
+} ListIter;
+
 /**
  * Tworzy wielomian, który jest współczynnikiem.
  * @param[in] c : wartość współczynnika
@@ -118,6 +200,149 @@ static inline bool PolyIsZero(const Poly *p)
     return PolyIsCoeff(p) && p->c == 0;
 }
 
+/**
+ * Sprawdza, czy element listy jest blokiem gęstym.
+ * @param[in] n : element listy
+ * @return Czy element jest blokiem gęstym?
+ */
+static inline bool NodeIsBlock(const Node *n)
+{
+    return n->m.exp == NODE_BLOCK;
+}
+
+/**
+ * Daje blok gęsty, którego nagłówkiem jest element listy.
+ * @param[in] n : element listy będący blokiem gęstym
+ * @return blok gęsty
+ */
+static inline const Block* NodeBlock(const Node *n)
+{
+    return (const Block *)n;
+}
+
+/**
+ * Sprawdza, czy element listy jest liściem.
+ * @param[in] n : element listy
+ * @return Czy element jest liściem?
+ */
+static inline bool NodeIsLeaf(const Node *n)
+{
+    return n->m.exp == NODE_LEAF;
+}
+
+/**
+ * Sprawdza, czy element listy jest trwałym drzewem wyrazów.
+ * @param[in] n : element listy
+ * @return Czy element jest drzewem?
+ */
+static inline bool NodeIsTree(const Node *n)
+{
+    return n->m.exp == NODE_TREE;
+}
+
+/**
+ * Sprawdza, czy wielomian jest zapisany w trwałym drzewie wyrazów.
+ * @param[in] p : wielomian
+ * @return Czy wielomian jest drzewem?
+ */
+static inline bool PolyIsTree(const Poly *p)
+{
+    return !PolyIsCoeff(p) && NodeIsTree(p->l);
+}
+
+/**
+ * Daje liść, którego nagłówkiem jest element listy.
+ * @param[in] n : element listy będący liściem
+ * @return liść
+ */
+static inline const Leaf* NodeLeaf(const Node *n)
+{
+    return (const Leaf *)n;
+}
+
+/**
+ * Daje tablicę wykładników liścia.
+ * @param[in] l : liść
+ * @return wykładniki
+ */
+static inline const poly_exp_t* LeafExps(const Leaf *l)
+{
+    return (const poly_exp_t *)(l->coeffs + l->len);
+}
+
+/**
+ * Tworzy iterator ustawiony na pierwszym wyrazie listy.
+ * @param[in] l : lista jednomianów
+ * @return iterator
+ */
+static inline ListIter ListIterBegin(const Node *l)
+{
+    return (ListIter) {.n = l, .i = 0};
+}
+
+/**
+ * Daje wykładnik bieżącego wyrazu.
+ * @param[in] it : iterator
+ * @return wykładnik
+ */
+static inline poly_exp_t ListIterExp(const ListIter *it)
+{
+    switch (it->n->m.exp)
+    {
+        case NODE_BLOCK:
+            return NodeBlock(it->n)->start + (poly_exp_t)it->i;
+        case NODE_LEAF:
+            return LeafExps(NodeLeaf(it->n))[it->i];
+        default:
+            return it->n->m.exp;
+    }
+}
+
+/**
+ * Daje współczynnik bieżącego wyrazu.
+ * Wynik nie jest kopią: nie wolno go usuwać ani modyfikować.
+ * @param[in] it : iterator
+ * @return współczynnik
+ */
+static inline Poly ListIterCoeff(const ListIter *it)
+{
+    switch (it->n->m.exp)
+    {
+        case NODE_BLOCK:
+            return (Poly) {.c = NodeBlock(it->n)->coeffs[it->i], .l = NULL};
+        case NODE_LEAF:
+            return (Poly) {.c = NodeLeaf(it->n)->coeffs[it->i], .l = NULL};
+        default:
+            return it->n->m.p;
+    }
+}
+
+/**
+ * Przesuwa iterator na następny niezerowy wyraz.
+ * @param[in,out] it : iterator
+ */
+static inline void ListIterNext(ListIter *it)
+{
+    if (NodeIsBlock(it->n))
+    {
+        const Block *b = NodeBlock(it->n);
+
+        do
+            it->i++;
+        while (it->i < b->len && b->coeffs[it->i] == 0);
+
+        if (it->i < b->len)
+            return;
+    }
+    else if (NodeIsLeaf(it->n) && ++it->i < NodeLeaf(it->n)->len)
+    {
+        return;
+    }
+
+    it->n = it->n->next;
+    it->i = 0;
+}
+
 /**
  * Usuwa wielomian z pamięci.
  * @param[in] p : wielomian
@@ -158,6 +383,16 @@ static inline Mono MonoClone(const Mono *m)
  */
 Poly PolyAdd(const Poly *p, const Poly *q);
 
+/**
+ * Sumuje wiele wielomianów jednym scalaniem @p count list, bez sum
+ * częściowych. Składniki wskazane w @p neg są odejmowane.
+ * @param[in] count : liczba składników
+ * @param[in] ps : składniki
+ * @param[in] neg : które składniki odjąć albo `NULL`, gdy wszystkie dodać
+ * @return @f$\sum_i \pm ps[i]@f$
+ */
+Poly PolyAddAll(unsigned count, const Poly ps[], const bool neg[]);
+
 /**
  * Sumuje listę jednomianów i tworzy z nich wielomian.
  * Przejmuje na własność zawartość tablicy @p monos.
@@ -175,6 +410,164 @@ Poly PolyAddMonos(unsigned count, const Mono monos[]);
  */
 Poly PolyMul(const Poly *p, const Poly *q);
 
+/**
+ * Mnoży wiele wielomianów w drzewie iloczynów zrównoważonym według liczby
+ * wyrazów: na każdym poziomie mnożone są parami czynniki podobnej
+ * wielkości, a duże mnożenia jednego poziomu wykonywane są równolegle.
+ * Gdy iloczyny pośrednie wypełniłyby przestrzeń wykładników (rzadkie
+ * czynniki), czynniki są mnożone kolejno od najmniejszego.
+ * @param[in] count : liczba czynników
+ * @param[in] ps : czynniki
+ * @return iloczyn czynników (1 dla @p count równego 0)
+ */
+Poly PolyMulAll(unsigned count, const Poly ps[]);
+
+/**
+ * Liczy `p * q + r` bez osobnego iloczynu: iloczyny wyrazów trafiają
+ * od razu do scalania z wyrazami @p r, na każdym poziomie zagnieżdżenia
+ * współczynników. Dla @p r w drzewie wynik też jest w drzewie.
+ * @param[in] p : wielomian
+ * @param[in] q : wielomian
+ * @param[in] r : wielomian
+ * @return `p * q + r`
+ */
+Poly PolyFma(const Poly *p, const Poly *q, const Poly *r);
+
+/**
+ * Jak `PolyFma`, ale przejmuje @p r na własność i używa jego pamięci:
+ * jednomiany @p r przechodzą do wyniku bez kopiowania, a drzewo, do którego
+ * @p r ma jedyne odwołanie, jest zmieniane w miejscu.
+ * @param[in] p : wielomian
+ * @param[in] q : wielomian
+ * @param[in] r : wielomian, przejmowany na własność
+ * @return `p * q + r`
+ */
+Poly PolyFmaTake(const Poly *p, const Poly *q, Poly *r);
+
+/**
+ * Podnosi wielomian do kwadratu. Iloczyn każdej pary różnych wyrazów jest
+ * liczony raz i podwajany, więc wykonuje około połowy mnożeń `PolyMul`.
+ * @param[in] p : wielomian
+ * @return `p * p`
+ */
+Poly PolySqr(const Poly *p);
+
+/**
+ * Podnosi wielomian do potęgi. Jednomian potęguje wprost, a dwa albo trzy
+ * wyrazy na najwyższym poziomie rozwija wzorem dwumianowym, gdy
+ * współczynniki dwumianowe dają się wyznaczyć w bieżącej arytmetyce.
+ * W pozostałych przypadkach wybiera podnoszenie do kwadratu albo mnożenie
+ * kolejno przez podstawę według szacowanej liczby iloczynów wyrazów.
+ * @param[in] p : wielomian
+ * @param[in] exp : wykładnik, nieujemny
+ * @return @f$p^{exp}@f$
+ */
+Poly PolyPow(const Poly *p, poly_exp_t exp);
+
+/**
+ * Ograniczenia stopni szeregu potęgowego: wyrazy, w których któraś zmienna
+ * ma wykładnik większy od swojego ograniczenia albo stopień całkowity jest
+ * większy od ograniczenia całkowitego, są pomijane.
+ */
+typedef struct PolyBound
+{
+    unsigned vars; ///< długość tablicy `max`; dalsze zmienne są nieograniczone
+    const poly_exp_t *max; ///< ograniczenia kolejnych zmiennych, ujemne oznacza brak
+    poly_exp_t total; ///< ograniczenie stopnia całkowitego, ujemne oznacza brak
+} PolyBound;
+
+/**
+ * Obcina wielomian do wyrazów mieszczących się w ograniczeniach.
+ * @param[in] p : wielomian
+ * @param[in] b : ograniczenia
+ * @return obcięty wielomian
+ */
+Poly PolyTrunc(const Poly *p, const PolyBound *b);
+
+/**
+ * Dodaje wielomiany obcięte do ograniczeń.
+ * @param[in] p : wielomian
+ * @param[in] q : wielomian
+ * @param[in] b : ograniczenia
+ * @return obcięta suma `p + q`
+ */
+Poly PolyAddTrunc(const Poly *p, const Poly *q, const PolyBound *b);
+
+/**
+ * Mnoży wielomiany obcięte do ograniczeń. Iloczyny wyrazów o wykładniku
+ * przekraczającym ograniczenie nie są tworzone na żadnym poziomie
+ * zagnieżdżenia.
+ * @param[in] p : wielomian
+ * @param[in] q : wielomian
+ * @param[in] b : ograniczenia
+ * @return obcięty iloczyn `p * q`
+ */
+Poly PolyMulTrunc(const Poly *p, const Poly *q, const PolyBound *b);
+
+/**
+ * Mnoży wiele wielomianów jak `PolyMulAll`, obcinając każdy iloczyn
+ * do ograniczeń.
+ * @param[in] count : liczba czynników
+ * @param[in] ps : czynniki
+ * @param[in] b : ograniczenia
+ * @return obcięty iloczyn czynników
+ */
+Poly PolyMulAllTrunc(unsigned count, const Poly ps[], const PolyBound *b);
+
+/**
+ * Podnosi wielomian do potęgi, obcinając każdy iloczyn pośredni.
+ * @param[in] p : wielomian
+ * @param[in] exp : wykładnik, nieujemny
+ * @param[in] b : ograniczenia
+ * @return obcięta potęga @f$p^{exp}@f$
+ */
+Poly PolyPowTrunc(const Poly *p, poly_exp_t exp, const PolyBound *b);
+
+/**
+ * Dzieli wielomian z resztą przez wielomian zmiennej @f$x_0@f$ o stałych
+ * współczynnikach i odwracalnym współczynniku wiodącym (zob.
+ * `CoeffInverse`). Współczynniki dzielnej mogą być wielomianami.
+ * Duże dzielenia liczy przez odwrotność szeregu metodą Newtona, małe
+ * i gęste metodą szkolną.
+ * @param[in] p : dzielna
+ * @param[in] q : dzielnik
+ * @param[out] quot : iloraz
+ * @param[out] rem : reszta stopnia względem @f$x_0@f$ mniejszego niż @p q
+ * @return czy dzielnik jest dopuszczalny; wpp @p quot i @p rem są nieustawione
+ */
+bool PolyDivRem(const Poly *p, const Poly *q, Poly *quot, Poly *rem);
+
+/**
+ * Dzieli wielomian przez wielomian zmiennej @f$x_0@f$ tak jak `PolyDivRem`,
+ * sprawdzając, czy reszta jest zerowa.
+ * @param[in] p : dzielna
+ * @param[in] q : dzielnik
+ * @param[out] quot : iloraz
+ * @return czy dzielnik jest dopuszczalny i dzieli @p p; wpp @p quot jest
+ * nieustawiony
+ */
+bool PolyDivExact(const Poly *p, const Poly *q, Poly *quot);
+
+/**
+ * Wyznacza największy wspólny dzielnik wielomianów metodą modularną.
+ * Bez modułu liczy w pierścieniu wielomianów o współczynnikach
+ * całkowitych: NWD obrazów modulo duże liczby pierwsze, liczone
+ * równolegle, są sklejane chińskim twierdzeniem o resztach i sprawdzane
+ * dzieleniem próbnym; wynik ma dodatni współczynnik wiodący w porządku
+ * leksykograficznym, w którym najważniejsza jest zmienna @f$x_0@f$.
+ * Modulo liczba pierwsza wynik ma współczynnik wiodący 1.
+ * NWD wielomianów wielu zmiennych jest odtwarzany interpolacją z NWD
+ * wartości w punktach, liczonych równolegle. NWD dwóch zer to zero.
+ * @param[in] p : wielomian
+ * @param[in] q : wielomian
+ * @param[out] g : NWD
+ * @return czy NWD udało się wyznaczyć: nie udaje się modulo liczba
+ * złożona, modulo liczba pierwsza mniejsza od potrzebnej liczby punktów
+ * interpolacji oraz bez modułu, gdy obrazy NWD nie dają się skleić
+ * w zakresie `poly_coeff_t`; wpp @p g jest nieustawiony
+ */
+bool PolyGcd(const Poly *p, const Poly *q, Poly *g);
+
 /**
  * Zwraca przeciwny wielomian.
  * @param[in] p : wielomian
@@ -218,6 +611,20 @@ poly_exp_t PolyDeg(const Poly *p);
  */
 bool PolyIsEq(const Poly *p, const Poly *q);
 
+/**
+ * Sprawdza równość dwóch wielomianów probabilistycznie, bez liczenia
+ * różnicy. Porównuje wartości wielomianów w kilku losowych punktach
+ * modulo @f$2^{61} - 1@f$, każdą liczoną jednym przejściem po wyrazach;
+ * dla dużych wielomianów punkty są sprawdzane równolegle. Wynik `false` jest
+ * zawsze prawdziwy, a równe wielomiany zawsze dają `true`; różne
+ * wielomiany stopnia łącznego @f$d@f$ dają `true` z prawdopodobieństwem
+ * nie większym niż @f$((d + 1) / (2^{61} - 1))^4@f$.
+ * @param[in] p : wielomian
+ * @param[in] q : wielomian
+ * @return `p = q` z dużym prawdopodobieństwem
+ */
+bool PolyIsEqFast(const Poly *p, const Poly *q);
+
 /**
  * Wylicza wartość wielomianu w punkcie @p x.
  * Wstawia pod pierwszą zmienną wielomianu wartość @p x.
@@ -231,6 +638,148 @@ bool PolyIsEq(const Poly *p, const Poly *q);
  */
 Poly PolyAt(const Poly *p, poly_coeff_t x);
 
+/**
+ * Sprawdza, czy od poprzedniego wywołania wynik którejś operacji na
+ * współczynnikach wyszedł poza zakres `poly_coeff_t`, i zeruje ten znacznik.
+ * Współczynniki są zawsze liczone modulo @f$2^b@f$, gdzie @f$b@f$ to
+ * `POLY_COEFF_BITS` (64 albo 32); znacznik mówi, że
+ * wynik może różnić się od dokładnego. Zapala go także przepełnienie sumy
+ * częściowej, nawet gdy ostateczna suma mieści się w zakresie.
+ * @return czy nastąpiło przepełnienie
+ */
+bool PolyCoeffOverflow(void);
+
+/**
+ * Ustawia moduł arytmetyki współczynników.
+ * Dla @p p różnego od zera wszystkie operacje liczą modulo @p p i zakładają,
+ * że współczynniki argumentów są resztami z przedziału @f$[0, p)@f$;
+ * wielomiany utworzone wcześniej trzeba sprowadzić `PolyCoeffReduce`.
+ * Moduł 0 przywraca liczenie modulo @f$2^b@f$, gdzie @f$b@f$ to
+ * `POLY_COEFF_BITS`. Moduł jest ustawiany dla bieżącego wątku.
+ * @param[in] p : moduł, 0 albo od 2 do `POLY_COEFF_MAX`, czyli mniejszy niż
+ * @f$2^{63}@f$ (@f$2^{31}@f$ dla 32-bitowych współczynników)
+ */
+void PolyCoeffModSet(poly_coeff_t p);
+
+/**
+ * Daje bieżący moduł arytmetyki współczynników.
+ * @return moduł albo 0, gdy współczynniki są liczone modulo @f$2^b@f$,
+ * gdzie @f$b@f$ to `POLY_COEFF_BITS`
+ */
+poly_coeff_t PolyCoeffMod(void);
+
+/**
+ * Sprowadza współczynniki wielomianu do reszt modulo bieżący moduł,
+ * pomijając jednomiany, które stały się zerowe.
+ * @param[in] p : wielomian
+ * @return wielomian o współczynnikach w postaci kanonicznej
+ */
+Poly PolyCoeffReduce(const Poly *p);
+
+/**
+ * Daje liczbę procesorów, na które biblioteka dzieli obliczenia równoległe.
+ * Liczba procesorów systemu jest odczytywana raz, przy pierwszym wywołaniu
+ * z któregokolwiek wątku.
+ * @return liczba procesorów, co najmniej 1
+ */
+unsigned PolyCpuCount(void);
+
+/**
+ * Ustawia liczbę procesorów, na które biblioteka dzieli obliczenia
+ * równoległe, zamiast liczby procesorów systemu. Nie wolno jej zmieniać
+ * w trakcie obliczeń innych wątków.
+ * @param[in] n : liczba procesorów albo 0, by wrócić do liczby z systemu
+ */
+void PolyCpuCountSet(unsigned n);
+
+/** Statystyki pamięci tablicy unikalnych wielomianów */
+typedef struct PolyInternStats
+{
+    size_t lists; ///< liczba różnych list jednomianów w tablicy
+    size_t refs; ///< liczba odwołań do list spoza tablicy
+    size_t bytes; ///< pamięć elementów list w tablicy
+    double tree_bytes; ///< pamięć, jaką zajęłyby te odwołania bez współdzielenia
+} PolyInternStats;
+
+/**
+ * Włącza albo wyłącza tablicę unikalnych wielomianów.
+ * Gdy jest włączona, wyniki operacji są składane z list przechowywanych
+ * w tablicy: identyczne poddrzewa współczynników istnieją w pamięci raz,
+ * kopiowanie ich tylko zwiększa licznik odwołań, a porównanie dwóch
+ * wielomianów z tablicy to porównanie wskaźników.
+ * Wielomiany utworzone wcześniej można wstawić do tablicy `PolyIntern`.
+ * @param[in] on : czy tablica ma być włączona
+ */
+void PolyInternSet(bool on);
+
+/**
+ * Daje wielomian równy @p p, złożony z list z tablicy unikalnych wielomianów.
+ * @param[in] p : wielomian
+ * @return wielomian współdzielący listy z tablicy
+ */
+Poly PolyIntern(const Poly *p);
+
+/**
+ * Daje statystyki pamięci tablicy unikalnych wielomianów.
+ * @return statystyki
+ */
+PolyInternStats PolyInternReport(void);
+
+/**
+ * Daje wielomian równy @p p, którego wyrazy najwyższego poziomu są zapisane
+ * w trwałym drzewie. Dodanie do takiego wielomianu wielomianu o @f$k@f$
+ * wyrazach kosztuje @f$O(k \log n)@f$ zamiast @f$O(n + k)@f$, a suma
+ * współdzieli niezmienione węzły drzewa z argumentem, więc kopiowanie
+ * i poprzednie wersje wielomianu pozostają tanie. Suma, różnica i wielomian
+ * przeciwny wielomianu w drzewie są zapisane w drzewie; pozostałe operacje
+ * działają na jego postaci listowej i dają zwykłe wielomiany.
+ * Stała pozostaje stałą.
+ * @param[in] p : wielomian
+ * @return wielomian w drzewie
+ */
+Poly PolyToTree(const Poly *p);
+
+/**
+ * Daje wielomian równy @p p zapisany w listach jednomianów.
+ * @param[in] p : wielomian
+ * @return wielomian bez drzewa
+ */
+Poly PolyToList(const Poly *p);
+
+/**
+ * Daje liczbę zmiennych wielomianu, czyli głębokość zagnieżdżenia jego
+ * współczynników (0 dla stałej).
+ * @param[in] p : wielomian
+ * @return liczba zmiennych
+ */
+unsigned PolyVars(const Poly *p);
+
+/**
+ * Przenumerowuje zmienne wielomianu: zmienna @f$x_i@f$ staje się zmienną
+ * @f$x_{perm[i]}@f$. Zmienne o indeksach co najmniej @p count zachowują
+ * swoje indeksy.
+ * @param[in] p : wielomian
+ * @param[in] count : długość permutacji
+ * @param[in] perm : permutacja zbioru @f$\{0, \ldots, count - 1\}@f$
+ * @return wielomian o przenumerowanych zmiennych
+ */
+Poly PolyPermute(const Poly *p, unsigned count, const unsigned perm[]);
+
+/**
+ * Wybiera kolejność zmiennych, przy której wielomiany zajmują najmniej
+ * elementów list, np. przed długim ciągiem mnożeń lub złożeń.
+ * Kolejność jest wybierana zachłannie od zmiennej zewnętrznej: na każdym
+ * poziomie ta zmienna, która daje najmniej elementów list. Wielomiany
+ * trzeba potem przenumerować `PolyPermute(p, vars, perm)`, a wyniki
+ * przywrócić do pierwotnych zmiennych permutacją odwrotną.
+ * @param[in] count : liczba wielomianów
+ * @param[in] ps : wielomiany
+ * @param[in] vars : liczba zmiennych, co najmniej `PolyVars` każdego z nich
+ * @param[out] perm : nowe indeksy zmiennych @f$x_0, \ldots, x_{vars - 1}@f$
+ */
+void PolyReorderChoose(unsigned count, const Poly ps[], unsigned vars,
+                       unsigned perm[]);
+
 /**
  * Usuwa tablicę wielomianów z pamięci.
  * @param[in] count : liczba wielomianów
@@ -0,0 +1,317 @@
+/** @file
+    Implementacja przenumerowywania zmiennych wielomianów
+
+    @author Aliaksandr Sarokin <as372525@students.mimuw.edu.pl>
+    @copyright Uniwersytet Warszawski
+    @date 2017-06-03
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <stdint.h>
+
+#include "reorder.h"
+#include "utils.h"
+
+/** Wyrazy wielomianów zapisane jako wiersze wykładników */
+typedef struct ReorderRows
+{
+    unsigned vars; ///< liczba wykładników w wierszu
+    size_t len; ///< liczba wyrazów
+    size_t cap; ///< pojemność tablic
+    poly_exp_t *exps; ///< wiersze wykładników, kolejno dla każdego wyrazu
+    poly_coeff_t *coeffs; ///< niezerowe współczynniki wyrazów
+} ReorderRows;
+
+/** Klucz sortowania wyrazu */
+typedef struct ReorderKey
+{
+    uint64_t key; ///< wykładnik albo para numer klasy i wykładnik
+    size_t row; ///< numer wyrazu
+} ReorderKey;
+
+/**
+ * Porównuje klucze sortowania.
+ * @param[in] a : klucz
+ * @param[in] b : klucz
+ * @return wynik porównania dla `qsort`
+ */
+static int ReorderKeyCompare(const void *a, const void *b)
+{
+    uint64_t x = ((const ReorderKey *)a)->key, y = ((const ReorderKey *)b)->key;
+
+    return (x > y) - (x < y);
+}
+
+/**
+ * Dopisuje wyraz, przenumerowując jego zmienne.
+ * @param[in,out] r : wiersze
+ * @param[in] cur : wykładniki zmiennych zewnętrznych
+ * @param[in] depth : liczba zmiennych zewnętrznych
+ * @param[in] c : współczynnik
+ * @param[in] perm : nowe indeksy zmiennych albo `NULL`
+ */
+static void RowsPush(ReorderRows *r, const poly_exp_t cur[], unsigned depth,
+                     poly_coeff_t c, const unsigned perm[])
+{
+    if (r->len == r->cap)
+    {
+        r->cap = r->cap == 0 ? 16 : 2 * r->cap;
+        r->exps = realloc(r->exps, r->cap * r->vars * sizeof(poly_exp_t));
+        r->coeffs = realloc(r->coeffs, r->cap * sizeof(poly_coeff_t));
+        assert((r->exps != NULL || r->vars == 0) && r->coeffs != NULL);
+    }
+
+    poly_exp_t *row = r->exps + r->len * r->vars;
+
+    memset(row, 0, r->vars * sizeof(poly_exp_t));
+    for (unsigned v = 0; v < depth; v++)
+        row[perm == NULL ? v : perm[v]] = cur[v];
+    r->coeffs[r->len++] = c;
+}
+
+/**
+ * Dopisuje wyrazy wielomianu będącego współczynnikiem jednomianu
+ * zmiennych zewnętrznych.
+ * @param[in,out] r : wiersze
+ * @param[in] p : wielomian
+ * @param[in,out] cur : wykładniki zmiennych zewnętrznych
+ * @param[in] depth : liczba zmiennych zewnętrznych
+ * @param[in] perm : nowe indeksy zmiennych albo `NULL`
+ */
+static void RowsCollect(ReorderRows *r, const Poly *p, poly_exp_t cur[],
+                        unsigned depth, const unsigned perm[])
+{
+    if (PolyIsCoeff(p))
+    {
+        if (p->c != 0)
+            RowsPush(r, cur, depth, p->c, perm);
+        return;
+    }
+
+    for (ListIter it = ListIterBegin(p->l); it.n != NULL; ListIterNext(&it))
+    {
+        Poly c = ListIterCoeff(&it);
+
+        cur[depth] = ListIterExp(&it);
+        RowsCollect(r, &c, cur, depth + 1, perm);
+    }
+}
+
+/**
+ * Zapisuje wyrazy wielomianu jako wiersze.
+ * @param[in,out] r : wiersze
+ * @param[in] p : wielomian
+ * @param[in] perm : nowe indeksy zmiennych albo `NULL`
+ */
+static void RowsAdd(ReorderRows *r, const Poly *p, const unsigned perm[])
+{
+    poly_exp_t *cur = malloc((r->vars + 1) * sizeof(poly_exp_t));
+    assert(cur != NULL);
+
+    RowsCollect(r, p, cur, 0, perm);
+
+    free(cur);
+}
+
+/**
+ * Usuwa wiersze z pamięci.
+ * @param[in] r : wiersze
+ */
+static void RowsDestroy(ReorderRows *r)
+{
+    free(r->exps);
+    free(r->coeffs);
+}
+
+/**
+ * Daje wykładnik zmiennej w wierszu.
+ * @param[in] r : wiersze
+ * @param[in] row : numer wyrazu
+ * @param[in] var : indeks zmiennej
+ * @return wykładnik
+ */
+static inline poly_exp_t RowsExp(const ReorderRows *r, size_t row, unsigned var)
+{
+    return r->exps[row * r->vars + var];
+}
+
+/**
+ * Składa wielomian nad zmienną @p var z wyrazów o wspólnych wykładnikach
+ * zmiennych zewnętrznych, rozdzielając je do kubełków według wykładnika
+ * zmiennej @p var.
+ * @param[in] r : wiersze
+ * @param[in,out] idx : numery wyrazów, porządkowane według wykładników
+ * @param[in] n : liczba wyrazów
+ * @param[in] var : indeks zmiennej
+ * @param[in] keys : bufor na co najmniej @p n kluczy
+ * @return wielomian
+ */
+static Poly RowsBuild(const ReorderRows *r, size_t idx[], size_t n,
+                      unsigned var, ReorderKey keys[])
+{
+    if (n == 0)
+        return PolyZero();
+
+    if (var == r->vars)
+        return PolyFromCoeff(r->coeffs[idx[0]]);
+
+    bool sorted = true;
+    size_t groups = 1;
+
+    for (size_t i = 1; i < n; i++)
+        sorted &= RowsExp(r, idx[i - 1], var) <= RowsExp(r, idx[i], var);
+
+    /* Przy zachowanej kolejności zmiennych wyrazy są już posortowane. */
+    if (!sorted)
+    {
+        for (size_t i = 0; i < n; i++)
+            keys[i] = (ReorderKey) {.key = (uint64_t)RowsExp(r, idx[i], var),
+                                    .row = idx[i]};
+        qsort(keys, n, sizeof(ReorderKey), ReorderKeyCompare);
+        for (size_t i = 0; i < n; i++)
+            idx[i] = keys[i].row;
+    }
+
+    for (size_t i = 1; i < n; i++)
+        groups += RowsExp(r, idx[i - 1], var) != RowsExp(r, idx[i], var);
+
+    Mono *monos = malloc(groups * sizeof(Mono));
+    assert(monos != NULL);
+    unsigned k = 0;
+
+    for (size_t i = 0, j; i < n; i = j)
+    {
+        poly_exp_t e = RowsExp(r, idx[i], var);
+
+        for (j = i + 1; j < n && RowsExp(r, idx[j], var) == e; j++)
+            ;
+
+        Poly c = RowsBuild(r, idx + i, j - i, var + 1, keys);
+        monos[k++] = MonoFromPoly(&c, e);
+    }
+
+    Poly res = PolyAddMonos(k, monos);
+
+    free(monos);
+
+    return res;
+}
+
+Poly ReorderPermute(const Poly *p, unsigned vars, const unsigned perm[])
+{
+    if (PolyIsCoeff(p))
+        return PolyClone(p);
+
+    ReorderRows r = {.vars = vars, .len = 0, .cap = 0, .exps = NULL,
+                     .coeffs = NULL};
+
+    RowsAdd(&r, p, perm);
+
+    size_t *idx = malloc(r.len * sizeof(size_t));
+    ReorderKey *keys = malloc(r.len * sizeof(ReorderKey));
+    assert(idx != NULL && keys != NULL);
+
+    for (size_t i = 0; i < r.len; i++)
+        idx[i] = i;
+
+    Poly res = RowsBuild(&r, idx, r.len, 0, keys);
+
+    free(idx);
+    free(keys);
+    RowsDestroy(&r);
+
+    return res;
+}
+
+/**
+ * Sortuje wyrazy według pary: klasa wyrazu i wykładnik zmiennej,
+ * i zlicza różne pary.
+ * @param[in] r : wiersze
+ * @param[in] cls : klasy wyrazów
+ * @param[in] var : indeks zmiennej
+ * @param[out] keys : posortowane klucze wyrazów
+ * @return liczba różnych par
+ */
+static size_t RowsDistinct(const ReorderRows *r, const size_t cls[],
+                           unsigned var, ReorderKey keys[])
+{
+    size_t res = 0;
+
+    for (size_t i = 0; i < r->len; i++)
+        keys[i] = (ReorderKey) {.key = ((uint64_t)cls[i] << 32)
+                                       | (uint32_t)RowsExp(r, i, var),
+                                .row = i};
+    qsort(keys, r->len, sizeof(ReorderKey), ReorderKeyCompare);
+
+    for (size_t i = 0; i < r->len; i++)
+        res += i == 0 || keys[i].key != keys[i - 1].key;
+
+    return res;
+}
+
+void ReorderChoose(unsigned count, const Poly ps[], unsigned vars,
+                   unsigned perm[])
+{
+    ReorderRows r = {.vars = vars, .len = 0, .cap = 0, .exps = NULL,
+                     .coeffs = NULL};
+    size_t *cls = NULL;
+
+    /* Klasa wyrazu to wielomian, z którego pochodzi, i wykładniki
+       zmiennych już ustawionych; różnych klas jest tyle, ile elementów
+       list na bieżącym poziomie. */
+    for (unsigned k = 0; k < count; k++)
+    {
+        size_t start = r.len;
+
+        RowsAdd(&r, &ps[k], NULL);
+        cls = realloc(cls, (r.len + 1) * sizeof(size_t));
+        assert(cls != NULL);
+        for (size_t i = start; i < r.len; i++)
+            cls[i] = k;
+    }
+
+    ReorderKey *keys = malloc((r.len + 1) * sizeof(ReorderKey));
+    ReorderKey *best_keys = malloc((r.len + 1) * sizeof(ReorderKey));
+    bool *used = calloc(vars + 1, sizeof(bool));
+    assert(keys != NULL && best_keys != NULL && used != NULL);
+
+    for (unsigned pos = 0; pos < vars; pos++)
+    {
+        unsigned best = vars;
+        size_t best_count = 0;
+
+        for (unsigned v = 0; v < vars; v++)
+        {
+            if (used[v])
+                continue;
+
+            size_t c = RowsDistinct(&r, cls, v, keys);
+
+            if (best == vars || c < best_count)
+            {
+                ReorderKey *tmp = keys;
+                keys = best_keys;
+                best_keys = tmp;
+                best = v;
+                best_count = c;
+            }
+        }
+
+        used[best] = true;
+        perm[best] = pos;
+
+        for (size_t i = 0, rank = 0; i < r.len; i++)
+        {
+            rank += i > 0 && best_keys[i].key != best_keys[i - 1].key;
+            cls[best_keys[i].row] = rank;
+        }
+    }
+
+    free(keys);
+    free(best_keys);
+    free(used);
+    free(cls);
+    RowsDestroy(&r);
+}
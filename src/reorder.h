@@ -0,0 +1,42 @@
+/** @file
+    Interfejs przenumerowywania zmiennych wielomianów
+
+    Wielomian jest rozkładany na wiersze wykładników wszystkich zmiennych
+    i składany z powrotem poziom po poziomie: wyrazy o wspólnych
+    wykładnikach zmiennych zewnętrznych są rozdzielane do kubełków według
+    wykładnika kolejnej zmiennej.
+
+    @author Aliaksandr Sarokin <as372525@students.mimuw.edu.pl>
+    @copyright Uniwersytet Warszawski
+    @date 2017-06-03
+*/
+
+#ifndef __REORDER_H__
+#define __REORDER_H__
+
+#include "poly.h"
+
+/**
+ * Przenumerowuje zmienne wielomianu: zmienna @f$x_i@f$ staje się zmienną
+ * @f$x_{perm[i]}@f$.
+ * @param[in] p : wielomian bez drzewa
+ * @param[in] vars : liczba zmiennych, co najmniej `DistVars(p)`
+ * @param[in] perm : permutacja zbioru @f$\{0, \ldots, vars - 1\}@f$
+ * @return wielomian o przenumerowanych zmiennych
+ */
+Poly ReorderPermute(const Poly *p, unsigned vars, const unsigned perm[]);
+
+/**
+ * Wybiera zachłannie kolejność zmiennych, przy której wielomiany mają
+ * najmniej elementów list: na każdym poziomie zagnieżdżenia stawia zmienną
+ * dającą najmniej różnych ciągów wykładników zmiennych zewnętrznych.
+ * Przy remisie zostawia mniejszy indeks.
+ * @param[in] count : liczba wielomianów
+ * @param[in] ps : wielomiany bez drzew
+ * @param[in] vars : liczba zmiennych, co najmniej `DistVars` każdego z nich
+ * @param[out] perm : nowe indeksy zmiennych
+ */
+void ReorderChoose(unsigned count, const Poly ps[], unsigned vars,
+                   unsigned perm[]);
+
+#endif /* __REORDER_H__ */
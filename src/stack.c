@@ -28,24 +28,58 @@ void StackPush(Stack *s, Poly p)
     assert(tmp != NULL);
     tmp->next = *s;
     tmp->p = p;
+    tmp->e = NULL;
     *s = tmp;
 }
 
 Poly StackPop(Stack *s)
 {
     StackNode *tmp = *s;
-    Poly res = (*s)->p;
+    Poly res = tmp->e == NULL ? tmp->p : ExprTake(tmp->e);
     *s = (*s)->next;
     free(tmp);
     return res;
 }
 
+void StackPushExpr(Stack *s, Expr *e)
+{
+    StackPush(s, PolyZero());
+    (*s)->e = e;
+}
+
+Expr* StackPopExpr(Stack *s)
+{
+    StackNode *tmp = *s;
+    Expr *res = tmp->e == NULL ? ExprFromPoly(tmp->p) : tmp->e;
+    *s = (*s)->next;
+    free(tmp);
+    return res;
+}
+
+void StackForce(Stack s)
+{
+    for (; s != NULL; s = s->next)
+    {
+        if (s->e != NULL)
+        {
+            s->p = ExprTake(s->e);
+            s->e = NULL;
+        }
+    }
+}
+
 void StackDestroy(Stack *s)
 {
     while (!StackIsEmpty(*s))
     {
-        Poly tmp = StackPop(s);
-        PolyDestroy(&tmp);
+        StackNode *tmp = *s;
+
+        if (tmp->e != NULL)
+            ExprRelease(tmp->e);
+        else
+            PolyDestroy(&tmp->p);
+        *s = tmp->next;
+        free(tmp);
     }
 }
 
@@ -64,3 +98,54 @@ Poly* StackPopArray(Stack *s, unsigned count)
 
     return res;
 }
+
+void StackMap(Stack s, Poly (*f)(const Poly *))
+{
+    StackForce(s);
+    for (; s != NULL; s = s->next)
+    {
+        Poly tmp = f(&s->p);
+        PolyDestroy(&s->p);
+        s->p = tmp;
+    }
+}
+
+void StackPermute(Stack s, unsigned count, const unsigned perm[])
+{
+    StackForce(s);
+    for (; s != NULL; s = s->next)
+    {
+        Poly tmp = PolyPermute(&s->p, count, perm);
+        PolyDestroy(&s->p);
+        s->p = tmp;
+    }
+}
+
+unsigned* StackReorderChoose(const Stack s, unsigned *vars)
+{
+    unsigned count = 0, i = 0;
+
+    StackForce(s);
+
+    *vars = 0;
+    for (Stack n = s; n != NULL; n = n->next)
+    {
+        unsigned v = PolyVars(&n->p);
+
+        if (v > *vars)
+            *vars = v;
+        count++;
+    }
+
+    Poly *ps = malloc((count + 1) * sizeof(Poly));
+    unsigned *perm = malloc((*vars + 1) * sizeof(unsigned));
+    assert(ps != NULL && perm != NULL);
+
+    for (Stack n = s; n != NULL; n = n->next)
+        ps[i++] = n->p;
+
+    PolyReorderChoose(count, ps, *vars, perm);
+    free(ps);
+
+    return perm;
+}
@@ -10,12 +10,15 @@
 #define __STACK_H__
 
 #include "poly.h"
+#include "expr.h"
 
 /**
  * Struktura przchowująca element stosu wielomianów.
+ * Element jest wielomianem albo niepoliczonym wyrażeniem (patrz `Expr`).
  */
 typedef struct StackNode{
     Poly p; ///< wielomian
+    Expr *e; ///< wyrażenie albo `NULL`, gdy element jest wielomianem
     struct StackNode *next; ///< następny wielomian
 } StackNode;
 
@@ -43,12 +46,32 @@ Stack StackInit();
 void StackPush(Stack *s, Poly p);
 
 /**
- * Zdejmuje ze stosu wielomian.
+ * Zdejmuje ze stosu wielomian. Wyrażenie ze szczytu stosu jest liczone.
  * @param[in] s: stos wielomianów
  * @return wielomian ze szczytu stosu
  */
 Poly StackPop(Stack *s);
 
+/**
+ * Wkłada wyrażenie na stos, przejmując odwołanie do niego.
+ * @param[in] s: stos wielomianów
+ * @param[in] e: wyrażenie
+ */
+void StackPushExpr(Stack *s, Expr *e);
+
+/**
+ * Zdejmuje ze stosu element jako wyrażenie, bez liczenia go.
+ * @param[in] s: stos wielomianów
+ * @return wyrażenie ze szczytu stosu
+ */
+Expr* StackPopExpr(Stack *s);
+
+/**
+ * Liczy wszystkie wyrażenia na stosie.
+ * @param[in,out] s: stos wielomianów
+ */
+void StackForce(Stack s);
+
 /**
  * Wyczyszcza stos.
  * @param[in] s: stos wielomianów
@@ -71,4 +94,28 @@ bool StackIsSmallerThan(const Stack s, size_t size);
  */
 Poly* StackPopArray(Stack *s, unsigned count);
 
+/**
+ * Zastępuje każdy wielomian na stosie wynikiem funkcji @p f.
+ * @param[in,out] s : stos
+ * @param[in] f : funkcja tworząca nowy wielomian
+ */
+void StackMap(Stack s, Poly (*f)(const Poly *));
+
+/**
+ * Przenumerowuje zmienne każdego wielomianu na stosie (patrz `PolyPermute`).
+ * @param[in,out] s : stos
+ * @param[in] count : długość permutacji
+ * @param[in] perm : nowe indeksy zmiennych
+ */
+void StackPermute(Stack s, unsigned count, const unsigned perm[]);
+
+/**
+ * Wybiera kolejność zmiennych wspólną dla wszystkich wielomianów na stosie
+ * (patrz `PolyReorderChoose`).
+ * @param[in] s : stos
+ * @param[out] vars : liczba zmiennych wielomianów na stosie
+ * @return tablica @p vars nowych indeksów zmiennych
+ */
+unsigned* StackReorderChoose(const Stack s, unsigned *vars);
+
 #endif /* __STACK_H__ */
\ No newline at end of file
@@ -0,0 +1,349 @@
+/** @file
+    Implementacja trwałych drzew wyrazów wielomianu
+
+    @author Aliaksandr Sarokin <as372525@students.mimuw.edu.pl>
+    @copyright Uniwersytet Warszawski
+    @date 2017-06-03
+*/
+
+#include <stdlib.h>
+#include <assert.h>
+
+#include "tree.h"
+#include "utils.h"
+
+/**
+ * Daje priorytet wyrazu o danym wykładniku (krok końcowy generatora
+ * SplitMix64).
+ * @param[in] e : wykładnik
+ * @return priorytet
+ */
+static inline uint32_t TreePrio(poly_exp_t e)
+{
+    uint64_t x = (uint64_t)(unsigned)e + 0x9e3779b97f4a7c15UL;
+
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9UL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebUL;
+
+    return (uint32_t)((x ^ (x >> 31)) >> 32);
+}
+
+/**
+ * Sprawdza, czy wyraz o wykładniku @p a leży w drzewie nad wyrazem
+ * o wykładniku @p b. Remisy priorytetów rozstrzyga mniejszy wykładnik,
+ * więc porządek jest liniowy.
+ * @param[in] pa : priorytet wyrazu @p a
+ * @param[in] a : wykładnik
+ * @param[in] pb : priorytet wyrazu @p b
+ * @param[in] b : wykładnik
+ * @return czy @p a jest nad @p b
+ */
+static inline bool TreeAbove(uint32_t pa, poly_exp_t a, uint32_t pb, poly_exp_t b)
+{
+    return pa > pb || (pa == pb && a < b);
+}
+
+/**
+ * Tworzy węzeł bez poddrzew.
+ * @param[in] e : wykładnik
+ * @param[in] p : współczynnik, przejmowany na własność
+ * @return węzeł
+ */
+static TreeNode* TreeNew(poly_exp_t e, Poly p)
+{
+    TreeNode *t = malloc(sizeof(TreeNode));
+    assert(t != NULL);
+
+    *t = (TreeNode) {.refs = 1, .size = 1, .exp = e, .prio = TreePrio(e),
+                     .p = p, .left = NULL, .right = NULL};
+
+    return t;
+}
+
+/**
+ * Przelicza liczbę wyrazów poddrzewa.
+ * @param[in,out] t : węzeł
+ */
+static inline void TreeUpdate(TreeNode *t)
+{
+    t->size = 1 + TreeSize(t->left) + TreeSize(t->right);
+}
+
+/**
+ * Kopiuje węzeł z nowym współczynnikiem, współdzieląc jego poddrzewa.
+ * @param[in] t : węzeł
+ * @param[in] p : współczynnik, przejmowany na własność
+ * @return kopia węzła
+ */
+static TreeNode* TreeCopy(const TreeNode *t, Poly p)
+{
+    TreeNode *res = TreeNew(t->exp, p);
+
+    res->size = t->size;
+    res->left = TreeRetain(t->left);
+    res->right = TreeRetain(t->right);
+
+    return res;
+}
+
+/**
+ * Daje węzeł, który wolno zmieniać: sam węzeł, jeśli nikt inny go nie
+ * używa, wpp jego kopię. Przejmuje odwołanie do węzła.
+ * @param[in] t : węzeł
+ * @return węzeł na wyłączność
+ */
+static TreeNode* TreeOwn(TreeNode *t)
+{
+    if (t->refs == 1)
+        return t;
+
+    t->refs--;
+
+    return TreeCopy(t, PolyClone(&t->p));
+}
+
+void TreeRelease(TreeNode *t)
+{
+    while (t != NULL && --t->refs == 0)
+    {
+        TreeNode *right = t->right;
+
+        TreeRelease(t->left);
+        PolyDestroy(&t->p);
+        free(t);
+        t = right;
+    }
+}
+
+List TreeList(TreeNode *t)
+{
+    assert(t != NULL);
+
+    TreeHead *h = malloc(sizeof(TreeHead));
+    assert(h != NULL);
+
+    h->node = (Node) {.m = {.p = PolyZero(), .exp = NODE_TREE}, .next = NULL};
+    h->root = t;
+
+    return &h->node;
+}
+
+/**
+ * Uzupełnia liczby wyrazów poddrzew zbudowanego drzewa.
+ * @param[in,out] t : drzewo
+ */
+static void TreeFixSizes(TreeNode *t)
+{
+    if (t == NULL)
+        return;
+
+    TreeFixSizes(t->left);
+    TreeFixSizes(t->right);
+    TreeUpdate(t);
+}
+
+TreeNode* TreeBuild(size_t count, Mono monos[])
+{
+    if (count == 0)
+        return NULL;
+
+    /* Prawa krawędź budowanego drzewa; priorytety na niej maleją. */
+    TreeNode **spine = malloc(count * sizeof(TreeNode *));
+    assert(spine != NULL);
+    size_t top = 0;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        TreeNode *t = TreeNew(monos[i].exp, monos[i].p), *last = NULL;
+
+        while (top > 0 && TreeAbove(t->prio, t->exp,
+                                    spine[top - 1]->prio, spine[top - 1]->exp))
+            last = spine[--top];
+
+        t->left = last;
+        if (top > 0)
+            spine[top - 1]->right = t;
+        spine[top++] = t;
+    }
+
+    TreeNode *res = spine[0];
+
+    free(spine);
+    TreeFixSizes(res);
+
+    return res;
+}
+
+Mono* TreeGather(const TreeNode *t, Mono *out)
+{
+    for (; t != NULL; t = t->right)
+    {
+        out = TreeGather(t->left, out);
+        *out++ = (Mono) {.p = PolyClone(&t->p), .exp = t->exp};
+    }
+
+    return out;
+}
+
+/**
+ * Dzieli drzewo na wyrazy o wykładnikach mniejszych i większych od @p e.
+ * Przejmuje odwołanie do drzewa.
+ * @param[in] t : drzewo bez wyrazu o wykładniku @p e
+ * @param[in] e : wykładnik
+ * @param[out] l : drzewo mniejszych wykładników
+ * @param[out] r : drzewo większych wykładników
+ */
+static void TreeSplit(TreeNode *t, poly_exp_t e, TreeNode **l, TreeNode **r)
+{
+    if (t == NULL)
+    {
+        *l = *r = NULL;
+        return;
+    }
+
+    t = TreeOwn(t);
+
+    if (t->exp < e)
+    {
+        TreeSplit(t->right, e, &t->right, r);
+        *l = t;
+    }
+    else
+    {
+        TreeSplit(t->left, e, l, &t->left);
+        *r = t;
+    }
+
+    TreeUpdate(t);
+}
+
+/**
+ * Łączy drzewa, z których pierwsze ma mniejsze wykładniki.
+ * Przejmuje odwołania do obu drzew.
+ * @param[in] l : drzewo
+ * @param[in] r : drzewo
+ * @return połączone drzewo
+ */
+static TreeNode* TreeMerge(TreeNode *l, TreeNode *r)
+{
+    if (l == NULL)
+        return r;
+    if (r == NULL)
+        return l;
+
+    if (TreeAbove(l->prio, l->exp, r->prio, r->exp))
+    {
+        l = TreeOwn(l);
+        l->right = TreeMerge(l->right, r);
+        TreeUpdate(l);
+
+        return l;
+    }
+
+    r = TreeOwn(r);
+    r->left = TreeMerge(l, r->left);
+    TreeUpdate(r);
+
+    return r;
+}
+
+TreeNode* TreeAddTerm(TreeNode *t, poly_exp_t e, const Poly *c)
+{
+    if (t == NULL)
+        return TreeNew(e, PolyClone(c));
+
+    if (t->exp == e)
+    {
+        Poly sum = PolyAdd(&(t->p), c);
+
+        if (PolyIsZero(&sum))
+        {
+            TreeNode *l = t->left, *r = t->right;
+
+            if (t->refs == 1)
+            {
+                t->left = t->right = NULL;
+            }
+            else
+            {
+                TreeRetain(l);
+                TreeRetain(r);
+            }
+            TreeRelease(t);
+
+            return TreeMerge(l, r);
+        }
+
+        if (t->refs == 1)
+        {
+            PolyDestroy(&(t->p));
+            t->p = sum;
+
+            return t;
+        }
+
+        t->refs--;
+
+        return TreeCopy(t, sum);
+    }
+
+    /* Priorytet zależy tylko od wykładnika, więc wyraz, który powinien
+       leżeć nad korzeniem poddrzewa, nie może być w tym poddrzewie. */
+    uint32_t prio = TreePrio(e);
+
+    if (TreeAbove(prio, e, t->prio, t->exp))
+    {
+        TreeNode *res = TreeNew(e, PolyClone(c));
+
+        TreeSplit(t, e, &res->left, &res->right);
+        TreeUpdate(res);
+
+        return res;
+    }
+
+    t = TreeOwn(t);
+
+    if (e < t->exp)
+        t->left = TreeAddTerm(t->left, e, c);
+    else
+        t->right = TreeAddTerm(t->right, e, c);
+
+    TreeUpdate(t);
+
+    return t;
+}
+
+TreeNode* TreeAddTree(TreeNode *t, const TreeNode *u)
+{
+    for (; u != NULL; u = u->right)
+    {
+        t = TreeAddTree(t, u->left);
+        t = TreeAddTerm(t, u->exp, &(u->p));
+    }
+
+    return t;
+}
+
+bool TreeEqual(const TreeNode *a, const TreeNode *b)
+{
+    for (; a != b; a = a->right, b = b->right)
+    {
+        if (a == NULL || b == NULL || a->size != b->size || a->exp != b->exp
+            || !PolyIsEq(&(a->p), &(b->p)) || !TreeEqual(a->left, b->left))
+            return false;
+    }
+
+    return true;
+}
+
+poly_exp_t TreeMaxExp(const TreeNode *t)
+{
+    assert(t != NULL);
+
+    while (t->right != NULL)
+        t = t->right;
+
+    return t->exp;
+}
@@ -0,0 +1,145 @@
+/** @file
+    Interfejs trwałych drzew wyrazów wielomianu
+
+    Drzewo przechowuje wyrazy najwyższego poziomu wielomianu w drzewcu
+    (treap) uporządkowanym według wykładników. Priorytet węzła jest skrótem
+    jego wykładnika, więc kształt drzewa zależy tylko od zbioru wykładników.
+    Drzewo jest trwałe: zmiana wyrazu nie modyfikuje węzłów używanych przez
+    inne wersje, tylko kopiuje ścieżkę od korzenia do tego wyrazu, a resztę
+    węzłów współdzieli z poprzednią wersją. Węzły mają liczniki odwołań;
+    węzeł używany tylko przez zmienianą wersję jest zmieniany w miejscu.
+
+    @author Aliaksandr Sarokin <as372525@students.mimuw.edu.pl>
+    @copyright Uniwersytet Warszawski
+    @date 2017-06-03
+*/
+
+#ifndef __TREE_H__
+#define __TREE_H__
+
+#include <stdint.h>
+
+#include "poly.h"
+
+/** Węzeł drzewa: jeden wyraz wielomianu */
+typedef struct TreeNode
+{
+    unsigned refs; ///< liczba odwołań do węzła
+    unsigned size; ///< liczba wyrazów poddrzewa
+    poly_exp_t exp; ///< wykładnik wyrazu
+    uint32_t prio; ///< priorytet, skrót wykładnika
+    Poly p; ///< niezerowy współczynnik wyrazu
+    struct TreeNode *left; ///< poddrzewo mniejszych wykładników
+    struct TreeNode *right; ///< poddrzewo większych wykładników
+} TreeNode;
+
+/**
+ * Element listy jednomianów trzymający drzewo. Jest jedynym elementem
+ * listy wielomianu zapisanego w drzewie.
+ */
+typedef struct TreeHead
+{
+    Node node; ///< nagłówek elementu listy, `node.m.exp == NODE_TREE`
+    TreeNode *root; ///< niepuste drzewo
+} TreeHead;
+
+/**
+ * Daje korzeń drzewa, którego nagłówkiem jest element listy.
+ * @param[in] n : element listy będący drzewem
+ * @return korzeń drzewa
+ */
+static inline TreeNode* NodeTree(const Node *n)
+{
+    return ((const TreeHead *)n)->root;
+}
+
+/**
+ * Daje liczbę wyrazów drzewa.
+ * @param[in] t : drzewo
+ * @return liczba wyrazów
+ */
+static inline unsigned TreeSize(const TreeNode *t)
+{
+    return t == NULL ? 0 : t->size;
+}
+
+/**
+ * Zwiększa licznik odwołań drzewa.
+ * @param[in] t : drzewo
+ * @return @p t
+ */
+static inline TreeNode* TreeRetain(TreeNode *t)
+{
+    if (t != NULL)
+        t->refs++;
+
+    return t;
+}
+
+/**
+ * Zmniejsza licznik odwołań drzewa i zwalnia je przy zerze.
+ * @param[in] t : drzewo
+ */
+void TreeRelease(TreeNode *t);
+
+/**
+ * Tworzy listę jednomianów złożoną z samego drzewa.
+ * Przejmuje odwołanie do drzewa.
+ * @param[in] t : niepuste drzewo
+ * @return lista jednomianów
+ */
+List TreeList(TreeNode *t);
+
+/**
+ * Buduje drzewo z jednomianów o rosnących wykładnikach i niezerowych
+ * współczynnikach w czasie liniowym. Przejmuje współczynniki na własność.
+ * @param[in] count : liczba jednomianów
+ * @param[in] monos : jednomiany
+ * @return drzewo
+ */
+TreeNode* TreeBuild(size_t count, Mono monos[]);
+
+/**
+ * Kopiuje wyrazy drzewa do tablicy w kolejności rosnących wykładników.
+ * @param[in] t : drzewo
+ * @param[out] out : tablica na `TreeSize(t)` jednomianów
+ * @return wskaźnik za ostatnim zapisanym jednomianem
+ */
+Mono* TreeGather(const TreeNode *t, Mono *out);
+
+/**
+ * Dodaje do drzewa wyraz `c * x^e` w czasie proporcjonalnym do wysokości
+ * drzewa. Przejmuje odwołanie do drzewa.
+ * @param[in] t : drzewo
+ * @param[in] e : wykładnik
+ * @param[in] c : niezerowy współczynnik
+ * @return drzewo z dodanym wyrazem
+ */
+TreeNode* TreeAddTerm(TreeNode *t, poly_exp_t e, const Poly *c);
+
+/**
+ * Dodaje do drzewa wszystkie wyrazy innego drzewa.
+ * Przejmuje odwołanie do pierwszego drzewa.
+ * @param[in] t : drzewo
+ * @param[in] u : dodawane drzewo
+ * @return drzewo sumy
+ */
+TreeNode* TreeAddTree(TreeNode *t, const TreeNode *u);
+
+/**
+ * Sprawdza równość drzew. Kształt drzewa zależy tylko od wykładników,
+ * a wspólne poddrzewa są równe bez porównywania.
+ * @param[in] a : drzewo
+ * @param[in] b : drzewo
+ * @return czy drzewa mają te same wyrazy
+ */
+bool TreeEqual(const TreeNode *a, const TreeNode *b);
+
+/**
+ * Daje największy wykładnik drzewa.
+ * @param[in] t : niepuste drzewo
+ * @return wykładnik
+ */
+poly_exp_t TreeMaxExp(const TreeNode *t);
+
+#endif /* __TREE_H__ */
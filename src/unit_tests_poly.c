@@ -1,5 +1,6 @@
 /** @file
-    Testy jednostkowe funkcji `PolyCompose`
+    Testy jednostkowe funkcji `PolyCompose`, operacji na tablicach
+    współczynników, bloków gęstych, liści i reprezentacji rozproszonej
 
     @author Aliaksandr Sarokin <as372525@students.mimuw.edu.pl>
     @copyright Uniwersytet Warszawski
@@ -14,6 +15,32 @@
 
 #include "cmocka.h"
 #include "poly.h"
+#include "kernels.h"
+#include "dist.h"
+#include "acc.h"
+
+/** Długość tablic w testach operacji na współczynnikach, niepodzielna przez 8 */
+#define KERNEL_TEST_LEN 45
+
+/** Połowa szerokości współczynników w bitach */
+#define COEFF_HALF_BITS (POLY_COEFF_BITS / 2)
+
+#if POLY_COEFF_BITS == 32
+/** Liczba pierwsza bliska największemu współczynnikowi */
+#define COEFF_MOD_PRIME 2147483647
+/** Największy współczynnik nie większy niż moduł wartości `PolyIsEqFast` */
+#define EQ_FAST_COEFF 2147483647
+#else
+/** Liczba pierwsza bliska największemu współczynnikowi */
+#define COEFF_MOD_PRIME 9223372036854775783
+/** Współczynnik równy modułowi wartości `PolyIsEqFast`: @f$2^{61} - 1@f$ */
+#define EQ_FAST_COEFF 2305843009213693951
+#endif
+
+/** Zapis dziesiętny stałej liczbowej */
+#define TEST_STR(x) TEST_STR_(x)
+/** Pomocnicze makro `TEST_STR`, które nie rozwija argumentu */
+#define TEST_STR_(x) #x
 
 /** Bufor służący do jump'a */
 static jmp_buf jmp_at_exit;
@@ -316,6 +343,90 @@ static void test_poly_count_one_poly(void **state)
     PolyDestroy(&tmp3);
 }
 
+/**
+ * Wypełnia tablicę współczynnikami testowymi, w tym skrajnymi wartościami.
+ * @param[out] a : tablica
+ * @param[in] seed : ziarno
+ */
+static void kernel_fill(poly_coeff_t a[], poly_coeff_t seed)
+{
+    for (int i = 0; i < KERNEL_TEST_LEN; i++)
+        a[i] = (i % 3 == 0) ? 0 : seed * (i - 20) * 1000003L;
+    a[1] = POLY_COEFF_MAX;
+    a[2] = POLY_COEFF_MIN;
+}
+
+/**
+ * Test funkcji `KernelNeg` i `KernelScale`, także w miejscu.
+ */
+static void test_kernel_neg_scale(void **state)
+{
+    (void)state;
+
+    poly_coeff_t a[KERNEL_TEST_LEN], b[KERNEL_TEST_LEN];
+    kernel_fill(a, 7);
+
+    KernelNeg(b, a, KERNEL_TEST_LEN);
+    for (int i = 0; i < KERNEL_TEST_LEN; i++)
+        assert_true(b[i] == (poly_coeff_t)(0 - (unsigned long)a[i]));
+
+    KernelScale(b, a, KERNEL_TEST_LEN,
+                (poly_coeff_t)1 << (COEFF_HALF_BITS + 1));
+    for (int i = 0; i < KERNEL_TEST_LEN; i++)
+        assert_true(b[i] == (poly_coeff_t)((unsigned long)a[i]
+                                           << (COEFF_HALF_BITS + 1)));
+
+    KernelScale(a, a, KERNEL_TEST_LEN, -3);
+    kernel_fill(b, 7);
+    for (int i = 0; i < KERNEL_TEST_LEN; i++)
+        assert_true(a[i] == (poly_coeff_t)((unsigned long)b[i] * (unsigned long)-3));
+}
+
+/**
+ * Test funkcji `KernelAdd`.
+ */
+static void test_kernel_add(void **state)
+{
+    (void)state;
+
+    poly_coeff_t a[KERNEL_TEST_LEN], b[KERNEL_TEST_LEN], c[KERNEL_TEST_LEN];
+    kernel_fill(a, 5);
+    kernel_fill(b, -11);
+
+    KernelAdd(c, a, b, KERNEL_TEST_LEN);
+    for (int i = 0; i < KERNEL_TEST_LEN; i++)
+        assert_true(c[i] == (poly_coeff_t)((unsigned long)a[i] + (unsigned long)b[i]));
+}
+
+/**
+ * Test funkcji `KernelCompact`.
+ */
+static void test_kernel_compact(void **state)
+{
+    (void)state;
+
+    poly_coeff_t a[KERNEL_TEST_LEN], b[KERNEL_TEST_LEN];
+    poly_exp_t e[KERNEL_TEST_LEN];
+    kernel_fill(a, 3);
+    kernel_fill(b, 3);
+    for (int i = 0; i < KERNEL_TEST_LEN; i++)
+        e[i] = 2 * i;
+
+    size_t n = KernelCompact(e, a, KERNEL_TEST_LEN);
+    size_t k = 0;
+    for (int i = 0; i < KERNEL_TEST_LEN; i++)
+    {
+        if (b[i] != 0)
+        {
+            assert_true(k < n);
+            assert_true(a[k] == b[i]);
+            assert_int_equal(e[k], 2 * i);
+            k++;
+        }
+    }
+    assert_int_equal(k, n);
+}
+
 /**
  * Funkcja wołana przed każdym testem.
  */
@@ -457,34 +568,2251 @@ static void test_parse_digits_letters(void **state) {
 }
 
 /**
- * Uruchamia dwie grupy testów jednostkowych.
+ * Test parsowania sumy dłuższej niż wewnętrzny bufor jednomianów parsera,
+ * z powtórzonymi wykładnikami i jednomianami w kolejności malejącej.
  */
-int main(void)
+static void test_parse_long_sum(void **state) {
+    (void)state;
+
+    init_input_stream("(1,9)+(1,8)+(1,7)+(1,6)+(1,5)+(1,4)+(1,3)+(1,2)+(1,1)"
+                      "+(-1,9)+((2,1),0)\nPRINT\n");
+
+    assert_int_equal(mock_main(), 0);
+    assert_string_equal(printf_buffer, "((2,1),0)+(1,1)+(1,2)+(1,3)+(1,4)+"
+                                       "(1,5)+(1,6)+(1,7)+(1,8)\n");
+    assert_string_equal(fprintf_buffer, "");
+}
+
+/**
+ * Test polecenia `MOD`: reszty kanoniczne i błędny moduł.
+ */
+static void test_parse_mod(void **state) {
+    (void)state;
+
+    init_input_stream("MOD 7\n(3,1)+(-2,0)\nCLONE\nMUL\nPRINT\nAT -1\nPRINT\n"
+                      "MOD 1\nMOD 0\n");
+
+    assert_int_equal(mock_main(), 0);
+    assert_string_equal(printf_buffer, "(4,0)+(2,1)+(2,2)\n4\n");
+    assert_string_equal(fprintf_buffer, "ERROR 8 WRONG MODULUS\n");
+}
+
+#if POLY_COEFF_BITS == 32
+/**
+ * Test kalkulatora o 32-bitowych współczynnikach: przepełnione działania
+ * dają wynik modulo @f$2^{32}@f$ i ustawiają flagę `OVERFLOW`, a liczby
+ * spoza zakresu typu `int32_t` są odrzucane.
+ */
+static void test_parse_coeff_wrap(void **state) {
+    (void)state;
+
+    init_input_stream("(2147483647,1)+(1,1)\nPRINT\nOVERFLOW\n(65536,0)+(1,1)\n"
+                      "SQR\nPRINT\nOVERFLOW\n2147483648\n-2147483648\nNEG\n"
+                      "PRINT\nAT 2147483648\nCOMPOSE 4294967295\n");
+
+    assert_int_equal(mock_main(), 0);
+    assert_string_equal(printf_buffer, "(-2147483648,1)\n1\n(131072,1)+(1,2)\n"
+                                       "1\n-2147483648\n");
+    assert_string_equal(fprintf_buffer, "ERROR 8 10\nERROR 12 WRONG VALUE\n"
+                                        "ERROR 13 STACK UNDERFLOW\n");
+}
+#endif
+
+/**
+ * Test arytmetyki modulo liczba pierwsza bliska największemu
+ * współczynnikowi.
+ */
+static void test_coeff_mod(void **state)
 {
-    const struct CMUnitTest tests_poly_compose[] = {
-        cmocka_unit_test(test_poly_zero_count_zero),
-        cmocka_unit_test(test_poly_zero_count_one_poly_const),
-        cmocka_unit_test(test_poly_const_count_zero),
-        cmocka_unit_test(test_poly_const_count_one_poly_diff_const),
-        cmocka_unit_test(test_poly_count_zero),
-        cmocka_unit_test(test_poly_count_one_poly_const),
-        cmocka_unit_test(test_poly_count_one_poly)
-    };
+    (void)state;
 
+    const poly_coeff_t p = COEFF_MOD_PRIME;
+    PolyCoeffModSet(p);
 
-    const struct CMUnitTest tests_parse_poly_compose[] = {
-        cmocka_unit_test_setup(test_parse_empty, test_setup),
-        cmocka_unit_test_setup(test_parse_min, test_setup),
-        cmocka_unit_test_setup(test_parse_max, test_setup),
-        cmocka_unit_test_setup(test_parse_under_min, test_setup),
-        cmocka_unit_test_setup(test_parse_over_max, test_setup),
-        cmocka_unit_test_setup(test_parse_very_big, test_setup),
-        cmocka_unit_test_setup(test_parse_letters, test_setup),
-        cmocka_unit_test_setup(test_parse_digits_letters, test_setup)
+    Poly a = PolyFromCoeff(-1), b = PolyCoeffReduce(&a);
+    assert_true(b.c == p - 1);
+
+    /* (p - 1)^2 = 1 (mod p), a mnożenie bloku przez p - 1 to negacja. */
+    Poly sq = PolyMul(&b, &b);
+    assert_true(sq.c == 1);
+
+    poly_coeff_t c[] = {p - 1, 2, p - 3}, d[3];
+    KernelScale(d, c, 3, p - 2);
+    assert_true(d[0] == 2 && d[1] == p - 4 && d[2] == 6);
+    KernelAdd(d, d, c, 3);
+    assert_true(d[0] == 1 && d[1] == p - 2 && d[2] == 3);
+    assert_false(PolyCoeffOverflow());
+
+    /* Modulo 4 mnożenie bloku przez 2 zeruje wyraz 2 x^0. */
+    PolyCoeffModSet(4);
+
+    Mono monos[8], expected[7];
+    Poly two = PolyFromCoeff(2);
+
+    for (int i = 0; i < 8; i++)
+    {
+        Poly x = PolyFromCoeff(i == 0 ? 2 : 1);
+        monos[i] = MonoFromPoly(&x, i);
+        if (i > 0)
+            expected[i - 1] = MonoFromPoly(&two, i);
+    }
+
+    Poly q = PolyAddMonos(8, monos), r = PolyMul(&q, &two);
+    Poly s = PolyAddMonos(7, expected);
+    assert_true(PolyIsEq(&r, &s));
+
+    PolyDestroy(&q);
+    PolyDestroy(&r);
+    PolyDestroy(&s);
+
+    PolyCoeffModSet(0);
+    assert_int_equal(PolyCoeffMod(), 0);
+}
+
+/**
+ * Test funkcji `KernelMergeLeaf`, `KernelMulLeaf` i `KernelEvalLeaf`.
+ */
+static void test_kernel_leaf(void **state)
+{
+    (void)state;
+
+    poly_exp_t ea[] = {0, 3, 10}, eb[] = {3, 7}, e[5];
+    poly_coeff_t ca[] = {1, 2, -1}, cb[] = {-2, 5}, c[5];
+
+    size_t n = KernelMergeLeaf(ea, ca, 3, eb, cb, 2, e, c);
+    assert_int_equal(n, 3);
+    assert_true(e[0] == 0 && c[0] == 1);
+    assert_true(e[1] == 7 && c[1] == 5);
+    assert_true(e[2] == 10 && c[2] == -1);
+    assert_true(KernelEvalLeaf(e, c, n, 2) == 1 + 5 * 128 - 1024);
+
+    poly_exp_t eh[] = {0, 1000}, *pe;
+    poly_coeff_t ch[] = {1, 1}, *pc;
+
+    /* (1 + x^1000)^2 = 1 + 2x^1000 + x^2000: gałąź sortująca. */
+    n = KernelMulLeaf(eh, ch, 2, eh, ch, 2, &pe, &pc);
+    assert_int_equal(n, 3);
+    assert_true(pe[1] == 1000 && pc[1] == 2 && pe[2] == 2000);
+    test_free(pe);
+    test_free(pc);
+
+    /* (1 + 2x^3 - x^10)(x^3 + x^4): gałąź gęsta. */
+    poly_exp_t ed[] = {3, 4};
+    poly_coeff_t cd[] = {1, 1};
+    n = KernelMulLeaf(ea, ca, 3, ed, cd, 2, &pe, &pc);
+    assert_int_equal(n, 6);
+    assert_true(KernelEvalLeaf(pe, pc, n, 3) == (1 + 2 * 27 - 59049L) * (27 + 81));
+    test_free(pe);
+    test_free(pc);
+}
+
+/**
+ * Test wykrywania przepełnienia współczynników.
+ */
+static void test_coeff_overflow(void **state)
+{
+    (void)state;
+
+    Poly p = PolyFromCoeff((poly_coeff_t)1 << COEFF_HALF_BITS);
+    Poly q = PolyFromCoeff(POLY_COEFF_MIN);
+    PolyCoeffOverflow();
+
+    Poly r = PolyMul(&p, &p);
+    assert_true(PolyIsZero(&r));
+    assert_true(PolyCoeffOverflow());
+    assert_false(PolyCoeffOverflow());
+
+    /* Równość liczona przez różnicę nie zgłasza przepełnienia. */
+    assert_false(PolyIsEq(&p, &q));
+    assert_false(PolyCoeffOverflow());
+
+    poly_coeff_t a[] = {1, POLY_COEFF_MAX, 3, 4, 5}, b[] = {1, 1, 1, 1, 1}, c[5];
+    KernelAdd(c, a, b, 5);
+    assert_true(c[1] == POLY_COEFF_MIN);
+    assert_true(PolyCoeffOverflow());
+
+    KernelScale(c, b, 5, POLY_COEFF_MIN);
+    assert_false(PolyCoeffOverflow());
+    KernelNeg(c, c, 5);
+    assert_true(PolyCoeffOverflow());
+}
+
+/**
+ * Tworzy wielomian @f$\sum_{i} sign \cdot (i + 1) x^i@f$ dla
+ * @f$i = start, \ldots, start + n - 1@f$.
+ * @param[in] start : najmniejszy wykładnik
+ * @param[in] n : liczba wyrazów
+ * @param[in] sign : znak współczynników
+ * @return wielomian
+ */
+static Poly dense_poly(poly_exp_t start, unsigned n, poly_coeff_t sign)
+{
+    Mono *monos = calloc(n, sizeof(Mono));
+    for (unsigned i = 0; i < n; i++)
+    {
+        Poly c = PolyFromCoeff(sign * (start + (poly_coeff_t)i + 1));
+        monos[i] = MonoFromPoly(&c, start + (poly_exp_t)i);
+    }
+
+    Poly res = PolyAddMonos(n, monos);
+    free(monos);
+
+    return res;
+}
+
+/**
+ * Test przechowywania gęstego ciągu wyrazów w jednym bloku.
+ */
+static void test_dense_block(void **state)
+{
+    (void)state;
+
+    Poly p = dense_poly(0, 20, 1);
+    assert_true(p.l != NULL && NodeIsBlock(p.l) && p.l->next == NULL);
+    assert_int_equal(ListLen(p.l), 20);
+    assert_int_equal(PolyDeg(&p), 19);
+    assert_int_equal(PolyDegBy(&p, 0), 19);
+
+    Poly v = PolyAt(&p, 1);
+    assert_true(PolyIsCoeff(&v) && v.c == 210);
+
+    Poly q = PolyMul(&p, &p);
+    assert_true(q.l != NULL && NodeIsBlock(q.l));
+    assert_int_equal(PolyDeg(&q), 38);
+
+    PolyDestroy(&p);
+    PolyDestroy(&q);
+}
+
+/**
+ * Test dodawania, które usuwa środek bloku gęstego.
+ */
+static void test_dense_add_split(void **state)
+{
+    (void)state;
+
+    Poly p = dense_poly(0, 30, 1);
+    Poly q = dense_poly(5, 20, -1);
+    Poly r = PolyAdd(&p, &q);
+
+    assert_int_equal(ListLen(r.l), 10);
+    for (Node *n = r.l; n != NULL; n = n->next)
+        assert_true(!NodeIsBlock(n));
+    assert_int_equal(PolyDeg(&r), 29);
+
+    Poly s = PolyAdd(&r, &q);
+    Poly t = PolySub(&s, &q);
+    assert_true(PolyIsEq(&t, &r));
+    assert_true(s.l != NULL && NodeIsBlock(s.l));
+
+    PolyDestroy(&p);
+    PolyDestroy(&q);
+    PolyDestroy(&r);
+    PolyDestroy(&s);
+    PolyDestroy(&t);
+}
+
+/**
+ * Test listy łączącej blok gęsty z jednomianem o niestałym współczynniku.
+ */
+static void test_dense_mixed(void **state)
+{
+    (void)state;
+
+    Poly p = dense_poly(0, 12, 1);
+    Poly y = dense_poly(0, 2, 1);
+    Mono m = MonoFromPoly(&y, 40);
+    Poly q = PolyAddMonos(1, &m);
+    Poly r = PolyAdd(&p, &q);
+
+    assert_int_equal(ListLen(r.l), 13);
+    assert_int_equal(PolyDeg(&r), 41);
+    assert_int_equal(PolyDegBy(&r, 1), 1);
+
+    Poly v = PolyAt(&r, 1);
+    Poly w = dense_poly(0, 2, 1);
+    Poly c = PolyFromCoeff(78);
+    Poly u = PolyAdd(&w, &c);
+    assert_true(PolyIsEq(&v, &u));
+
+    Poly n = PolyNeg(&r);
+    Poly z = PolyAdd(&n, &r);
+    assert_true(PolyIsZero(&z));
+
+    PolyDestroy(&p);
+    PolyDestroy(&q);
+    PolyDestroy(&r);
+    PolyDestroy(&v);
+    PolyDestroy(&w);
+    PolyDestroy(&u);
+    PolyDestroy(&n);
+}
+
+/**
+ * Test liścia: rzadkiego ciągu wyrazów o stałych współczynnikach.
+ */
+static void test_leaf_mul(void **state)
+{
+    (void)state;
+
+    Mono monos[6];
+    for (int i = 0; i < 6; i++)
+    {
+        Poly c = PolyFromCoeff(i % 2 ? -i : i + 1);
+        monos[i] = MonoFromPoly(&c, 100 * i);
+    }
+    Poly p = PolyAddMonos(6, monos);
+    assert_true(p.l != NULL && NodeIsLeaf(p.l) && p.l->next == NULL);
+    assert_int_equal(ListLen(p.l), 6);
+    assert_int_equal(PolyDeg(&p), 500);
+
+    Poly q = PolyMul(&p, &p);
+    Poly v = PolyAt(&q, 1);
+    Poly w = PolyAt(&p, 1);
+    assert_true(v.c == w.c * w.c);
+    assert_int_equal(PolyDeg(&q), 1000);
+
+    Poly r = PolySub(&q, &q);
+    assert_true(PolyIsZero(&r));
+
+    PolyDestroy(&p);
+    PolyDestroy(&q);
+}
+
+/**
+ * Tworzy gęsty wielomian jednej zmiennej o współczynnikach
+ * @f$c_i = ((a i + b) \bmod 1009) + 1@f$.
+ * @param[in] n : liczba wyrazów
+ * @param[in] a : mnożnik
+ * @param[in] b : przesunięcie
+ * @return wielomian
+ */
+static Poly dense_test_poly(unsigned n, long a, long b)
+{
+    Mono *monos = malloc(n * sizeof(Mono));
+    assert_true(monos != NULL);
+
+    for (unsigned i = 0; i < n; i++)
+        monos[i] = (Mono) {.p = PolyFromCoeff((a * i + b) % 1009 + 1), .exp = i};
+
+    Poly res = PolyAddMonos(n, monos);
+
+    free(monos);
+
+    return res;
+}
+
+/**
+ * Test mnożenia długich gęstych wielomianów algorytmem Karacuby:
+ * porównanie z iloczynem liczonym wyraz po wyrazie, także modulo.
+ */
+static void test_dense_karatsuba(void **state)
+{
+    (void)state;
+
+    for (unsigned mod = 0; mod < 2; mod++)
+    {
+        PolyCoeffModSet(mod ? 998244353 : 0);
+
+        Poly p = dense_test_poly(300, 37, 11), q = dense_test_poly(1000, 91, 5);
+        Poly pq = PolyMul(&p, &q), expected = PolyZero();
+
+        for (unsigned i = 0; i < 300; i++)
+        {
+            Poly c = PolyFromCoeff((37L * i + 11) % 1009 + 1);
+            Mono m = MonoFromPoly(&c, i);
+            Poly t = PolyAddMonos(1, &m), tq = PolyMul(&t, &q);
+            Poly sum = PolyAdd(&expected, &tq);
+
+            PolyDestroy(&expected);
+            PolyDestroy(&t);
+            PolyDestroy(&tq);
+            expected = sum;
+        }
+
+        assert_true(PolyIsEq(&pq, &expected));
+
+        PolyDestroy(&p);
+        PolyDestroy(&q);
+        PolyDestroy(&pq);
+        PolyDestroy(&expected);
+    }
+
+    PolyCoeffModSet(0);
+}
+
+/**
+ * Tworzy wielomian o wyrazach @f$c_i x_0^{s (i + 1)}@f$ dla @f$i < n@f$,
+ * gdzie @f$c_i = sign (i + 1)@f$, a dla @p nested
+ * @f$c_i = sign (i + 1) x_1@f$.
+ * Dla niezerowego @p period bierze tylko wyrazy odległe o mniej niż
+ * @p width od wielokrotności @p period.
+ * @param[in] n : liczba wyrazów
+ * @param[in] s : odstęp między wykładnikami
+ * @param[in] sign : znak współczynników
+ * @param[in] nested : czy współczynniki są wielomianami
+ * @param[in] period : okres wybieranych wyrazów albo 0
+ * @param[in] width : promień wybieranych fragmentów
+ * @return wielomian
+ */
+static Poly merge_test_poly(unsigned n, poly_exp_t s, poly_coeff_t sign,
+                            bool nested, unsigned period, unsigned width)
+{
+    Mono *monos = malloc(n * sizeof(Mono));
+    unsigned k = 0;
+    assert_true(monos != NULL);
+
+    for (unsigned i = 0; i < n; i++)
+    {
+        if (period > 0 && (i + width) % period >= 2 * width)
+            continue;
+
+        Poly c = PolyFromCoeff(sign * (poly_coeff_t)(i + 1));
+        if (nested)
+        {
+            Mono m = MonoFromPoly(&c, 1);
+            c = PolyAddMonos(1, &m);
+        }
+        monos[k++] = MonoFromPoly(&c, s * (poly_exp_t)(i + 1));
+    }
+
+    Poly res = PolyAddMonos(k, monos);
+
+    free(monos);
+
+    return res;
+}
+
+/**
+ * Sprawdza, czy równoległe dodawanie daje to samo co sekwencyjne `ListMerge`.
+ * @param[in] p : wielomian
+ * @param[in] q : wielomian
+ */
+static void check_merge_parallel(const Poly *p, const Poly *q)
+{
+    Poly expected = {.l = ListMerge(p->l, q->l), .c = 0};
+    Poly r = PolyAdd(p, q);
+
+    assert_true(PolyIsEq(&r, &expected));
+
+    PolyDestroy(&r);
+    PolyDestroy(&expected);
+}
+
+/**
+ * Test scalania długich list w kilku wątkach: wyrazy przeplatające się,
+ * całkowicie się znoszące i znoszące się przy granicach przedziałów.
+ */
+static void test_merge_parallel(void **state)
+{
+    (void)state;
+
+    PolyCpuCountSet(4);
+    assert_int_equal(PolyCpuCount(), 4);
+
+    for (int nested = 0; nested < 2; nested++)
+    {
+        Poly p = merge_test_poly(3000, 2, 1, nested, 0, 0);
+        Poly q = merge_test_poly(3000, 3, -1, nested, 0, 0);
+        Poly n = merge_test_poly(3000, 2, -1, nested, 0, 0);
+        Poly edges = merge_test_poly(3000, 2, -1, nested, 750, 4);
+
+        check_merge_parallel(&p, &q);
+        check_merge_parallel(&q, &p);
+        check_merge_parallel(&p, &edges);
+        check_merge_parallel(&edges, &p);
+
+        Poly z = PolyAdd(&p, &n);
+        assert_true(PolyIsZero(&z));
+
+        Poly r = PolyAdd(&p, &edges);
+        assert_int_equal(ListLen(r.l), 3000 - 3 * 8 - 2 * 4);
+
+        PolyDestroy(&p);
+        PolyDestroy(&q);
+        PolyDestroy(&n);
+        PolyDestroy(&edges);
+        PolyDestroy(&r);
+    }
+
+    PolyCpuCountSet(0);
+}
+
+/**
+ * Sprawdza `ListMerge` dla obu kolejności argumentów: porównuje wynik
+ * z sumą liczoną przez `PolyAddMonos` ze wszystkich wyrazów.
+ * @param[in] p : wielomian bez wyrazu wolnego
+ * @param[in] q : wielomian bez wyrazu wolnego
+ */
+static void check_merge(const Poly *p, const Poly *q)
+{
+    unsigned n = 0, k = 0;
+    const Poly *args[] = {p, q};
+
+    for (int i = 0; i < 2; i++)
+        for (ListIter it = ListIterBegin(args[i]->l); it.n != NULL;
+             ListIterNext(&it))
+            n++;
+
+    Mono *monos = malloc((n + 1) * sizeof(Mono));
+    assert_true(monos != NULL);
+
+    for (int i = 0; i < 2; i++)
+    {
+        for (ListIter it = ListIterBegin(args[i]->l); it.n != NULL;
+             ListIterNext(&it))
+        {
+            Poly c = ListIterCoeff(&it);
+            monos[k++] = (Mono) {.p = PolyClone(&c), .exp = ListIterExp(&it)};
+        }
+    }
+
+    Poly expected = PolyAddMonos(n, monos);
+    Poly pq = {.l = ListMerge(p->l, q->l), .c = 0};
+    Poly qp = {.l = ListMerge(q->l, p->l), .c = 0};
+
+    assert_true(PolyIsEq(&pq, &expected));
+    assert_true(PolyIsEq(&qp, &expected));
+
+    free(monos);
+    PolyDestroy(&expected);
+    PolyDestroy(&pq);
+    PolyDestroy(&qp);
+}
+
+/**
+ * Test scalania list: wyrazy przeplatające się, całkowicie się znoszące
+ * i jedna lista pusta, dla długości po obu stronach progu
+ * `LEAF_MERGE_MIN_LEN` oraz dla bloków gęstych obok liści.
+ */
+static void test_merge(void **state)
+{
+    (void)state;
+
+    for (unsigned np = 0; np <= 20; np++)
+    {
+        for (unsigned nq = 0; nq <= 20; nq++)
+        {
+            Poly p = merge_test_poly(np, 2, 1, false, 0, 0);
+            Poly q = merge_test_poly(nq, 3, -1, nq % 2 == 1, 0, 0);
+            Poly d = dense_poly(nq / 2 + 1, nq, 1);
+
+            check_merge(&p, &q);
+            check_merge(&p, &d);
+            check_merge(&d, &q);
+
+            PolyDestroy(&p);
+            PolyDestroy(&q);
+            PolyDestroy(&d);
+        }
+
+        for (int nested = 0; nested < 2; nested++)
+        {
+            Poly p = merge_test_poly(np, 2, 1, nested, 0, 0);
+            Poly n = merge_test_poly(np, 2, -1, nested, 0, 0);
+            Poly d = dense_poly(1, np, 1), e = dense_poly(1, np, -1);
+
+            assert_true(ListMerge(p.l, n.l) == NULL);
+            assert_true(ListMerge(d.l, e.l) == NULL);
+
+            PolyDestroy(&p);
+            PolyDestroy(&n);
+            PolyDestroy(&d);
+            PolyDestroy(&e);
+        }
+    }
+}
+
+/**
+ * Tworzy wielomian @f$x_0^{e_0} x_1^{e_1} x_2^{e_2} + c@f$.
+ * @param[in] e0 : wykładnik zmiennej @f$x_0@f$
+ * @param[in] e1 : wykładnik zmiennej @f$x_1@f$
+ * @param[in] e2 : wykładnik zmiennej @f$x_2@f$
+ * @param[in] c : wyraz wolny
+ * @return wielomian
+ */
+static Poly dist_test_poly(poly_exp_t e0, poly_exp_t e1, poly_exp_t e2,
+                           poly_coeff_t c)
+{
+    Poly p = PolyFromCoeff(1);
+    poly_exp_t exps[] = {e2, e1, e0};
+
+    for (int i = 0; i < 3; i++)
+    {
+        Mono m = MonoFromPoly(&p, exps[i]);
+        p = PolyAddMonos(1, &m);
+    }
+
+    Poly q = PolyFromCoeff(c);
+    Poly res = PolyAdd(&p, &q);
+    PolyDestroy(&p);
+
+    return res;
+}
+
+/**
+ * Test przerabiania wielomianu na reprezentację rozproszoną i z powrotem.
+ */
+static void test_dist_round_trip(void **state)
+{
+    (void)state;
+
+    Poly p = dist_test_poly(3, 1, 7, -2);
+    Poly q = dist_test_poly(0, 5, 2, 4);
+    Poly r = PolyAdd(&p, &q);
+    poly_exp_t degs[3] = {0};
+    DistLayout l;
+
+    assert_int_equal(DistVars(&r), 3);
+    assert_int_equal(DistDegrees(&r, degs), 3);
+    assert_true(degs[0] == 3 && degs[1] == 5 && degs[2] == 7);
+    assert_true(DistLayoutInit(&l, 3, 7));
+
+    DistPoly d = DistFromPoly(&r, &l);
+    assert_int_equal(d.len, 3);
+
+    Poly back = DistToPoly(&d);
+    assert_true(PolyIsEq(&back, &r));
+
+    DistDestroy(&d);
+    PolyDestroy(&p);
+    PolyDestroy(&q);
+    PolyDestroy(&r);
+    PolyDestroy(&back);
+}
+
+/**
+ * Test mnożenia w reprezentacji rozproszonej i wykrywania przepełnienia pól.
+ */
+static void test_dist_mul(void **state)
+{
+    (void)state;
+
+    Poly p = dist_test_poly(3, 1, 7, -2);
+    Poly q = dist_test_poly(1, 2, 1, 5);
+    Poly expected = PolyMul(&p, &q);
+    DistLayout l;
+
+    assert_true(DistLayoutInit(&l, 3, 8));
+
+    DistPoly a = DistFromPoly(&p, &l), b = DistFromPoly(&q, &l), c;
+    assert_true(DistMul(&a, &b, &c));
+
+    Poly got = DistToPoly(&c);
+    assert_true(PolyIsEq(&got, &expected));
+
+    /* Pole na wykładniki do 7 nie pomieści x_2^14. */
+    DistLayout small;
+    assert_true(DistLayoutInit(&small, 3, 7));
+
+    DistPoly s = DistFromPoly(&p, &small), t;
+    assert_true(!DistMul(&s, &s, &t));
+
+    DistDestroy(&a);
+    DistDestroy(&b);
+    DistDestroy(&c);
+    DistDestroy(&s);
+    PolyDestroy(&p);
+    PolyDestroy(&q);
+    PolyDestroy(&expected);
+    PolyDestroy(&got);
+}
+
+/**
+ * Test mnożenia kopcem dla kluczy jedno- i dwusłowowych.
+ */
+static void test_dist_mul_words(void **state)
+{
+    (void)state;
+
+    Poly p = PolyZero(), q = PolyZero();
+
+    for (int i = 0; i < 4; i++)
+    {
+        Poly x = dist_test_poly(100 * i, 7 * i + 3, 400 - 90 * i, i - 2);
+        Poly y = dist_test_poly(3 * i, 250 - 60 * i, 11 * i, 2 * i + 1);
+        Poly p2 = PolyAdd(&p, &x), q2 = PolyAdd(&q, &y);
+
+        PolyDestroy(&p);
+        PolyDestroy(&q);
+        PolyDestroy(&x);
+        PolyDestroy(&y);
+        p = p2;
+        q = q2;
+    }
+
+    Poly expected = PolyMul(&p, &q);
+    poly_exp_t max_exps[] = {1000, 1 << 21};
+
+    for (int k = 0; k < 2; k++)
+    {
+        DistLayout l;
+        assert_true(DistLayoutInit(&l, 3, max_exps[k]));
+        assert_true((l.per_word >= 3) == (k == 0));
+
+        DistPoly a = DistFromPoly(&p, &l), b = DistFromPoly(&q, &l), c;
+        assert_true(DistMul(&a, &b, &c));
+
+        Poly got = DistToPoly(&c);
+        assert_true(PolyIsEq(&got, &expected));
+
+        DistDestroy(&a);
+        DistDestroy(&b);
+        DistDestroy(&c);
+        PolyDestroy(&got);
+    }
+
+    PolyDestroy(&p);
+    PolyDestroy(&q);
+    PolyDestroy(&expected);
+}
+
+/**
+ * Test tablicy unikalnych wielomianów: równe współczynniki iloczynów są
+ * jednym obiektem, kopia zwiększa tylko licznik odwołań, a po usunięciu
+ * wszystkich wielomianów tablica jest pusta.
+ */
+static void test_intern(void **state)
+{
+    (void)state;
+
+    PolyInternSet(true);
+
+    Mono cm[] = {{.p = PolyFromCoeff(1), .exp = 0}, {.p = PolyFromCoeff(1), .exp = 1}};
+    Poly c = PolyAddMonos(2, cm);
+    Mono pm[] = {{.p = PolyClone(&c), .exp = 1}, {.p = PolyClone(&c), .exp = 3}};
+    Poly p = PolyAddMonos(2, pm);
+
+    assert_true(p.l->m.p.l == c.l);
+    assert_true(p.l->next->m.p.l == c.l);
+
+    Poly r1 = PolyMul(&p, &p), r2 = PolyMul(&p, &p), r3 = PolyClone(&r1);
+
+    assert_true(r1.l == r2.l);
+    assert_true(r1.l == r3.l);
+    assert_true(PolyIsEq(&r1, &r2));
+    assert_false(PolyIsEq(&r1, &p));
+
+    /* c, p, c^2, 2c^2 i p^2; odwołania spoza tablicy: c, p i trzy do p^2. */
+    PolyInternStats st = PolyInternReport();
+    assert_int_equal(st.lists, 5);
+    assert_int_equal(st.refs, 5);
+    assert_true(st.tree_bytes > (double)st.bytes);
+
+    PolyDestroy(&c);
+    PolyDestroy(&p);
+    PolyDestroy(&r1);
+    PolyDestroy(&r2);
+    PolyDestroy(&r3);
+
+    assert_int_equal(PolyInternReport().lists, 0);
+
+    PolyInternSet(false);
+}
+
+/**
+ * Test poleceń `INTERN` i `MEMORY`.
+ */
+static void test_parse_intern(void **state) {
+    (void)state;
+
+    char expected[64];
+
+    init_input_stream("((1,1),1)\nINTERN\nCLONE\nMEMORY\nMUL\nMEMORY\n");
+
+    assert_int_equal(mock_main(), 0);
+    PolyInternSet(false);
+
+    snprintf(expected, sizeof(expected), "2 2 %zu %zu\n2 1 %zu %zu\n",
+             2 * sizeof(Node), 4 * sizeof(Node), 2 * sizeof(Node), 2 * sizeof(Node));
+    assert_string_equal(printf_buffer, expected);
+    assert_string_equal(fprintf_buffer, "");
+}
+
+/**
+ * Test wielomianów w trwałym drzewie: suma współdzieli drzewo z argumentem,
+ * który nadal ma poprzednią wartość, a skracające się wyrazy znikają.
+ */
+static void test_tree(void **state)
+{
+    (void)state;
+
+    Mono pm[1000];
+    for (unsigned i = 0; i < 1000; i++)
+        pm[i] = (Mono) {.p = PolyFromCoeff(i + 1), .exp = 2 * i};
+    Poly p = PolyAddMonos(1000, pm);
+    Poly t = PolyToTree(&p);
+
+    assert_true(PolyIsTree(&t));
+    assert_true(PolyIsEq(&t, &p));
+
+    Mono sm[] = {{.p = PolyFromCoeff(7), .exp = 1}, {.p = PolyFromCoeff(-1), .exp = 0}};
+    Poly s = PolyAddMonos(2, sm);
+    Poly u = PolyAdd(&t, &s), w = PolyAdd(&p, &s);
+
+    assert_true(PolyIsTree(&u));
+    assert_true(PolyIsEq(&u, &w));
+    assert_true(PolyIsEq(&t, &p));
+    assert_false(PolyIsEq(&u, &t));
+    assert_int_equal(PolyDeg(&u), 1998);
+
+    Poly v = PolySub(&u, &s);
+
+    assert_true(PolyIsTree(&v));
+    assert_true(PolyIsEq(&v, &t));
+
+    Poly l = PolyToList(&u);
+
+    assert_false(PolyIsTree(&l));
+    assert_true(PolyIsEq(&l, &w));
+
+    Poly d = PolySub(&u, &t);
+
+    assert_true(PolyIsEq(&d, &s));
+
+    PolyDestroy(&p);
+    PolyDestroy(&t);
+    PolyDestroy(&s);
+    PolyDestroy(&u);
+    PolyDestroy(&w);
+    PolyDestroy(&v);
+    PolyDestroy(&l);
+    PolyDestroy(&d);
+}
+
+/**
+ * Test polecenia `TREE`: kopia sprzed dodawania zachowuje swoją wartość.
+ */
+static void test_parse_tree(void **state) {
+    (void)state;
+
+    init_input_stream("(1,0)+(1,5)\nTREE\nCLONE\n(2,5)+(-1,0)\nADD\nPRINT\n"
+                      "POP\nPRINT\n");
+
+    assert_int_equal(mock_main(), 0);
+    assert_string_equal(printf_buffer, "(3,5)\n(1,0)+(1,5)\n");
+    assert_string_equal(fprintf_buffer, "");
+}
+
+/**
+ * Test przenumerowania zmiennych: wynik jest złożeniem ze zmiennymi
+ * w nowej kolejności, a permutacja odwrotna przywraca wielomian.
+ * Wybrana kolejność stawia na zewnątrz zmienną o najmniejszej liczbie
+ * różnych wykładników.
+ */
+static void test_reorder(void **state)
+{
+    (void)state;
+
+    /* p = sum_i x_0^i (1 + x_1) */
+    Mono pm[50];
+    for (unsigned i = 0; i < 50; i++)
+    {
+        Mono cm[] = {{.p = PolyFromCoeff(1), .exp = 0}, {.p = PolyFromCoeff(1), .exp = 1}};
+        Poly c = PolyAddMonos(2, cm);
+        pm[i] = MonoFromPoly(&c, i);
+    }
+    Poly p = PolyAddMonos(50, pm);
+
+    assert_int_equal(PolyVars(&p), 2);
+
+    unsigned perm[2];
+    PolyReorderChoose(1, &p, 2, perm);
+    assert_int_equal(perm[0], 1);
+    assert_int_equal(perm[1], 0);
+
+    Poly q = PolyPermute(&p, 2, perm);
+
+    Poly one = PolyFromCoeff(1), zero = PolyZero();
+    Mono x0m = MonoFromPoly(&one, 1);
+    Poly x0 = PolyAddMonos(1, &x0m);
+    Poly x0c = PolyClone(&x0);
+    Mono x1m = MonoFromPoly(&x0c, 0);
+    Poly x1 = PolyAddMonos(1, &x1m);
+    Poly xs[] = {x1, x0};
+    Poly composed = PolyCompose(&p, 2, xs);
+
+    assert_true(PolyIsEq(&q, &composed));
+    assert_int_equal(PolyDegBy(&q, 0), 1);
+    assert_int_equal(PolyDegBy(&q, 1), 49);
+
+    /* Zamiana dwóch zmiennych jest swoją odwrotnością. */
+    Poly r = PolyPermute(&q, 2, perm);
+
+    assert_true(PolyIsEq(&r, &p));
+
+    Poly z = PolyPermute(&zero, 2, perm);
+    assert_true(PolyIsZero(&z));
+
+    PolyDestroy(&p);
+    PolyDestroy(&q);
+    PolyDestroy(&r);
+    PolyDestroy(&x0);
+    PolyDestroy(&x1);
+    PolyDestroy(&composed);
+}
+
+/**
+ * Test poleceń `REORDER` i `RESTORE`.
+ */
+static void test_parse_reorder(void **state) {
+    (void)state;
+
+    init_input_stream("((1,0)+(1,1),0)+((1,0)+(1,1),1)+((1,0)+(1,1),2)\n"
+                      "REORDER\nPRINT\nRESTORE\nPRINT\n");
+
+    assert_int_equal(mock_main(), 0);
+    assert_string_equal(printf_buffer, "1 0\n"
+                        "((1,0)+(1,1)+(1,2),0)+((1,0)+(1,1)+(1,2),1)\n"
+                        "((1,0)+(1,1),0)+((1,0)+(1,1),1)+((1,0)+(1,1),2)\n");
+    assert_string_equal(fprintf_buffer, "");
+}
+
+/**
+ * Sprawdza, czy kwadrat wielomianu jest równy iloczynowi przez siebie.
+ * @param[in] p : wielomian, przejmowany na własność
+ */
+static void check_sqr(Poly p)
+{
+    Poly sq = PolySqr(&p), mul = PolyMul(&p, &p);
+
+    assert_true(PolyIsEq(&sq, &mul));
+
+    PolyDestroy(&p);
+    PolyDestroy(&sq);
+    PolyDestroy(&mul);
+}
+
+/**
+ * Test podnoszenia do kwadratu: wielomian jednej zmiennej gęsty i rzadki,
+ * wielomian wielu zmiennych w reprezentacji rozproszonej i wielomian
+ * o niewielu wyrazach mnożony rekurencyjnie.
+ */
+static void test_sqr(void **state)
+{
+    (void)state;
+
+    Mono dm[40], sm[40], mm[12], nm[2];
+    for (unsigned i = 0; i < 40; i++)
+    {
+        dm[i] = (Mono) {.p = PolyFromCoeff((poly_coeff_t)i - 20), .exp = i};
+        sm[i] = (Mono) {.p = PolyFromCoeff(3 * i + 1), .exp = i * i * 1000};
+    }
+    for (unsigned i = 0; i < 12; i++)
+    {
+        Mono cm[] = {{.p = PolyFromCoeff(1), .exp = 0},
+                     {.p = PolyFromCoeff(-(poly_coeff_t)i), .exp = i % 4 + 1}};
+        Poly c = PolyAddMonos(2, cm);
+        mm[i] = MonoFromPoly(&c, 2 * i);
+        if (i < 2)
+        {
+            Poly d = PolyClone(&c);
+            nm[i] = MonoFromPoly(&d, 3 * i);
+        }
+    }
+    check_sqr(PolyAddMonos(40, dm));
+    check_sqr(PolyAddMonos(40, sm));
+    check_sqr(PolyAddMonos(12, mm));
+    check_sqr(PolyAddMonos(2, nm));
+
+    /* Kwadraty się mieszczą, przepełnia się tylko podwojony iloczyn. */
+    poly_coeff_t half = (poly_coeff_t)1 << (COEFF_HALF_BITS - 1);
+    Mono om[] = {{.p = PolyFromCoeff(half), .exp = 0},
+                 {.p = PolyFromCoeff(half), .exp = 1}};
+    Poly o = PolyAddMonos(2, om);
+    PolyCoeffOverflow();
+    Poly osq = PolySqr(&o);
+
+    assert_true(PolyCoeffOverflow());
+    assert_int_equal(PolyDeg(&osq), 2);
+
+    Poly c = PolyFromCoeff(-7), csq = PolySqr(&c);
+    assert_int_equal(csq.c, 49);
+
+    PolyDestroy(&o);
+    PolyDestroy(&osq);
+}
+
+/**
+ * Test polecenia `SQR`.
+ */
+static void test_parse_sqr(void **state) {
+    (void)state;
+
+    init_input_stream("(1,0)+(2,1)\nSQR\nPRINT\n((1,0)+(1,1),1)\nTREE\nSQR\n"
+                      "PRINT\n");
+
+    assert_int_equal(mock_main(), 0);
+    assert_string_equal(printf_buffer, "(1,0)+(4,1)+(4,2)\n"
+                        "((1,0)+(2,1)+(1,2),2)\n");
+    assert_string_equal(fprintf_buffer, "");
+}
+
+/**
+ * Sprawdza, czy potęga wielomianu jest równa iloczynowi kolejnych mnożeń.
+ * @param[in] p : wielomian, przejmowany na własność
+ * @param[in] exp : wykładnik
+ */
+static void check_pow(Poly p, poly_exp_t exp)
+{
+    Poly pow = PolyPow(&p, exp), mul = PolyFromCoeff(1);
+
+    for (poly_exp_t k = 0; k < exp; k++)
+    {
+        Poly tmp = PolyMul(&mul, &p);
+        PolyDestroy(&mul);
+        mul = tmp;
+    }
+
+    assert_true(PolyIsEq(&pow, &mul));
+
+    PolyDestroy(&p);
+    PolyDestroy(&pow);
+    PolyDestroy(&mul);
+}
+
+/**
+ * Test potęgowania: jednomian, dwumian o stałych i o wielomianowych
+ * współczynnikach, rzadki i gęsty trójmian oraz rzadka podstawa o wielu
+ * wyrazach. Współczynniki dwumianowe modulo @f$2^{64}@f$ są dokładne także
+ * wtedy, gdy się nie mieszczą.
+ */
+static void test_pow(void **state)
+{
+    (void)state;
+
+    Mono bm[] = {{.p = PolyFromCoeff(-3), .exp = 2}, {.p = PolyFromCoeff(5), .exp = 1000}};
+    check_pow(PolyAddMonos(2, bm), 40);
+
+    Mono tm[] = {{.p = PolyFromCoeff(1), .exp = 0}, {.p = PolyFromCoeff(2), .exp = 100},
+                 {.p = PolyFromCoeff(-1), .exp = 10000}};
+    check_pow(PolyAddMonos(3, tm), 30);
+
+    Mono dm[] = {{.p = PolyFromCoeff(1), .exp = 0}, {.p = PolyFromCoeff(1), .exp = 1},
+                 {.p = PolyFromCoeff(1), .exp = 2}};
+    check_pow(PolyAddMonos(3, dm), 30);
+
+    Mono cm[] = {{.p = PolyFromCoeff(1), .exp = 0}, {.p = PolyFromCoeff(2), .exp = 1}};
+    Poly c = PolyAddMonos(2, cm), d = PolyClone(&c);
+    Mono nm[] = {MonoFromPoly(&c, 0), MonoFromPoly(&d, 7)};
+    check_pow(PolyAddMonos(2, nm), 12);
+
+    Poly e = PolyAddMonos(2, cm), f = PolyClone(&e);
+    Mono mm[] = {MonoFromPoly(&e, 3)};
+    check_pow(PolyAddMonos(1, mm), 9);
+
+    Mono sm[4];
+    for (unsigned i = 0; i < 4; i++)
+    {
+        Poly g = i == 0 ? PolyClone(&f) : PolyFromCoeff(i + 1);
+        sm[i] = MonoFromPoly(&g, 17 * i * i);
+    }
+    check_pow(PolyAddMonos(4, sm), 8);
+    PolyDestroy(&f);
+
+    /* binom(66, 33) > 2^63, a (1 + x)^66 w x = 1 to 2^66 = 0 modulo 2^64. */
+    Mono om[] = {{.p = PolyFromCoeff(1), .exp = 0}, {.p = PolyFromCoeff(1), .exp = 1}};
+    Poly o = PolyAddMonos(2, om);
+    PolyCoeffOverflow();
+    Poly opow = PolyPow(&o, 66), oat = PolyAt(&opow, 1);
+
+    assert_true(PolyCoeffOverflow());
+    assert_true(PolyIsZero(&oat));
+    assert_int_equal(PolyDeg(&opow), 66);
+
+    PolyDestroy(&o);
+    PolyDestroy(&opow);
+    PolyDestroy(&oat);
+}
+
+/**
+ * Test polecenia `POW`, także modulo liczba pierwsza mniejsza od wykładnika
+ * i z błędnym wykładnikiem.
+ */
+static void test_parse_pow(void **state) {
+    (void)state;
+
+    init_input_stream("(1,0)+(2,3)\nPOW 3\nPRINT\nMOD 3\n(1,0)+(1,1)\nPOW 4\n"
+                      "PRINT\nPOW -1\nMOD 0\n");
+
+    assert_int_equal(mock_main(), 0);
+    assert_string_equal(printf_buffer, "(1,0)+(6,3)+(12,6)+(8,9)\n"
+                        "(1,0)+(1,1)+(1,3)+(1,4)\n");
+    assert_string_equal(fprintf_buffer, "ERROR 8 WRONG EXPONENT\n");
+}
+
+/**
+ * Sprawdza obcięte mnożenie i potęgowanie z obcięciem pełnych wyników.
+ * @param[in] p : wielomian
+ * @param[in] q : wielomian
+ * @param[in] b : ograniczenia
+ */
+static void check_trunc(const Poly *p, const Poly *q, const PolyBound *b)
+{
+    Poly mul = PolyMul(p, q), pow = PolyPow(p, 5);
+    Poly mul_full = PolyTrunc(&mul, b), pow_full = PolyTrunc(&pow, b);
+    Poly mul_trunc = PolyMulTrunc(p, q, b), pow_trunc = PolyPowTrunc(p, 5, b);
+    Poly add = PolyAdd(p, q), add_full = PolyTrunc(&add, b);
+    Poly add_trunc = PolyAddTrunc(p, q, b);
+
+    assert_true(PolyIsEq(&mul_trunc, &mul_full));
+    assert_true(PolyIsEq(&pow_trunc, &pow_full));
+    assert_true(PolyIsEq(&add_trunc, &add_full));
+
+    PolyDestroy(&mul);
+    PolyDestroy(&pow);
+    PolyDestroy(&add);
+    PolyDestroy(&mul_full);
+    PolyDestroy(&pow_full);
+    PolyDestroy(&add_full);
+    PolyDestroy(&mul_trunc);
+    PolyDestroy(&pow_trunc);
+    PolyDestroy(&add_trunc);
+}
+
+/**
+ * Test arytmetyki obciętej: gęste i rzadkie wielomiany o stałych
+ * współczynnikach oraz wielomiany dwóch zmiennych, z ograniczeniami stopni
+ * zmiennych, stopnia całkowitego i obydwoma naraz.
+ */
+static void test_series(void **state)
+{
+    (void)state;
+
+    Mono am[21], bm[] = {{.p = PolyFromCoeff(2), .exp = 0},
+                         {.p = PolyFromCoeff(3), .exp = 5},
+                         {.p = PolyFromCoeff(1), .exp = 40}};
+    for (int i = 0; i <= 20; i++)
+        am[i] = (Mono) {.p = PolyFromCoeff(i + 1), .exp = i};
+    Poly a = PolyAddMonos(21, am), b = PolyAddMonos(3, bm);
+
+    Mono cm[] = {{.p = PolyFromCoeff(1), .exp = 0}, {.p = PolyFromCoeff(1), .exp = 1}};
+    Mono dm[] = {{.p = PolyFromCoeff(2), .exp = 0}, {.p = PolyFromCoeff(1), .exp = 3}};
+    Poly c0 = PolyAddMonos(2, cm), c2 = PolyAddMonos(2, dm), c7 = PolyFromCoeff(-1);
+    Poly d0 = PolyClone(&c2), d1 = PolyClone(&c0);
+    Mono xm[] = {MonoFromPoly(&c0, 0), MonoFromPoly(&c2, 2), MonoFromPoly(&c7, 7)};
+    Mono ym[] = {MonoFromPoly(&d0, 0), MonoFromPoly(&d1, 1)};
+    Poly x = PolyAddMonos(3, xm), y = PolyAddMonos(2, ym);
+
+    poly_exp_t per_var[] = {5, 2}, mixed[] = {-1, 1};
+    PolyBound bounds[] = {{.vars = 2, .max = per_var, .total = -1},
+                          {.vars = 0, .max = NULL, .total = 6},
+                          {.vars = 2, .max = mixed, .total = 4}};
+
+    for (unsigned i = 0; i < 3; i++)
+    {
+        check_trunc(&a, &b, &bounds[i]);
+        check_trunc(&a, &a, &bounds[i]);
+        check_trunc(&x, &y, &bounds[i]);
+        check_trunc(&x, &a, &bounds[i]);
+    }
+
+    Poly t = PolyTrunc(&x, &bounds[0]);
+    assert_int_equal(PolyDeg(&t), 2);
+    PolyDestroy(&t);
+
+    PolyDestroy(&a);
+    PolyDestroy(&b);
+    PolyDestroy(&x);
+    PolyDestroy(&y);
+}
+
+/**
+ * Test polecenia `SERIES`: obcinanie wyników i wczytanych wielomianów,
+ * błędne argumenty oraz wyłączenie ograniczenia.
+ */
+static void test_parse_series(void **state) {
+    (void)state;
+
+    init_input_stream("(1,0)+(1,1)\nSERIES 0 3\nPOW 5\nPRINT\n(1,0)+(1,5)\n"
+                      "PRINT\nSERIES 0\nSERIES x 1\nSERIES 0 -2\nSERIES 0 -1\n"
+                      "(1,0)+(1,5)\nPRINT\n");
+
+    assert_int_equal(mock_main(), 0);
+    assert_string_equal(printf_buffer, "(1,0)+(5,1)+(10,2)+(10,3)\n1\n"
+                        "(1,0)+(1,5)\n");
+    assert_string_equal(fprintf_buffer, "ERROR 7 WRONG EXPONENT\n"
+                        "ERROR 8 WRONG VARIABLE\nERROR 9 WRONG EXPONENT\n");
+}
+
+/**
+ * Test poleceń `REORDER` i `RESTORE` w trybie szeregów: ograniczenia
+ * stopni przechodzą na zmienne razem z nimi, więc wyrazy nie giną.
+ */
+static void test_parse_series_reorder(void **state) {
+    (void)state;
+
+    init_input_stream("((1,5),0)+((1,5),1)+((1,5),2)+((1,5),3)\nSERIES 0 3\n"
+                      "REORDER\nPRINT\nRESTORE\nPRINT\nSERIES 1 4\nPRINT\n");
+
+    assert_int_equal(mock_main(), 0);
+    assert_string_equal(printf_buffer, "1 0\n((1,0)+(1,1)+(1,2)+(1,3),5)\n"
+                        "((1,5),0)+((1,5),1)+((1,5),2)+((1,5),3)\n0\n");
+    assert_string_equal(fprintf_buffer, "");
+}
+
+/**
+ * Sprawdza, że dzielenie @f$q b + r@f$ przez @p b daje @p q i @p r,
+ * także dla dzielnej w drzewie.
+ * @param[in] b : dzielnik
+ * @param[in] q : iloraz
+ * @param[in] r : reszta stopnia mniejszego niż @p b
+ */
+static void check_div(const Poly *b, const Poly *q, const Poly *r)
+{
+    Poly qb = PolyMul(q, b), p = PolyAdd(&qb, r), t = PolyToTree(&p);
+    Poly quot, rem, tquot, trem;
+
+    assert_true(PolyDivRem(&p, b, &quot, &rem));
+    assert_true(PolyIsEq(&quot, q));
+    assert_true(PolyIsEq(&rem, r));
+
+    assert_true(PolyDivRem(&t, b, &tquot, &trem));
+    assert_true(PolyIsEq(&tquot, q));
+    assert_true(PolyIsEq(&trem, r));
+
+    PolyDestroy(&qb);
+    PolyDestroy(&p);
+    PolyDestroy(&t);
+    PolyDestroy(&quot);
+    PolyDestroy(&rem);
+    PolyDestroy(&tquot);
+    PolyDestroy(&trem);
+}
+
+/**
+ * Test dzielenia z resztą: dzielna o wielomianowych współczynnikach,
+ * rzadka dzielna wysokiego stopnia, dzielenie dokładne, niedopuszczalne
+ * dzielniki oraz duże gęste dzielenie modulo liczba pierwsza, liczone
+ * metodą Newtona.
+ */
+static void test_div(void **state)
+{
+    (void)state;
+
+    /* b = x^3 - 2x + 5, q = x^2 + x_1 x + 3, r = x_1^2 x + 4 */
+    Mono bm[] = {{.p = PolyFromCoeff(5), .exp = 0}, {.p = PolyFromCoeff(-2), .exp = 1},
+                 {.p = PolyFromCoeff(1), .exp = 3}};
+    Mono x1m[] = {{.p = PolyFromCoeff(1), .exp = 1}}, x1sq[] = {{.p = PolyFromCoeff(1), .exp = 2}};
+    Poly b = PolyAddMonos(3, bm), x1 = PolyAddMonos(1, x1m), x1s = PolyAddMonos(1, x1sq);
+    Mono qm[] = {{.p = PolyFromCoeff(3), .exp = 0}, MonoFromPoly(&x1, 1),
+                 {.p = PolyFromCoeff(1), .exp = 2}};
+    Mono rm[] = {{.p = PolyFromCoeff(4), .exp = 0}, MonoFromPoly(&x1s, 1)};
+    Poly q = PolyAddMonos(3, qm), r = PolyAddMonos(2, rm);
+
+    check_div(&b, &q, &r);
+
+    Poly qb = PolyMul(&q, &b), quot;
+    assert_true(PolyDivExact(&qb, &b, &quot));
+    assert_true(PolyIsEq(&quot, &q));
+    PolyDestroy(&quot);
+
+    Poly qbr = PolyAdd(&qb, &r);
+    assert_false(PolyDivExact(&qbr, &b, &quot));
+
+    Mono sm[] = {{.p = PolyFromCoeff(1), .exp = 0}, {.p = PolyFromCoeff(-1), .exp = 5000}};
+    Poly sq = PolyAddMonos(2, sm), one = PolyFromCoeff(1);
+    check_div(&b, &sq, &one);
+
+    Mono wm[] = {{.p = PolyFromCoeff(1), .exp = 0}, {.p = PolyFromCoeff(2), .exp = 1}};
+    Poly w = PolyAddMonos(2, wm), z = PolyZero(), rem;
+    assert_false(PolyDivRem(&qb, &w, &quot, &rem));
+    assert_false(PolyDivRem(&qb, &z, &quot, &rem));
+    assert_false(PolyDivRem(&qb, &q, &quot, &rem));
+
+    PolyCoeffModSet(998244353);
+
+    Poly db = dense_test_poly(2600, 37, 11), dq = dense_test_poly(2500, 91, 5);
+    Poly dr = dense_test_poly(2599, 13, 7);
+    check_div(&db, &dq, &dr);
+    check_div(&db, &dq, &z);
+
+    PolyCoeffModSet(0);
+
+    PolyDestroy(&b);
+    PolyDestroy(&q);
+    PolyDestroy(&r);
+    PolyDestroy(&qb);
+    PolyDestroy(&qbr);
+    PolyDestroy(&sq);
+    PolyDestroy(&w);
+    PolyDestroy(&db);
+    PolyDestroy(&dq);
+    PolyDestroy(&dr);
+}
+
+/**
+ * Test poleceń `DIV` i `REM`, także z niedopuszczalnymi dzielnikami
+ * i modulo liczba pierwsza.
+ */
+static void test_parse_div(void **state) {
+    (void)state;
+
+    init_input_stream("(1,0)+(1,1)\n(-1,0)+(1,2)\nDIV\nPRINT\n(1,0)+(1,1)\n"
+                      "(1,0)+(1,3)\nREM\nPRINT\n((1,1),1)\n(1,2)\nDIV\nPOP\nPOP\n"
+                      "(2,1)\n(1,0)\nDIV\nPOP\nPOP\nMOD 7\n(3,1)\n(1,0)+(1,1)\n"
+                      "DIV\nPRINT\nMOD 0\n");
+
+    assert_int_equal(mock_main(), 0);
+    assert_string_equal(printf_buffer, "(-1,0)+(1,1)\n0\n5\n");
+    assert_string_equal(fprintf_buffer, "ERROR 11 WRONG DIVISOR\n"
+                        "ERROR 16 WRONG DIVISOR\n");
+}
+
+/**
+ * Test NWD: wielomiany wielu zmiennych o współczynnikach całkowitych,
+ * wejście w postaci drzewa, wielomiany zerowe, złożony modulus oraz
+ * gęste wielomiany jednej zmiennej modulo liczba pierwsza.
+ */
+static void test_gcd(void **state)
+{
+    (void)state;
+
+    /* g = x_0 + x_1, a = 2 g (x_0 - 2), b = 4 g (x_0 + 3 x_1) */
+    Mono x1m[] = {{.p = PolyFromCoeff(1), .exp = 1}}, x13m[] = {{.p = PolyFromCoeff(3), .exp = 1}};
+    Poly x1 = PolyAddMonos(1, x1m), x13 = PolyAddMonos(1, x13m);
+    Mono gm[] = {MonoFromPoly(&x1, 0), {.p = PolyFromCoeff(1), .exp = 1}};
+    Mono um[] = {{.p = PolyFromCoeff(-4), .exp = 0}, {.p = PolyFromCoeff(2), .exp = 1}};
+    Mono vm[] = {MonoFromPoly(&x13, 0), {.p = PolyFromCoeff(1), .exp = 1}};
+    Poly g = PolyAddMonos(2, gm), u = PolyAddMonos(2, um), v = PolyAddMonos(2, vm);
+    Poly four = PolyFromCoeff(4), two = PolyFromCoeff(2), v4 = PolyMul(&v, &four);
+    Poly a = PolyMul(&g, &u), b = PolyMul(&g, &v4), g2 = PolyMul(&g, &two);
+    Poly t = PolyToTree(&a), res;
+
+    assert_true(PolyGcd(&a, &b, &res));
+    assert_true(PolyIsEq(&res, &g2));
+    PolyDestroy(&res);
+
+    assert_true(PolyGcd(&t, &b, &res));
+    assert_true(PolyIsEq(&res, &g2));
+    PolyDestroy(&res);
+
+    Poly z = PolyZero(), nb = PolyNeg(&b);
+    assert_true(PolyGcd(&z, &nb, &res));
+    assert_true(PolyIsEq(&res, &b));
+    PolyDestroy(&res);
+
+    Poly one = PolyFromCoeff(1);
+    assert_true(PolyGcd(&u, &v, &res));
+    assert_true(PolyIsEq(&res, &one));
+    PolyDestroy(&res);
+
+    PolyCoeffModSet(6);
+    assert_false(PolyGcd(&a, &b, &res));
+
+    PolyCoeffModSet(998244353);
+
+    Poly dg = dense_test_poly(300, 37, 11), du = dense_test_poly(250, 91, 5);
+    Poly dv = dense_test_poly(280, 13, 7);
+    Poly da = PolyMul(&dg, &du), db = PolyMul(&dg, &dv), quot;
+
+    assert_true(PolyGcd(&da, &db, &res));
+    assert_true(PolyDivExact(&res, &dg, &quot));
+    assert_true(PolyIsCoeff(&quot));
+    assert_true(PolyDivExact(&da, &res, &quot));
+    PolyDestroy(&quot);
+    PolyDestroy(&res);
+
+    PolyCoeffModSet(0);
+
+    PolyDestroy(&g);
+    PolyDestroy(&u);
+    PolyDestroy(&v);
+    PolyDestroy(&v4);
+    PolyDestroy(&a);
+    PolyDestroy(&b);
+    PolyDestroy(&g2);
+    PolyDestroy(&t);
+    PolyDestroy(&nb);
+    PolyDestroy(&dg);
+    PolyDestroy(&du);
+    PolyDestroy(&dv);
+    PolyDestroy(&da);
+    PolyDestroy(&db);
+}
+
+/**
+ * Tworzy gęsty wielomian dwóch zmiennych o @p n wyrazach w każdej z nich.
+ * @param[in] n : liczba wyrazów
+ * @param[in] a : mnożnik współczynników
+ * @return wielomian
+ */
+static Poly dense_test_poly2(unsigned n, long a)
+{
+    Mono *monos = malloc(n * sizeof(Mono));
+    assert_true(monos != NULL);
+
+    for (unsigned i = 0; i < n; i++)
+    {
+        Poly c = dense_test_poly(n, a + i, i);
+        monos[i] = MonoFromPoly(&c, i);
+    }
+
+    Poly res = PolyAddMonos(n, monos);
+
+    free(monos);
+
+    return res;
+}
+
+/**
+ * Test NWD dwóch zmiennych w kilku wątkach bez tablicy unikalnych
+ * wielomianów i z nią; po usunięciu wielomianów tablica jest pusta.
+ */
+static void test_gcd_intern(void **state)
+{
+    (void)state;
+
+    PolyCpuCountSet(4);
+
+    for (int intern = 0; intern < 2; intern++)
+    {
+        PolyInternSet(intern);
+
+        Poly g = dense_test_poly2(12, 5), u = dense_test_poly2(10, 17);
+        Poly v = dense_test_poly2(11, 29);
+        Poly a = PolyMul(&g, &u), b = PolyMul(&g, &v), res;
+
+        assert_true(PolyGcd(&a, &b, &res));
+        assert_true(PolyIsEq(&res, &g));
+
+        PolyDestroy(&res);
+        PolyDestroy(&g);
+        PolyDestroy(&u);
+        PolyDestroy(&v);
+        PolyDestroy(&a);
+        PolyDestroy(&b);
+    }
+
+    assert_int_equal(PolyInternReport().lists, 0);
+
+    PolyInternSet(false);
+    PolyCpuCountSet(0);
+}
+
+/**
+ * Test polecenia `GCD`, także modulo liczba pierwsza i z modulusem
+ * złożonym.
+ */
+static void test_parse_gcd(void **state) {
+    (void)state;
+
+    init_input_stream("(1,0)+(1,1)\n(-1,0)+(1,2)\nGCD\nPRINT\n(2,0)+(2,1)\n"
+                      "(-4,0)+(4,2)\nGCD\nPRINT\n((1,1),0)+(1,1)\n"
+                      "((1,1),1)+(1,2)\nGCD\nPRINT\nMOD 7\n(3,0)+(3,1)\n"
+                      "(5,0)+(2,2)\nGCD\nPRINT\nMOD 6\n(1,1)\n(1,1)\nGCD\n"
+                      "MOD 0\n");
+
+    assert_int_equal(mock_main(), 0);
+    assert_string_equal(printf_buffer, "(1,0)+(1,1)\n(2,0)+(2,1)\n"
+                        "((1,1),0)+(1,1)\n(1,0)+(1,1)\n");
+    assert_string_equal(fprintf_buffer, "ERROR 21 GCD FAILED\n");
+}
+
+/**
+ * Test probabilistycznego porównania: te same wielomiany w różnych
+ * postaciach, współczynniki różniące się o wielokrotność modułu wartości
+ * oraz długie gęste wielomiany, liczone w wątkach.
+ */
+static void test_is_eq_fast(void **state)
+{
+    (void)state;
+
+    Poly a = dense_test_poly(5000, 37, 11), b = dense_test_poly(5000, 91, 5);
+    Poly ab = PolyMul(&a, &b), ba = PolyMul(&b, &a), t = PolyToTree(&ab);
+    Poly one = PolyFromCoeff(1), ab1 = PolyAdd(&ab, &one);
+
+    assert_true(PolyIsEqFast(&ab, &ba));
+    assert_true(PolyIsEqFast(&t, &ba));
+    assert_true(PolyIsEqFast(&ab, &ab));
+    assert_false(PolyIsEqFast(&ab1, &ba));
+    assert_false(PolyIsEqFast(&a, &b));
+
+    /* x_1^2 c x_0 + 1 i 1, gdzie c = EQ_FAST_COEFF */
+    Mono cm[] = {{.p = PolyFromCoeff(EQ_FAST_COEFF), .exp = 2}};
+    Poly c = PolyAddMonos(1, cm);
+    Mono pm[] = {{.p = PolyFromCoeff(1), .exp = 0}, MonoFromPoly(&c, 1)};
+    Poly p = PolyAddMonos(2, pm);
+
+    assert_false(PolyIsEqFast(&p, &one));
+    assert_false(PolyIsEqFast(&one, &p));
+    assert_true(PolyIsEqFast(&one, &one));
+
+    PolyDestroy(&a);
+    PolyDestroy(&b);
+    PolyDestroy(&ab);
+    PolyDestroy(&ba);
+    PolyDestroy(&t);
+    PolyDestroy(&ab1);
+    PolyDestroy(&p);
+}
+
+/**
+ * Test polecenia `IS_EQ_FAST`.
+ */
+static void test_parse_is_eq_fast(void **state) {
+    (void)state;
+
+    init_input_stream("((1,2),1)+(3,4)\n(3,4)+((1,2),1)\nIS_EQ_FAST\n"
+                      "(3,4)\nIS_EQ_FAST\nPOP\nPOP\nPOP\nIS_EQ_FAST\n"
+                      "(" TEST_STR(EQ_FAST_COEFF) ",1)\nZERO\nIS_EQ_FAST\n");
+
+    assert_int_equal(mock_main(), 0);
+    assert_string_equal(printf_buffer, "1\n0\n0\n");
+    assert_string_equal(fprintf_buffer, "ERROR 9 STACK UNDERFLOW\n");
+}
+
+/**
+ * Test sumy wielu wielomianów jednym scalaniem: porównanie z sumą
+ * liczoną parami dla składników o wielomianowych współczynnikach, stałych,
+ * drzew i odejmowanych składników, także modulo.
+ */
+static void test_add_all(void **state)
+{
+    (void)state;
+
+    for (unsigned mod = 0; mod < 2; mod++)
+    {
+        PolyCoeffModSet(mod ? 998244353 : 0);
+
+        Poly ps[12];
+        bool neg[12];
+
+        for (unsigned i = 0; i < 12; i++)
+        {
+            neg[i] = i % 3 == 1;
+            if (i % 4 == 3)
+            {
+                ps[i] = PolyFromCoeff(i);
+                continue;
+            }
+
+            Poly d = dense_test_poly(30 + 7 * i, 13 * i + 1, i);
+            Mono m[] = {MonoFromPoly(&d, i % 3), {.p = PolyFromCoeff(i + 1), .exp = 40 + i}};
+
+            ps[i] = PolyAddMonos(2, m);
+            if (i % 4 == 1)
+            {
+                Poly t = PolyToTree(&ps[i]);
+                PolyDestroy(&ps[i]);
+                ps[i] = t;
+            }
+        }
+
+        Poly expected = PolyZero();
+
+        for (unsigned i = 0; i < 12; i++)
+        {
+            Poly tmp = neg[i] ? PolySub(&expected, &ps[i]) : PolyAdd(&expected, &ps[i]);
+            PolyDestroy(&expected);
+            expected = tmp;
+        }
+
+        Poly res = PolyAddAll(12, ps, neg), plain = PolyAddAll(12, ps, NULL);
+        assert_true(PolyIsEq(&res, &expected));
+
+        for (unsigned i = 0; i < 12; i++)
+            neg[i] = !neg[i];
+        Poly opposite = PolyAddAll(12, ps, neg), zero = PolyAdd(&res, &opposite);
+        assert_true(PolyIsZero(&zero));
+
+        /* Składniki i ich przeciwieństwa znoszą się do zera. */
+        Poly both[24];
+        bool both_neg[24];
+        for (unsigned i = 0; i < 24; i++)
+        {
+            both[i] = ps[i % 12];
+            both_neg[i] = i >= 12;
+        }
+        Poly cancel = PolyAddAll(24, both, both_neg);
+        assert_true(PolyIsZero(&cancel));
+
+        Poly sum = PolyZero();
+        for (unsigned i = 0; i < 12; i++)
+        {
+            Poly tmp = PolyAdd(&sum, &ps[i]);
+            PolyDestroy(&sum);
+            sum = tmp;
+        }
+        assert_true(PolyIsEq(&plain, &sum));
+
+        PolyDestroy(&expected);
+        PolyDestroy(&res);
+        PolyDestroy(&plain);
+        PolyDestroy(&opposite);
+        PolyDestroy(&zero);
+        PolyDestroy(&cancel);
+        PolyDestroy(&sum);
+        for (unsigned i = 0; i < 12; i++)
+            PolyDestroy(&ps[i]);
+    }
+
+    PolyCoeffModSet(0);
+}
+
+/**
+ * Test trybu leniwego: sumy, różnice, negacje i iloczyny, współdzielenie
+ * wyrażeń przez `CLONE` i liczenie wyrażeń przed `MOD`.
+ */
+static void test_parse_lazy(void **state) {
+    (void)state;
+
+    init_input_stream("LAZY\n(1,1)\n(2,0)\nADD\nCLONE\nMUL\nPRINT\n"
+                      "(1,2)\n(1,0)\nSUB\nNEG\nCLONE\nNEG\nADD\nIS_ZERO\n"
+                      "POP\n(3,1)\n(1,1)\nMUL\nNEG\n(2,0)\nADD\nCLONE\n"
+                      "MOD 5\nPRINT\nADD\nPRINT\nDEG\nMOD 0\n(1,1)\n(1,1)\n"
+                      "MUL\n(1,0)\n(1,1)\nMUL\nNEG\nADD\n(5,0)\nSUB\n(2,0)\n"
+                      "(1,2)\nMUL\nADD\nPRINT\n");
+
+    assert_int_equal(mock_main(), 0);
+    assert_string_equal(printf_buffer, "(4,0)+(4,1)+(1,2)\n1\n"
+                        "(2,0)+(2,2)\n(4,0)+(4,2)\n2\n"
+                        "(5,0)+(1,1)+(1,2)\n");
+    assert_string_equal(fprintf_buffer, "");
+}
+
+/**
+ * Sprawdza iloczyn wielu czynników z iloczynem liczonym parami,
+ * także z obcięciem.
+ * @param[in] count : liczba czynników
+ * @param[in] ps : czynniki
+ * @param[in] b : ograniczenia
+ */
+static void check_mul_all(unsigned count, const Poly ps[], const PolyBound *b)
+{
+    Poly expected = PolyFromCoeff(1);
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        Poly tmp = PolyMul(&expected, &ps[i]);
+        PolyDestroy(&expected);
+        expected = tmp;
+    }
+
+    Poly res = PolyMulAll(count, ps), trunc = PolyMulAllTrunc(count, ps, b);
+    Poly trunc_full = PolyTrunc(&expected, b);
+
+    assert_true(PolyIsEq(&res, &expected));
+    assert_true(PolyIsEq(&trunc, &trunc_full));
+
+    PolyDestroy(&expected);
+    PolyDestroy(&res);
+    PolyDestroy(&trunc);
+    PolyDestroy(&trunc_full);
+}
+
+/**
+ * Test mnożenia wielu wielomianów: gęste czynniki (drzewo iloczynów),
+ * rzadkie czynniki wypełniające przestrzeń wykładników (mnożenie kolejne),
+ * czynniki w drzewie i o wielomianowych współczynnikach, także modulo.
+ */
+static void test_mul_all(void **state)
+{
+    (void)state;
+
+    poly_exp_t max[] = {70, 3};
+    PolyBound b = {.vars = 2, .max = max, .total = -1};
+
+    for (unsigned mod = 0; mod < 2; mod++)
+    {
+        PolyCoeffModSet(mod ? 998244353 : 0);
+
+        Poly dense[6], sparse[6];
+
+        for (unsigned i = 0; i < 6; i++)
+        {
+            dense[i] = dense_test_poly(20 + 3 * i, 7 * i + 3, i);
+
+            Mono m[8];
+            for (unsigned j = 0; j < 8; j++)
+            {
+                Poly c = dense_test_poly(j % 3 + 1, i + 1, j);
+                m[j] = MonoFromPoly(&c, (j * j * 5 + i * 3) % 41);
+            }
+            sparse[i] = PolyAddMonos(8, m);
+            if (i % 3 == 2)
+            {
+                Poly t = PolyToTree(&sparse[i]);
+                PolyDestroy(&sparse[i]);
+                sparse[i] = t;
+            }
+        }
+
+        check_mul_all(6, dense, &b);
+        check_mul_all(6, sparse, &b);
+        check_mul_all(3, dense + 1, &b);
+        check_mul_all(1, sparse, &b);
+        check_mul_all(0, sparse, &b);
+
+        Poly zero = PolyZero(), mixed[] = {dense[0], zero, sparse[1]};
+        Poly res = PolyMulAll(3, mixed);
+        assert_true(PolyIsZero(&res));
+        PolyDestroy(&res);
+
+        for (unsigned i = 0; i < 6; i++)
+        {
+            PolyDestroy(&dense[i]);
+            PolyDestroy(&sparse[i]);
+        }
+    }
+
+    PolyCoeffModSet(0);
+}
+
+/**
+ * Test poleceń `ADD_ALL` i `MUL_ALL`: zero i jeden czynników, niepoprawny
+ * parametr, za mało wielomianów na stosie, tryb szeregów i tryb leniwy.
+ */
+static void test_parse_add_mul_all(void **state) {
+    (void)state;
+
+    init_input_stream("(1,1)\n(2,0)\n(1,2)\nADD_ALL 3\nPRINT\nADD_ALL 0\n"
+                      "IS_ZERO\nPOP\n(1,1)+(1,0)\nCLONE\nMUL_ALL 3\nPRINT\n"
+                      "MUL_ALL 0\nPRINT\nADD_ALL\nMUL_ALL -1\nMUL_ALL 3\n"
+                      "SERIES 0 2\nMUL_ALL 2\nPRINT\nSERIES 0 -1\nLAZY\n"
+                      "(1,1)\nCLONE\n(3,0)\nADD_ALL 3\nPRINT\n");
+
+    assert_int_equal(mock_main(), 0);
+    assert_string_equal(printf_buffer, "(2,0)+(1,1)+(1,2)\n1\n"
+                        "(2,0)+(5,1)+(5,2)+(3,3)+(1,4)\n1\n"
+                        "(2,0)+(5,1)+(5,2)\n(3,0)+(2,1)\n");
+    assert_string_equal(fprintf_buffer, "ERROR 15 WRONG COUNT\n"
+                        "ERROR 16 WRONG COUNT\nERROR 17 STACK UNDERFLOW\n");
+}
+
+/**
+ * Sprawdza `PolyFma` i `PolyFmaTake` z sumą iloczynu.
+ * @param[in] p : wielomian
+ * @param[in] q : wielomian
+ * @param[in] r : wielomian
+ */
+static void check_fma(const Poly *p, const Poly *q, const Poly *r)
+{
+    Poly prod = PolyMul(p, q), expected = PolyAdd(&prod, r);
+    Poly res = PolyFma(p, q, r), own = PolyClone(r);
+
+    own = PolyFmaTake(p, q, &own);
+    assert_true(PolyIsEq(&res, &expected));
+    assert_true(PolyIsEq(&own, &expected));
+
+    PolyDestroy(&prod);
+    PolyDestroy(&expected);
+    PolyDestroy(&res);
+    PolyDestroy(&own);
+}
+
+/**
+ * Test mnożenia z dodawaniem: wielomiany o stałych współczynnikach,
+ * zagnieżdżone (także w reprezentacji rozproszonej), współczynniki,
+ * zera i składnik w drzewie, także modulo.
+ */
+static void test_fma(void **state)
+{
+    (void)state;
+
+    for (unsigned mod = 0; mod < 2; mod++)
+    {
+        PolyCoeffModSet(mod ? 998244353 : 0);
+
+        Poly a = dense_test_poly(40, 7, 3), b = dense_test_poly(25, 11, 5);
+        Poly c = dense_test_poly(90, 13, 1), k = PolyFromCoeff(5);
+        Poly zero = PolyZero();
+        Poly nested[3];
+
+        for (unsigned i = 0; i < 3; i++)
+        {
+            Mono m[12];
+            for (unsigned j = 0; j < 12; j++)
+            {
+                Poly d = dense_test_poly(j % 4 + 1, i + 2, j);
+                m[j] = MonoFromPoly(&d, (j * 7 + i) % 19);
+            }
+            nested[i] = PolyAddMonos(12, m);
+        }
+
+        check_fma(&a, &b, &c);
+        check_fma(&a, &b, &k);
+        check_fma(&k, &a, &c);
+        check_fma(&a, &b, &zero);
+        check_fma(&zero, &b, &c);
+        check_fma(&nested[0], &nested[1], &nested[2]);
+        check_fma(&nested[0], &a, &nested[2]);
+        check_fma(&a, &nested[1], &c);
+        check_fma(&nested[0], &nested[1], &k);
+        check_fma(&k, &nested[0], &nested[2]);
+
+        /* Składnik w drzewie: wynik też jest w drzewie, a drzewo, do którego
+           nikt inny się nie odwołuje, jest zmieniane w miejscu. */
+        Poly t = PolyToTree(&c), shared = PolyClone(&t);
+        Poly prod = PolyMul(&a, &b), expected = PolyAdd(&prod, &c);
+
+        check_fma(&a, &b, &t);
+        t = PolyFmaTake(&a, &b, &t);
+        assert_true(PolyIsTree(&t));
+        assert_true(PolyIsEq(&t, &expected));
+        assert_true(PolyIsEq(&shared, &c));
+
+        PolyDestroy(&t);
+        PolyDestroy(&shared);
+        PolyDestroy(&prod);
+        PolyDestroy(&expected);
+        PolyDestroy(&a);
+        PolyDestroy(&b);
+        PolyDestroy(&c);
+        for (unsigned i = 0; i < 3; i++)
+            PolyDestroy(&nested[i]);
+    }
+
+    PolyCoeffModSet(0);
+}
+
+/**
+ * Test polecenia `FMA`: zwykłe, z zerowym czynnikiem, za mało wielomianów
+ * na stosie i w trybie leniwym.
+ */
+static void test_parse_fma(void **state) {
+    (void)state;
+
+    init_input_stream("(1,1)\n(2,0)+(1,1)\n(1,1)\nFMA\nPRINT\n(1,0)\nFMA\n"
+                      "ZERO\nFMA\nPRINT\nLAZY\nCLONE\nCLONE\nFMA\nPRINT\n");
+
+    assert_int_equal(mock_main(), 0);
+    assert_string_equal(printf_buffer, "(3,1)+(1,2)\n(3,1)+(1,2)\n"
+                        "(3,1)+(10,2)+(6,3)+(1,4)\n");
+    assert_string_equal(fprintf_buffer, "ERROR 7 STACK UNDERFLOW\n");
+}
+
+/**
+ * Test akumulatora: długi ciąg składników różnych rozmiarów (jednomiany,
+ * współczynniki, wielomiany gęste, zagnieżdżone i w drzewie) daje tę samą
+ * sumę co kolejne dodawania, także modulo, a składniki znoszące się dają
+ * zero.
+ */
+static void test_acc(void **state)
+{
+    (void)state;
+
+    for (unsigned mod = 0; mod < 2; mod++)
+    {
+        PolyCoeffModSet(mod ? 998244353 : 0);
+
+        PolyAccumulator acc = PolyAccInit();
+        Poly expected = PolyZero();
+
+        for (unsigned i = 0; i < 300; i++)
+        {
+            Poly p;
+
+            if (i % 10 == 3)
+            {
+                p = dense_test_poly(i % 60 + 1, i, 3);
+            }
+            else if (i % 25 == 7)
+            {
+                Poly d = dense_test_poly(i % 5 + 1, 3, i);
+                Mono m = MonoFromPoly(&d, i % 11);
+                Poly q = PolyAddMonos(1, &m);
+
+                p = PolyToTree(&q);
+                PolyDestroy(&q);
+            }
+            else if (i % 4 == 1)
+            {
+                p = PolyFromCoeff((poly_coeff_t)(i % 9));
+            }
+            else
+            {
+                Poly c = PolyFromCoeff((poly_coeff_t)(i % 7 + 1));
+                Mono m = MonoFromPoly(&c, (poly_exp_t)((i * 37) % 500));
+
+                p = PolyAddMonos(1, &m);
+            }
+
+            Poly sum = PolyAdd(&expected, &p);
+
+            PolyDestroy(&expected);
+            expected = sum;
+            PolyAccPush(&acc, p);
+        }
+
+        Poly res = PolyAccFlush(&acc);
+
+        assert_true(PolyIsEq(&res, &expected));
+        assert_true(PolyAccIsEmpty(&acc));
+
+        Poly neg = PolyNeg(&res);
+
+        PolyAccPush(&acc, res);
+        PolyAccPush(&acc, neg);
+        assert_true(PolyAccIsEmpty(&acc));
+
+        res = PolyAccFlush(&acc);
+        assert_true(PolyIsZero(&res));
+
+        PolyAccPush(&acc, PolyClone(&expected));
+        PolyAccDestroy(&acc);
+        assert_true(PolyAccIsEmpty(&acc));
+
+        PolyDestroy(&expected);
+    }
+
+    PolyCoeffModSet(0);
+}
+
+/**
+ * Test poleceń `ACC_PUSH` i `ACC_FLUSH`: suma, pusty akumulator, za mało
+ * wielomianów na stosie oraz `MOD` i `SERIES` zmieniające sumę w
+ * akumulatorze.
+ */
+static void test_parse_acc(void **state) {
+    (void)state;
+
+    init_input_stream("(1,1)\nACC_PUSH\n(2,1)+(1,2)\nACC_PUSH\n3\nACC_PUSH\n"
+                      "ACC_FLUSH\nPRINT\nACC_FLUSH\nPRINT\nPOP\nPOP\n"
+                      "ACC_PUSH\n(5,0)+(1,1)\nACC_PUSH\nMOD 3\nACC_FLUSH\n"
+                      "PRINT\nMOD 0\n(1,0)+(1,1)+(1,2)\nACC_PUSH\n"
+                      "SERIES 0 1\nACC_FLUSH\nPRINT\nSERIES 0 -1\n");
+
+    assert_int_equal(mock_main(), 0);
+    assert_string_equal(printf_buffer, "(3,0)+(3,1)+(1,2)\n0\n"
+                        "(2,0)+(1,1)\n(1,0)+(1,1)\n");
+    assert_string_equal(fprintf_buffer, "ERROR 13 STACK UNDERFLOW\n");
+}
+
+/**
+ * Daje wyrazy wielomianu jako widoki jednomianów; współczynnik daje jeden
+ * wyraz o wykładniku 0.
+ * @param[in] p : wielomian bez drzewa
+ * @param[out] n : liczba wyrazów
+ * @return tablica jednomianów do zwolnienia przez `free`
+ */
+static Mono* test_terms(const Poly *p, unsigned *n)
+{
+    *n = PolyIsCoeff(p) ? 1 : ListLen(p->l);
+
+    Mono *res = malloc(*n * sizeof(Mono));
+    unsigned i = 0;
+
+    assert_true(res != NULL);
+    if (PolyIsCoeff(p))
+    {
+        res[0] = (Mono) {.p = *p, .exp = 0};
+        return res;
+    }
+
+    for (ListIter it = ListIterBegin(p->l); it.n != NULL; ListIterNext(&it))
+        res[i++] = (Mono) {.p = ListIterCoeff(&it), .exp = ListIterExp(&it)};
+
+    return res;
+}
+
+/**
+ * Mnoży wielomiany wyraz po wyrazie na wszystkich poziomach.
+ * @param[in] p : wielomian bez drzewa
+ * @param[in] q : wielomian bez drzewa
+ * @return `p * q`
+ */
+static Poly naive_mul(const Poly *p, const Poly *q)
+{
+    if (PolyIsCoeff(p) && PolyIsCoeff(q))
+        return PolyMul(p, q);
+
+    unsigned np, nq, k = 0;
+    Mono *x = test_terms(p, &np), *y = test_terms(q, &nq);
+    Mono *monos = malloc(np * nq * sizeof(Mono));
+
+    assert_true(monos != NULL);
+    for (unsigned i = 0; i < np; i++)
+    {
+        for (unsigned j = 0; j < nq; j++)
+        {
+            monos[k++] = (Mono) {.p = naive_mul(&x[i].p, &y[j].p),
+                                 .exp = x[i].exp + y[j].exp};
+        }
+    }
+
+    Poly res = PolyAddMonos(np * nq, monos);
+
+    free(monos);
+    free(x);
+    free(y);
+
+    return res;
+}
+
+/**
+ * Sprawdza iloczyn `PolyMul` z iloczynem liczonym wyraz po wyrazie, w obu
+ * kolejnościach czynników.
+ * @param[in] p : wielomian
+ * @param[in] q : wielomian
+ */
+static void check_mul_short(const Poly *p, const Poly *q)
+{
+    Poly expected = naive_mul(p, q);
+    Poly pq = PolyMul(p, q), qp = PolyMul(q, p);
+
+    assert_true(PolyIsEq(&pq, &expected));
+    assert_true(PolyIsEq(&qp, &expected));
+
+    PolyDestroy(&expected);
+    PolyDestroy(&pq);
+    PolyDestroy(&qp);
+}
+
+/**
+ * Tworzy wielomian o wyrazach @f$c_i x_0^{e_i}@f$, przejmując
+ * współczynniki na własność.
+ * @param[in] n : liczba wyrazów
+ * @param[in] c : współczynniki
+ * @param[in] e : wykładniki
+ * @return wielomian
+ */
+static Poly terms_test_poly(unsigned n, Poly c[], const poly_exp_t e[])
+{
+    Mono monos[8];
+
+    assert_true(n <= 8);
+    for (unsigned i = 0; i < n; i++)
+        monos[i] = MonoFromPoly(&c[i], e[i]);
+
+    return PolyAddMonos(n, monos);
+}
+
+/**
+ * Test mnożenia przez krótkie czynniki: jednomiany o stałych i
+ * zagnieżdżonych współczynnikach, dwumiany i czteromiany razy wielomiany
+ * gęste, rzadkie i zagnieżdżone, także modulo liczba złożona, gdy
+ * iloczyny współczynników się zerują.
+ */
+static void test_mul_short(void **state)
+{
+    (void)state;
+
+    for (unsigned mod = 0; mod < 2; mod++)
+    {
+        poly_exp_t e[] = {0, 3, 4, 90, 91, 200};
+        Poly c[6];
+
+        for (unsigned i = 0; i < 6; i++)
+            c[i] = PolyFromCoeff(i % 3 == 2 ? 4 : 3);
+        Poly sparse = terms_test_poly(6, c, e);
+
+        c[0] = PolyFromCoeff(3);
+        Poly mono = terms_test_poly(1, c, &e[3]);
+        c[0] = PolyFromCoeff(1);
+        Poly shift = terms_test_poly(1, c, &e[1]);
+        c[0] = PolyFromCoeff(-1);
+        c[1] = PolyFromCoeff(4);
+        Poly binom = terms_test_poly(2, c, e);
+        c[0] = PolyClone(&binom);
+        Poly nested_mono = terms_test_poly(1, c, &e[2]);
+        for (unsigned i = 0; i < 4; i++)
+            c[i] = i % 2 ? PolyClone(&sparse) : PolyFromCoeff(i + 1);
+        Poly quad = terms_test_poly(4, c, &e[1]);
+        for (unsigned i = 0; i < 5; i++)
+            c[i] = i % 2 ? PolyClone(&binom) : dense_test_poly(i + 9, 5, i);
+        Poly nested = terms_test_poly(5, c, e);
+        Poly dense = dense_test_poly(100, 7, 1);
+
+        Poly shorts[] = {mono, shift, binom, nested_mono, quad};
+        Poly longs[] = {sparse, dense, nested};
+
+        PolyCoeffModSet(mod ? 12 : 0);
+        for (unsigned i = 0; i < 8; i++)
+        {
+            Poly *x = i < 5 ? &shorts[i] : &longs[i - 5];
+            Poly r = PolyCoeffReduce(x);
+
+            PolyDestroy(x);
+            *x = r;
+        }
+
+        for (unsigned i = 0; i < 5; i++)
+        {
+            for (unsigned j = 0; j < 3; j++)
+                check_mul_short(&shorts[i], &longs[j]);
+            for (unsigned j = 0; j < 5; j++)
+                check_mul_short(&shorts[i], &shorts[j]);
+        }
+
+        for (unsigned i = 0; i < 5; i++)
+            PolyDestroy(&shorts[i]);
+        for (unsigned i = 0; i < 3; i++)
+            PolyDestroy(&longs[i]);
+        PolyCoeffModSet(0);
+    }
+}
+
+/**
+ * Test polecenia `MUL` z krótkimi czynnikami: jednomian, dwumian i
+ * jednomian o zagnieżdżonym współczynniku.
+ */
+static void test_parse_mul_short(void **state) {
+    (void)state;
+
+    init_input_stream("(1,0)+(2,1)+(3,5)\n(2,3)\nMUL\nPRINT\n(1,0)+(-1,1)\n"
+                      "MUL\nPRINT\n((1,1),2)\nMUL\nPRINT\n");
+
+    assert_int_equal(mock_main(), 0);
+    assert_string_equal(printf_buffer, "(2,3)+(4,4)+(6,8)\n"
+                        "(2,3)+(2,4)+(-4,5)+(6,8)+(-6,9)\n"
+                        "((2,1),5)+((2,1),6)+((-4,1),7)+((6,1),10)"
+                        "+((-6,1),11)\n");
+    assert_string_equal(fprintf_buffer, "");
+}
+
+/**
+ * Uruchamia grupy testów jednostkowych.
+ */
+int main(void)
+{
+    const struct CMUnitTest tests_poly_compose[] = {
+        cmocka_unit_test(test_poly_zero_count_zero),
+        cmocka_unit_test(test_poly_zero_count_one_poly_const),
+        cmocka_unit_test(test_poly_const_count_zero),
+        cmocka_unit_test(test_poly_const_count_one_poly_diff_const),
+        cmocka_unit_test(test_poly_count_zero),
+        cmocka_unit_test(test_poly_count_one_poly_const),
+        cmocka_unit_test(test_poly_count_one_poly)
+    };
+
+
+    const struct CMUnitTest tests_parse_poly_compose[] = {
+        cmocka_unit_test_setup(test_parse_empty, test_setup),
+        cmocka_unit_test_setup(test_parse_min, test_setup),
+        cmocka_unit_test_setup(test_parse_max, test_setup),
+        cmocka_unit_test_setup(test_parse_under_min, test_setup),
+        cmocka_unit_test_setup(test_parse_over_max, test_setup),
+        cmocka_unit_test_setup(test_parse_very_big, test_setup),
+        cmocka_unit_test_setup(test_parse_letters, test_setup),
+        cmocka_unit_test_setup(test_parse_digits_letters, test_setup),
+        cmocka_unit_test_setup(test_parse_long_sum, test_setup),
+#if POLY_COEFF_BITS == 32
+        cmocka_unit_test_setup(test_parse_coeff_wrap, test_setup),
+#endif
+        cmocka_unit_test_setup(test_parse_mod, test_setup)
+    };
+
+    const struct CMUnitTest tests_kernels[] = {
+        cmocka_unit_test(test_kernel_neg_scale),
+        cmocka_unit_test(test_kernel_add),
+        cmocka_unit_test(test_kernel_compact),
+        cmocka_unit_test(test_kernel_leaf),
+        cmocka_unit_test(test_coeff_overflow),
+        cmocka_unit_test(test_coeff_mod)
+    };
+
+    const struct CMUnitTest tests_dense[] = {
+        cmocka_unit_test(test_dense_block),
+        cmocka_unit_test(test_dense_add_split),
+        cmocka_unit_test(test_dense_mixed),
+        cmocka_unit_test(test_leaf_mul),
+        cmocka_unit_test(test_dense_karatsuba)
+    };
+
+    const struct CMUnitTest tests_merge[] = {
+        cmocka_unit_test(test_merge),
+        cmocka_unit_test(test_merge_parallel)
+    };
+
+    const struct CMUnitTest tests_dist[] = {
+        cmocka_unit_test(test_dist_round_trip),
+        cmocka_unit_test(test_dist_mul),
+        cmocka_unit_test(test_dist_mul_words)
+    };
+
+    const struct CMUnitTest tests_intern[] = {
+        cmocka_unit_test(test_intern),
+        cmocka_unit_test_setup(test_parse_intern, test_setup)
+    };
+
+    const struct CMUnitTest tests_tree[] = {
+        cmocka_unit_test(test_tree),
+        cmocka_unit_test_setup(test_parse_tree, test_setup)
+    };
+
+    const struct CMUnitTest tests_reorder[] = {
+        cmocka_unit_test(test_reorder),
+        cmocka_unit_test_setup(test_parse_reorder, test_setup)
+    };
+
+    const struct CMUnitTest tests_sqr[] = {
+        cmocka_unit_test(test_sqr),
+        cmocka_unit_test_setup(test_parse_sqr, test_setup)
+    };
+
+    const struct CMUnitTest tests_pow[] = {
+        cmocka_unit_test(test_pow),
+        cmocka_unit_test_setup(test_parse_pow, test_setup)
+    };
+
+    const struct CMUnitTest tests_series[] = {
+        cmocka_unit_test(test_series),
+        cmocka_unit_test_setup(test_parse_series, test_setup),
+        cmocka_unit_test_setup(test_parse_series_reorder, test_setup)
+    };
+
+    const struct CMUnitTest tests_div[] = {
+        cmocka_unit_test(test_div),
+        cmocka_unit_test_setup(test_parse_div, test_setup)
+    };
+
+    const struct CMUnitTest tests_gcd[] = {
+        cmocka_unit_test(test_gcd),
+        cmocka_unit_test(test_gcd_intern),
+        cmocka_unit_test_setup(test_parse_gcd, test_setup)
+    };
+
+    const struct CMUnitTest tests_is_eq_fast[] = {
+        cmocka_unit_test(test_is_eq_fast),
+        cmocka_unit_test_setup(test_parse_is_eq_fast, test_setup)
+    };
+
+    const struct CMUnitTest tests_lazy[] = {
+        cmocka_unit_test(test_add_all),
+        cmocka_unit_test_setup(test_parse_lazy, test_setup)
+    };
+
+    const struct CMUnitTest tests_all[] = {
+        cmocka_unit_test(test_mul_all),
+        cmocka_unit_test_setup(test_parse_add_mul_all, test_setup)
+    };
+
+    const struct CMUnitTest tests_fma[] = {
+        cmocka_unit_test(test_fma),
+        cmocka_unit_test_setup(test_parse_fma, test_setup)
+    };
+
+    const struct CMUnitTest tests_acc[] = {
+        cmocka_unit_test(test_acc),
+        cmocka_unit_test_setup(test_parse_acc, test_setup)
+    };
+
+    const struct CMUnitTest tests_mul_short[] = {
+        cmocka_unit_test(test_mul_short),
+        cmocka_unit_test_setup(test_parse_mul_short, test_setup)
     };
 
     int res = cmocka_run_group_tests(tests_poly_compose, NULL, NULL);
     res |= cmocka_run_group_tests(tests_parse_poly_compose, NULL, NULL);
+    res |= cmocka_run_group_tests(tests_kernels, NULL, NULL);
+    res |= cmocka_run_group_tests(tests_dense, NULL, NULL);
+    res |= cmocka_run_group_tests(tests_merge, NULL, NULL);
+    res |= cmocka_run_group_tests(tests_dist, NULL, NULL);
+    res |= cmocka_run_group_tests(tests_intern, NULL, NULL);
+    res |= cmocka_run_group_tests(tests_tree, NULL, NULL);
+    res |= cmocka_run_group_tests(tests_reorder, NULL, NULL);
+    res |= cmocka_run_group_tests(tests_sqr, NULL, NULL);
+    res |= cmocka_run_group_tests(tests_pow, NULL, NULL);
+    res |= cmocka_run_group_tests(tests_series, NULL, NULL);
+    res |= cmocka_run_group_tests(tests_div, NULL, NULL);
+    res |= cmocka_run_group_tests(tests_gcd, NULL, NULL);
+    res |= cmocka_run_group_tests(tests_is_eq_fast, NULL, NULL);
+    res |= cmocka_run_group_tests(tests_lazy, NULL, NULL);
+    res |= cmocka_run_group_tests(tests_all, NULL, NULL);
+    res |= cmocka_run_group_tests(tests_fma, NULL, NULL);
+    res |= cmocka_run_group_tests(tests_acc, NULL, NULL);
+    res |= cmocka_run_group_tests(tests_mul_short, NULL, NULL);
 
     return res;
 }